@@ -16,12 +16,32 @@ MY_HEADERS  = $$SRC_DIR/qtdefs.h \
               $$SRC_DIR/Camera.h \
               $$SRC_DIR/ControlMesh.h \
               $$SRC_DIR/DoubleEdit.h \
+              $$SRC_DIR/EigenContinuation.h \
+              $$SRC_DIR/EigenUtils.h \
+              $$SRC_DIR/FEAssembler.h \
+              $$SRC_DIR/ForcedResponse.h \
               $$SRC_DIR/GLShader.h \
               $$SRC_DIR/HoleListModel.h \
+              $$SRC_DIR/KrylovSweep.h \
+              $$SRC_DIR/LivePreview.h \
+              $$SRC_DIR/LOBPCGSolver.h \
+              $$SRC_DIR/Mesher.h \
+              $$SRC_DIR/ModalSynth.h \
+              $$SRC_DIR/Multigrid.h \
               $$SRC_DIR/PointListModel.h \
+              $$SRC_DIR/Preconditioner.h \
+              $$SRC_DIR/ReducedModel.h \
               $$SRC_DIR/SegmentListModel.h \
+              $$SRC_DIR/ShapePerturbation.h \
+              $$SRC_DIR/SizeField.h \
+              $$SRC_DIR/ShiftInvertLanczos.h \
+              $$SRC_DIR/SkylineLDLT.h \
+              $$SRC_DIR/SolvePlanner.h \
+              $$SRC_DIR/SparseMatrix.h \
+              $$SRC_DIR/SpectrumSlicer.h \
               $$SRC_DIR/SystemData.h \
               $$SRC_DIR/SystemView.h \
+              $$SRC_DIR/TransientSolver.h \
               $$SRC_DIR/triangle.h \
               $$SRC_DIR/ScriptEditor.h \
               $$SRC_DIR/SyntaxHighlighter.h
@@ -32,12 +52,30 @@ MY_SOURCES  = $$SRC_DIR/MainWindow.cpp \
               $$SRC_DIR/Camera.cpp \
               $$SRC_DIR/ControlMesh.cpp \
               $$SRC_DIR/DoubleEdit.cpp \
+              $$SRC_DIR/EigenContinuation.cpp \
+              $$SRC_DIR/EigenUtils.cpp \
+              $$SRC_DIR/FEAssembler.cpp \
+              $$SRC_DIR/ForcedResponse.cpp \
               $$SRC_DIR/GLShader.cpp \
               $$SRC_DIR/HoleListModel.cpp \
+              $$SRC_DIR/KrylovSweep.cpp \
+              $$SRC_DIR/LivePreview.cpp \
+              $$SRC_DIR/LOBPCGSolver.cpp \
+              $$SRC_DIR/Mesher.cpp \
+              $$SRC_DIR/ModalSynth.cpp \
+              $$SRC_DIR/Multigrid.cpp \
               $$SRC_DIR/PointListModel.cpp \
+              $$SRC_DIR/ReducedModel.cpp \
               $$SRC_DIR/SegmentListModel.cpp \
+              $$SRC_DIR/ShapePerturbation.cpp \
+              $$SRC_DIR/SizeField.cpp \
+              $$SRC_DIR/ShiftInvertLanczos.cpp \
+              $$SRC_DIR/SolvePlanner.cpp \
+              $$SRC_DIR/SparseMatrix.cpp \
+              $$SRC_DIR/SpectrumSlicer.cpp \
               $$SRC_DIR/SystemData.cpp \
               $$SRC_DIR/SystemView.cpp \
+              $$SRC_DIR/TransientSolver.cpp \
               $$SRC_DIR/triangle.c \
               $$SRC_DIR/ScriptEditor.cpp \
               $$SRC_DIR/SyntaxHighlighter.cpp
@@ -77,7 +115,12 @@ CONFIG   += console warn_on
 QT       += core gui opengl script
 TEMPLATE  = app
 
-DEFINES  += TRILIBRARY ANSI_DECLARATORS # REDUCED
+DEFINES  += TRILIBRARY ANSI_DECLARATORS EXTERNAL_TEST # REDUCED
+
+USE_AUDIO {
+    QT      += multimedia
+    DEFINES += HAVE_AUDIO
+}
 
 
 ######################################################################  intermediate moc and object files
@@ -20,6 +20,13 @@ LAPACK_DIR  = $$PWD/lapack
 
 #########################
 
+#######  AUDIO  #######
+# play struck plates through QtMultimedia (SoundStrike); SoundSave works without
+
+#CONFIG += USE_AUDIO
+
+#########################
+
 ### You should not need to modify the following stuff...
 
 include( numchladni.pri )
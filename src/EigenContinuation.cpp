@@ -0,0 +1,202 @@
+/**
+    @file   EigenContinuation.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+#include "EigenContinuation.h"
+#include "LOBPCGSolver.h"
+
+static const double trackMin    = 0.6;    // smallest overlap of an unambiguous assignment
+static const int    maxHalvings = 4;      // step halvings per requested step
+static const double degenerate  = 1e-6;   // relative gap below which two eigenvalues are equal
+
+EigenContinuation::EigenContinuation( const SparseMatrix &K0, const SparseMatrix &B, const SparseMatrix &M )
+    : m_K0(K0), m_B(B), m_M(M) {
+    m_numThreads = 0;
+    m_numModes = 0;
+    m_numSolve = 0;
+    m_numAmbiguous = 0;
+}
+
+EigenContinuation::~EigenContinuation() {
+}
+
+// ********************************** public methods *****************************
+
+void EigenContinuation::SetNumThreads( int num ) {
+    m_numThreads = std::max(0,num);
+}
+
+
+bool EigenContinuation::Trace( const std::vector<double> &kappa, int numModes ) {
+    m_kappa.clear();
+    m_lambda.clear();
+    m_numAmbiguous = 0;
+    int n = m_K0.Size();
+    m_numModes = std::min(numModes,n);
+    m_numSolve = std::min(n,m_numModes + std::max(2,m_numModes/4));
+    if (kappa.empty() || m_numModes<=0) {
+        return true;
+    }
+
+    if (!solve(kappa[0],std::vector<double>(),m_numSolve,m_currLambda,m_currX)) {
+        return false;
+    }
+    m_kappa.push_back(kappa[0]);
+    m_lambda.insert(m_lambda.end(),m_currLambda.begin(),m_currLambda.begin()+m_numModes);
+
+    double k = kappa[0];
+    std::vector<double> Xp, lambda, X, Y;
+    std::vector<int> perm;
+    for(size_t i=1; i<kappa.size(); i++) {
+        while (k<kappa[i]) {
+            double dk = kappa[i] - k;
+            for(int h=0; ; h++) {
+                predict(dk,Xp);
+                if (!solve(k+dk,Xp,m_numSolve,lambda,X)) {
+                    return false;
+                }
+                double overlap = assign(Xp,X,m_numSolve,perm);
+                if (overlap>=trackMin) {
+                    break;
+                }
+                if (h==maxHalvings) {
+                    fprintf(stderr,"Continuation: ambiguous mode assignment at kappa=%g (overlap %.3f).\n",k+dk,overlap);
+                    m_numAmbiguous++;
+                    break;
+                }
+                dk *= 0.5;
+            }
+            k += dk;
+
+            // curve order
+            Y.resize(X.size());
+            for(int c=0; c<m_numSolve; c++) {
+                m_currLambda[c] = lambda[perm[c]];
+                std::copy(X.begin()+static_cast<size_t>(perm[c])*n,X.begin()+static_cast<size_t>(perm[c]+1)*n,
+                          Y.begin()+static_cast<size_t>(c)*n);
+            }
+            m_currX.swap(Y);
+            m_kappa.push_back(k);
+            m_lambda.insert(m_lambda.end(),m_currLambda.begin(),m_currLambda.begin()+m_numModes);
+        }
+    }
+    return true;
+}
+
+// ********************************* protected methods *****************************
+
+bool EigenContinuation::solve( double kappa, const std::vector<double> &X0, int num,
+                               std::vector<double> &lambda, std::vector<double> &X ) {
+    SparseMatrix K = m_K0;
+    for(size_t k=0; k<K.m_values.size(); k++) {
+        K.m_values[k] += kappa*m_B.m_values[k];
+    }
+
+    LOBPCGSolver solver(K,m_M);
+    solver.SetNumThreads(m_numThreads);
+    if (!X0.empty()) {
+        solver.SetInitialVectors(&X0[0],static_cast<int>(X0.size()/K.Size()));
+    }
+    if (!solver.Solve(num) && solver.NumFound()<num) {
+        fprintf(stderr,"Continuation: solve at kappa=%g failed.\n",kappa);
+        return false;
+    }
+    lambda = solver.Eigenvalues();
+    X = solver.Eigenvectors();
+    return true;
+}
+
+
+void EigenContinuation::predict( double dk, std::vector<double> &Xp ) {
+    int n = m_K0.Size();
+    int num = m_numSolve;
+    std::vector<double> BX(m_currX.size()), Mx(n);
+    for(int j=0; j<num; j++) {
+        m_B.Multiply(&m_currX[static_cast<size_t>(j)*n],&BX[static_cast<size_t>(j)*n]);
+    }
+
+    Xp = m_currX;
+    for(int j=0; j<num; j++) {
+        double lj = m_currLambda[j];
+        double* xp = &Xp[static_cast<size_t>(j)*n];
+        for(int m=0; m<num; m++) {
+            double gap = lj - m_currLambda[m];
+            if (m==j || std::fabs(gap)<=degenerate*std::max(std::fabs(lj),1.0)) {
+                continue;
+            }
+            const double* xm = &m_currX[static_cast<size_t>(m)*n];
+            double b = vecDot(n,xm,&BX[static_cast<size_t>(j)*n]);
+            vecAxpy(n,dk*b/gap,xm,xp);
+        }
+        m_M.Multiply(xp,&Mx[0]);
+        double xMx = vecDot(n,xp,&Mx[0]);
+        if (xMx>0.0) {
+            vecScale(n,1.0/std::sqrt(xMx),xp);
+        }
+    }
+}
+
+
+double EigenContinuation::assign( const std::vector<double> &Xp, const std::vector<double> &X, int num,
+                                  std::vector<int> &perm ) {
+    int n = m_K0.Size();
+    int numNew = static_cast<int>(X.size()/n);
+    std::vector<double> MX(X.size()), O(static_cast<size_t>(num)*numNew);
+    for(int j=0; j<numNew; j++) {
+        m_M.Multiply(&X[static_cast<size_t>(j)*n],&MX[static_cast<size_t>(j)*n]);
+    }
+    for(int c=0; c<num; c++) {
+        for(int j=0; j<numNew; j++) {
+            O[static_cast<size_t>(c)*numNew+j] = std::fabs(vecDot(n,&Xp[static_cast<size_t>(c)*n],&MX[static_cast<size_t>(j)*n]));
+        }
+    }
+
+    // greedy: the largest remaining overlap first
+    perm.assign(num,-1);
+    std::vector<bool> taken(numNew,false);
+    double minOverlap = 1.0;
+    for(int a=0; a<num && a<numNew; a++) {
+        int bc = -1, bj = -1;
+        double best = -1.0;
+        for(int c=0; c<num; c++) {
+            if (perm[c]>=0) {
+                continue;
+            }
+            for(int j=0; j<numNew; j++) {
+                if (!taken[j] && O[static_cast<size_t>(c)*numNew+j]>best) {
+                    best = O[static_cast<size_t>(c)*numNew+j];
+                    bc = c;
+                    bj = j;
+                }
+            }
+        }
+        perm[bc] = bj;
+        taken[bj] = true;
+        // guard modes may enter or leave the window
+        if (bc<m_numModes) {
+            minOverlap = std::min(minOverlap,best);
+        }
+    }
+    return minOverlap;
+}
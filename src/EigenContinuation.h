@@ -0,0 +1,110 @@
+/**
+    @file   EigenContinuation.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_EIGEN_CONTINUATION_H
+#define NUMCHLADNI_EIGEN_CONTINUATION_H
+
+#include <vector>
+
+#include "SparseMatrix.h"
+
+/**
+ * @brief Eigenvalue curves of  (K0 + kappa*B) x = lambda M x  over kappa.
+ *
+ *   Starting from the lowest eigenpairs at the first parameter value,
+ *   every step predicts the eigenvectors at the next value to first
+ *   order, d x_n/d kappa = sum_{m!=n} x_m^T B x_n / (lambda_n - lambda_m) x_m,
+ *   and corrects them by LOBPCG started from the prediction. The new
+ *   eigenpairs are assigned to the curves by their M-overlap with the
+ *   prediction, so a curve follows its mode through crossings. If the
+ *   assignment is ambiguous, the step is halved.
+ *
+ *   Some guard modes above the traced ones are solved as well, so a
+ *   traced mode that is overtaken by a higher one is still found.
+ */
+class EigenContinuation
+{
+public:
+    EigenContinuation( const SparseMatrix &K0, const SparseMatrix &B, const SparseMatrix &M );
+    ~EigenContinuation();
+
+    // --------- public methods -----------
+public:
+    /** Number of worker threads of LOBPCG; 0 uses the number of cores.
+     */
+    void  SetNumThreads( int num );
+
+    /** Trace the numModes lowest eigenpairs of the first parameter value.
+     * \param kappa     ascending parameter values
+     * \param numModes  number of curves
+     * \return  false if a corrector failed; the curves reached so far are kept
+     */
+    bool  Trace( const std::vector<double> &kappa, int numModes );
+
+    int   NumModes() const  { return m_numModes; }
+
+    /** Parameter values reached, including inserted intermediate steps.
+     */
+    const std::vector<double>&  Parameters() const  { return m_kappa; }
+
+    /** Eigenvalues per parameter value, row-major with NumModes() columns;
+     *   column k is curve k.
+     */
+    const std::vector<double>&  Eigenvalues() const  { return m_lambda; }
+
+    /** Number of steps whose assignment stayed ambiguous at the smallest step.
+     */
+    int   NumAmbiguous() const  { return m_numAmbiguous; }
+
+protected:
+    /** Eigenpairs at kappa, started from X0 (may be empty).
+     */
+    bool  solve( double kappa, const std::vector<double> &X0, int num,
+                 std::vector<double> &lambda, std::vector<double> &X );
+
+    /** First-order prediction of the eigenvectors at kappa + dk.
+     */
+    void  predict( double dk, std::vector<double> &Xp );
+
+    /** Assign the new eigenpairs to the curves by M-overlap with Xp.
+     * \param perm  new index per curve
+     * \return  smallest overlap of an assigned pair
+     */
+    double  assign( const std::vector<double> &Xp, const std::vector<double> &X, int num,
+                    std::vector<int> &perm );
+
+    // -------- private attributes --------
+private:
+    const SparseMatrix&  m_K0;
+    const SparseMatrix&  m_B;
+    const SparseMatrix&  m_M;
+    int                  m_numThreads;
+    int                  m_numModes;
+    int                  m_numSolve;     //!< traced plus guard modes
+
+    std::vector<double>  m_kappa;
+    std::vector<double>  m_lambda;
+    std::vector<double>  m_currLambda;   //!< eigenvalues of the last step, curve order first
+    std::vector<double>  m_currX;        //!< eigenvectors of the last step, curve order first
+    int                  m_numAmbiguous;
+};
+
+#endif // NUMCHLADNI_EIGEN_CONTINUATION_H
@@ -0,0 +1,276 @@
+/**
+    @file   EigenUtils.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include "EigenUtils.h"
+
+static double pythag( double a, double b ) {
+    double absa = std::fabs(a);
+    double absb = std::fabs(b);
+    if (absa>absb) {
+        return absa*std::sqrt(1.0 + (absb/absa)*(absb/absa));
+    }
+    return (absb==0.0 ? 0.0 : absb*std::sqrt(1.0 + (absa/absb)*(absa/absb)));
+}
+
+
+bool TridiagonalEigen( int n, double* d, double* e, double* z ) {
+    if (z!=NULL) {
+        for(int c=0; c<n; c++) {
+            for(int r=0; r<n; r++) {
+                z[c*n+r] = (r==c ? 1.0 : 0.0);
+            }
+        }
+    }
+    if (n<=0) {
+        return true;
+    }
+    e[n-1] = 0.0;
+
+    const double eps = std::numeric_limits<double>::epsilon();
+    for(int l=0; l<n; l++) {
+        int iter = 0;
+        int m;
+        do {
+            for(m=l; m<n-1; m++) {
+                double dd = std::fabs(d[m]) + std::fabs(d[m+1]);
+                if (std::fabs(e[m])<=eps*dd) {
+                    break;
+                }
+            }
+            if (m!=l) {
+                if (iter++==60) {
+                    return false;
+                }
+                double g = (d[l+1]-d[l])/(2.0*e[l]);
+                double r = pythag(g,1.0);
+                g = d[m] - d[l] + e[l]/(g + (g>=0.0 ? std::fabs(r) : -std::fabs(r)));
+                double s = 1.0, c = 1.0, p = 0.0;
+                int i;
+                for(i=m-1; i>=l; i--) {
+                    double f = s*e[i];
+                    double b = c*e[i];
+                    e[i+1] = (r = pythag(f,g));
+                    if (r==0.0) {
+                        d[i+1] -= p;
+                        e[m] = 0.0;
+                        break;
+                    }
+                    s = f/r;
+                    c = g/r;
+                    g = d[i+1] - p;
+                    r = (d[i]-g)*s + 2.0*c*b;
+                    d[i+1] = g + (p = s*r);
+                    g = c*r - b;
+                    if (z!=NULL) {
+                        double* zi  = z + i*n;
+                        double* zi1 = z + (i+1)*n;
+                        for(int k=0; k<n; k++) {
+                            f = zi1[k];
+                            zi1[k] = s*zi[k] + c*f;
+                            zi[k]  = c*zi[k] - s*f;
+                        }
+                    }
+                }
+                if (r==0.0 && i>=l) {
+                    continue;
+                }
+                d[l] -= p;
+                e[l] = g;
+                e[m] = 0.0;
+            }
+        } while (m!=l);
+    }
+    return true;
+}
+
+
+void SortEigenpairs( int n, double* d, double* z, int ldz ) {
+    // selection sort, n is small
+    for(int i=0; i<n-1; i++) {
+        int k = i;
+        for(int j=i+1; j<n; j++) {
+            if (d[j]<d[k]) {
+                k = j;
+            }
+        }
+        if (k!=i) {
+            std::swap(d[i],d[k]);
+            if (z!=NULL) {
+                std::swap_ranges(z + i*ldz, z + (i+1)*ldz, z + k*ldz);
+            }
+        }
+    }
+}
+
+
+bool SymmetricEigen( int n, double* a, double* d, double* z ) {
+    for(int c=0; c<n; c++) {
+        for(int r=0; r<n; r++) {
+            z[c*n+r] = (r==c ? 1.0 : 0.0);
+        }
+    }
+
+    // cyclic Jacobi; accurate also for tiny eigenvalues, n is small
+    const double eps = std::numeric_limits<double>::epsilon();
+    bool converged = false;
+    for(int sweep=0; sweep<50 && !converged; sweep++) {
+        double off = 0.0, diag = 0.0;
+        for(int c=0; c<n; c++) {
+            diag += a[c*n+c]*a[c*n+c];
+            for(int r=c+1; r<n; r++) {
+                off += a[c*n+r]*a[c*n+r];
+            }
+        }
+        if (off<=eps*eps*diag || off==0.0) {
+            converged = true;
+            break;
+        }
+
+        for(int p=0; p<n-1; p++) {
+            for(int q=p+1; q<n; q++) {
+                double apq = a[q*n+p];
+                if (std::fabs(apq)<=eps*std::sqrt(std::fabs(a[p*n+p]*a[q*n+q])) || apq==0.0) {
+                    continue;
+                }
+                double theta = (a[q*n+q] - a[p*n+p])/(2.0*apq);
+                double t = 1.0/(std::fabs(theta) + std::sqrt(theta*theta + 1.0));
+                if (theta<0.0) {
+                    t = -t;
+                }
+                double c = 1.0/std::sqrt(t*t + 1.0);
+                double s = t*c;
+
+                for(int k=0; k<n; k++) {
+                    double akp = a[p*n+k];
+                    double akq = a[q*n+k];
+                    a[p*n+k] = c*akp - s*akq;
+                    a[q*n+k] = s*akp + c*akq;
+                }
+                for(int k=0; k<n; k++) {
+                    double apk = a[k*n+p];
+                    double aqk = a[k*n+q];
+                    a[k*n+p] = c*apk - s*aqk;
+                    a[k*n+q] = s*apk + c*aqk;
+                }
+                for(int k=0; k<n; k++) {
+                    double zkp = z[p*n+k];
+                    double zkq = z[q*n+k];
+                    z[p*n+k] = c*zkp - s*zkq;
+                    z[q*n+k] = s*zkp + c*zkq;
+                }
+            }
+        }
+    }
+
+    for(int k=0; k<n; k++) {
+        d[k] = a[k*n+k];
+    }
+    SortEigenpairs(n,d,z,n);
+    return converged;
+}
+
+
+bool CholeskyDecomp( int n, double* a ) {
+    double scale = 0.0;
+    for(int k=0; k<n; k++) {
+        scale = std::max(scale,std::fabs(a[k*n+k]));
+    }
+    for(int j=0; j<n; j++) {
+        double s = a[j*n+j];
+        for(int k=0; k<j; k++) {
+            s -= a[k*n+j]*a[k*n+j];
+        }
+        if (s<=1e-14*scale) {
+            return false;
+        }
+        double ljj = std::sqrt(s);
+        a[j*n+j] = ljj;
+        for(int i=j+1; i<n; i++) {
+            double t = a[j*n+i];
+            for(int k=0; k<j; k++) {
+                t -= a[k*n+i]*a[k*n+j];
+            }
+            a[j*n+i] = t/ljj;
+        }
+        for(int i=0; i<j; i++) {
+            a[j*n+i] = 0.0;
+        }
+    }
+    return true;
+}
+
+
+bool GeneralizedSymmetricEigen( int n, const double* a, const double* b, double* d, double* z ) {
+    std::vector<double> L(b,b+n*n);
+    if (!CholeskyDecomp(n,&L[0])) {
+        return false;
+    }
+
+    // C = L^{-1} A L^{-T}
+    std::vector<double> C(a,a+n*n);
+    for(int c=0; c<n; c++) {
+        double* col = &C[c*n];
+        for(int i=0; i<n; i++) {
+            double s = col[i];
+            for(int k=0; k<i; k++) {
+                s -= L[k*n+i]*col[k];
+            }
+            col[i] = s/L[i*n+i];
+        }
+    }
+    for(int r=0; r<n; r++) {
+        for(int i=0; i<n; i++) {
+            double s = C[i*n+r];
+            for(int k=0; k<i; k++) {
+                s -= L[k*n+i]*C[k*n+r];
+            }
+            C[i*n+r] = s/L[i*n+i];
+        }
+    }
+    for(int c=0; c<n; c++) {
+        for(int r=c+1; r<n; r++) {
+            double s = 0.5*(C[c*n+r] + C[r*n+c]);
+            C[c*n+r] = C[r*n+c] = s;
+        }
+    }
+
+    std::vector<double> y(n*n);
+    SymmetricEigen(n,&C[0],d,&y[0]);
+
+    // z = L^{-T} y
+    for(int c=0; c<n; c++) {
+        double* col = &y[c*n];
+        for(int i=n-1; i>=0; i--) {
+            double s = col[i];
+            for(int k=i+1; k<n; k++) {
+                s -= L[i*n+k]*col[k];
+            }
+            col[i] = s/L[i*n+i];
+        }
+    }
+    std::copy(y.begin(),y.end(),z);
+    return true;
+}
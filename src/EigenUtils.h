@@ -0,0 +1,70 @@
+/**
+    @file   EigenUtils.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_EIGEN_UTILS_H
+#define NUMCHLADNI_EIGEN_UTILS_H
+
+/**
+ *  Small dense eigenvalue helpers for the projected problems of the
+ *  iterative solvers. Matrices are stored column-major.
+ */
+
+/** Eigenvalues and eigenvectors of a symmetric tridiagonal matrix (QL with implicit shifts).
+ * \param n  matrix size
+ * \param d  diagonal (n), eigenvalues on output
+ * \param e  off-diagonal, e[i] = T(i,i+1) (n, last entry unused), destroyed
+ * \param z  eigenvectors (n x n, column-major) on output, may be NULL
+ * \return false if the iteration did not converge
+ */
+bool TridiagonalEigen( int n, double* d, double* e, double* z );
+
+/** Sort eigenvalues ascending together with their eigenvectors.
+ * \param n     number of eigenpairs
+ * \param d     eigenvalues
+ * \param z     eigenvectors (column k belongs to d[k]), may be NULL
+ * \param ldz   length of one eigenvector
+ */
+void SortEigenpairs( int n, double* d, double* z, int ldz );
+
+/** Eigenvalues and eigenvectors of a dense symmetric matrix (cyclic Jacobi).
+ * \param n  matrix size
+ * \param a  matrix (n x n), destroyed
+ * \param d  eigenvalues in ascending order (n)
+ * \param z  eigenvectors (n x n)
+ * \return false if the iteration did not converge
+ */
+bool SymmetricEigen( int n, double* a, double* d, double* z );
+
+/** Cholesky decomposition  A = L L^T  in place, L in the lower triangle.
+ * \return false if A is not (numerically) positive definite
+ */
+bool CholeskyDecomp( int n, double* a );
+
+/** Generalized symmetric-definite eigenproblem  A z = d B z.
+ * \param a  matrix A (n x n)
+ * \param b  positive definite matrix B (n x n)
+ * \param d  eigenvalues in ascending order (n)
+ * \param z  B-orthonormal eigenvectors (n x n)
+ * \return false if B is not (numerically) positive definite
+ */
+bool GeneralizedSymmetricEigen( int n, const double* a, const double* b, double* d, double* z );
+
+#endif // NUMCHLADNI_EIGEN_UTILS_H
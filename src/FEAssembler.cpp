@@ -0,0 +1,559 @@
+/**
+    @file   FEAssembler.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cassert>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+#include "FEAssembler.h"
+#include "SkylineLDLT.h"
+#include "qtdefs.h"
+
+// boundary mass matrices for linear and quadratic edges
+static const double S5l[] = { 1.0/3.0, 1.0/6.0,
+                              1.0/6.0, 1.0/3.0 };
+static const double S5q[] = { 2.0/15.0,  1.0/15.0, -1.0/30.0,
+                              1.0/15.0,  8.0/15.0,  1.0/15.0,
+                             -1.0/30.0,  1.0/15.0,  2.0/15.0 };
+
+/**
+ *  Factorize the Laplacian of the nodes which are not given.
+ */
+static bool factorLaplacian( const FEMesh &mesh, const std::vector<bool> &given,
+                             DofMap &dofs, SkylineLDLT<double> &ldlt ) {
+    FEMesh lap = mesh;
+    for(int i=0; i<lap.NumNodes(); i++) {
+        lap.bmarker[i] = (given[i] ? BOUNDARY_FIXED_MARKER : 0);
+    }
+    FEAssembler::BuildDofMap(lap,dofs);
+    if (dofs.NumDofs()==0) {
+        return false;
+    }
+    SparseMatrix K, M;
+    FEAssembler::Assemble(lap,dofs,FEOptions(),K,M);
+    ldlt.Analyze(K);
+    if (!ldlt.Factorize(K,M,1.0,0.0)) {
+        fprintf(stderr,"Harmonic extension: factorization failed.\n");
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ *  Gradients of the barycentric coordinates of element t and its area.
+ */
+static double barycentricGradients( const FEMesh &mesh, int t, glm::dvec2* g ) {
+    const int* idx = &mesh.elems[t*mesh.nodesPerElem];
+    const glm::dvec2 &v1 = mesh.pos[idx[0]];
+    const glm::dvec2 &v2 = mesh.pos[idx[1]];
+    const glm::dvec2 &v3 = mesh.pos[idx[2]];
+    double J = (v2.x-v1.x)*(v3.y-v1.y) - (v3.x-v1.x)*(v2.y-v1.y);
+    g[0] = glm::dvec2(v2.y-v3.y, v3.x-v2.x)/J;
+    g[1] = glm::dvec2(v3.y-v1.y, v1.x-v3.x)/J;
+    g[2] = glm::dvec2(v1.y-v2.y, v2.x-v1.x)/J;
+    return 0.5*std::fabs(J);
+}
+
+/**
+ *  Gradient of the finite element function with nodal values ue at the
+ *  point with barycentric coordinates l of an element.
+ */
+static glm::dvec2 elementGradient( int npe, const glm::dvec2* g, const double* ue, const double* l ) {
+    glm::dvec2 grad(0.0);
+    if (npe==3) {
+        for(int j=0; j<3; j++) {
+            grad += ue[j]*g[j];
+        }
+        return grad;
+    }
+    for(int j=0; j<3; j++) {
+        int k = (j+1)%3;
+        grad += ue[j]*(4.0*l[j] - 1.0)*g[j];
+        grad += ue[3+j]*4.0*(l[k]*g[j] + l[j]*g[k]);
+    }
+    return grad;
+}
+
+// ********************************** public methods *****************************
+
+void FEAssembler::BuildDofMap( const FEMesh &mesh, DofMap &dofs ) {
+    int numNodes = mesh.NumNodes();
+    dofs.nodeToDof.assign(numNodes,-1);
+    dofs.dofToNode.clear();
+    for(int i=0; i<numNodes; i++) {
+        if (mesh.bmarker[i]!=BOUNDARY_FIXED_MARKER) {
+            dofs.nodeToDof[i] = static_cast<int>(dofs.dofToNode.size());
+            dofs.dofToNode.push_back(i);
+        }
+    }
+}
+
+
+void FEAssembler::BuildPattern( const FEMesh &mesh, const DofMap &dofs, SparseMatrix &A ) {
+    int numDofs = dofs.NumDofs();
+    int npe = mesh.nodesPerElem;
+    std::vector< std::vector<int> > pattern(numDofs);
+    for(int t=0; t<mesh.NumElems(); t++) {
+        const int* idx = &mesh.elems[t*npe];
+        for(int j=0; j<npe; j++) {
+            int dj = dofs.nodeToDof[idx[j]];
+            if (dj<0) {
+                continue;
+            }
+            for(int k=0; k<npe; k++) {
+                int dk = dofs.nodeToDof[idx[k]];
+                if (dk>=0) {
+                    pattern[dj].push_back(dk);
+                }
+            }
+        }
+    }
+    A.SetPattern(numDofs,pattern);
+}
+
+
+void FEAssembler::Assemble( const FEMesh &mesh, const DofMap &dofs, const FEOptions &opts,
+                            SparseMatrix &K, SparseMatrix &M ) {
+    BuildPattern(mesh,dofs,K);
+    M.SetPatternFrom(K);
+
+    int npe = mesh.nodesPerElem;
+    double Se[36], Me[36];
+    for(int t=0; t<mesh.NumElems(); t++) {
+        ElementMatrices(mesh,t,Se,Me);
+        LumpElementMass(npe,opts.massType,Me);
+        if (opts.elastSupported) {
+            ElementBoundaryMatrix(mesh,t,opts.elastStiffness,Se);
+        }
+
+        const int* idx = &mesh.elems[t*npe];
+        for(int j=0; j<npe; j++) {
+            int dj = dofs.nodeToDof[idx[j]];
+            if (dj<0) {
+                continue;
+            }
+            for(int k=0; k<npe; k++) {
+                int dk = dofs.nodeToDof[idx[k]];
+                if (dk<0) {
+                    continue;
+                }
+                int pos = K.Find(dj,dk);
+                K.m_values[pos] += Se[j*npe+k];
+                M.m_values[pos] += Me[j*npe+k];
+            }
+        }
+    }
+}
+
+
+void FEAssembler::ElementMatrices( const FEMesh &mesh, int t, double* Se, double* Me ) {
+    int npe = mesh.nodesPerElem;
+    const int* idx = &mesh.elems[t*npe];
+    glm::dvec2 v1 = mesh.pos[idx[0]];
+    glm::dvec2 v2 = mesh.pos[idx[1]];
+    glm::dvec2 v3 = mesh.pos[idx[2]];
+
+    // see SystemData::calc_params
+    double J = (v2.x-v1.x)*(v3.y-v1.y) - (v3.x-v1.x)*(v2.y-v1.y);
+    assert(J!=0.0);
+    double edJ = 1.0/J;
+    double a =  ((v3.x-v1.x)*(v3.x-v1.x) + (v3.y-v1.y)*(v3.y-v1.y))*edJ;
+    double b = -((v3.x-v1.x)*(v2.x-v1.x) + (v3.y-v1.y)*(v2.y-v1.y))*edJ;
+    double c =  ((v2.x-v1.x)*(v2.x-v1.x) + (v2.y-v1.y)*(v2.y-v1.y))*edJ;
+
+    const double *ms1, *ms2, *ms3, *ms4, *fac;
+    if (npe==3) {
+        ms1 = ms1_lin;   ms2 = ms2_lin;   ms3 = ms3_lin;   ms4 = ms4_lin;   fac = fac_lin;
+    } else {
+        ms1 = ms1_quad;  ms2 = ms2_quad;  ms3 = ms3_quad;  ms4 = ms4_quad;  fac = fac_quad;
+    }
+
+    for(int pos=0; pos<npe*npe; pos++) {
+        Se[pos] = a*fac[0]*ms1[pos] + b*fac[1]*ms2[pos] + c*fac[2]*ms3[pos];
+        Me[pos] = J*fac[3]*ms4[pos];
+    }
+}
+
+
+void FEAssembler::LumpElementMass( int npe, e_massType type, double* Me ) {
+    if (type==e_mass_consistent) {
+        return;
+    }
+
+    double total = 0.0;
+    double trace = 0.0;
+    double diag[6];
+    for(int j=0; j<npe; j++) {
+        double rowSum = 0.0;
+        for(int k=0; k<npe; k++) {
+            rowSum += Me[j*npe+k];
+        }
+        total += rowSum;
+        trace += Me[j*npe+j];
+        diag[j] = rowSum;
+    }
+
+    if (type==e_mass_hrz || npe==6) {
+        for(int j=0; j<npe; j++) {
+            diag[j] = Me[j*npe+j]*total/trace;
+        }
+    }
+
+    for(int j=0; j<npe; j++) {
+        for(int k=0; k<npe; k++) {
+            Me[j*npe+k] = (j==k ? diag[j] : 0.0);
+        }
+    }
+}
+
+
+void FEAssembler::LumpedMass( const FEMesh &mesh, const DofMap &dofs, std::vector<double> &diag ) {
+    int npe = mesh.nodesPerElem;
+    double Se[36], Me[36];
+    diag.assign(dofs.NumDofs(),0.0);
+    for(int t=0; t<mesh.NumElems(); t++) {
+        ElementMatrices(mesh,t,Se,Me);
+        LumpElementMass(npe,e_mass_hrz,Me);
+        const int* idx = &mesh.elems[t*npe];
+        for(int j=0; j<npe; j++) {
+            int dj = dofs.nodeToDof[idx[j]];
+            if (dj>=0) {
+                diag[dj] += Me[j*npe+j];
+            }
+        }
+    }
+}
+
+
+void FEAssembler::ElementBoundaryMatrix( const FEMesh &mesh, int t, double scale, double* Se ) {
+    int npe = mesh.nodesPerElem;
+    const int* idx = &mesh.elems[t*npe];
+
+    if (npe==3) {
+        static const int edges[3][2] = { {0,1}, {1,2}, {2,0} };
+        for(int e=0; e<3; e++) {
+            int i0 = idx[edges[e][0]];
+            int i1 = idx[edges[e][1]];
+            if (mesh.bmarker[i0]==1 && mesh.bmarker[i1]==1) {
+                double l = glm::length(mesh.pos[i1]-mesh.pos[i0]);
+                for(int y=0; y<2; y++) {
+                    for(int x=0; x<2; x++) {
+                        Se[edges[e][y]*npe + edges[e][x]] += scale*l*S5l[y*2+x];
+                    }
+                }
+            }
+        }
+    } else {
+        static const int edges[3][3] = { {0,3,1}, {1,4,2}, {2,5,0} };
+        for(int e=0; e<3; e++) {
+            int i0 = idx[edges[e][0]];
+            int im = idx[edges[e][1]];
+            int i1 = idx[edges[e][2]];
+            if (mesh.bmarker[i0]==1 && mesh.bmarker[i1]==1 && mesh.bmarker[im]==1) {
+                double l = glm::length(mesh.pos[i1]-mesh.pos[i0]);
+                for(int y=0; y<3; y++) {
+                    for(int x=0; x<3; x++) {
+                        Se[edges[e][y]*npe + edges[e][x]] += scale*l*S5q[y*3+x];
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void FEAssembler::EstimateError( const FEMesh &mesh, const DofMap &dofs, const FEOptions &opts,
+                                 const double* u, double lambda, std::vector<double> &eta2 ) {
+    int npe = mesh.nodesPerElem;
+    int numElems = mesh.NumElems();
+    double deg = (npe==6 ? 2.0 : 1.0);
+    eta2.assign(numElems,0.0);
+
+    // element residuals; the local edge e joins corners e and e+1
+    std::vector< std::pair<long long,int> > edges(3*static_cast<size_t>(numElems));
+    std::vector<double> ue(static_cast<size_t>(numElems)*npe);
+    for(int t=0; t<numElems; t++) {
+        const int* idx = &mesh.elems[t*npe];
+        double* uet = &ue[static_cast<size_t>(t)*npe];
+        for(int j=0; j<npe; j++) {
+            int d = dofs.nodeToDof[idx[j]];
+            uet[j] = (d>=0 ? u[d] : 0.0);
+        }
+
+        glm::dvec2 g[3];
+        double area = barycentricGradients(mesh,t,g);
+        double lap = 0.0;
+        if (npe==6) {
+            for(int j=0; j<3; j++) {
+                lap += uet[j]*4.0*glm::dot(g[j],g[j]) + uet[3+j]*8.0*glm::dot(g[j],g[(j+1)%3]);
+            }
+        }
+        // edge midpoint rule
+        double res = 0.0;
+        for(int j=0; j<3; j++) {
+            double um = (npe==6 ? uet[3+j] : 0.5*(uet[j] + uet[(j+1)%3]));
+            double r = lambda*um + lap;
+            res += r*r;
+        }
+        double h = std::max(glm::length(mesh.pos[idx[1]]-mesh.pos[idx[0]]),
+                   std::max(glm::length(mesh.pos[idx[2]]-mesh.pos[idx[1]]),
+                            glm::length(mesh.pos[idx[0]]-mesh.pos[idx[2]])));
+        eta2[t] = h*h*res*area/(3.0*deg*deg);
+
+        for(int e=0; e<3; e++) {
+            long long a = idx[e], b = idx[(e+1)%3];
+            edges[3*t+e] = std::make_pair(std::min(a,b)*mesh.NumNodes() + std::max(a,b),3*t+e);
+        }
+    }
+    std::sort(edges.begin(),edges.end());
+
+    // barycentric coordinates of the start, mid, and end point of local edge e
+    static const double lq[3][3][3] = {
+        { {1.0,0.0,0.0}, {0.5,0.5,0.0}, {0.0,1.0,0.0} },
+        { {0.0,1.0,0.0}, {0.0,0.5,0.5}, {0.0,0.0,1.0} },
+        { {0.0,0.0,1.0}, {0.5,0.0,0.5}, {1.0,0.0,0.0} } };
+
+    size_t k = 0;
+    while (k<edges.size()) {
+        bool interior = (k+1<edges.size() && edges[k+1].first==edges[k].first);
+        int t0 = edges[k].second/3, e0 = edges[k].second%3;
+        const int* idx0 = &mesh.elems[t0*npe];
+        glm::dvec2 p0 = mesh.pos[idx0[e0]];
+        glm::dvec2 p1 = mesh.pos[idx0[(e0+1)%3]];
+        double len = glm::length(p1-p0);
+        glm::dvec2 n = glm::dvec2(p1.y-p0.y, p0.x-p1.x)/len;    // outward for element t0
+
+        glm::dvec2 g0[3];
+        barycentricGradients(mesh,t0,g0);
+        const double* ue0 = &ue[static_cast<size_t>(t0)*npe];
+        double jump[3];
+        for(int q=0; q<3; q++) {
+            jump[q] = glm::dot(elementGradient(npe,g0,ue0,lq[e0][q]),n);
+        }
+
+        if (interior) {
+            int t1 = edges[k+1].second/3, e1 = edges[k+1].second%3;
+            glm::dvec2 g1[3];
+            barycentricGradients(mesh,t1,g1);
+            const double* ue1 = &ue[static_cast<size_t>(t1)*npe];
+            // the edge runs the other way round in t1
+            for(int q=0; q<3; q++) {
+                jump[q] -= glm::dot(elementGradient(npe,g1,ue1,lq[e1][2-q]),n);
+            }
+            double j2 = len*len*(jump[0]*jump[0] + 4.0*jump[1]*jump[1] + jump[2]*jump[2])/(6.0*deg);
+            eta2[t0] += 0.5*j2;
+            eta2[t1] += 0.5*j2;
+            k += 2;
+            continue;
+        }
+
+        int i0 = idx0[e0], i1 = idx0[(e0+1)%3];
+        bool fixed = (mesh.bmarker[i0]==BOUNDARY_FIXED_MARKER && mesh.bmarker[i1]==BOUNDARY_FIXED_MARKER);
+        if (!fixed) {
+            bool elast = (opts.elastSupported && mesh.bmarker[i0]==1 && mesh.bmarker[i1]==1);
+            if (elast) {
+                double um = (npe==6 ? ue0[3+e0] : 0.5*(ue0[e0] + ue0[(e0+1)%3]));
+                jump[0] += opts.elastStiffness*ue0[e0];
+                jump[1] += opts.elastStiffness*um;
+                jump[2] += opts.elastStiffness*ue0[(e0+1)%3];
+            }
+            eta2[t0] += len*len*(jump[0]*jump[0] + 4.0*jump[1]*jump[1] + jump[2]*jump[2])/(6.0*deg);
+        }
+        k++;
+    }
+}
+
+
+void FEAssembler::ShapeGradient( const FEMesh &mesh, const DofMap &dofs, const FEOptions &opts,
+                                 const double* x, double lambda, std::vector<glm::dvec2> &grad ) {
+    int npe = mesh.nodesPerElem;
+    grad.assign(mesh.NumNodes(),glm::dvec2(0.0));
+
+    const double *ms1, *ms2, *ms3, *ms4, *fac;
+    if (npe==3) {
+        ms1 = ms1_lin;   ms2 = ms2_lin;   ms3 = ms3_lin;   ms4 = ms4_lin;   fac = fac_lin;
+    } else {
+        ms1 = ms1_quad;  ms2 = ms2_quad;  ms3 = ms3_quad;  ms4 = ms4_quad;  fac = fac_quad;
+    }
+    // the (lumped) element mass matrix is J times M0
+    double M0[36];
+    for(int pos=0; pos<npe*npe; pos++) {
+        M0[pos] = fac[3]*ms4[pos];
+    }
+    LumpElementMass(npe,opts.massType,M0);
+
+    double xe[6];
+    for(int t=0; t<mesh.NumElems(); t++) {
+        const int* idx = &mesh.elems[t*npe];
+        for(int j=0; j<npe; j++) {
+            int d = dofs.nodeToDof[idx[j]];
+            xe[j] = (d>=0 ? x[d] : 0.0);
+        }
+        double q1 = 0.0, q2 = 0.0, q3 = 0.0, q4 = 0.0;
+        for(int j=0; j<npe; j++) {
+            for(int k=0; k<npe; k++) {
+                double xx = xe[j]*xe[k];
+                q1 += ms1[j*npe+k]*xx;
+                q2 += ms2[j*npe+k]*xx;
+                q3 += ms3[j*npe+k]*xx;
+                q4 += M0[j*npe+k]*xx;
+            }
+        }
+        q1 *= fac[0];
+        q2 *= fac[1];
+        q3 *= fac[2];
+
+        // see ElementMatrices: a = |e3|^2/J, b = -e2.e3/J, c = |e2|^2/J with e2 = v2-v1, e3 = v3-v1
+        glm::dvec2 e2 = mesh.pos[idx[1]] - mesh.pos[idx[0]];
+        glm::dvec2 e3 = mesh.pos[idx[2]] - mesh.pos[idx[0]];
+        double J = e2.x*e3.y - e3.x*e2.y;
+        double Es = (glm::dot(e3,e3)*q1 - glm::dot(e2,e3)*q2 + glm::dot(e2,e2)*q3)/J;
+        glm::dvec2 dJ2(e3.y,-e3.x), dJ3(-e2.y,e2.x);
+        glm::dvec2 g2 = (2.0*q3*e2 - q2*e3 - Es*dJ2)/J - lambda*q4*dJ2;
+        glm::dvec2 g3 = (2.0*q1*e3 - q2*e2 - Es*dJ3)/J - lambda*q4*dJ3;
+        grad[idx[0]] -= g2 + g3;
+        grad[idx[1]] += g2;
+        grad[idx[2]] += g3;
+
+        if (!opts.elastSupported) {
+            continue;
+        }
+        // see ElementBoundaryMatrix: proportional to the edge length
+        if (npe==3) {
+            static const int edges[3][2] = { {0,1}, {1,2}, {2,0} };
+            for(int e=0; e<3; e++) {
+                int i0 = idx[edges[e][0]];
+                int i1 = idx[edges[e][1]];
+                if (mesh.bmarker[i0]==1 && mesh.bmarker[i1]==1) {
+                    double q5 = 0.0;
+                    for(int y=0; y<2; y++) {
+                        for(int x=0; x<2; x++) {
+                            q5 += S5l[y*2+x]*xe[edges[e][y]]*xe[edges[e][x]];
+                        }
+                    }
+                    glm::dvec2 g = opts.elastStiffness*q5*glm::normalize(mesh.pos[i1]-mesh.pos[i0]);
+                    grad[i1] += g;
+                    grad[i0] -= g;
+                }
+            }
+        } else {
+            static const int edges[3][3] = { {0,3,1}, {1,4,2}, {2,5,0} };
+            for(int e=0; e<3; e++) {
+                int i0 = idx[edges[e][0]];
+                int im = idx[edges[e][1]];
+                int i1 = idx[edges[e][2]];
+                if (mesh.bmarker[i0]==1 && mesh.bmarker[i1]==1 && mesh.bmarker[im]==1) {
+                    double q5 = 0.0;
+                    for(int y=0; y<3; y++) {
+                        for(int x=0; x<3; x++) {
+                            q5 += S5q[y*3+x]*xe[edges[e][y]]*xe[edges[e][x]];
+                        }
+                    }
+                    glm::dvec2 g = opts.elastStiffness*q5*glm::normalize(mesh.pos[i1]-mesh.pos[i0]);
+                    grad[i1] += g;
+                    grad[i0] -= g;
+                }
+            }
+        }
+    }
+}
+
+
+void FEAssembler::HarmonicExtension( const FEMesh &mesh, const std::vector<bool> &given,
+                                     std::vector<glm::dvec2> &U ) {
+    DofMap dofs;
+    SkylineLDLT<double> ldlt;
+    if (!factorLaplacian(mesh,given,dofs,ldlt)) {
+        return;
+    }
+
+    // right-hand side from the given nodes
+    int n = dofs.NumDofs();
+    int npe = mesh.nodesPerElem;
+    double Se[36], Me[36];
+    std::vector<double> bx(n,0.0), by(n,0.0);
+    for(int t=0; t<mesh.NumElems(); t++) {
+        const int* idx = &mesh.elems[t*npe];
+        ElementMatrices(mesh,t,Se,Me);
+        for(int a=0; a<npe; a++) {
+            int row = dofs.nodeToDof[idx[a]];
+            if (row<0) {
+                continue;
+            }
+            for(int b=0; b<npe; b++) {
+                if (given[idx[b]]) {
+                    bx[row] -= Se[a*npe+b]*U[idx[b]].x;
+                    by[row] -= Se[a*npe+b]*U[idx[b]].y;
+                }
+            }
+        }
+    }
+
+    ldlt.Solve(&bx[0],&bx[0]);
+    ldlt.Solve(&by[0],&by[0]);
+    for(int j=0; j<n; j++) {
+        U[dofs.dofToNode[j]] = glm::dvec2(bx[j],by[j]);
+    }
+}
+
+
+void FEAssembler::HarmonicExtensionAdjoint( const FEMesh &mesh, const std::vector<bool> &given,
+                                            std::vector<glm::dvec2> &G, int num ) {
+    DofMap dofs;
+    SkylineLDLT<double> ldlt;
+    if (!factorLaplacian(mesh,given,dofs,ldlt)) {
+        return;
+    }
+
+    // U_f = -K_ff^{-1} K_fb U_b, hence G_b += -K_bf K_ff^{-1} G_f
+    int n = dofs.NumDofs();
+    int npe = mesh.nodesPerElem;
+    double Se[36], Me[36];
+    std::vector<double> wx(n), wy(n);
+    for(int k=0; k<num; k++) {
+        glm::dvec2* g = &G[static_cast<size_t>(k)*mesh.NumNodes()];
+        for(int j=0; j<n; j++) {
+            wx[j] = g[dofs.dofToNode[j]].x;
+            wy[j] = g[dofs.dofToNode[j]].y;
+            g[dofs.dofToNode[j]] = glm::dvec2(0.0);
+        }
+        ldlt.Solve(&wx[0],&wx[0]);
+        ldlt.Solve(&wy[0],&wy[0]);
+
+        for(int t=0; t<mesh.NumElems(); t++) {
+            const int* idx = &mesh.elems[t*npe];
+            ElementMatrices(mesh,t,Se,Me);
+            for(int b=0; b<npe; b++) {
+                if (!given[idx[b]]) {
+                    continue;
+                }
+                for(int a=0; a<npe; a++) {
+                    int col = dofs.nodeToDof[idx[a]];
+                    if (col>=0) {
+                        g[idx[b]] -= Se[b*npe+a]*glm::dvec2(wx[col],wy[col]);
+                    }
+                }
+            }
+        }
+    }
+}
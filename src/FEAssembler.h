@@ -0,0 +1,176 @@
+/**
+    @file   FEAssembler.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_FE_ASSEMBLER_H
+#define NUMCHLADNI_FE_ASSEMBLER_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "qtdefs.h"
+#include "SparseMatrix.h"
+
+/**
+ * @brief Self-contained triangle mesh for linear or quadratic elements.
+ *
+ *   Element node order is  v1,v2,v3  for linear and
+ *   v1,v2,v3,a12,a23,a31 for quadratic elements, where aij is the
+ *   midside node between vi and vj.
+ */
+struct FEMesh
+{
+    std::vector<glm::dvec2>  pos;       //!< node positions
+    std::vector<int>         bmarker;   //!< node boundary markers
+    std::vector<int>         elems;     //!< nodesPerElem node indices per element
+    int                      nodesPerElem;
+
+    FEMesh() : nodesPerElem(3) {}
+    int  NumNodes() const  { return static_cast<int>(pos.size()); }
+    int  NumElems() const  { return (nodesPerElem>0 ? static_cast<int>(elems.size())/nodesPerElem : 0); }
+};
+
+
+/**
+ * @brief Map between mesh nodes and degrees of freedom.
+ *
+ *   Nodes with BOUNDARY_FIXED_MARKER are clamped and carry no degree
+ *   of freedom. The remaining nodes are numbered in ascending order,
+ *   which is the same numbering the dense solvers obtain by deleting
+ *   the rows and columns of the fixed nodes.
+ */
+struct DofMap
+{
+    std::vector<int>  nodeToDof;   //!< dof index per node, -1 for fixed nodes
+    std::vector<int>  dofToNode;   //!< node index per dof
+
+    int  NumDofs() const  { return static_cast<int>(dofToNode.size()); }
+};
+
+
+/**
+ * @brief Options for the assembly of the stiffness and mass matrices.
+ */
+struct FEOptions
+{
+    bool        elastSupported;   //!< non-fixed boundary edges are elastically supported
+    double      elastStiffness;   //!< spring stiffness of the elastic support
+    e_massType  massType;         //!< consistent or lumped mass matrix
+
+    FEOptions() : elastSupported(false), elastStiffness(1.0), massType(e_mass_consistent) {}
+};
+
+
+/**
+ * @brief Assembly of the sparse stiffness and mass matrices.
+ *
+ *   Uses the same element matrices (qtdefs.h) as the dense assembly in
+ *   SystemData::compileMatrices, but stores only the nonzero pattern.
+ */
+class FEAssembler
+{
+public:
+    /** Build dof map from the boundary markers of the mesh.
+     */
+    static void BuildDofMap( const FEMesh &mesh, DofMap &dofs );
+
+    /** Build the common sparsity pattern of stiffness and mass matrix.
+     */
+    static void BuildPattern( const FEMesh &mesh, const DofMap &dofs, SparseMatrix &A );
+
+    /** Assemble stiffness matrix K and mass matrix M for the free dofs.
+     */
+    static void Assemble( const FEMesh &mesh, const DofMap &dofs, const FEOptions &opts,
+                          SparseMatrix &K, SparseMatrix &M );
+
+    /** Element stiffness and mass matrices (row-major, nodesPerElem^2 entries).
+     * \param mesh
+     * \param t     element index
+     * \param Se    element stiffness matrix
+     * \param Me    element mass matrix
+     */
+    static void ElementMatrices( const FEMesh &mesh, int t, double* Se, double* Me );
+
+    /** Replace element mass matrix by a diagonal (lumped) one.
+     *   Row sum lumping puts the sum of each row onto the diagonal. HRZ
+     *   lumping scales the diagonal of Me such that the element mass is
+     *   preserved. For quadratic elements the row sums of the vertex
+     *   nodes vanish, hence HRZ lumping is used for both types.
+     * \param npe   nodes per element
+     * \param type  lumping type, nothing is done for e_mass_consistent
+     * \param Me    element mass matrix (npe x npe)
+     */
+    static void LumpElementMass( int npe, e_massType type, double* Me );
+
+    /** Diagonal of the HRZ lumped mass matrix, also for a consistent one.
+     * \param diag  lumped mass per dof
+     */
+    static void LumpedMass( const FEMesh &mesh, const DofMap &dofs, std::vector<double> &diag );
+
+    /** Add the boundary integral of elastically supported edges of element t.
+     * \param Se    element stiffness matrix
+     * \param scale scaling factor (spring stiffness)
+     */
+    static void ElementBoundaryMatrix( const FEMesh &mesh, int t, double scale, double* Se );
+
+    /** Residual-based error indicators of an eigenpair of  -Laplace u = lambda u.
+     *   eta_T^2 = (h_T/p)^2 |lambda u + Laplace u|_T^2 + 1/2 sum h_e/p |[du/dn]|_e^2
+     *   over the interior edges of T, plus h_e/p |du/dn + s u|_e^2 over its
+     *   free boundary edges (s = elastStiffness for elastically supported edges, else 0),
+     *   where p is the polynomial degree.
+     *   The sum over all elements estimates the eigenvalue error
+     *   lambda_h - lambda up to a constant.
+     * \param u       eigenvector over the dofs, M-normalized
+     * \param lambda  eigenvalue
+     * \param eta2    eta_T^2 per element
+     */
+    static void EstimateError( const FEMesh &mesh, const DofMap &dofs, const FEOptions &opts,
+                               const double* u, double lambda, std::vector<double> &eta2 );
+
+    /** Derivative of  x^T (K - lambda M) x  with respect to the node positions.
+     *   For an M-normalized eigenvector x of a simple eigenvalue lambda,
+     *   this is the gradient of lambda. The element matrices only depend
+     *   on the corners, hence midside nodes get a zero gradient.
+     * \param x     vector over the dofs
+     * \param grad  derivative per node
+     */
+    static void ShapeGradient( const FEMesh &mesh, const DofMap &dofs, const FEOptions &opts,
+                               const double* x, double lambda, std::vector<glm::dvec2> &grad );
+
+    /** Extend node motions given at some nodes harmonically to the others.
+     * \param given  nodes whose motion is prescribed
+     * \param U      motion per node, overwritten at the other nodes
+     */
+    static void HarmonicExtension( const FEMesh &mesh, const std::vector<bool> &given,
+                                   std::vector<glm::dvec2> &U );
+
+    /** Transpose of HarmonicExtension: a gradient G with respect to all
+     *   node positions becomes the gradient with respect to the given nodes
+     *   only, when the others follow by harmonic extension. It costs one
+     *   solve with the Laplacian per gradient, independent of the number
+     *   of given nodes.
+     * \param G    num gradients, one per node each, zero at the other nodes on output
+     * \param num  number of gradients
+     */
+    static void HarmonicExtensionAdjoint( const FEMesh &mesh, const std::vector<bool> &given,
+                                          std::vector<glm::dvec2> &G, int num = 1 );
+};
+
+#endif // NUMCHLADNI_FE_ASSEMBLER_H
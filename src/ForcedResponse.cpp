@@ -0,0 +1,205 @@
+/**
+    @file   ForcedResponse.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <algorithm>
+
+#include "ForcedResponse.h"
+#include "Multigrid.h"
+
+ForcedResponse::ForcedResponse() {
+    m_zeta = 0.0;
+    m_numProbes = 0;
+}
+
+ForcedResponse::~ForcedResponse() {
+}
+
+// ********************************** public methods *****************************
+
+void ForcedResponse::Setup( const FEMesh &mesh, const DofMap &dofs, const SparseMatrix &M,
+                            int num, const double* lambda, const double* X ) {
+    m_mesh = mesh;
+    m_dofs = dofs;
+    int n = m_dofs.NumDofs();
+    m_lambda.assign(lambda,lambda+num);
+    m_X.assign(X,X+static_cast<size_t>(num)*n);
+    m_pressure.assign(num,0.0);
+
+    std::vector<double> Mx(n);
+    for(int k=0; k<num; k++) {
+        double* x = &m_X[static_cast<size_t>(k)*n];
+        M.Multiply(x,&Mx[0]);
+        double xMx = vecDot(n,x,&Mx[0]);
+        if (xMx>0.0) {
+            vecScale(n,1.0/std::sqrt(xMx),x);
+            vecScale(n,1.0/std::sqrt(xMx),&Mx[0]);
+        }
+        // M is symmetric: x^T M 1 = sum of M x
+        double sum = 0.0;
+        for(int j=0; j<n; j++) {
+            sum += Mx[j];
+        }
+        m_pressure[k] = sum;
+    }
+    ClearDrive();
+}
+
+
+void ForcedResponse::Clear() {
+    m_mesh = FEMesh();
+    m_dofs = DofMap();
+    m_lambda.clear();
+    m_X.clear();
+    m_pressure.clear();
+    ClearDrive();
+}
+
+
+void ForcedResponse::SetDamping( double zeta ) {
+    m_zeta = std::max(0.0,zeta);
+}
+
+
+void ForcedResponse::ClearDrive() {
+    m_force.assign(m_lambda.size(),0.0);
+    m_probeX.clear();
+    m_numProbes = 0;
+}
+
+
+void ForcedResponse::AddPointDrive( glm::dvec2 p, double a ) {
+    std::vector<int> idx;
+    std::vector<double> w;
+    PointWeights(m_mesh,m_dofs,p,idx,w);
+    int n = m_dofs.NumDofs();
+    for(int k=0; k<NumModes(); k++) {
+        const double* x = &m_X[static_cast<size_t>(k)*n];
+        for(size_t j=0; j<idx.size(); j++) {
+            m_force[k] += a*w[j]*x[idx[j]];
+        }
+    }
+}
+
+
+void ForcedResponse::AddPressureDrive( double a ) {
+    for(int k=0; k<NumModes(); k++) {
+        m_force[k] += a*m_pressure[k];
+    }
+}
+
+
+int ForcedResponse::AddProbe( glm::dvec2 p ) {
+    std::vector<double> values;
+    ModeValues(p,values);
+    m_probeX.insert(m_probeX.end(),values.begin(),values.end());
+    return m_numProbes++;
+}
+
+
+void ForcedResponse::ModeValues( glm::dvec2 p, std::vector<double> &values ) const {
+    std::vector<int> idx;
+    std::vector<double> w;
+    PointWeights(m_mesh,m_dofs,p,idx,w);
+    int n = m_dofs.NumDofs();
+    values.assign(NumModes(),0.0);
+    for(int k=0; k<NumModes(); k++) {
+        const double* x = &m_X[static_cast<size_t>(k)*n];
+        for(size_t j=0; j<idx.size(); j++) {
+            values[k] += w[j]*x[idx[j]];
+        }
+    }
+}
+
+
+void ForcedResponse::Sweep( const std::vector<double> &omega, std::vector< std::complex<double> > &H ) const {
+    int num = NumModes();
+    H.assign(omega.size()*m_numProbes,std::complex<double>(0.0,0.0));
+    if (num==0) {
+        return;
+    }
+    std::vector<double> qRe(num), qIm(num);
+    for(size_t f=0; f<omega.size(); f++) {
+        modalAmplitudes(omega[f],&qRe[0],&qIm[0]);
+        for(int p=0; p<m_numProbes; p++) {
+            const double* x = &m_probeX[static_cast<size_t>(p)*num];
+            H[f*m_numProbes+p] = std::complex<double>(vecDot(num,x,&qRe[0]),vecDot(num,x,&qIm[0]));
+        }
+    }
+}
+
+
+void ForcedResponse::Field( double omega, std::vector< std::complex<double> > &U ) const {
+    int num = NumModes();
+    int n = m_dofs.NumDofs();
+    std::vector<double> qRe(std::max(num,1)), qIm(std::max(num,1));
+    std::vector<double> uRe(n,0.0), uIm(n,0.0);
+    modalAmplitudes(omega,&qRe[0],&qIm[0]);
+    for(int k=0; k<num; k++) {
+        const double* x = &m_X[static_cast<size_t>(k)*n];
+        vecAxpy(n,qRe[k],x,&uRe[0]);
+        vecAxpy(n,qIm[k],x,&uIm[0]);
+    }
+    U.resize(n);
+    for(int j=0; j<n; j++) {
+        U[j] = std::complex<double>(uRe[j],uIm[j]);
+    }
+}
+
+
+void ForcedResponse::PointWeights( const FEMesh &mesh, const DofMap &dofs, glm::dvec2 p,
+                                   std::vector<int> &idx, std::vector<double> &w ) {
+    // a mesh of the single point, interpolated from the mesh of the modes
+    FEMesh point;
+    point.pos.push_back(p);
+    point.bmarker.push_back(0);
+    point.nodesPerElem = 0;
+    DofMap pointDofs;
+    pointDofs.nodeToDof.push_back(0);
+    pointDofs.dofToNode.push_back(0);
+
+    idx.clear();
+    w.clear();
+    if (mesh.NumElems()==0) {
+        return;
+    }
+    Interpolation P;
+    P.Build(mesh,dofs,point,pointDofs);
+    for(int k=P.rowPtr[0]; k<P.rowPtr[1]; k++) {
+        idx.push_back(P.colIdx[k]);
+        w.push_back(P.values[k]);
+    }
+}
+
+// ********************************* protected methods *****************************
+
+void ForcedResponse::modalAmplitudes( double omega, double* qRe, double* qIm ) const {
+    double w2 = omega*omega;
+    for(int k=0; k<NumModes(); k++) {
+        double dRe = m_lambda[k] - w2;
+        double dIm = 2.0*m_zeta*std::sqrt(std::max(m_lambda[k],0.0))*omega;
+        double d2 = dRe*dRe + dIm*dIm;
+        // an undamped resonance or a rigid body mode at rest has no finite response
+        double s = (d2>0.0 ? m_force[k]/d2 : 0.0);
+        qRe[k] =  s*dRe;
+        qIm[k] = -s*dIm;
+    }
+}
@@ -0,0 +1,142 @@
+/**
+    @file   ForcedResponse.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_FORCED_RESPONSE_H
+#define NUMCHLADNI_FORCED_RESPONSE_H
+
+#include <vector>
+#include <complex>
+#include <glm/glm.hpp>
+
+#include "FEAssembler.h"
+#include "SparseMatrix.h"
+
+/**
+ * @brief Steady-state response to a harmonic drive by modal superposition.
+ *
+ *   With M-normalized modes x_n, the response to the load f e^{i omega t} is
+ *
+ *     u(omega) = sum_n  x_n^T f / (lambda_n - omega^2 + 2 i zeta omega_n omega)  x_n,
+ *
+ *   where omega_n = sqrt(lambda_n) and zeta is the modal damping ratio.
+ *   Frequencies are angular frequencies in the units of the eigenvalues,
+ *   i.e. mode n resonates at omega = omega_n. A point drive loads the dofs
+ *   by the shape functions at the point, a uniform pressure by M*1. Only
+ *   the known modes contribute, so the response is accurate well below
+ *   the highest eigenvalue.
+ *
+ *   The modal forces and the mode values at the probes are computed once;
+ *   a frequency then costs O(numModes) per probe and O(numModes*numDofs)
+ *   per response field.
+ */
+class ForcedResponse
+{
+public:
+    ForcedResponse();
+    ~ForcedResponse();
+
+    // --------- public methods -----------
+public:
+    /** Take over the mesh and the modes.
+     * \param mesh    mesh of the modes
+     * \param dofs    dof map of the eigenvectors
+     * \param M       mass matrix over the dofs
+     * \param num     number of modes
+     * \param lambda  eigenvalues
+     * \param X       eigenvectors, num columns of length dofs.NumDofs(), any scaling
+     */
+    void  Setup( const FEMesh &mesh, const DofMap &dofs, const SparseMatrix &M,
+                 int num, const double* lambda, const double* X );
+
+    void  Clear();
+
+    bool  IsEmpty() const  { return m_lambda.empty(); }
+    int   NumModes() const  { return static_cast<int>(m_lambda.size()); }
+    const std::vector<double>&  Eigenvalues() const  { return m_lambda; }
+
+    const FEMesh&  Mesh() const  { return m_mesh; }
+    const DofMap&  Dofs() const  { return m_dofs; }
+
+    /** Modal damping ratio of all modes.
+     */
+    void  SetDamping( double zeta );
+
+    /** Remove all drives and probes.
+     */
+    void  ClearDrive();
+
+    /** Add a point force of amplitude a at p.
+     */
+    void  AddPointDrive( glm::dvec2 p, double a );
+
+    /** Add a uniform pressure of amplitude a over the whole plate.
+     */
+    void  AddPressureDrive( double a );
+
+    /** Add a probe at p for the transfer functions.
+     * \return  index of the probe
+     */
+    int   AddProbe( glm::dvec2 p );
+
+    int   NumProbes() const  { return m_numProbes; }
+
+    /** Values of the M-normalized modes at p.
+     */
+    void  ModeValues( glm::dvec2 p, std::vector<double> &values ) const;
+
+    /** Transfer functions from the drive to the probes.
+     * \param omega  angular frequencies
+     * \param H      response per frequency and probe, row-major with NumProbes() columns
+     */
+    void  Sweep( const std::vector<double> &omega, std::vector< std::complex<double> > &H ) const;
+
+    /** Response field over the dofs at omega.
+     */
+    void  Field( double omega, std::vector< std::complex<double> > &U ) const;
+
+    /** Weights of the dofs for the value at p, i.e. the shape functions at p.
+     *   Points outside the mesh use the nearest triangle.
+     * \param idx  dofs
+     * \param w    their weights
+     */
+    static void  PointWeights( const FEMesh &mesh, const DofMap &dofs, glm::dvec2 p,
+                               std::vector<int> &idx, std::vector<double> &w );
+
+protected:
+    /** Modal receptances  1/(lambda_n - omega^2 + 2 i zeta omega_n omega)  times the modal forces.
+     */
+    void  modalAmplitudes( double omega, double* qRe, double* qIm ) const;
+
+    // -------- private attributes --------
+private:
+    FEMesh               m_mesh;
+    DofMap               m_dofs;
+    std::vector<double>  m_lambda;
+    std::vector<double>  m_X;          //!< M-normalized modes
+    std::vector<double>  m_pressure;   //!< x_n^T M 1 per mode
+    double               m_zeta;
+
+    std::vector<double>  m_force;      //!< modal forces x_n^T f
+    std::vector<double>  m_probeX;     //!< mode values per probe, NumModes() per probe
+    int                  m_numProbes;
+};
+
+#endif // NUMCHLADNI_FORCED_RESPONSE_H
@@ -0,0 +1,391 @@
+/**
+    @file   KrylovSweep.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+#include "KrylovSweep.h"
+#include "EigenUtils.h"
+
+typedef std::complex<double> cplx;
+
+static const int    numMoments  = 10;     // Arnoldi steps per expansion point
+static const int    maxPoints   = 12;     // expansion points per sweep
+static const int    maxBasis    = 240;    // real basis vectors
+static const int    maxChecks   = 64;     // frequencies the error is estimated at
+static const double deflation   = 1e-10;  // relative norm of a dependent vector
+
+/** y = A*x for complex x.
+ */
+static void multiply( const SparseMatrix &A, const cplx* x, cplx* y ) {
+    for(int i=0; i<A.Size(); i++) {
+        cplx sum = 0.0;
+        for(int k=A.m_rowPtr[i]; k<A.m_rowPtr[i+1]; k++) {
+            sum += A.m_values[k]*x[A.m_colIdx[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+/** Hermitian inner product  x^H y.
+ */
+static cplx dotc( int n, const cplx* x, const cplx* y ) {
+    cplx sum = 0.0;
+    for(int i=0; i<n; i++) {
+        sum += std::conj(x[i])*y[i];
+    }
+    return sum;
+}
+
+/** Solve the dense system  A x = b  (row-major) by Gaussian elimination with partial pivoting.
+ */
+static void solveDense( int n, std::vector<cplx> &A, std::vector<cplx> &b ) {
+    for(int k=0; k<n; k++) {
+        int p = k;
+        for(int i=k+1; i<n; i++) {
+            if (std::abs(A[i*n+k])>std::abs(A[p*n+k])) {
+                p = i;
+            }
+        }
+        if (p!=k) {
+            std::swap_ranges(A.begin()+k*n,A.begin()+(k+1)*n,A.begin()+p*n);
+            std::swap(b[k],b[p]);
+        }
+        if (A[k*n+k]==cplx(0.0)) {
+            continue;
+        }
+        for(int i=k+1; i<n; i++) {
+            cplx l = A[i*n+k]/A[k*n+k];
+            for(int j=k+1; j<n; j++) {
+                A[i*n+j] -= l*A[k*n+j];
+            }
+            b[i] -= l*b[k];
+        }
+    }
+    for(int k=n-1; k>=0; k--) {
+        cplx sum = b[k];
+        for(int j=k+1; j<n; j++) {
+            sum -= A[k*n+j]*b[j];
+        }
+        b[k] = (A[k*n+k]!=cplx(0.0) ? sum/A[k*n+k] : cplx(0.0));
+    }
+}
+
+
+KrylovSweep::KrylovSweep( const SparseMatrix &K, const SparseMatrix &M )
+    : m_K(K), m_M(M) {
+    m_alpha = 0.0;
+    m_beta = 0.0;
+    m_basisSize = 0;
+    m_diagonal = false;
+    m_estimate = 0.0;
+}
+
+KrylovSweep::~KrylovSweep() {
+}
+
+// ********************************** public methods *****************************
+
+void KrylovSweep::SetDamping( double alpha, double beta ) {
+    m_alpha = alpha;
+    m_beta = beta;
+}
+
+
+bool KrylovSweep::Sweep( const std::vector<double> &omega, const std::vector<double> &f,
+                         const std::vector<double> &L, int numOutputs, double tol,
+                         std::vector< cplx > &H ) {
+    int n = m_K.Size();
+    int numFreq = static_cast<int>(omega.size());
+    H.assign(static_cast<size_t>(numFreq)*numOutputs,cplx(0.0));
+    m_points.clear();
+    m_basisSize = 0;
+    m_V.clear();
+    m_KV.clear();
+    m_MV.clear();
+    m_diagonal = false;
+    m_estimate = 0.0;
+    double fnorm = std::sqrt(vecDot(n,&f[0],&f[0]));
+    if (numFreq==0 || n==0 || fnorm==0.0) {
+        return true;
+    }
+
+    std::vector<int> checks;
+    int numChecks = std::min(numFreq,maxChecks);
+    for(int c=0; c<numChecks; c++) {
+        checks.push_back(numChecks>1 ? static_cast<int>((c*(numFreq-1.0))/(numChecks-1) + 0.5) : 0);
+    }
+
+    double lo = *std::min_element(omega.begin(),omega.end());
+    double hi = *std::max_element(omega.begin(),omega.end());
+    double omega0 = 0.5*(lo + hi);
+    std::vector<cplx> y;
+    while (true) {
+        if (!expand(omega0,f)) {
+            fprintf(stderr,"KrylovSweep: singular system at omega=%g.\n",omega0);
+        }
+        m_points.push_back(omega0);
+        project(f);
+
+        m_estimate = 0.0;
+        int worst = -1;
+        for(size_t c=0; c<checks.size(); c++) {
+            solveReduced(omega[checks[c]],y);
+            double res = residual(omega[checks[c]],y,f,fnorm);
+            if (res>m_estimate) {
+                m_estimate = res;
+                worst = checks[c];
+            }
+        }
+        if (m_estimate<=tol || worst<0 || static_cast<int>(m_points.size())>=maxPoints || m_basisSize>=maxBasis
+                || std::find(m_points.begin(),m_points.end(),omega[worst])!=m_points.end()) {
+            break;
+        }
+        omega0 = omega[worst];
+    }
+
+    // outputs on the basis; in the eigenvectors of the projected pencil a
+    // frequency costs O(r) per output
+    int r = m_basisSize;
+    std::vector<double> Lr(static_cast<size_t>(numOutputs)*r);
+    for(int p=0; p<numOutputs; p++) {
+        for(int j=0; j<r; j++) {
+            Lr[static_cast<size_t>(p)*r+j] = vecDot(n,&L[static_cast<size_t>(p)*n],&m_V[static_cast<size_t>(j)*n]);
+        }
+    }
+    if (m_diagonal) {
+        std::vector<double> G(static_cast<size_t>(numOutputs)*r);
+        for(int p=0; p<numOutputs; p++) {
+            for(int j=0; j<r; j++) {
+                G[static_cast<size_t>(p)*r+j] = vecDot(r,&Lr[static_cast<size_t>(p)*r],&m_Z[static_cast<size_t>(j)*r])*m_fz[j];
+            }
+        }
+        std::vector<double> dRe(r), dIm(r);
+        for(int w=0; w<numFreq; w++) {
+            double w2 = omega[w]*omega[w];
+            for(int j=0; j<r; j++) {
+                // 1/d = conj(d)/|d|^2  with  d = theta - omega^2 + i omega (alpha + beta theta)
+                double re = m_theta[j] - w2;
+                double im = omega[w]*(m_alpha + m_beta*m_theta[j]);
+                double d2 = re*re + im*im;
+                dRe[j] = (d2>0.0 ?  re/d2 : 0.0);
+                dIm[j] = (d2>0.0 ? -im/d2 : 0.0);
+            }
+            for(int p=0; p<numOutputs; p++) {
+                const double* g = &G[static_cast<size_t>(p)*r];
+                H[static_cast<size_t>(w)*numOutputs+p] = cplx(vecDot(r,g,&dRe[0]),vecDot(r,g,&dIm[0]));
+            }
+        }
+        return (m_estimate<=tol);
+    }
+    for(int w=0; w<numFreq; w++) {
+        solveReduced(omega[w],y);
+        for(int p=0; p<numOutputs; p++) {
+            cplx sum = 0.0;
+            for(int j=0; j<r; j++) {
+                sum += Lr[static_cast<size_t>(p)*r+j]*y[j];
+            }
+            H[static_cast<size_t>(w)*numOutputs+p] = sum;
+        }
+    }
+    return (m_estimate<=tol);
+}
+
+// ********************************* protected methods *****************************
+
+bool KrylovSweep::expand( double omega0, const std::vector<double> &f ) {
+    int n = m_K.Size();
+    if (m_ldlt.Size()!=n) {
+        m_ldlt.Analyze(m_K);
+    }
+    // A(omega) = (1 + i omega beta) K + (-omega^2 + i omega alpha) M
+    bool ok = m_ldlt.Factorize(m_K,m_M,cplx(1.0,omega0*m_beta),cplx(-omega0*omega0,omega0*m_alpha));
+
+    // Arnoldi on  [u_k; u_{k-1}] = [-A0^{-1} A1, -A0^{-1} A2; I, 0] [u_{k-1}; u_{k-2}]
+    std::vector<cplx> W(static_cast<size_t>(2*n)*numMoments), t(n), Ka(n), Ma(n), Mb(n);
+    std::vector<double> v(n);
+    for(int i=0; i<n; i++) {
+        t[i] = f[i];
+    }
+    m_ldlt.Solve(&t[0],&W[0]);
+    int num = 0;
+    for(int k=0; ; k++) {
+        cplx* w = &W[static_cast<size_t>(2*n)*k];
+        double norm0 = std::sqrt(std::real(dotc(2*n,w,w)));
+        if (k>0) {
+            // CGS with reorthogonalization
+            for(int pass=0; pass<2; pass++) {
+                for(int j=0; j<k; j++) {
+                    const cplx* wj = &W[static_cast<size_t>(2*n)*j];
+                    cplx h = dotc(2*n,wj,w);
+                    for(int i=0; i<2*n; i++) {
+                        w[i] -= h*wj[i];
+                    }
+                }
+            }
+        }
+        double norm = std::sqrt(std::real(dotc(2*n,w,w)));
+        if (norm==0.0 || norm<=deflation*norm0) {
+            break;
+        }
+        for(int i=0; i<2*n; i++) {
+            w[i] /= norm;
+        }
+        num++;
+
+        // the upper halves span the moments
+        for(int part=0; part<2; part++) {
+            for(int i=0; i<n; i++) {
+                v[i] = (part==0 ? w[i].real() : w[i].imag());
+            }
+            addToBasis(v);
+        }
+        if (num==numMoments || m_basisSize>=maxBasis) {
+            break;
+        }
+
+        // next vector: top = -A0^{-1} (A1 a + A2 b), bottom = a
+        const cplx* a = w;
+        const cplx* b = w + n;
+        multiply(m_K,a,&Ka[0]);
+        multiply(m_M,a,&Ma[0]);
+        multiply(m_M,b,&Mb[0]);
+        cplx cK(0.0,m_beta), cM(-2.0*omega0,m_alpha);
+        for(int i=0; i<n; i++) {
+            t[i] = -(cK*Ka[i] + cM*Ma[i] - Mb[i]);
+        }
+        cplx* next = &W[static_cast<size_t>(2*n)*(k+1)];
+        m_ldlt.Solve(&t[0],next);
+        std::copy(a,a+n,next+n);
+    }
+    return ok;
+}
+
+
+void KrylovSweep::addToBasis( std::vector<double> &v ) {
+    int n = m_K.Size();
+    double norm0 = std::sqrt(vecDot(n,&v[0],&v[0]));
+    if (norm0==0.0 || m_basisSize>=maxBasis) {
+        return;
+    }
+    for(int pass=0; pass<2; pass++) {
+        for(int j=0; j<m_basisSize; j++) {
+            const double* vj = &m_V[static_cast<size_t>(j)*n];
+            vecAxpy(n,-vecDot(n,vj,&v[0]),vj,&v[0]);
+        }
+    }
+    double norm = std::sqrt(vecDot(n,&v[0],&v[0]));
+    if (norm<=deflation*norm0) {
+        return;
+    }
+    vecScale(n,1.0/norm,&v[0]);
+    m_V.insert(m_V.end(),v.begin(),v.end());
+    m_basisSize++;
+}
+
+
+void KrylovSweep::project( const std::vector<double> &f ) {
+    int n = m_K.Size();
+    int r = m_basisSize;
+    int old = static_cast<int>(m_KV.size()/std::max(n,1));
+    m_KV.resize(static_cast<size_t>(r)*n);
+    m_MV.resize(static_cast<size_t>(r)*n);
+    for(int j=old; j<r; j++) {
+        m_K.Multiply(&m_V[static_cast<size_t>(j)*n],&m_KV[static_cast<size_t>(j)*n]);
+        m_M.Multiply(&m_V[static_cast<size_t>(j)*n],&m_MV[static_cast<size_t>(j)*n]);
+    }
+
+    // only the new rows and columns of the symmetric projections
+    std::vector<double> Kr(static_cast<size_t>(r)*r), Mr(static_cast<size_t>(r)*r);
+    for(int i=0; i<r; i++) {
+        for(int j=i; j<r; j++) {
+            double k, m;
+            if (j<old) {
+                k = m_Kr[static_cast<size_t>(i)*old+j];
+                m = m_Mr[static_cast<size_t>(i)*old+j];
+            } else {
+                k = vecDot(n,&m_V[static_cast<size_t>(i)*n],&m_KV[static_cast<size_t>(j)*n]);
+                m = vecDot(n,&m_V[static_cast<size_t>(i)*n],&m_MV[static_cast<size_t>(j)*n]);
+            }
+            Kr[static_cast<size_t>(i)*r+j] = Kr[static_cast<size_t>(j)*r+i] = k;
+            Mr[static_cast<size_t>(i)*r+j] = Mr[static_cast<size_t>(j)*r+i] = m;
+        }
+    }
+    m_Kr.swap(Kr);
+    m_Mr.swap(Mr);
+
+    m_fr.resize(r);
+    for(int j=0; j<r; j++) {
+        m_fr[j] = vecDot(n,&m_V[static_cast<size_t>(j)*n],&f[0]);
+    }
+
+    // Rayleigh damping keeps the projected pencil diagonal in the eigenvectors of (Kr,Mr)
+    m_theta.resize(r);
+    m_Z.resize(static_cast<size_t>(r)*r);
+    m_diagonal = (r>0 && GeneralizedSymmetricEigen(r,&m_Kr[0],&m_Mr[0],&m_theta[0],&m_Z[0]));
+    m_fz.assign(r,0.0);
+    if (m_diagonal) {
+        for(int j=0; j<r; j++) {
+            m_fz[j] = vecDot(r,&m_Z[static_cast<size_t>(j)*r],&m_fr[0]);
+        }
+    }
+}
+
+
+void KrylovSweep::solveReduced( double omega, std::vector<cplx> &y ) const {
+    int r = m_basisSize;
+    cplx kFac(1.0,omega*m_beta), mFac(-omega*omega,omega*m_alpha);
+    if (m_diagonal) {
+        y.assign(r,cplx(0.0));
+        for(int j=0; j<r; j++) {
+            cplx q = m_fz[j]/(kFac*m_theta[j] + mFac);
+            const double* z = &m_Z[static_cast<size_t>(j)*r];
+            for(int i=0; i<r; i++) {
+                y[i] += q*z[i];
+            }
+        }
+        return;
+    }
+    std::vector<cplx> A(static_cast<size_t>(r)*r);
+    for(size_t k=0; k<A.size(); k++) {
+        A[k] = kFac*m_Kr[k] + mFac*m_Mr[k];
+    }
+    y.assign(m_fr.begin(),m_fr.end());
+    solveDense(r,A,y);
+}
+
+
+double KrylovSweep::residual( double omega, const std::vector<cplx> &y, const std::vector<double> &f,
+                              double fnorm ) const {
+    int n = m_K.Size();
+    cplx kFac(1.0,omega*m_beta), mFac(-omega*omega,omega*m_alpha);
+    std::vector<cplx> r(f.begin(),f.end());
+    for(int j=0; j<m_basisSize; j++) {
+        cplx ck = kFac*y[j], cm = mFac*y[j];
+        const double* kv = &m_KV[static_cast<size_t>(j)*n];
+        const double* mv = &m_MV[static_cast<size_t>(j)*n];
+        for(int i=0; i<n; i++) {
+            r[i] -= ck*kv[i] + cm*mv[i];
+        }
+    }
+    return std::sqrt(std::real(dotc(n,&r[0],&r[0])))/fnorm;
+}
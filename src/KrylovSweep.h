@@ -0,0 +1,132 @@
+/**
+    @file   KrylovSweep.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_KRYLOV_SWEEP_H
+#define NUMCHLADNI_KRYLOV_SWEEP_H
+
+#include <vector>
+#include <complex>
+
+#include "SparseMatrix.h"
+#include "SkylineLDLT.h"
+
+/**
+ * @brief Frequency sweep of  (K + i omega C - omega^2 M) u = f  by Krylov model-order reduction.
+ *
+ *   C = alpha M + beta K is Rayleigh damping. Around an expansion
+ *   frequency omega0, the Taylor coefficients of u(omega) obey the
+ *   second-order recurrence  A0 u_k = -A1 u_{k-1} - A2 u_{k-2}  with
+ *   A0 = A(omega0), A1 = i C - 2 omega0 M, and A2 = -M. Arnoldi on its
+ *   linearization spans the same moments with an orthonormal basis, at
+ *   the cost of one factorization (complex SkylineLDLT) and one solve per
+ *   moment. The real and imaginary parts of the moments of all expansion
+ *   points form a real basis V, and the sweep solves the small projected
+ *   systems  V^T A(omega) V y = V^T f. With Rayleigh damping they are
+ *   diagonal in the eigenvectors of  V^T K V z = theta V^T M V z, so a
+ *   frequency only costs O(BasisSize()) per output.
+ *
+ *   The relative residual of the projected solution estimates the error.
+ *   Expansion points are added greedily at the frequency with the largest
+ *   estimate until it is below the tolerance everywhere on the sweep.
+ */
+class KrylovSweep
+{
+public:
+    KrylovSweep( const SparseMatrix &K, const SparseMatrix &M );
+    ~KrylovSweep();
+
+    // --------- public methods -----------
+public:
+    /** Rayleigh damping  C = alpha M + beta K.
+     */
+    void  SetDamping( double alpha, double beta );
+
+    /** Sweep the transfer functions from the load f to the outputs L.
+     * \param omega       angular frequencies
+     * \param f           load vector over the dofs
+     * \param L           output vectors over the dofs, numOutputs columns
+     * \param numOutputs  number of outputs
+     * \param tol         tolerance of the estimated relative error
+     * \param H           L^T u per frequency and output, row-major with numOutputs columns
+     * \return  false if the estimate stayed above the tolerance
+     */
+    bool  Sweep( const std::vector<double> &omega, const std::vector<double> &f,
+                 const std::vector<double> &L, int numOutputs, double tol,
+                 std::vector< std::complex<double> > &H );
+
+    /** Expansion frequencies of the last sweep, in the order they were added.
+     */
+    const std::vector<double>&  ExpansionPoints() const  { return m_points; }
+
+    int     BasisSize() const  { return m_basisSize; }
+
+    /** Largest estimated relative error on the check frequencies of the last sweep.
+     */
+    double  ErrorEstimate() const  { return m_estimate; }
+
+protected:
+    /** Add the moments at omega0 to the basis.
+     * \return  false if the factorization needed perturbed pivots
+     */
+    bool  expand( double omega0, const std::vector<double> &f );
+
+    /** Orthonormalize v against the basis and append it unless it is dependent.
+     */
+    void  addToBasis( std::vector<double> &v );
+
+    /** Project K, M, and f onto the basis.
+     */
+    void  project( const std::vector<double> &f );
+
+    /** Solution of the projected system at omega.
+     */
+    void  solveReduced( double omega, std::vector< std::complex<double> > &y ) const;
+
+    /** Relative residual  |A(omega) V y - f| / |f|.
+     */
+    double  residual( double omega, const std::vector< std::complex<double> > &y,
+                      const std::vector<double> &f, double fnorm ) const;
+
+    // -------- private attributes --------
+private:
+    const SparseMatrix&  m_K;
+    const SparseMatrix&  m_M;
+    double               m_alpha;
+    double               m_beta;
+
+    SkylineLDLT< std::complex<double> >  m_ldlt;
+
+    int                  m_basisSize;
+    std::vector<double>  m_V;        //!< orthonormal basis, m_basisSize columns
+    std::vector<double>  m_KV;       //!< K*V
+    std::vector<double>  m_MV;       //!< M*V
+    std::vector<double>  m_Kr;       //!< V^T K V
+    std::vector<double>  m_Mr;       //!< V^T M V
+    std::vector<double>  m_fr;       //!< V^T f
+    bool                 m_diagonal; //!< eigenvectors of the projected pencil are known
+    std::vector<double>  m_theta;    //!< eigenvalues of  Kr z = theta Mr z
+    std::vector<double>  m_Z;        //!< Mr-orthonormal eigenvectors
+    std::vector<double>  m_fz;       //!< Z^T V^T f
+    std::vector<double>  m_points;
+    double               m_estimate;
+};
+
+#endif // NUMCHLADNI_KRYLOV_SWEEP_H
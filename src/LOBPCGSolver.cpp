@@ -0,0 +1,737 @@
+/**
+    @file   LOBPCGSolver.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include "LOBPCGSolver.h"
+#include "EigenUtils.h"
+
+// below this number of rows, block kernels run in the calling thread
+static const int minRowsPerThread = 2048;
+
+/**
+ *  Description of a row-wise block kernel.
+ */
+struct BlockOp
+{
+    enum e_op {
+        op_multiply = 0,   //!< Y = A*X
+        op_gram,           //!< G = X^T Y
+        op_combine,        //!< Y = (accumulate ? Y : 0) + X*C
+        op_norms           //!< G = squared column norms of X
+    };
+
+    e_op                 op;
+    const SparseMatrix*  A;
+    const double*        X;
+    int                  kx;
+    double*              Y;
+    int                  ky;
+    const double*        C;
+    bool                 accumulate;
+
+    BlockOp() : op(op_multiply), A(NULL), X(NULL), kx(0), Y(NULL), ky(0), C(NULL), accumulate(false) {}
+};
+
+
+/**
+ *  Block kernel on the rows [rowBegin,rowEnd).
+ */
+class BlockJob : public QRunnable
+{
+public:
+    BlockJob( const BlockOp &op, int rowBegin, int rowEnd )
+        : m_op(op), m_rowBegin(rowBegin), m_rowEnd(rowEnd) {
+        setAutoDelete(false);
+    }
+
+    virtual void run() {
+        const BlockOp &op = m_op;
+        switch (op.op) {
+            case BlockOp::op_multiply: {
+                op.A->MultiplyBlock(op.X,op.Y,op.kx,m_rowBegin,m_rowEnd);
+                break;
+            }
+            case BlockOp::op_gram: {
+                m_sum.assign(static_cast<size_t>(op.kx)*op.ky,0.0);
+                for(int i=m_rowBegin; i<m_rowEnd; i++) {
+                    const double* x = op.X + static_cast<size_t>(i)*op.kx;
+                    const double* y = op.Y + static_cast<size_t>(i)*op.ky;
+                    for(int a=0; a<op.kx; a++) {
+                        double xa = x[a];
+                        double* g = &m_sum[static_cast<size_t>(a)*op.ky];
+                        for(int b=0; b<op.ky; b++) {
+                            g[b] += xa*y[b];
+                        }
+                    }
+                }
+                break;
+            }
+            case BlockOp::op_combine: {
+                for(int i=m_rowBegin; i<m_rowEnd; i++) {
+                    const double* x = op.X + static_cast<size_t>(i)*op.kx;
+                    double* y = op.Y + static_cast<size_t>(i)*op.ky;
+                    if (!op.accumulate) {
+                        for(int b=0; b<op.ky; b++) {
+                            y[b] = 0.0;
+                        }
+                    }
+                    for(int a=0; a<op.kx; a++) {
+                        double xa = x[a];
+                        const double* c = op.C + static_cast<size_t>(a)*op.ky;
+                        for(int b=0; b<op.ky; b++) {
+                            y[b] += xa*c[b];
+                        }
+                    }
+                }
+                break;
+            }
+            case BlockOp::op_norms: {
+                m_sum.assign(op.kx,0.0);
+                for(int i=m_rowBegin; i<m_rowEnd; i++) {
+                    const double* x = op.X + static_cast<size_t>(i)*op.kx;
+                    for(int a=0; a<op.kx; a++) {
+                        m_sum[a] += x[a]*x[a];
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    const std::vector<double>&  Sum() const  { return m_sum; }
+
+private:
+    BlockOp  m_op;
+    int      m_rowBegin;
+    int      m_rowEnd;
+    std::vector<double>  m_sum;
+};
+
+
+/**
+ *  Preconditioner applied to one column of a row-major block.
+ */
+class PrecondJob : public QRunnable
+{
+public:
+    PrecondJob( const SkylineLDLT<double> &ldlt, const Preconditioner* precond,
+                const double* R, double* W, int k, int col )
+        : m_ldlt(ldlt), m_precond(precond), m_R(R), m_W(W), m_k(k), m_col(col) {
+        setAutoDelete(false);
+    }
+
+    virtual void run() {
+        int n = (m_precond!=NULL ? m_precond->Size() : m_ldlt.Size());
+        std::vector<double> r(n), z(n);
+        for(int i=0; i<n; i++) {
+            r[i] = m_R[static_cast<size_t>(i)*m_k + m_col];
+        }
+        if (m_precond!=NULL) {
+            m_precond->Apply(&r[0],&z[0]);
+        } else {
+            m_ldlt.Solve(&r[0],&z[0]);
+        }
+        for(int i=0; i<n; i++) {
+            m_W[static_cast<size_t>(i)*m_k + m_col] = z[i];
+        }
+    }
+
+private:
+    const SkylineLDLT<double>&  m_ldlt;
+    const Preconditioner*  m_precond;
+    const double*  m_R;
+    double*        m_W;
+    int            m_k;
+    int            m_col;
+};
+
+
+static double infinityNorm( const SparseMatrix &A ) {
+    double nrm = 0.0;
+    for(int r=0; r<A.Size(); r++) {
+        double sum = 0.0;
+        for(int k=A.m_rowPtr[r]; k<A.m_rowPtr[r+1]; k++) {
+            sum += std::fabs(A.m_values[k]);
+        }
+        nrm = std::max(nrm,sum);
+    }
+    return nrm;
+}
+
+/**
+ *  Rows [r0,r0+rows) and the given columns of the column-major n x n
+ *  matrix Z as row-major block.
+ */
+static void subMatrix( const std::vector<double> &Z, int n, int r0, int rows,
+                       const std::vector<int> &cols, std::vector<double> &C ) {
+    int k = static_cast<int>(cols.size());
+    C.resize(static_cast<size_t>(rows)*k);
+    for(int a=0; a<rows; a++) {
+        for(int b=0; b<k; b++) {
+            C[static_cast<size_t>(a)*k + b] = Z[static_cast<size_t>(cols[b])*n + r0 + a];
+        }
+    }
+}
+
+
+LOBPCGSolver::LOBPCGSolver( const SparseMatrix &K, const SparseMatrix &M )
+    : m_K(K), m_M(M) {
+    m_seed       = 4711;
+    m_numThreads = 0;
+    m_sigma      = 0.0;
+    m_haveSigma  = false;
+    m_tol        = 1e-9;
+    m_maxIter    = 500;
+    m_pool       = NULL;
+    m_precond    = NULL;
+    m_numX0      = 0;
+    m_numConverged = 0;
+    m_numIter    = 0;
+}
+
+LOBPCGSolver::~LOBPCGSolver() {
+}
+
+// ********************************** public methods *****************************
+
+void LOBPCGSolver::SetOrdering( const std::vector<int> &perm ) {
+    m_perm = perm;
+}
+
+void LOBPCGSolver::SetSeed( unsigned int seed ) {
+    m_seed = seed;
+}
+
+void LOBPCGSolver::SetNumThreads( int num ) {
+    m_numThreads = num;
+}
+
+void LOBPCGSolver::SetShift( double sigma ) {
+    m_sigma = sigma;
+    m_haveSigma = true;
+}
+
+void LOBPCGSolver::SetPreconditioner( const Preconditioner* T ) {
+    m_precond = T;
+}
+
+void LOBPCGSolver::SetTolerance( double tol ) {
+    m_tol = tol;
+}
+
+void LOBPCGSolver::SetMaxIterations( int num ) {
+    m_maxIter = std::max(1,num);
+}
+
+void LOBPCGSolver::SetInitialVectors( const double* X, int num ) {
+    size_t n = static_cast<size_t>(m_K.Size());
+    m_numX0 = (X!=NULL ? std::max(num,0) : 0);
+    m_X0.assign(X,X + n*m_numX0);
+}
+
+
+bool LOBPCGSolver::Solve( int numModes ) {
+    int n = m_K.Size();
+    m_lambda.clear();
+    m_X.clear();
+    m_numConverged = 0;
+    m_numIter = 0;
+    if (numModes<=0 || n==0) {
+        return (numModes<=0);
+    }
+
+    int nev = std::min(numModes,n);
+    int bs  = std::min(n,nev + std::max(4,nev/4));   // guard vectors speed up convergence of the last modes
+
+    if (m_precond==NULL && !factorizePreconditioner()) {
+        fprintf(stderr,"LOBPCG: no shift below the spectrum found.\n");
+        return false;
+    }
+
+    QThreadPool pool;
+    int numThreads = (m_numThreads>0 ? m_numThreads : QThread::idealThreadCount());
+    pool.setMaxThreadCount(std::max(1,numThreads));
+    m_pool = &pool;
+
+    double normK = infinityNorm(m_K);
+    double normM = infinityNorm(m_M);
+
+    // start block: supplied vectors first, then random columns
+    std::vector<double> X(static_cast<size_t>(n)*bs), KX, MX;
+    int numStart = std::min(m_numX0,bs);
+    for(int i=0; i<n; i++) {
+        for(int b=0; b<bs; b++) {
+            X[static_cast<size_t>(i)*bs + b] = (b<numStart ? m_X0[static_cast<size_t>(b)*n + i] : random());
+        }
+    }
+    multiply(m_M,X,MX,bs);
+    if (orthonormalize(X,MX,NULL,bs)<bs) {
+        // dependent start vectors are replaced by random ones
+        for(size_t i=0; i<X.size(); i++) {
+            X[i] = random();
+        }
+        multiply(m_M,X,MX,bs);
+        if (orthonormalize(X,MX,NULL,bs)<bs) {
+            m_pool = NULL;
+            return false;
+        }
+    }
+    multiply(m_K,X,KX,bs);
+
+    // initial Rayleigh-Ritz
+    std::vector<double> GK, GM, theta(bs), Z;
+    gram(X,bs,KX,bs,GK);
+    gram(X,bs,MX,bs,GM);
+    Z.resize(static_cast<size_t>(bs)*bs);
+    if (!GeneralizedSymmetricEigen(bs,&GK[0],&GM[0],&theta[0],&Z[0])) {
+        m_pool = NULL;
+        return false;
+    }
+    {
+        std::vector<int> all(bs);
+        for(int b=0; b<bs; b++) {
+            all[b] = b;
+        }
+        std::vector<double> C, T;
+        subMatrix(Z,bs,0,bs,all,C);
+        combine(X,bs,C,T,bs,false);   X.swap(T);
+        combine(KX,bs,C,T,bs,false);  KX.swap(T);
+        combine(MX,bs,C,T,bs,false);  MX.swap(T);
+    }
+
+    std::vector<double> R, W, KW, MW, P, KP, MP, T;
+    std::vector<double> rnrm, xnrm, res(bs);
+    std::vector<int> active;
+    int np = 0;
+
+    for(m_numIter=0; m_numIter<m_maxIter; m_numIter++) {
+        // residuals R = KX - MX*diag(theta)
+        R = KX;
+        for(int i=0; i<n; i++) {
+            double* r = &R[static_cast<size_t>(i)*bs];
+            const double* mx = &MX[static_cast<size_t>(i)*bs];
+            for(int b=0; b<bs; b++) {
+                r[b] -= theta[b]*mx[b];
+            }
+        }
+        columnNorms(R,bs,rnrm);
+        columnNorms(X,bs,xnrm);
+
+        active.clear();
+        m_numConverged = 0;
+        for(int b=0; b<bs; b++) {
+            double denom = (normK + std::fabs(theta[b])*normM)*xnrm[b];
+            res[b] = (denom>0.0 ? rnrm[b]/denom : 0.0);
+            if (res[b]>m_tol) {
+                active.push_back(b);
+            } else if (b<nev) {
+                m_numConverged++;
+            }
+        }
+        if (m_numConverged>=nev) {
+            break;
+        }
+        int na = static_cast<int>(active.size());
+
+        // preconditioned residuals of the active columns
+        std::vector<double> Ra(static_cast<size_t>(n)*na);
+        for(int i=0; i<n; i++) {
+            for(int a=0; a<na; a++) {
+                Ra[static_cast<size_t>(i)*na + a] = R[static_cast<size_t>(i)*bs + active[a]];
+            }
+        }
+        precondition(Ra,W,na);
+
+        // W := W - X (MX^T W), then M-orthonormalize
+        std::vector<double> G;
+        gram(MX,bs,W,na,G);
+        for(size_t g=0; g<G.size(); g++) {
+            G[g] = -G[g];
+        }
+        combine(X,bs,G,W,na,true);
+        multiply(m_M,W,MW,na);
+        int nw = orthonormalize(W,MW,NULL,na);
+        if (nw==0) {
+            break;
+        }
+        multiply(m_K,W,KW,nw);
+        if (np>0) {
+            np = orthonormalize(P,MP,&KP,np);
+        }
+
+        // Rayleigh-Ritz on [X,W,P]; without P if its Gram matrix is too ill-conditioned
+        bool solved = false;
+        int m = 0;
+        for(int attempt=0; attempt<2 && !solved; attempt++) {
+            m = bs + nw + np;
+            GK.assign(static_cast<size_t>(m)*m,0.0);
+            GM.assign(static_cast<size_t>(m)*m,0.0);
+            const std::vector<double>* blocks[3]  = { &X,  &W,  &P  };
+            const std::vector<double>* kblocks[3] = { &KX, &KW, &KP };
+            const std::vector<double>* mblocks[3] = { &MX, &MW, &MP };
+            int sizes[3] = { bs, nw, np };
+            int offs[3]  = { 0, bs, bs+nw };
+            for(int u=0; u<3; u++) {
+                for(int v=u; v<3; v++) {
+                    if (sizes[u]==0 || sizes[v]==0) {
+                        continue;
+                    }
+                    // X^T K X = diag(theta), and X, W, P are M-orthonormal
+                    std::vector<double> gk, gm;
+                    if (u!=0 || v!=0) {
+                        gram(*blocks[u],sizes[u],*kblocks[v],sizes[v],gk);
+                    }
+                    if (u!=v) {
+                        gram(*blocks[u],sizes[u],*mblocks[v],sizes[v],gm);
+                    }
+                    for(int a=0; a<sizes[u]; a++) {
+                        for(int b=0; b<sizes[v]; b++) {
+                            size_t r = offs[u]+a;
+                            size_t c = offs[v]+b;
+                            double vk, vm;
+                            if (u==v) {
+                                vk = (u==0 ? (a==b ? theta[a] : 0.0)
+                                           : 0.5*(gk[static_cast<size_t>(a)*sizes[v] + b] + gk[static_cast<size_t>(b)*sizes[v] + a]));
+                                vm = (a==b ? 1.0 : 0.0);
+                            } else {
+                                vk = gk[static_cast<size_t>(a)*sizes[v] + b];
+                                vm = gm[static_cast<size_t>(a)*sizes[v] + b];
+                            }
+                            GK[c*m + r] = GK[r*m + c] = vk;
+                            GM[c*m + r] = GM[r*m + c] = vm;
+                        }
+                    }
+                }
+            }
+            std::vector<double> d(m);
+            Z.resize(static_cast<size_t>(m)*m);
+            solved = GeneralizedSymmetricEigen(m,&GK[0],&GM[0],&d[0],&Z[0]);
+            if (solved) {
+                std::copy(d.begin(),d.begin()+bs,theta.begin());
+            } else if (np>0) {
+                np = 0;
+            } else {
+                break;
+            }
+        }
+        if (!solved) {
+            fprintf(stderr,"LOBPCG: Rayleigh-Ritz failed in iteration %d.\n",m_numIter);
+            break;
+        }
+
+        // new search directions P = W*Cw + P*Cp, then X = X*Cx + P
+        std::vector<int> all(bs);
+        for(int b=0; b<bs; b++) {
+            all[b] = b;
+        }
+        std::vector<double> Cx, Cw, Cp;
+        subMatrix(Z,m,0,bs,all,Cx);
+        subMatrix(Z,m,bs,nw,all,Cw);
+        if (np>0) {
+            subMatrix(Z,m,bs+nw,np,all,Cp);
+        }
+        const std::vector<double>* src[3][3] = { { &X, &W, &P }, { &KX, &KW, &KP }, { &MX, &MW, &MP } };
+        std::vector<double>* dst[3] = { &X, &KX, &MX };
+        std::vector<double>* dir[3] = { &P, &KP, &MP };
+        for(int s=0; s<3; s++) {
+            std::vector<double> D;
+            combine(*src[s][1],nw,Cw,D,bs,false);
+            if (np>0) {
+                combine(*src[s][2],np,Cp,D,bs,true);
+            }
+            combine(*src[s][0],bs,Cx,T,bs,false);
+            for(size_t i=0; i<T.size(); i++) {
+                T[i] += D[i];
+            }
+            dst[s]->swap(T);
+
+            // keep the directions of the active columns only
+            std::vector<double> &Pa = *dir[s];
+            Pa.resize(static_cast<size_t>(n)*na);
+            for(int i=0; i<n; i++) {
+                for(int a=0; a<na; a++) {
+                    Pa[static_cast<size_t>(i)*na + a] = D[static_cast<size_t>(i)*bs + active[a]];
+                }
+            }
+        }
+        np = na;
+    }
+    m_pool = NULL;
+
+    // eigenpairs as M-normalized columns
+    m_lambda.assign(theta.begin(),theta.begin()+nev);
+    m_X.resize(static_cast<size_t>(n)*nev);
+    std::vector<double> mnrm(nev,0.0);
+    for(int i=0; i<n; i++) {
+        for(int b=0; b<nev; b++) {
+            mnrm[b] += X[static_cast<size_t>(i)*bs + b]*MX[static_cast<size_t>(i)*bs + b];
+        }
+    }
+    for(int b=0; b<nev; b++) {
+        double s = (mnrm[b]>0.0 ? 1.0/std::sqrt(mnrm[b]) : 1.0);
+        for(int i=0; i<n; i++) {
+            m_X[static_cast<size_t>(b)*n + i] = s*X[static_cast<size_t>(i)*bs + b];
+        }
+    }
+
+    fprintf(stderr,"LOBPCG: %d of %d eigenpairs converged after %d iterations (block size %d, %s).\n",
+            m_numConverged,nev,m_numIter,bs,(m_precond!=NULL ? "preconditioner set" : "skyline preconditioner"));
+    return (m_numConverged>=nev);
+}
+
+double LOBPCGSolver::DefaultShift( const SparseMatrix &K, const SparseMatrix &M ) {
+    // diag(K)/diag(M) estimates the upper end of the spectrum
+    double trK = 0.0, trM = 0.0;
+    for(int i=0; i<K.Size(); i++) {
+        trK += K.GetValue(i,i);
+        trM += M.GetValue(i,i);
+    }
+    double step = (trM>0.0 ? 1e-3*std::fabs(trK/trM) : 1.0);
+    return (step>0.0 ? -step : -1.0);
+}
+
+// ********************************* protected methods *****************************
+
+double LOBPCGSolver::random() {
+    // linear congruential generator, see ShiftInvertLanczos
+    m_seed = m_seed*1664525u + 1013904223u;
+    return static_cast<double>(m_seed)/4294967296.0 - 0.5;
+}
+
+
+bool LOBPCGSolver::factorizePreconditioner() {
+    if (m_perm.empty()) {
+        m_ldlt.Analyze(m_K);
+    } else {
+        m_ldlt.SetOrdering(m_K,m_perm);
+    }
+
+    double step = -DefaultShift(m_K,m_M);
+    if (!m_haveSigma) {
+        m_sigma = -step;
+    }
+
+    for(int iter=0; iter<20; iter++) {
+        m_ldlt.Factorize(m_K,m_M,1.0,-m_sigma);
+        if (m_ldlt.NumNegativePivots()==0 && m_ldlt.NumPerturbedPivots()==0) {
+            return true;
+        }
+        m_sigma -= std::max(std::fabs(m_sigma),step);
+    }
+    return false;
+}
+
+
+void LOBPCGSolver::forRows( const BlockOp &op, std::vector<double>* sum ) {
+    int n = m_K.Size();
+    int numJobs = (m_pool!=NULL ? std::min(m_pool->maxThreadCount(),n/minRowsPerThread) : 1);
+    numJobs = std::max(1,numJobs);
+
+    std::vector<BlockJob*> jobs;
+    for(int j=0; j<numJobs; j++) {
+        int r0 = static_cast<int>(static_cast<long long>(n)*j/numJobs);
+        int r1 = static_cast<int>(static_cast<long long>(n)*(j+1)/numJobs);
+        jobs.push_back(new BlockJob(op,r0,r1));
+    }
+    if (numJobs==1) {
+        jobs[0]->run();
+    } else {
+        for(int j=0; j<numJobs; j++) {
+            m_pool->start(jobs[j]);
+        }
+        m_pool->waitForDone();
+    }
+
+    if (sum!=NULL) {
+        *sum = jobs[0]->Sum();
+        for(int j=1; j<numJobs; j++) {
+            const std::vector<double> &s = jobs[j]->Sum();
+            for(size_t k=0; k<s.size(); k++) {
+                (*sum)[k] += s[k];
+            }
+        }
+    }
+    for(int j=0; j<numJobs; j++) {
+        delete jobs[j];
+    }
+}
+
+
+void LOBPCGSolver::multiply( const SparseMatrix &A, const std::vector<double> &X, std::vector<double> &Y, int k ) {
+    Y.resize(static_cast<size_t>(A.Size())*k);
+    if (k==0) {
+        return;
+    }
+    BlockOp op;
+    op.op = BlockOp::op_multiply;
+    op.A  = &A;
+    op.X  = &X[0];
+    op.kx = k;
+    op.Y  = &Y[0];
+    forRows(op,NULL);
+}
+
+
+void LOBPCGSolver::gram( const std::vector<double> &A, int ka, const std::vector<double> &B, int kb,
+                         std::vector<double> &G ) {
+    if (ka==0 || kb==0) {
+        G.clear();
+        return;
+    }
+    BlockOp op;
+    op.op = BlockOp::op_gram;
+    op.X  = &A[0];
+    op.kx = ka;
+    op.Y  = const_cast<double*>(&B[0]);
+    op.ky = kb;
+    forRows(op,&G);
+}
+
+
+void LOBPCGSolver::combine( const std::vector<double> &A, int ka, const std::vector<double> &C,
+                            std::vector<double> &Y, int ky, bool accumulate ) {
+    size_t n = static_cast<size_t>(m_K.Size());
+    if (!accumulate || Y.size()!=n*ky) {
+        Y.assign(n*ky,0.0);
+    }
+    if (ka==0 || ky==0) {
+        return;
+    }
+    BlockOp op;
+    op.op = BlockOp::op_combine;
+    op.X  = &A[0];
+    op.kx = ka;
+    op.Y  = &Y[0];
+    op.ky = ky;
+    op.C  = &C[0];
+    op.accumulate = accumulate;
+    forRows(op,NULL);
+}
+
+
+void LOBPCGSolver::columnNorms( const std::vector<double> &A, int k, std::vector<double> &nrm ) {
+    BlockOp op;
+    op.op = BlockOp::op_norms;
+    op.X  = &A[0];
+    op.kx = k;
+    forRows(op,&nrm);
+    for(int a=0; a<k; a++) {
+        nrm[a] = std::sqrt(nrm[a]);
+    }
+}
+
+
+void LOBPCGSolver::precondition( const std::vector<double> &R, std::vector<double> &W, int k ) {
+    W.resize(R.size());
+    std::vector<PrecondJob*> jobs;
+    for(int c=0; c<k; c++) {
+        jobs.push_back(new PrecondJob(m_ldlt,m_precond,&R[0],&W[0],k,c));
+    }
+    for(int c=0; c<k; c++) {
+        if (m_pool!=NULL && k>1) {
+            m_pool->start(jobs[c]);
+        } else {
+            jobs[c]->run();
+        }
+    }
+    if (m_pool!=NULL) {
+        m_pool->waitForDone();
+    }
+    for(int c=0; c<k; c++) {
+        delete jobs[c];
+    }
+}
+
+
+int LOBPCGSolver::orthonormalize( std::vector<double> &V, std::vector<double> &MV,
+                                  std::vector<double>* KV, int k ) {
+    if (k==0) {
+        return 0;
+    }
+    std::vector<double> G;
+    gram(V,k,MV,k,G);
+
+    // scaled Gram matrix D G D with D = diag(G)^{-1/2}
+    std::vector<double> D(k,0.0);
+    for(int a=0; a<k; a++) {
+        double g = G[static_cast<size_t>(a)*k + a];
+        D[a] = (g>0.0 ? 1.0/std::sqrt(g) : 0.0);
+    }
+    for(int a=0; a<k; a++) {
+        for(int b=0; b<k; b++) {
+            G[static_cast<size_t>(a)*k + b] *= D[a]*D[b];
+        }
+    }
+    for(int a=0; a<k; a++) {
+        for(int b=a+1; b<k; b++) {
+            double s = 0.5*(G[static_cast<size_t>(a)*k + b] + G[static_cast<size_t>(b)*k + a]);
+            G[static_cast<size_t>(a)*k + b] = G[static_cast<size_t>(b)*k + a] = s;
+        }
+    }
+
+    std::vector<double> d(k), Z(static_cast<size_t>(k)*k);
+    SymmetricEigen(k,&G[0],&d[0],&Z[0]);
+
+    // keep directions well above round-off
+    double dmax = d[k-1];
+    std::vector<int> keep;
+    for(int j=0; j<k; j++) {
+        if (d[j]>1e-12*dmax && d[j]>0.0) {
+            keep.push_back(j);
+        }
+    }
+    int nk = static_cast<int>(keep.size());
+    if (nk==0) {
+        V.clear();
+        MV.clear();
+        if (KV!=NULL) {
+            KV->clear();
+        }
+        return 0;
+    }
+
+    std::vector<double> C(static_cast<size_t>(k)*nk);
+    for(int a=0; a<k; a++) {
+        for(int b=0; b<nk; b++) {
+            int j = keep[b];
+            C[static_cast<size_t>(a)*nk + b] = D[a]*Z[static_cast<size_t>(j)*k + a]/std::sqrt(d[j]);
+        }
+    }
+
+    std::vector<double> T;
+    combine(V,k,C,T,nk,false);
+    V.swap(T);
+    combine(MV,k,C,T,nk,false);
+    MV.swap(T);
+    if (KV!=NULL) {
+        combine(*KV,k,C,T,nk,false);
+        KV->swap(T);
+    }
+    return nk;
+}
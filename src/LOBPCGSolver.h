@@ -0,0 +1,179 @@
+/**
+    @file   LOBPCGSolver.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef NUMCHLADNI_LOBPCG_SOLVER_H
+#define NUMCHLADNI_LOBPCG_SOLVER_H
+
+#include <vector>
+
+#include "SparseMatrix.h"
+#include "SkylineLDLT.h"
+#include "Preconditioner.h"
+
+class QThreadPool;
+struct BlockOp;
+
+/**
+ * @brief Block solver (LOBPCG) for the lowest eigenpairs of  K x = lambda M x.
+ *
+ *   A block of vectors X is improved by Rayleigh-Ritz on [X,W,P], where
+ *   W = T*R are the preconditioned residuals and P the previous search
+ *   directions. The preconditioner T = (K - sigma*M)^{-1} is applied with
+ *   a skyline LDL^T factorization; sigma must lie below the wanted
+ *   eigenvalues, which is checked by inertia. Another preconditioner,
+ *   e.g. multigrid, can be set instead.
+ *
+ *   Blocks are stored row-major, so sparse matrix-block products and
+ *   Gram matrices run over contiguous rows. These kernels and the
+ *   preconditioner solves are distributed over a thread pool.
+ *
+ *   Initial vectors, e.g. the eigenvectors of a previous solve, can be
+ *   supplied; the remaining columns of the block are random.
+ *   Eigenvectors are M-normalized, like the ones returned by dsygv.
+ */
+class LOBPCGSolver
+{
+public:
+    LOBPCGSolver( const SparseMatrix &K, const SparseMatrix &M );
+    ~LOBPCGSolver();
+
+    // --------- public methods -----------
+public:
+    /** Use a precomputed fill-reducing ordering for the preconditioner.
+     * \param perm  new -> old index, see ReverseCuthillMcKee
+     */
+    void  SetOrdering( const std::vector<int> &perm );
+
+    /** Seed of the random start vectors.
+     */
+    void  SetSeed( unsigned int seed );
+
+    /** Number of worker threads; 0 uses the number of cores.
+     */
+    void  SetNumThreads( int num );
+
+    /** Shift of the preconditioner, below the wanted eigenvalues.
+     *   By default, a small negative shift relative to diag(K)/diag(M) is used.
+     */
+    void  SetShift( double sigma );
+
+    /** Use T instead of the skyline factorization; T is not owned.
+     */
+    void  SetPreconditioner( const Preconditioner* T );
+
+    /** Relative residual  |K x - lambda M x| / ((|K| + |lambda| |M|) |x|)  for convergence.
+     */
+    void  SetTolerance( double tol );
+
+    void  SetMaxIterations( int num );
+
+    /** Start vectors for the next Solve.
+     * \param X    num columns of length K.Size()
+     * \param num  number of columns
+     */
+    void  SetInitialVectors( const double* X, int num );
+
+    /** Compute the numModes lowest eigenpairs.
+     * \return true if all of them converged
+     */
+    bool  Solve( int numModes );
+
+    int   NumFound() const  { return static_cast<int>(m_lambda.size()); }
+    int   NumConverged() const  { return m_numConverged; }
+    int   NumIterations() const  { return m_numIter; }
+
+    /** Eigenvalues in ascending order.
+     */
+    const std::vector<double>&  Eigenvalues() const  { return m_lambda; }
+
+    /** Eigenvectors, NumFound() columns of length K.Size().
+     */
+    const std::vector<double>&  Eigenvectors() const  { return m_X; }
+
+    /** Default shift:  -1e-3 * trace(K)/trace(M).
+     */
+    static double  DefaultShift( const SparseMatrix &K, const SparseMatrix &M );
+
+protected:
+    double  random();
+
+    /** Factorize K - sigma*M; lower sigma until the inertia is zero.
+     */
+    bool    factorizePreconditioner();
+
+    /** Run a block kernel over all rows, split among the threads.
+     */
+    void    forRows( const BlockOp &op, std::vector<double>* sum );
+
+    /** Y = A*X for a block with k columns.
+     */
+    void    multiply( const SparseMatrix &A, const std::vector<double> &X, std::vector<double> &Y, int k );
+
+    /** G = A^T B, row-major ka x kb.
+     */
+    void    gram( const std::vector<double> &A, int ka, const std::vector<double> &B, int kb,
+                  std::vector<double> &G );
+
+    /** Y = (accumulate ? Y : 0) + A*C, C row-major ka x ky.
+     */
+    void    combine( const std::vector<double> &A, int ka, const std::vector<double> &C,
+                     std::vector<double> &Y, int ky, bool accumulate );
+
+    /** Euclidean norm of every column.
+     */
+    void    columnNorms( const std::vector<double> &A, int k, std::vector<double> &nrm );
+
+    /** W = T*R column by column.
+     */
+    void    precondition( const std::vector<double> &R, std::vector<double> &W, int k );
+
+    /** M-orthonormalize the columns of V (SVQB); linearly dependent columns are dropped.
+     *   MV = M*V is transformed alike, and KV if not NULL.
+     * \return  number of remaining columns
+     */
+    int     orthonormalize( std::vector<double> &V, std::vector<double> &MV,
+                            std::vector<double>* KV, int k );
+
+    // -------- private attributes --------
+private:
+    const SparseMatrix&  m_K;
+    const SparseMatrix&  m_M;
+    std::vector<int>     m_perm;
+    unsigned int         m_seed;
+    int                  m_numThreads;
+    double               m_sigma;
+    bool                 m_haveSigma;
+    double               m_tol;
+    int                  m_maxIter;
+    QThreadPool*         m_pool;
+    const Preconditioner*  m_precond;
+
+    SkylineLDLT<double>  m_ldlt;
+    std::vector<double>  m_X0;
+    int                  m_numX0;
+    std::vector<double>  m_lambda;
+    std::vector<double>  m_X;
+    int                  m_numConverged;
+    int                  m_numIter;
+};
+
+#endif // NUMCHLADNI_LOBPCG_SOLVER_H
@@ -0,0 +1,177 @@
+/**
+    @file   LivePreview.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <algorithm>
+
+#include <QMetaObject>
+#include <QRunnable>
+
+#include "LivePreview.h"
+#include "LOBPCGSolver.h"
+
+static const double previewTolerance = 1e-6;
+static const int    previewMaxIter   = 100;
+
+/**
+ *  Boundary marker of an output vertex of triangle, see SystemData::MarkerFromTag.
+ */
+static int markerFromTag( const PreviewInput &input, int tag ) {
+    if (tag>=2 && tag-2<static_cast<int>(input.pointMarkers.size())) {
+        return input.pointMarkers[tag-2];
+    } else if (tag<=-2 && -tag-2<static_cast<int>(input.segmentMarkers.size())) {
+        return input.segmentMarkers[-tag-2];
+    }
+    return tag;
+}
+
+
+/**
+ *  Mesh, assemble, and solve one preview.
+ */
+class PreviewJob : public QRunnable
+{
+public:
+    PreviewJob( QObject* owner, const PreviewInput &input )
+        : m_owner(owner), m_input(input) {
+        setAutoDelete(false);
+    }
+
+    virtual void run() {
+        compute();
+        QMetaObject::invokeMethod(m_owner,"jobFinished",Qt::QueuedConnection);
+    }
+
+    PreviewResult&  Result()  { return m_result; }
+
+protected:
+    void compute() {
+        PreviewResult &res = m_result;
+        if (!Mesher::Triangulate(m_input.switches.c_str(),m_input.geom,NULL,res.mesh)) {
+            return;
+        }
+
+        // midside nodes: opposite to the corners in triangle, after them in FEMesh
+        FEMesh &mesh = res.feMesh;
+        int npe = res.mesh.nodesPerElem;
+        mesh.nodesPerElem = npe;
+        mesh.pos   = res.mesh.pos;
+        mesh.elems = res.mesh.elems;
+        if (npe==6) {
+            for(int t=0; t<mesh.NumElems(); t++) {
+                const int* tri = &res.mesh.elems[t*6];
+                mesh.elems[t*6+3] = tri[5];
+                mesh.elems[t*6+4] = tri[3];
+                mesh.elems[t*6+5] = tri[4];
+            }
+        }
+        mesh.bmarker.resize(mesh.NumNodes());
+        for(int i=0; i<mesh.NumNodes(); i++) {
+            mesh.bmarker[i] = markerFromTag(m_input,res.mesh.tags[i]);
+        }
+
+        SparseMatrix K, M;
+        FEAssembler::BuildDofMap(mesh,res.dofs);
+        if (res.dofs.NumDofs()==0) {
+            return;
+        }
+        FEAssembler::Assemble(mesh,res.dofs,m_input.opts,K,M);
+
+        LOBPCGSolver solver(K,M);
+        solver.SetNumThreads(1);
+        solver.SetTolerance(previewTolerance);
+        solver.SetMaxIterations(previewMaxIter);
+        solver.Solve(m_input.numModes);
+        res.lambda = solver.Eigenvalues();
+        res.X = solver.Eigenvectors();
+        res.ok = !res.lambda.empty();
+    }
+
+private:
+    QObject*       m_owner;
+    PreviewInput   m_input;
+    PreviewResult  m_result;
+};
+
+// ********************************** LivePreview *****************************
+
+LivePreview::LivePreview( QObject* parent )
+    : QObject(parent) {
+    m_pool.setMaxThreadCount(1);
+    m_job = NULL;
+    m_jobEpoch = 0;
+    m_epoch = 0;
+    m_havePending = false;
+}
+
+LivePreview::~LivePreview() {
+    m_pool.waitForDone();
+    if (m_job!=NULL) {
+        delete m_job;
+    }
+}
+
+// ********************************** public methods *****************************
+
+void LivePreview::Request( const PreviewInput &input ) {
+    m_pending = input;
+    m_havePending = true;
+    if (m_job==NULL) {
+        startJob();
+    }
+}
+
+
+void LivePreview::Cancel() {
+    m_havePending = false;
+    m_epoch++;
+}
+
+// ********************************* protected methods *****************************
+
+void LivePreview::jobFinished() {
+    if (m_job==NULL) {
+        return;
+    }
+    m_pool.waitForDone();
+    bool keep = (m_jobEpoch==m_epoch && m_job->Result().ok);
+    if (keep) {
+        std::swap(m_result,m_job->Result());
+    }
+    delete m_job;
+    m_job = NULL;
+
+    // a newer geometry may already be waiting
+    if (m_havePending) {
+        startJob();
+    }
+    if (keep) {
+        emit ready();
+    }
+}
+
+
+void LivePreview::startJob() {
+    m_job = new PreviewJob(this,m_pending);
+    m_jobEpoch = m_epoch;
+    m_havePending = false;
+    m_pool.start(m_job);
+}
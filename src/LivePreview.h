@@ -0,0 +1,119 @@
+/**
+    @file   LivePreview.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_LIVE_PREVIEW_H
+#define NUMCHLADNI_LIVE_PREVIEW_H
+
+#include <string>
+#include <vector>
+
+#include <QObject>
+#include <QThreadPool>
+
+#include "FEAssembler.h"
+#include "Mesher.h"
+
+class PreviewJob;
+
+/**
+ * @brief Everything a preview is computed from; a copy of the input geometry.
+ */
+struct PreviewInput
+{
+    MeshGeometry      geom;
+    std::vector<int>  pointMarkers;     //!< boundary marker of input point i (tag i+2)
+    std::vector<int>  segmentMarkers;   //!< boundary marker of segment i (tag -(i+2))
+    std::string       switches;         //!< triangle switches of the coarse mesh, 'o2' for quadratic elements
+    FEOptions         opts;
+    int               numModes;
+};
+
+
+/**
+ * @brief Coarse mesh and its lowest eigenpairs.
+ */
+struct PreviewResult
+{
+    bool                 ok;
+    TriMesh              mesh;
+    FEMesh               feMesh;   //!< mesh with boundary markers
+    DofMap               dofs;
+    std::vector<double>  lambda;   //!< eigenvalues in ascending order
+    std::vector<double>  X;        //!< eigenvectors over the dofs, lambda.size() columns
+
+    PreviewResult() : ok(false) {}
+};
+
+
+/**
+ * @brief Background preview of the lowest modes while the geometry is edited.
+ *
+ *   One preview is computed at a time in a worker thread: a coarse mesh
+ *   by the reentrant Mesher, the sparse operators, and a few LOBPCG modes.
+ *   Requests that arrive meanwhile replace each other, so only the latest
+ *   geometry is computed next. Signal ready() is emitted in the thread of
+ *   the LivePreview object.
+ */
+class LivePreview : public QObject
+{
+    Q_OBJECT
+
+public:
+    LivePreview( QObject* parent = 0 );
+    virtual ~LivePreview();
+
+    // --------- public methods -----------
+public:
+    /** Compute a preview of input as soon as the running one is finished.
+     */
+    void  Request( const PreviewInput &input );
+
+    /** Drop the pending request; the result of the running one is discarded.
+     */
+    void  Cancel();
+
+    bool  IsBusy() const  { return (m_job!=NULL); }
+
+    /** Result of the last finished preview.
+     */
+    const PreviewResult&  Result() const  { return m_result; }
+
+signals:
+    void  ready();
+
+protected slots:
+    void  jobFinished();
+
+protected:
+    void  startJob();
+
+    // -------- private attributes --------
+private:
+    QThreadPool    m_pool;
+    PreviewJob*    m_job;
+    quint64        m_jobEpoch;     //!< m_epoch when m_job was started
+    quint64        m_epoch;        //!< incremented by Cancel
+    PreviewInput   m_pending;
+    bool           m_havePending;
+    PreviewResult  m_result;
+};
+
+#endif // NUMCHLADNI_LIVE_PREVIEW_H
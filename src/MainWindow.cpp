@@ -28,6 +28,7 @@
 #include <QMenuBar>
 #include <QMessageBox>
 #include <QSettings>
+#include <QTextStream>
 
 QScriptValue func_toRadians( QScriptContext *context, QScriptEngine * ) {
     QScriptValue a = context->argument(0);
@@ -74,6 +75,40 @@ void MainWindow::IgnoreTessShaderAvailability() {
     mOGLProps->SetOGLParams();
 }
 
+void MainWindow::SetHeadless() {
+    mData->m_headless = true;
+    // thousands of eigenvalues would flood the log of a batch run
+    mData->m_printEV  = false;
+}
+
+bool MainWindow::ExecScriptFile( QString filename ) {
+    QFile scriptFile(filename);
+    if (!scriptFile.open(QIODevice::ReadOnly)) {
+        fprintf(stderr,"Cannot open script file %s.\n",filename.toStdString().c_str());
+        return false;
+    }
+
+    if (!mData->m_headless) {
+        scriptFile.close();
+        mScriptEditor->loadScript(filename);
+        mScriptEditor->execScript(filename);
+        return true;
+    }
+
+    QTextStream stream(&scriptFile);
+    QString contents = stream.readAll();
+    scriptFile.close();
+
+    QScriptValue result = mScriptEngine->evaluate(contents,filename);
+    if (result.isError()) {
+        fprintf(stderr,"%s:%d: %s\n",filename.toStdString().c_str(),
+                result.property("lineNumber").toInt32(),
+                result.toString().toStdString().c_str());
+        return false;
+    }
+    return true;
+}
+
 // *********************************** public slots ******************************
 void MainWindow::quit() {
     close();
@@ -157,6 +192,10 @@ void MainWindow::initConnects() {
 
     connect( mOpenGL, SIGNAL(addCtrlPoint(double,double)),  mCtrlMesh, SLOT(addPoint(double,double)) );
     connect( mOpenGL, SIGNAL(moveCtrlPoint(double,double)), mCtrlMesh, SLOT(movePoint(double,double)) );
+    // after movePoint, which updates the geometry
+    connect( mOpenGL, SIGNAL(moveCtrlPoint(double,double)), mControl, SLOT(PreviewMesh()) );
+    connect( mOpenGL, SIGNAL(grabCtrlPoint()),              mControl, SLOT(GrabPreview()) );
+    connect( mOpenGL, SIGNAL(releaseCtrlPoint()),           mControl, SLOT(FinishPreview()) );
     connect( mOpenGL, SIGNAL(delCtrlPoint(int)),   mCtrlMesh, SLOT(delPoint(int)) );
     connect( mOpenGL, SIGNAL(checkCtrlPoint(int)), mCtrlMesh, SLOT(checkPoint(int)) );
     connect( mOpenGL, SIGNAL(setActivePoint(int)), mCtrlMesh, SLOT(setActive(int)) );
@@ -60,6 +60,16 @@ public:
 
     void   IgnoreTessShaderAvailability();
 
+    /** Run without OpenGL output (batch mode).
+     */
+    void   SetHeadless();
+
+    /** Execute script file.
+     *   In headless mode, script errors are reported on stderr.
+     * \param filename  script file name
+     */
+    bool   ExecScriptFile( QString filename );
+
 
 // --------- protected methods -----------
 protected:
@@ -0,0 +1,530 @@
+/**
+    @file   Mesher.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <algorithm>
+
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include "Mesher.h"
+
+extern "C" {
+#include "triangle.h"
+}
+
+/**
+ *  Free a list triangle allocated.
+ */
+static void freeList( void* data ) {
+    if (data!=NULL) {
+        trifree(data);
+    }
+}
+
+/**
+ *  Take over the output of triangle and free its lists.
+ *  The hole and region lists alias the input and are not freed.
+ */
+static bool takeOutput( struct triangulateio &out, TriMesh &mesh ) {
+    mesh.nodesPerElem = out.numberofcorners;
+    mesh.pos.resize(out.numberofpoints);
+    mesh.tags.resize(out.numberofpoints);
+    for(int i=0; i<out.numberofpoints; i++) {
+        mesh.pos[i]  = glm::dvec2(out.pointlist[2*i+0],out.pointlist[2*i+1]);
+        mesh.tags[i] = (out.pointmarkerlist!=NULL ? out.pointmarkerlist[i] : 0);
+    }
+    mesh.elems.assign(out.trianglelist,out.trianglelist + out.numberofcorners*out.numberoftriangles);
+    mesh.segments.assign(out.segmentlist,out.segmentlist + 2*out.numberofsegments);
+    mesh.segmentTags.assign(out.segmentmarkerlist,out.segmentmarkerlist + out.numberofsegments);
+
+    freeList(out.pointlist);
+    freeList(out.pointattributelist);
+    freeList(out.pointmarkerlist);
+    freeList(out.trianglelist);
+    freeList(out.triangleattributelist);
+    freeList(out.trianglearealist);
+    freeList(out.neighborlist);
+    freeList(out.segmentlist);
+    freeList(out.segmentmarkerlist);
+    freeList(out.edgelist);
+    freeList(out.edgemarkerlist);
+    return (out.numberoftriangles>0);
+}
+
+/**
+ *  Run triangle with the size field active in the calling thread.
+ */
+static bool run( const char* switches, struct triangulateio &in, const SizeField* field, TriMesh &mesh ) {
+    std::string sw(switches);
+    if (field!=NULL && !field->IsEmpty()) {
+        sw += "u";
+    } else {
+        field = NULL;
+    }
+    std::vector<char> buf(sw.begin(),sw.end());
+    buf.push_back('\0');
+
+    struct triangulateio out;
+    memset(&out,0,sizeof(struct triangulateio));
+    SizeField::SetActive(field);
+    triangulate(&buf[0],&in,&out,(struct triangulateio*)NULL);
+    SizeField::SetActive(NULL);
+    return takeOutput(out,mesh);
+}
+
+/**
+ *  Area switch; triangle does not parse exponents.
+ */
+static std::string areaSwitch( double area ) {
+    char buf[64];
+#if defined _WIN32 && !defined __MINGW32__
+    sprintf_s(buf, 64, "a%.12f", area);
+#else
+    sprintf(buf,"a%.12f",area);
+#endif
+    return std::string(buf);
+}
+
+//! Coarse triangles per part of TriangulateParts
+static const int coarseTrisPerPart = 64;
+
+//! Tag of the segments between parts; triangle reserves 1 for unmarked boundaries
+static const int interfaceTag = -1;
+
+
+/**
+ *  Triangulation of one part in a worker thread.
+ */
+class PartJob : public QRunnable
+{
+public:
+    PartJob( const std::string &switches, const SizeField* field )
+        : m_switches(switches), m_field(field), m_ok(false) {
+        setAutoDelete(false);
+    }
+
+    virtual void run() {
+        m_ok = Mesher::Triangulate(m_switches.c_str(),geom,m_field,mesh);
+    }
+
+    bool IsOk() const  { return m_ok; }
+
+    MeshGeometry      geom;
+    std::vector<int>  inputToGlobal;   //!< global node of every input point
+    TriMesh           mesh;
+
+private:
+    std::string       m_switches;
+    const SizeField*  m_field;
+    bool              m_ok;
+};
+
+// ********************************** public methods *****************************
+
+bool Mesher::Triangulate( const char* switches, const MeshGeometry &geom,
+                          const SizeField* field, TriMesh &mesh ) {
+    int numPoints = static_cast<int>(geom.points.size());
+    if (numPoints<3) {
+        return false;
+    }
+    std::vector<REAL> pointlist(2*numPoints), holelist(2*geom.holes.size()+2);
+    std::vector<int>  pointmarkers(numPoints,0);
+    std::vector<int>  segmentlist(geom.segments), segmentmarkers(geom.segmentTags);
+    for(int i=0; i<numPoints; i++) {
+        pointlist[2*i+0] = static_cast<REAL>(geom.points[i].x);
+        pointlist[2*i+1] = static_cast<REAL>(geom.points[i].y);
+        if (i<static_cast<int>(geom.pointTags.size())) {
+            pointmarkers[i] = geom.pointTags[i];
+        }
+    }
+    for(size_t i=0; i<geom.holes.size(); i++) {
+        holelist[2*i+0] = static_cast<REAL>(geom.holes[i].x);
+        holelist[2*i+1] = static_cast<REAL>(geom.holes[i].y);
+    }
+    int numSegs = static_cast<int>(segmentlist.size())/2;
+    segmentmarkers.resize(numSegs,0);
+    segmentlist.resize(2*numSegs+2);
+    segmentmarkers.resize(numSegs+1);
+
+    struct triangulateio in;
+    memset(&in,0,sizeof(struct triangulateio));
+    in.numberofpoints    = numPoints;
+    in.pointlist         = &pointlist[0];
+    in.pointmarkerlist   = &pointmarkers[0];
+    in.numberofsegments  = numSegs;
+    in.segmentlist       = &segmentlist[0];
+    in.segmentmarkerlist = &segmentmarkers[0];
+    in.numberofholes     = static_cast<int>(geom.holes.size());
+    in.holelist          = &holelist[0];
+    in.numberofcorners   = 3;
+    return run(switches,in,field,mesh);
+}
+
+
+bool Mesher::Refine( const char* switches, const TriMesh &coarse, const std::vector<double> &maxAreas,
+                     const SizeField* field, TriMesh &mesh ) {
+    if (coarse.nodesPerElem!=3 || coarse.NumElems()==0 || &coarse==&mesh) {
+        return false;
+    }
+    int numPoints = coarse.NumNodes();
+    int numTris   = coarse.NumElems();
+    bool withAreas = (static_cast<int>(maxAreas.size())==numTris);
+
+    std::vector<REAL> pointlist(2*numPoints), arealist(withAreas ? numTris : 1);
+    std::vector<int>  pointmarkers(numPoints,0);
+    std::vector<int>  trianglelist(coarse.elems);
+    std::vector<int>  segmentlist(coarse.segments), segmentmarkers(coarse.segmentTags);
+    for(int i=0; i<numPoints; i++) {
+        pointlist[2*i+0] = static_cast<REAL>(coarse.pos[i].x);
+        pointlist[2*i+1] = static_cast<REAL>(coarse.pos[i].y);
+        if (i<static_cast<int>(coarse.tags.size())) {
+            pointmarkers[i] = coarse.tags[i];
+        }
+    }
+    for(int t=0; withAreas && t<numTris; t++) {
+        arealist[t] = static_cast<REAL>(maxAreas[t]);
+    }
+    int numSegs = static_cast<int>(segmentlist.size())/2;
+    segmentmarkers.resize(numSegs,0);
+    segmentlist.resize(2*numSegs+2);
+    segmentmarkers.resize(numSegs+1);
+
+    struct triangulateio in;
+    memset(&in,0,sizeof(struct triangulateio));
+    in.numberofpoints    = numPoints;
+    in.pointlist         = &pointlist[0];
+    in.pointmarkerlist   = &pointmarkers[0];
+    in.numberoftriangles = numTris;
+    in.numberofcorners   = 3;
+    in.trianglelist      = &trianglelist[0];
+    in.trianglearealist  = (withAreas ? &arealist[0] : (REAL*)NULL);
+    in.numberofsegments  = numSegs;
+    in.segmentlist       = &segmentlist[0];
+    in.segmentmarkerlist = &segmentmarkers[0];
+    return run(switches,in,field,mesh);
+}
+
+
+bool Mesher::TriangulateParts( const MeshGeometry &geom, const char* quality, double maxArea,
+                               bool convexHull, bool quadratic, const SizeField* field,
+                               int numParts, TriMesh &mesh ) {
+    if (numParts<2 || maxArea<=0.0) {
+        return false;
+    }
+    if (field!=NULL && field->IsEmpty()) {
+        field = NULL;
+    }
+    std::string base = std::string("zpQ") + (convexHull ? "c" : "");
+
+    // the coarse mesh gets about coarseTrisPerPart triangles per part
+    TriMesh cdt, coarse;
+    if (!Triangulate(base.c_str(),geom,NULL,cdt)) {
+        return false;
+    }
+    double total = 0.0;
+    for(int t=0; t<cdt.NumElems(); t++) {
+        const int* idx = &cdt.elems[3*t];
+        glm::dvec2 e1 = cdt.pos[idx[1]] - cdt.pos[idx[0]];
+        glm::dvec2 e2 = cdt.pos[idx[2]] - cdt.pos[idx[0]];
+        total += 0.5*std::fabs(e1.x*e2.y - e1.y*e2.x);
+    }
+    double coarseArea = total/(coarseTrisPerPart*numParts);
+    if (coarseArea<16.0*maxArea) {
+        return false;
+    }
+    if (!Triangulate((base + quality + areaSwitch(coarseArea)).c_str(),geom,NULL,coarse)) {
+        return false;
+    }
+    int numCoarse = coarse.NumElems();
+    int numInput  = static_cast<int>(geom.points.size());
+
+    // strips along the longer side, by the centroids of the coarse triangles
+    glm::dvec2 lo = coarse.pos[0], hi = coarse.pos[0];
+    for(int i=1; i<coarse.NumNodes(); i++) {
+        lo = glm::min(lo,coarse.pos[i]);
+        hi = glm::max(hi,coarse.pos[i]);
+    }
+    int axis = (hi.x-lo.x >= hi.y-lo.y ? 0 : 1);
+    std::vector< std::pair<double,int> > order(numCoarse);
+    for(int t=0; t<numCoarse; t++) {
+        const int* idx = &coarse.elems[3*t];
+        glm::dvec2 c = (coarse.pos[idx[0]] + coarse.pos[idx[1]] + coarse.pos[idx[2]])/3.0;
+        order[t] = std::make_pair(c[axis],t);
+    }
+    std::sort(order.begin(),order.end());
+    numParts = std::min(numParts,numCoarse);
+    std::vector<int> part(numCoarse);
+    for(int k=0; k<numCoarse; k++) {
+        part[order[k].second] = static_cast<int>(static_cast<long long>(k)*numParts/numCoarse);
+    }
+
+    // coarse edges; edgeTris[2*e+1] is -1 on the boundary
+    std::map< std::pair<int,int>, int > edgeIdx;
+    std::vector<int> edgeNodes, edgeTris;
+    for(int t=0; t<numCoarse; t++) {
+        for(int j=0; j<3; j++) {
+            int a = coarse.elems[3*t+j], b = coarse.elems[3*t+(j+1)%3];
+            std::pair<int,int> key(std::min(a,b),std::max(a,b));
+            std::map< std::pair<int,int>, int >::iterator it = edgeIdx.find(key);
+            if (it==edgeIdx.end()) {
+                edgeIdx[key] = static_cast<int>(edgeTris.size())/2;
+                edgeNodes.push_back(key.first);
+                edgeNodes.push_back(key.second);
+                edgeTris.push_back(t);
+                edgeTris.push_back(-1);
+            } else {
+                edgeTris[2*it->second+1] = t;
+            }
+        }
+    }
+    int numEdges = static_cast<int>(edgeTris.size())/2;
+    std::vector<int> edgeTag(numEdges,0);
+    for(size_t s=0; s<coarse.segmentTags.size(); s++) {
+        int a = coarse.segments[2*s+0], b = coarse.segments[2*s+1];
+        std::map< std::pair<int,int>, int >::iterator it = edgeIdx.find(std::make_pair(std::min(a,b),std::max(a,b)));
+        if (it!=edgeIdx.end()) {
+            edgeTag[it->second] = coarse.segmentTags[s];
+        }
+    }
+
+    // global nodes: coarse nodes, then the points dividing the constrained edges
+    mesh = TriMesh();
+    mesh.nodesPerElem = (quadratic ? 6 : 3);
+    mesh.pos  = coarse.pos;
+    mesh.tags = coarse.tags;
+    std::vector<int> edgeFirst(numEdges,-1), edgeCount(numEdges,0);
+    for(int e=0; e<numEdges; e++) {
+        int t0 = edgeTris[2*e+0], t1 = edgeTris[2*e+1];
+        bool isInterface = (t1>=0 && part[t0]!=part[t1]);
+        if (!isInterface && t1>=0 && edgeTag[e]==0) {
+            continue;
+        }
+        if (isInterface && edgeTag[e]==0) {
+            edgeTag[e] = interfaceTag;
+        }
+        // hull edges without segment (switch 'c') are boundary edges as well
+        if (t1<0 && edgeTag[e]==0) {
+            edgeTag[e] = 1;
+        }
+        const glm::dvec2 &a = coarse.pos[edgeNodes[2*e+0]];
+        const glm::dvec2 &b = coarse.pos[edgeNodes[2*e+1]];
+        double area = maxArea;
+        if (field!=NULL) {
+            area = std::min(area,field->MaxArea(0.5*(a+b)));
+        }
+        // about the edge length of a triangle of that area
+        double h = std::sqrt(2.0*area);
+        int n = std::max(1,static_cast<int>(std::ceil(glm::length(b-a)/h)));
+        edgeFirst[e] = mesh.NumNodes();
+        edgeCount[e] = n - 1;
+        for(int k=1; k<n; k++) {
+            mesh.pos.push_back(a + (b-a)*(static_cast<double>(k)/n));
+            mesh.tags.push_back(edgeTag[e]==interfaceTag ? 0 : edgeTag[e]);
+        }
+    }
+
+    // geometry of every part: its constrained edges, its input points, and
+    // holes in the coarse triangles of the other parts
+    std::string sw = std::string("zpQY") + quality + areaSwitch(maxArea) + (quadratic ? "o2" : "");
+    std::vector<PartJob*> jobs(numParts);
+    for(int p=0; p<numParts; p++) {
+        jobs[p] = new PartJob(sw,field);
+    }
+    std::vector<int> local(mesh.NumNodes(),-1), localPart(mesh.NumNodes(),-1), edgePart(numEdges,-1);
+    for(int p=0; p<numParts; p++) {
+        PartJob* job = jobs[p];
+        for(int t=0; t<numCoarse; t++) {
+            const int* idx = &coarse.elems[3*t];
+            if (part[t]!=p) {
+                job->geom.holes.push_back((coarse.pos[idx[0]] + coarse.pos[idx[1]] + coarse.pos[idx[2]])/3.0);
+                continue;
+            }
+            for(int j=0; j<3; j++) {
+                int a = idx[j], b = idx[(j+1)%3];
+                int e = edgeIdx[std::make_pair(std::min(a,b),std::max(a,b))];
+                bool constrained = (edgeFirst[e]>=0);
+                int ends[2] = { edgeNodes[2*e+0], edgeNodes[2*e+1] };
+                for(int m=0; m<2; m++) {
+                    int v = ends[m];
+                    if (localPart[v]!=p && (v<numInput || constrained)) {
+                        localPart[v] = p;
+                        local[v] = static_cast<int>(job->geom.points.size());
+                        job->geom.points.push_back(mesh.pos[v]);
+                        job->geom.pointTags.push_back(mesh.tags[v]);
+                        job->inputToGlobal.push_back(v);
+                    }
+                }
+                if (!constrained || edgePart[e]==p) {
+                    continue;
+                }
+                edgePart[e] = p;
+                int prev = local[ends[0]];
+                for(int k=0; k<=edgeCount[e]; k++) {
+                    int next = local[ends[1]];
+                    if (k<edgeCount[e]) {
+                        int v = edgeFirst[e] + k;
+                        next = static_cast<int>(job->geom.points.size());
+                        job->geom.points.push_back(mesh.pos[v]);
+                        job->geom.pointTags.push_back(mesh.tags[v]);
+                        job->inputToGlobal.push_back(v);
+                    }
+                    job->geom.segments.push_back(prev);
+                    job->geom.segments.push_back(next);
+                    job->geom.segmentTags.push_back(edgeTag[e]);
+                    prev = next;
+                }
+            }
+        }
+        job->geom.holes.insert(job->geom.holes.end(),geom.holes.begin(),geom.holes.end());
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(std::min(numParts,std::max(1,QThread::idealThreadCount())));
+    for(int p=0; p<numParts; p++) {
+        pool.start(jobs[p]);
+    }
+    pool.waitForDone();
+
+    // merge: input points are known, midside nodes are shared by their corners
+    bool ok = true;
+    std::map< std::pair<int,int>, int > midside;
+    std::map< std::pair<int,int>, int > segs;
+    int npe = mesh.nodesPerElem;
+    for(int p=0; p<numParts && ok; p++) {
+        const TriMesh &pm = jobs[p]->mesh;
+        ok = jobs[p]->IsOk() && pm.nodesPerElem==npe;
+        if (!ok) {
+            break;
+        }
+        std::vector<int> toGlobal(pm.NumNodes(),-1);
+        for(size_t i=0; i<jobs[p]->inputToGlobal.size(); i++) {
+            toGlobal[i] = jobs[p]->inputToGlobal[i];
+        }
+        for(int t=0; t<pm.NumElems(); t++) {
+            for(int j=0; j<3; j++) {
+                int v = pm.elems[t*npe+j];
+                if (toGlobal[v]<0) {
+                    toGlobal[v] = mesh.NumNodes();
+                    mesh.pos.push_back(pm.pos[v]);
+                    mesh.tags.push_back(pm.tags[v]==interfaceTag ? 0 : pm.tags[v]);
+                }
+            }
+        }
+        for(int t=0; t<pm.NumElems(); t++) {
+            const int* idx = &pm.elems[t*npe];
+            for(int j=0; j<3; j++) {
+                mesh.elems.push_back(toGlobal[idx[j]]);
+            }
+            // midside node 3+j lies opposite to corner j
+            for(int j=3; j<npe; j++) {
+                int a = toGlobal[idx[(j-2)%3]], b = toGlobal[idx[(j-1)%3]];
+                std::pair<int,int> key(std::min(a,b),std::max(a,b));
+                std::map< std::pair<int,int>, int >::iterator it = midside.find(key);
+                if (it==midside.end()) {
+                    int v = idx[j];
+                    it = midside.insert(std::make_pair(key,mesh.NumNodes())).first;
+                    mesh.pos.push_back(pm.pos[v]);
+                    mesh.tags.push_back(pm.tags[v]==interfaceTag ? 0 : pm.tags[v]);
+                }
+                mesh.elems.push_back(it->second);
+            }
+        }
+        for(size_t s=0; s<pm.segmentTags.size(); s++) {
+            int a = toGlobal[pm.segments[2*s+0]], b = toGlobal[pm.segments[2*s+1]];
+            if (pm.segmentTags[s]!=interfaceTag && a>=0 && b>=0) {
+                segs[std::make_pair(std::min(a,b),std::max(a,b))] = pm.segmentTags[s];
+            }
+        }
+    }
+    for(std::map< std::pair<int,int>, int >::iterator it=segs.begin(); it!=segs.end(); ++it) {
+        mesh.segments.push_back(it->first.first);
+        mesh.segments.push_back(it->first.second);
+        mesh.segmentTags.push_back(it->second);
+    }
+
+    for(int p=0; p<numParts; p++) {
+        delete jobs[p];
+    }
+    if (!ok) {
+        mesh = TriMesh();
+        return false;
+    }
+
+    // drop the coarse nodes inside the parts
+    std::vector<int> newIdx(mesh.NumNodes(),-1);
+    for(size_t k=0; k<mesh.elems.size(); k++) {
+        newIdx[mesh.elems[k]] = 0;
+    }
+    int numUsed = 0;
+    for(int i=0; i<mesh.NumNodes(); i++) {
+        if (newIdx[i]==0) {
+            mesh.pos[numUsed]  = mesh.pos[i];
+            mesh.tags[numUsed] = mesh.tags[i];
+            newIdx[i] = numUsed++;
+        }
+    }
+    mesh.pos.resize(numUsed);
+    mesh.tags.resize(numUsed);
+    for(size_t k=0; k<mesh.elems.size(); k++) {
+        mesh.elems[k] = newIdx[mesh.elems[k]];
+    }
+    for(size_t k=0; k<mesh.segments.size(); k++) {
+        mesh.segments[k] = newIdx[mesh.segments[k]];
+    }
+    fprintf(stderr,"Meshed %d parts: %d nodes, %d triangles\n",numParts,mesh.NumNodes(),mesh.NumElems());
+    return true;
+}
+
+
+void Mesher::Corners( const TriMesh &mesh, TriMesh &linear ) {
+    int npe = mesh.nodesPerElem;
+    std::vector<int> newIdx(mesh.NumNodes(),-1);
+    TriMesh lin;
+    lin.nodesPerElem = 3;
+    for(int t=0; t<mesh.NumElems(); t++) {
+        for(int j=0; j<3; j++) {
+            int v = mesh.elems[t*npe+j];
+            if (newIdx[v]<0) {
+                newIdx[v] = lin.NumNodes();
+                lin.pos.push_back(mesh.pos[v]);
+                lin.tags.push_back(v<static_cast<int>(mesh.tags.size()) ? mesh.tags[v] : 0);
+            }
+            lin.elems.push_back(newIdx[v]);
+        }
+    }
+    for(size_t i=0; i<mesh.segmentTags.size(); i++) {
+        int p1 = newIdx[mesh.segments[2*i+0]];
+        int p2 = newIdx[mesh.segments[2*i+1]];
+        if (p1>=0 && p2>=0) {
+            lin.segments.push_back(p1);
+            lin.segments.push_back(p2);
+            lin.segmentTags.push_back(mesh.segmentTags[i]);
+        }
+    }
+    linear = lin;
+}
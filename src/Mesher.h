@@ -0,0 +1,129 @@
+/**
+    @file   Mesher.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef NUMCHLADNI_MESHER_H
+#define NUMCHLADNI_MESHER_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "SizeField.h"
+
+/**
+ * @brief Planar straight line graph to be triangulated.
+ *
+ *   Tags are passed to triangle as boundary markers; output vertices
+ *   inherit the tag of the input point or segment they lie on.
+ */
+struct MeshGeometry
+{
+    std::vector<glm::dvec2>  points;
+    std::vector<int>         pointTags;     //!< 0: left to triangle
+    std::vector<int>         segments;      //!< two point indices per segment
+    std::vector<int>         segmentTags;
+    std::vector<glm::dvec2>  holes;
+};
+
+
+/**
+ * @brief Triangulation owned by the caller.
+ *
+ *   The node order of the triangles is the one of triangle: three
+ *   corners, then the midside nodes opposite to them.
+ */
+struct TriMesh
+{
+    int                      nodesPerElem;  //!< 3 or 6
+    std::vector<glm::dvec2>  pos;
+    std::vector<int>         tags;          //!< point markers of triangle
+    std::vector<int>         elems;
+    std::vector<int>         segments;      //!< boundary edges, two nodes each
+    std::vector<int>         segmentTags;
+
+    TriMesh() : nodesPerElem(3) {}
+
+    int  NumNodes() const  { return static_cast<int>(pos.size()); }
+    int  NumElems() const  { return static_cast<int>(elems.size())/nodesPerElem; }
+};
+
+
+/**
+ * @brief Reentrant interface to the triangle library.
+ *
+ *   All state lives in the arguments and in triangle's per-call mesh, and
+ *   the few globals of triangle.c are thread local. Hence, several
+ *   threads may mesh at the same time, each into its own TriMesh.
+ *   Note that triangle still terminates the process on internal errors.
+ */
+class Mesher
+{
+public:
+    /** Triangulate a planar straight line graph.
+     * \param switches  triangle switches; 'u' is added if field is not NULL
+     * \param geom      input geometry
+     * \param field     local maximum area or NULL
+     * \param mesh      output triangulation
+     * \return  false if triangle produced no triangles
+     */
+    static bool  Triangulate( const char* switches, const MeshGeometry &geom,
+                              const SizeField* field, TriMesh &mesh );
+
+    /** Refine a linear triangulation (switch 'r').
+     *   The segments of coarse are kept with their tags, so new boundary
+     *   vertices get the tags of the segments they split.
+     * \param switches  triangle switches, must contain 'r'
+     * \param coarse    linear triangulation
+     * \param maxAreas  maximum area per triangle (switch 'a' without number), or empty
+     * \param field     local maximum area or NULL
+     * \param mesh      output triangulation; may not be coarse
+     * \return  false if triangle produced no triangles
+     */
+    static bool  Refine( const char* switches, const TriMesh &coarse, const std::vector<double> &maxAreas,
+                         const SizeField* field, TriMesh &mesh );
+
+    /** Triangulate by domain decomposition; the parts are meshed concurrently.
+     *   A coarse triangulation is split into strips of about equal numbers
+     *   of triangles. The edges between the strips and on the segments are
+     *   divided beforehand according to maxArea (or the size field), and
+     *   triangle does not insert points on them (switch 'Y'), so the
+     *   meshes of the parts fit together. Shared corner and midside nodes
+     *   are merged into one conforming mesh.
+     * \param geom        input geometry
+     * \param quality     additional switches for every part, e.g. "q30D"
+     * \param maxArea     maximum triangle area, must be positive
+     * \param convexHull  triangulate the convex hull (switch 'c')
+     * \param quadratic   generate midside nodes (switch 'o2')
+     * \param field       local maximum area or NULL
+     * \param numParts    number of parts
+     * \param mesh        output triangulation
+     * \return  false if the geometry is too small to be split or meshing failed
+     */
+    static bool  TriangulateParts( const MeshGeometry &geom, const char* quality, double maxArea,
+                                   bool convexHull, bool quadratic, const SizeField* field,
+                                   int numParts, TriMesh &mesh );
+
+    /** Linear mesh of the corners of a quadratic one, with segments and tags.
+     */
+    static void  Corners( const TriMesh &mesh, TriMesh &linear );
+};
+
+#endif // NUMCHLADNI_MESHER_H
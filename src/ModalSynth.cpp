@@ -0,0 +1,228 @@
+/**
+    @file   ModalSynth.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <algorithm>
+
+#include "ModalSynth.h"
+
+// modes up to this fraction of the sample rate are rendered
+static const double nyquistFraction = 0.45;
+
+// about 6 ms at 44.1 kHz
+static const int defaultBlockSize = 256;
+
+// modes below this fraction of the total amplitude are silenced
+static const double silenceFraction = 1e-7;
+
+ModalSynth::ModalSynth() {
+    m_rate = 44100;
+    m_baseFreq = 220.0;
+    m_zeta = 0.0;
+    m_blockSize = defaultBlockSize;
+}
+
+ModalSynth::~ModalSynth() {
+}
+
+// ********************************** public methods *****************************
+
+void ModalSynth::SetModes( int num, const double* lambda ) {
+    m_lambda.assign(lambda,lambda+std::max(num,0));
+    update();
+}
+
+
+void ModalSynth::SetSampleRate( int rate ) {
+    m_rate = std::max(rate,1);
+    update();
+}
+
+
+void ModalSynth::SetBaseFrequency( double hz ) {
+    m_baseFreq = std::max(hz,0.0);
+    update();
+}
+
+
+void ModalSynth::SetDamping( double zeta ) {
+    m_zeta = std::max(zeta,0.0);
+    update();
+}
+
+
+void ModalSynth::Reset() {
+    std::fill(m_state.begin(),m_state.end(),std::complex<double>(0.0,0.0));
+}
+
+
+void ModalSynth::Strike( const std::vector<double> &a ) {
+    for(size_t k=0; k<m_mode.size(); k++) {
+        if (m_mode[k]<static_cast<int>(a.size())) {
+            m_state[k] += a[m_mode[k]];
+        }
+    }
+}
+
+
+void ModalSynth::Render( float* out, int numSamples ) {
+    for(int s=0; s<numSamples; s+=m_blockSize) {
+        renderBlock(out+s,std::min(m_blockSize,numSamples-s));
+    }
+}
+
+
+double ModalSynth::Bound() const {
+    double sum = 0.0;
+    for(size_t k=0; k<m_state.size(); k++) {
+        sum += std::abs(m_state[k]);
+    }
+    return sum;
+}
+
+// ********************************* protected methods *****************************
+
+void ModalSynth::update() {
+    // the state of modes that stay audible is kept
+    std::vector< std::complex<double> > oldState(m_lambda.size(),std::complex<double>(0.0,0.0));
+    for(size_t k=0; k<m_mode.size(); k++) {
+        if (m_mode[k]<static_cast<int>(m_lambda.size())) {
+            oldState[m_mode[k]] = m_state[k];
+        }
+    }
+
+    double lambdaLow = 0.0;
+    for(size_t n=0; n<m_lambda.size(); n++) {
+        if (m_lambda[n]>0.0 && (lambdaLow==0.0 || m_lambda[n]<lambdaLow)) {
+            lambdaLow = m_lambda[n];
+        }
+    }
+
+    m_mode.clear();
+    m_rot.clear();
+    m_state.clear();
+    for(size_t n=0; n<m_lambda.size() && lambdaLow>0.0; n++) {
+        if (m_lambda[n]<=0.0) {
+            continue;
+        }
+        double f = m_baseFreq*std::sqrt(m_lambda[n]/lambdaLow);
+        if (f>=nyquistFraction*m_rate) {
+            continue;
+        }
+        double omega = 2.0*M_PI*f;
+        m_mode.push_back(static_cast<int>(n));
+        m_rot.push_back(std::exp(std::complex<double>(-m_zeta*omega,omega)/static_cast<double>(m_rate)));
+        m_state.push_back(oldState[n]);
+    }
+
+    size_t padded = (m_mode.size() + LANES - 1)/LANES*LANES;
+    m_re.assign(padded,0.0f);
+    m_im.assign(padded,0.0f);
+    m_rotRe.assign(padded,0.0f);
+    m_rotIm.assign(padded,0.0f);
+    m_acc.assign(m_blockSize*LANES,0.0f);
+}
+
+
+void ModalSynth::renderBlock( float* out, int numSamples ) {
+    int num = static_cast<int>(m_mode.size());
+    int padded = static_cast<int>(m_re.size());
+
+    // decayed modes are silenced before their single precision values
+    // become denormal, which would slow down the whole block
+    double floor = silenceFraction*Bound();
+    for(int k=0; k<num; k++) {
+        if (std::abs(m_state[k])<floor) {
+            m_state[k] = 0.0;
+        }
+        m_re[k] = static_cast<float>(m_state[k].real());
+        m_im[k] = static_cast<float>(m_state[k].imag());
+        m_rotRe[k] = static_cast<float>(m_rot[k].real());
+        m_rotIm[k] = static_cast<float>(m_rot[k].imag());
+    }
+
+    // partial sums per sample and lane, reduced at the end of the block
+    float* acc = &m_acc[0];
+    std::fill(acc,acc+numSamples*LANES,0.0f);
+    for(int k=0; k<padded; k+=LANES) {
+        // a group of LANES oscillators is kept in registers over the block;
+        // the lanes are independent, so the inner loop vectorizes
+        float re[LANES], im[LANES], cr[LANES], ci[LANES];
+        for(int l=0; l<LANES; l++) {
+            re[l] = m_re[k+l];
+            im[l] = m_im[k+l];
+            cr[l] = m_rotRe[k+l];
+            ci[l] = m_rotIm[k+l];
+        }
+        for(int s=0; s<numSamples; s++) {
+            float* a = acc + s*LANES;
+            for(int l=0; l<LANES; l++) {
+                float r = re[l];
+                a[l] += r;
+                re[l] = r*cr[l] - im[l]*ci[l];
+                im[l] = r*ci[l] + im[l]*cr[l];
+            }
+        }
+    }
+    for(int s=0; s<numSamples; s++) {
+        float sum = 0.0f;
+        for(int l=0; l<LANES; l++) {
+            sum += acc[s*LANES+l];
+        }
+        out[s] = sum;
+    }
+
+    // exact state at the end of the block
+    for(int k=0; k<num; k++) {
+        m_state[k] *= std::pow(m_rot[k],numSamples);
+    }
+}
+
+
+#ifdef HAVE_AUDIO
+ModalSynthDevice::ModalSynthDevice( ModalSynth* synth, QObject* parent )
+    : QIODevice(parent), m_synth(synth) {
+    m_gain = 1.0;
+}
+
+qint64 ModalSynthDevice::bytesAvailable() const {
+    return QIODevice::bytesAvailable() + m_synth->BlockSize()*static_cast<qint64>(sizeof(qint16));
+}
+
+qint64 ModalSynthDevice::readData( char* data, qint64 maxlen ) {
+    int num = static_cast<int>(maxlen/sizeof(qint16));
+    if (num<=0) {
+        return 0;
+    }
+    m_buffer.resize(num);
+    m_synth->Render(&m_buffer[0],num);
+    qint16* pcm = reinterpret_cast<qint16*>(data);
+    for(int s=0; s<num; s++) {
+        double v = std::max(-1.0,std::min(1.0,m_gain*m_buffer[s]));
+        pcm[s] = static_cast<qint16>(32767.0*v);
+    }
+    return num*static_cast<qint64>(sizeof(qint16));
+}
+
+qint64 ModalSynthDevice::writeData( const char*, qint64 ) {
+    return 0;
+}
+#endif // HAVE_AUDIO
@@ -0,0 +1,162 @@
+/**
+    @file   ModalSynth.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_MODAL_SYNTH_H
+#define NUMCHLADNI_MODAL_SYNTH_H
+
+#include <vector>
+#include <complex>
+
+#ifdef HAVE_AUDIO
+#include <QIODevice>
+#endif
+
+/**
+ * @brief Sound of the plate as a bank of damped oscillators, one per mode.
+ *
+ *   A strike of amplitude a at p with the pickup at r excites mode n with
+ *   a x_n(p) x_n(r), where x_n is M-normalized. The output is the velocity
+ *   at the pickup,
+ *
+ *     v(t) = sum_n  a x_n(p) x_n(r) e^{-zeta omega_n t} cos(omega_n t).
+ *
+ *   The lowest mode with a positive eigenvalue sounds at the base frequency,
+ *   the others at sqrt(lambda_n/lambda_low) times it; modes above 0.45 times
+ *   the sample rate are dropped.
+ *
+ *   Render works in blocks of at most BlockSize() samples. Within a block,
+ *   the oscillators rotate in single precision, with the modes in groups of
+ *   LANES independent sums that the compiler vectorizes. At every block
+ *   boundary they restart from the exact double precision state, so the
+ *   rounding errors do not accumulate, and a strike is heard at the next
+ *   block, i.e. with a latency of at most one block.
+ */
+class ModalSynth
+{
+public:
+    ModalSynth();
+    ~ModalSynth();
+
+    enum { LANES = 8 };
+
+    // --------- public methods -----------
+public:
+    /** Eigenvalues of the modes, in the units of the solution.
+     */
+    void  SetModes( int num, const double* lambda );
+
+    void  SetSampleRate( int rate );
+    int   SampleRate() const  { return m_rate; }
+
+    /** Frequency in Hz of the lowest mode.
+     */
+    void  SetBaseFrequency( double hz );
+
+    /** Modal damping ratio of all modes.
+     */
+    void  SetDamping( double zeta );
+
+    /** Silence all modes.
+     */
+    void  Reset();
+
+    /** Add a strike to the current state.
+     * \param a  excitation per mode, a x_n(p) x_n(r)
+     */
+    void  Strike( const std::vector<double> &a );
+
+    /** Render the next numSamples samples.
+     */
+    void  Render( float* out, int numSamples );
+
+    /** Number of modes below the Nyquist limit.
+     */
+    int   NumAudible() const  { return static_cast<int>(m_mode.size()); }
+
+    int   BlockSize() const  { return m_blockSize; }
+
+    /** Sum of the absolute excitations, an upper bound of the output.
+     */
+    double  Bound() const;
+
+protected:
+    /** Frequencies and decay rates of the audible modes.
+     */
+    void  update();
+
+    /** Render at most one block.
+     */
+    void  renderBlock( float* out, int numSamples );
+
+    // -------- private attributes --------
+private:
+    std::vector<double>  m_lambda;
+    int                  m_rate;
+    double               m_baseFreq;
+    double               m_zeta;
+    int                  m_blockSize;
+
+    std::vector<int>     m_mode;     //!< audible modes
+    std::vector< std::complex<double> >  m_rot;     //!< e^{(-sigma + i omega)/rate} per audible mode
+    std::vector< std::complex<double> >  m_state;   //!< oscillator state at the block boundary
+
+    // single precision oscillators of the block, padded to a multiple of LANES
+    std::vector<float>   m_re;
+    std::vector<float>   m_im;
+    std::vector<float>   m_rotRe;
+    std::vector<float>   m_rotIm;
+    std::vector<float>   m_acc;      //!< partial sums of the block per lane
+};
+
+
+#ifdef HAVE_AUDIO
+/**
+ * @brief Pull-mode audio source for QAudioOutput rendering a ModalSynth.
+ *
+ *   The output asks for as many bytes as its buffer has room for, so the
+ *   latency is bounded by the buffer size of the QAudioOutput.
+ */
+class ModalSynthDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    ModalSynthDevice( ModalSynth* synth, QObject* parent = 0 );
+
+    virtual bool isSequential() const  { return true; }
+    virtual qint64 bytesAvailable() const;
+
+    /** Scale of the samples, which are clipped to [-1,1].
+     */
+    void  SetGain( double gain )  { m_gain = gain; }
+
+protected:
+    virtual qint64 readData( char* data, qint64 maxlen );
+    virtual qint64 writeData( const char* data, qint64 len );
+
+private:
+    ModalSynth*         m_synth;
+    double              m_gain;
+    std::vector<float>  m_buffer;
+};
+#endif // HAVE_AUDIO
+
+#endif // NUMCHLADNI_MODAL_SYNTH_H
@@ -0,0 +1,296 @@
+/**
+    @file   Multigrid.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+#include "Multigrid.h"
+
+/**
+ *  Barycentric coordinates of p with respect to the triangle (a,b,c).
+ */
+static void barycentric( const glm::dvec2 &p, const glm::dvec2 &a, const glm::dvec2 &b,
+                         const glm::dvec2 &c, double* l ) {
+    double det = (b.x-a.x)*(c.y-a.y) - (c.x-a.x)*(b.y-a.y);
+    if (det==0.0) {
+        l[0] = l[1] = l[2] = -1.0;
+        return;
+    }
+    l[1] = ((p.x-a.x)*(c.y-a.y) - (c.x-a.x)*(p.y-a.y))/det;
+    l[2] = ((b.x-a.x)*(p.y-a.y) - (p.x-a.x)*(b.y-a.y))/det;
+    l[0] = 1.0 - l[1] - l[2];
+}
+
+// ********************************** Interpolation *****************************
+
+void Interpolation::Build( const FEMesh &coarse, const DofMap &coarseDofs,
+                           const FEMesh &fine, const DofMap &fineDofs ) {
+    int numTris = coarse.NumElems();
+    int npe = coarse.nodesPerElem;
+
+    // bucket grid over the coarse triangles
+    glm::dvec2 lo = coarse.pos[0], hi = coarse.pos[0];
+    for(int i=1; i<coarse.NumNodes(); i++) {
+        lo = glm::min(lo,coarse.pos[i]);
+        hi = glm::max(hi,coarse.pos[i]);
+    }
+    int nb = std::max(1,static_cast<int>(std::sqrt(static_cast<double>(numTris))));
+    glm::dvec2 cell = (hi - lo)/static_cast<double>(nb);
+    cell.x = (cell.x>0.0 ? cell.x : 1.0);
+    cell.y = (cell.y>0.0 ? cell.y : 1.0);
+
+    std::vector< std::vector<int> > buckets(static_cast<size_t>(nb)*nb);
+    for(int t=0; t<numTris; t++) {
+        const int* idx = &coarse.elems[t*npe];
+        glm::dvec2 tlo = glm::min(coarse.pos[idx[0]],glm::min(coarse.pos[idx[1]],coarse.pos[idx[2]]));
+        glm::dvec2 thi = glm::max(coarse.pos[idx[0]],glm::max(coarse.pos[idx[1]],coarse.pos[idx[2]]));
+        int x0 = std::max(0,std::min(nb-1,static_cast<int>((tlo.x-lo.x)/cell.x)));
+        int x1 = std::max(0,std::min(nb-1,static_cast<int>((thi.x-lo.x)/cell.x)));
+        int y0 = std::max(0,std::min(nb-1,static_cast<int>((tlo.y-lo.y)/cell.y)));
+        int y1 = std::max(0,std::min(nb-1,static_cast<int>((thi.y-lo.y)/cell.y)));
+        for(int y=y0; y<=y1; y++) {
+            for(int x=x0; x<=x1; x++) {
+                buckets[static_cast<size_t>(y)*nb + x].push_back(t);
+            }
+        }
+    }
+
+    int numFine = fineDofs.NumDofs();
+    rowPtr.assign(numFine+1,0);
+    colIdx.clear();
+    values.clear();
+    double l[3], bl[3];
+    for(int i=0; i<numFine; i++) {
+        const glm::dvec2 &p = fine.pos[fineDofs.dofToNode[i]];
+        int cx = std::max(0,std::min(nb-1,static_cast<int>((p.x-lo.x)/cell.x)));
+        int cy = std::max(0,std::min(nb-1,static_cast<int>((p.y-lo.y)/cell.y)));
+
+        // search rings of buckets around p until a triangle contains it
+        int best = -1;
+        double bestMin = -1e300;
+        for(int ring=0; ring<nb && bestMin<-1e-9; ring++) {
+            for(int y=cy-ring; y<=cy+ring; y++) {
+                for(int x=cx-ring; x<=cx+ring; x++) {
+                    if (x<0 || y<0 || x>=nb || y>=nb || (std::abs(x-cx)!=ring && std::abs(y-cy)!=ring)) {
+                        continue;
+                    }
+                    const std::vector<int> &bucket = buckets[static_cast<size_t>(y)*nb + x];
+                    for(size_t k=0; k<bucket.size(); k++) {
+                        const int* idx = &coarse.elems[bucket[k]*npe];
+                        barycentric(p,coarse.pos[idx[0]],coarse.pos[idx[1]],coarse.pos[idx[2]],l);
+                        double lmin = std::min(l[0],std::min(l[1],l[2]));
+                        if (lmin>bestMin) {
+                            bestMin = lmin;
+                            best = bucket[k];
+                            bl[0] = l[0];  bl[1] = l[1];  bl[2] = l[2];
+                        }
+                    }
+                }
+            }
+            // a nearby triangle is good enough for nodes on a curved hole boundary
+            if (best>=0 && ring>=1) {
+                break;
+            }
+        }
+
+        if (best>=0) {
+            double sum = 0.0;
+            for(int j=0; j<3; j++) {
+                bl[j] = std::max(bl[j],0.0);
+                sum += bl[j];
+            }
+            for(int j=0; j<3; j++) {
+                bl[j] = (sum>0.0 ? bl[j]/sum : 1.0/3.0);
+            }
+
+            // shape functions; midside node 3+j lies between corners j and j+1
+            double w[6];
+            if (npe==6) {
+                for(int j=0; j<3; j++) {
+                    w[j]   = bl[j]*(2.0*bl[j] - 1.0);
+                    w[3+j] = 4.0*bl[j]*bl[(j+1)%3];
+                }
+            } else {
+                w[0] = bl[0];  w[1] = bl[1];  w[2] = bl[2];
+            }
+            const int* idx = &coarse.elems[best*npe];
+            for(int j=0; j<npe; j++) {
+                int dof = coarseDofs.nodeToDof[idx[j]];
+                if (dof>=0 && std::fabs(w[j])>1e-14) {
+                    colIdx.push_back(dof);
+                    values.push_back(w[j]);
+                }
+            }
+        }
+        rowPtr[i+1] = static_cast<int>(colIdx.size());
+    }
+}
+
+
+void Interpolation::Prolongate( const double* x, double* y, int numFine ) const {
+    for(int i=0; i<numFine; i++) {
+        double sum = 0.0;
+        for(int k=rowPtr[i]; k<rowPtr[i+1]; k++) {
+            sum += values[k]*x[colIdx[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+
+void Interpolation::Restrict( const double* x, double* y, int numCoarse ) const {
+    std::fill(y,y+numCoarse,0.0);
+    int numFine = static_cast<int>(rowPtr.size()) - 1;
+    for(int i=0; i<numFine; i++) {
+        for(int k=rowPtr[i]; k<rowPtr[i+1]; k++) {
+            y[colIdx[k]] += values[k]*x[i];
+        }
+    }
+}
+
+// ********************************** MultigridPreconditioner *****************************
+
+MultigridPreconditioner::MultigridPreconditioner() {
+    m_numSmooth = 2;
+}
+
+MultigridPreconditioner::~MultigridPreconditioner() {
+}
+
+// ********************************** public methods *****************************
+
+void MultigridPreconditioner::SetSmoothingSteps( int num ) {
+    m_numSmooth = std::max(1,num);
+}
+
+
+bool MultigridPreconditioner::Setup( const std::vector<FEMesh> &coarse, const FEMesh &fine, const DofMap &fineDofs,
+                                     const SparseMatrix &K, const SparseMatrix &M, const FEOptions &opts, double sigma ) {
+    int numLevels = static_cast<int>(coarse.size()) + 1;
+    m_levels.clear();
+    m_levels.resize(numLevels);
+
+    std::vector<DofMap> dofs(numLevels);
+    for(int l=0; l<numLevels-1; l++) {
+        SparseMatrix Kc, Mc;
+        FEAssembler::BuildDofMap(coarse[l],dofs[l]);
+        FEAssembler::Assemble(coarse[l],dofs[l],opts,Kc,Mc);
+        shiftedOperator(Kc,Mc,sigma,m_levels[l]);
+    }
+    dofs[numLevels-1] = fineDofs;
+    shiftedOperator(K,M,sigma,m_levels[numLevels-1]);
+
+    for(int l=1; l<numLevels; l++) {
+        const FEMesh &fmesh = (l==numLevels-1 ? fine : coarse[l]);
+        m_levels[l].P.Build(coarse[l-1],dofs[l-1],fmesh,dofs[l]);
+    }
+
+    m_coarse.Analyze(m_levels[0].A);
+    m_coarse.Factorize(m_levels[0].A,SparseMatrix(),1.0,0.0);
+
+    fprintf(stderr,"Multigrid: %d levels, dofs",numLevels);
+    for(int l=0; l<numLevels; l++) {
+        fprintf(stderr," %d",LevelSize(l));
+    }
+    fprintf(stderr,"\n");
+    return (m_coarse.NumNegativePivots()==0 && m_coarse.NumPerturbedPivots()==0);
+}
+
+
+void MultigridPreconditioner::Apply( const double* r, double* z ) const {
+    if (m_levels.empty()) {
+        return;
+    }
+    vcycle(NumLevels()-1,r,z);
+}
+
+
+int MultigridPreconditioner::Size() const {
+    return (m_levels.empty() ? 0 : LevelSize(NumLevels()-1));
+}
+
+
+int MultigridPreconditioner::LevelSize( int l ) const {
+    return m_levels[l].A.Size();
+}
+
+// ********************************* protected methods *****************************
+
+void MultigridPreconditioner::vcycle( int l, const double* r, double* z ) const {
+    if (l==0) {
+        m_coarse.Solve(r,z);
+        return;
+    }
+
+    const Level &lev = m_levels[l];
+    int n  = lev.A.Size();
+    int nc = m_levels[l-1].A.Size();
+    std::fill(z,z+n,0.0);
+    for(int s=0; s<m_numSmooth; s++) {
+        smooth(lev,r,z,true);
+    }
+
+    // coarse grid correction
+    std::vector<double> res(n), rc(nc), zc(nc), dz(n);
+    lev.A.Multiply(z,&res[0]);
+    for(int i=0; i<n; i++) {
+        res[i] = r[i] - res[i];
+    }
+    lev.P.Restrict(&res[0],&rc[0],nc);
+    vcycle(l-1,&rc[0],&zc[0]);
+    lev.P.Prolongate(&zc[0],&dz[0],n);
+    for(int i=0; i<n; i++) {
+        z[i] += dz[i];
+    }
+
+    for(int s=0; s<m_numSmooth; s++) {
+        smooth(lev,r,z,false);
+    }
+}
+
+
+void MultigridPreconditioner::smooth( const Level &lev, const double* r, double* z, bool forward ) const {
+    const SparseMatrix &A = lev.A;
+    int n = A.Size();
+    for(int c=0; c<n; c++) {
+        int i = (forward ? c : n-1-c);
+        double sum = r[i];
+        for(int k=A.m_rowPtr[i]; k<A.m_rowPtr[i+1]; k++) {
+            sum -= A.m_values[k]*z[A.m_colIdx[k]];
+        }
+        z[i] += sum*lev.invDiag[i];
+    }
+}
+
+
+void MultigridPreconditioner::shiftedOperator( const SparseMatrix &K, const SparseMatrix &M, double sigma, Level &lev ) {
+    lev.A = K;
+    for(size_t k=0; k<lev.A.m_values.size(); k++) {
+        lev.A.m_values[k] -= sigma*M.m_values[k];
+    }
+    int n = lev.A.Size();
+    lev.invDiag.assign(n,0.0);
+    for(int i=0; i<n; i++) {
+        double d = lev.A.GetValue(i,i);
+        lev.invDiag[i] = (d!=0.0 ? 1.0/d : 0.0);
+    }
+}
@@ -0,0 +1,122 @@
+/**
+    @file   Multigrid.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_MULTIGRID_H
+#define NUMCHLADNI_MULTIGRID_H
+
+#include <vector>
+
+#include "FEAssembler.h"
+#include "SkylineLDLT.h"
+#include "Preconditioner.h"
+
+/**
+ * @brief Interpolation from a coarse to a fine mesh (fine dofs x coarse dofs, CRS).
+ */
+struct Interpolation
+{
+    std::vector<int>     rowPtr;
+    std::vector<int>     colIdx;
+    std::vector<double>  values;
+
+    /** Build by locating every free fine node within the coarse mesh.
+     *   The shape functions of the coarse triangles are used, linear or
+     *   quadratic, so the meshes need not be nested and either of them
+     *   may be quadratic. Fine nodes slightly outside the coarse mesh use
+     *   the nearest triangle.
+     */
+    void  Build( const FEMesh &coarse, const DofMap &coarseDofs,
+                 const FEMesh &fine, const DofMap &fineDofs );
+
+    /** y = P*x (prolongation) */
+    void  Prolongate( const double* x, double* y, int numFine ) const;
+
+    /** y = P^T*x (restriction) */
+    void  Restrict( const double* x, double* y, int numCoarse ) const;
+};
+
+
+/**
+ * @brief Geometric multigrid V-cycle for  K - sigma*M.
+ *
+ *   The levels are meshes of the same geometry, ordered from coarse to
+ *   fine; the finest one is the mesh of K and M. The operator of every
+ *   coarser level is assembled on its own mesh. Symmetric Gauss-Seidel
+ *   smoothing (forward before, backward after the coarse correction)
+ *   keeps the V-cycle symmetric, as LOBPCG requires. The coarsest level
+ *   is solved by a skyline LDL^T factorization.
+ */
+class MultigridPreconditioner : public Preconditioner
+{
+public:
+    MultigridPreconditioner();
+    virtual ~MultigridPreconditioner();
+
+    // --------- public methods -----------
+public:
+    /** Number of Gauss-Seidel sweeps before and after the coarse correction.
+     */
+    void  SetSmoothingSteps( int num );
+
+    /** Build all levels.
+     * \param coarse    coarser meshes, coarsest first
+     * \param fine      mesh of K and M
+     * \param fineDofs  dof map of K and M
+     * \param K         stiffness matrix of the fine mesh
+     * \param M         mass matrix of the fine mesh
+     * \param opts      assembly options for the coarser levels
+     * \param sigma     shift below the spectrum
+     * \return false if an operator could not be factorized
+     */
+    bool  Setup( const std::vector<FEMesh> &coarse, const FEMesh &fine, const DofMap &fineDofs,
+                 const SparseMatrix &K, const SparseMatrix &M, const FEOptions &opts, double sigma );
+
+    /** One V-cycle with zero initial guess.
+     */
+    virtual void  Apply( const double* r, double* z ) const;
+
+    virtual int   Size() const;
+
+    int   NumLevels() const  { return static_cast<int>(m_levels.size()); }
+
+    /** Number of dofs of level l (0: coarsest).
+     */
+    int   LevelSize( int l ) const;
+
+protected:
+    struct Level {
+        SparseMatrix         A;      //!< K - sigma*M
+        std::vector<double>  invDiag;
+        Interpolation        P;      //!< from the next coarser level
+    };
+
+    void  vcycle( int l, const double* r, double* z ) const;
+    void  smooth( const Level &lev, const double* r, double* z, bool forward ) const;
+    void  shiftedOperator( const SparseMatrix &K, const SparseMatrix &M, double sigma, Level &lev );
+
+    // -------- private attributes --------
+private:
+    std::vector<Level>   m_levels;
+    SkylineLDLT<double>  m_coarse;
+    int                  m_numSmooth;
+};
+
+#endif // NUMCHLADNI_MULTIGRID_H
@@ -36,10 +36,14 @@ OpenGL :: OpenGL(QGLFormat format, SystemData *sd, QWidget* parent )
     m_controlVertices(NULL),
     m_controlVertIdx(NULL),
     m_controlSegments(NULL),
-    va_triangles(0)
+    va_triangles(0),
+    vbo_triangles(0),
+    ibo_triangles(0),
+    texID(0)
 {
 
     mData = sd;
+    mInitialized = false;
     mButtonPressed = Qt::NoButton;
     setFocusPolicy( Qt::ClickFocus );
     mKeyPressed = Qt::Key_No;
@@ -84,6 +88,9 @@ OpenGL::~OpenGL() {
 }
 
 void OpenGL::DeleteMeshBuffers() {
+    if (!mInitialized) {
+        return;
+    }
     if (vbo_triangles>0) {
         glDeleteBuffers(1,&vbo_triangles);
         vbo_triangles = 0;
@@ -105,6 +112,9 @@ void OpenGL::AddObjectsToScriptEngine( QScriptEngine* engine ) {
 }
 
 void OpenGL::GenMeshBuffers() {
+    if (!mInitialized) {
+        return;
+    }
     DeleteMeshBuffers();
 
     glGenVertexArrays(1,&va_triangles);
@@ -139,6 +149,9 @@ void OpenGL::GenMeshBuffers() {
 }
 
 void OpenGL::GenDataTexture() {
+    if (!mInitialized) {
+        return;
+    }
     if (texID>0) {
         glDeleteTextures(1,&texID);
         texID = 0;
@@ -160,7 +173,20 @@ void OpenGL::GenDataTexture() {
     glBindTexture(GL_TEXTURE_2D,0);
 }
 
+void OpenGL::UpdateDataTexture() {
+    if (!mInitialized || texID==0 || mData->evals==NULL) {
+        GenDataTexture();
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D,texID);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mData->numMeshVertices,mData->N, GL_RED,GL_FLOAT,mData->evals);
+    glBindTexture(GL_TEXTURE_2D,0);
+}
+
 void OpenGL::UpdateShaders() {
+    if (!mInitialized) {
+        return;
+    }
     removeShaders();
     createShaders();
 }
@@ -189,7 +215,7 @@ void OpenGL::setCtrlPoints() {
     }
 
     int num = mData->m_vertices.size();
-    if (num<=0) {
+    if (num<=0 || !mInitialized) {
         updateGL();
         return;
     }
@@ -219,7 +245,7 @@ void OpenGL::setCtrlSegments() {
         delete [] m_controlSegments;
         m_controlSegments = NULL;
     }
-    if (mData->m_segments.size()<=0) {
+    if (mData->m_segments.size()<=0 || !mInitialized) {
         updateGL();
         return;
     }
@@ -236,8 +262,15 @@ void OpenGL::setCtrlSegments() {
 }
 
 void OpenGL::timeStep() {
-    mData->m_currTime += mData->m_time.elapsed()*1e-3;
+    double elapsed = mData->m_time.elapsed()*1e-3;
+    mData->m_currTime += elapsed;
     mData->m_time.restart();
+    // a transient streams its frames instead of oscillating a mode
+    if (mData->IsTransientShown()) {
+        if (mData->AdvanceTransient(elapsed*mData->m_transientRate,TRANSIENT_FRAME_MSEC)) {
+            UpdateDataTexture();
+        }
+    }
     updateGL();
 }
 
@@ -384,6 +417,7 @@ void OpenGL::initializeGL() {
     glGetIntegerv(GL_MAX_PATCH_VERTICES, &mData->m_maxPatchVertices);
 
     createShaders();
+    mInitialized = true;
     emit haveOGLParams();
 }
 
@@ -491,6 +525,7 @@ void OpenGL::mousePressEvent( QMouseEvent * event ) {
                     emit addCtrlPoint(c.x,c.y);
                 } else {
                     mData->m_trackPoint = mData->m_activePoint;
+                    emit grabCtrlPoint();
                 }
                 break;
             }
@@ -532,7 +567,10 @@ void OpenGL::mousePressEvent( QMouseEvent * event ) {
 }
 
 void OpenGL::mouseReleaseEvent( QMouseEvent * event ) {    
-    mData->m_trackPoint = -1;
+    if (mData->m_trackPoint>=0) {
+        mData->m_trackPoint = -1;
+        emit releaseCtrlPoint();
+    }
     mButtonPressed = Qt::NoButton;
     event->accept();
     updateGL();
@@ -841,7 +879,10 @@ void OpenGL::draw2DView() {
         return;
     }
 
-    float cosWT = static_cast<float>(cos(2.0*M_PI*mData->m_freq*mData->m_currTime));
+    // a superposition or a transient is time dependent by itself
+    glm::vec4 modes[MAX_SUPER_MODES];
+    int numSuper = superModes(modes);
+    float cosWT = ((numSuper>0 || mData->IsTransientShown()) ? 1.0f : static_cast<float>(cos(2.0*M_PI*mData->m_freq*mData->m_currTime)));
 
     mView2DShader.Bind();
     projMX = glm::ortho(mData->m_border.x,mData->m_border.y,mData->m_border.z,mData->m_border.w);
@@ -850,6 +891,10 @@ void OpenGL::draw2DView() {
     glUniform1i(mView2DShader.GetUniformLocation("currEV"),mData->m_currEV);
     glUniform1i(mView2DShader.GetUniformLocation("numNodesPerTriangle"),mData->numNodesPerTriangle);
     glUniform1f(mView2DShader.GetUniformLocation("cosWT"),cosWT);
+    glUniform1i(mView2DShader.GetUniformLocation("numSuperModes"),numSuper);
+    if (numSuper>0) {
+        glUniform4fv(mView2DShader.GetUniformLocation("superModes"),numSuper,glm::value_ptr(modes[0]));
+    }
     glUniform1f(mView2DShader.GetUniformLocation("meshOpacity"),mData->m_meshOpacity);
     glUniform1i(mView2DShader.GetUniformLocation("useColor"),static_cast<int>(mData->m_useColor));
     glUniform1i(mView2DShader.GetUniformLocation("useGridOnly"),static_cast<int>(mData->m_useMeshOnly));
@@ -897,7 +942,9 @@ void OpenGL::draw3DView() {
         glPolygonMode(GL_FRONT_AND_BACK,GL_LINE);
     }
 
-    float cosWT = static_cast<float>(cos(2.0*M_PI*mData->m_freq*mData->m_currTime));
+    glm::vec4 modes[MAX_SUPER_MODES];
+    int numSuper = superModes(modes);
+    float cosWT = ((numSuper>0 || mData->IsTransientShown()) ? 1.0f : static_cast<float>(cos(2.0*M_PI*mData->m_freq*mData->m_currTime)));
 
     mView3DShader.Bind();
     glm::vec3 camPos = mData->mCamera.GetEyePos();
@@ -907,6 +954,10 @@ void OpenGL::draw3DView() {
     glUniform1i(mView3DShader.GetUniformLocation("numNodesPerTriangle"),mData->numNodesPerTriangle);
     glUniform1i(mView3DShader.GetUniformLocation("currEV"),mData->m_currEV);
     glUniform1f(mView3DShader.GetUniformLocation("cosWT"),cosWT);
+    glUniform1i(mView3DShader.GetUniformLocation("numSuperModes"),numSuper);
+    if (numSuper>0) {
+        glUniform4fv(mView3DShader.GetUniformLocation("superModes"),numSuper,glm::value_ptr(modes[0]));
+    }
     glUniform1f(mView3DShader.GetUniformLocation("scaleFactor"),static_cast<float>(mData->m_scaleFactor));
     glUniform1i(mView3DShader.GetUniformLocation("useDotProd"),static_cast<int>(mData->m_useDotProd));
     glUniform1i(mView3DShader.GetUniformLocation("whichShading"),static_cast<int>(mData->m_shading));
@@ -947,6 +998,35 @@ void OpenGL::draw3DView() {
 }
 
 
+int OpenGL::superModes( glm::vec4* modes ) {
+    if (mData->m_superModes.empty() || mData->evals==NULL || mData->m_eigenvalues==NULL
+            || mData->IsTransientShown()) {
+        return 0;
+    }
+    // the lowest positive eigenvalue of the selection oscillates with m_freq
+    double evLow = 0.0;
+    for(int i=0; i<mData->m_superModes.size(); i++) {
+        int n = mData->m_superModes[i].mode;
+        if (n<mData->N && mData->m_eigenvalues[n]>0.0 && (evLow==0.0 || mData->m_eigenvalues[n]<evLow)) {
+            evLow = mData->m_eigenvalues[n];
+        }
+    }
+    int num = 0;
+    for(int i=0; i<mData->m_superModes.size() && num<MAX_SUPER_MODES; i++) {
+        const superMode_t &sm = mData->m_superModes[i];
+        if (sm.mode>=mData->N) {
+            continue;
+        }
+        double ev = mData->m_eigenvalues[sm.mode];
+        double omega = (evLow>0.0 && ev>0.0 ? 2.0*M_PI*mData->m_freq*sqrt(ev/evLow) : 0.0);
+        // the phase is reduced in double; omega*t in float would jitter after a while
+        double phase = fmod(omega*mData->m_currTime + sm.phase,2.0*M_PI);
+        modes[num++] = glm::vec4(static_cast<float>(sm.mode),static_cast<float>(sm.amplitude),
+                                 static_cast<float>(phase),0.0f);
+    }
+    return num;
+}
+
 int OpenGL::findActivePoint( QPoint mousePos ) {
     int num = -1;
 
@@ -63,6 +63,7 @@ public:
     void AddObjectsToScriptEngine( QScriptEngine* engine );    
     void GenMeshBuffers();
     void GenDataTexture();
+    void UpdateDataTexture();
     void UpdateShaders();
     void SetShaderProps();
     void DeleteMeshBuffers();    
@@ -84,6 +85,8 @@ signals:
     void  checkCtrlPoint  ( int );
     void  addCtrlPoint    ( double, double );
     void  moveCtrlPoint   ( double, double );
+    void  grabCtrlPoint();
+    void  releaseCtrlPoint();
     void  setActivePoint  ( int );
     void  addCtrlSegment  ( int, int );
     void  setActiveSegment( int, int );
@@ -129,10 +132,17 @@ protected:
     void  draw3DView();
     int   findActivePoint( QPoint mousePos );
 
+   /** Modes of the animated superposition that exist in the solution,
+    *  as (mode, amplitude, phase at m_currTime, 0).
+    * \return  their number, at most MAX_SUPER_MODES
+    */
+    int   superModes( glm::vec4* modes );
+
 
 // -------- private attributes --------
 private:
     SystemData*       mData;
+    bool              mInitialized;     //!< OpenGL context and buffers are set up
     int               mKeyPressed;
     int               mKeyModifier;
     Qt::MouseButton   mButtonPressed;
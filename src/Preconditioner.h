@@ -0,0 +1,43 @@
+/**
+    @file   Preconditioner.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_PRECONDITIONER_H
+#define NUMCHLADNI_PRECONDITIONER_H
+
+/**
+ * @brief Symmetric positive definite approximation T of (K - sigma*M)^{-1}.
+ */
+class Preconditioner
+{
+public:
+    virtual ~Preconditioner() {}
+
+    /** z = T*r. Must not modify the preconditioner, since several
+     *   vectors are preconditioned in parallel.
+     */
+    virtual void  Apply( const double* r, double* z ) const = 0;
+
+    /** Number of unknowns.
+     */
+    virtual int   Size() const = 0;
+};
+
+#endif // NUMCHLADNI_PRECONDITIONER_H
@@ -0,0 +1,378 @@
+/**
+    @file   ReducedModel.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+#include "ReducedModel.h"
+#include "EigenUtils.h"
+#include "LOBPCGSolver.h"
+#include "SkylineLDLT.h"
+
+static const double podTolerance = 1e-8;   // relative POD energy left out of the basis
+static const int    maxGridPoints = 4096;  // limit of samples^NumParameters()
+static const int    maxParameters = 4;     // 3^p assemblies per grid point
+static const double diffStep      = 1e-3;  // step of the central differences, relative to the grid spacing
+
+/**
+ *  Twice the signed area of the corner triangle of element t.
+ */
+static double signedArea( const FEMesh &mesh, int t ) {
+    const int* e = &mesh.elems[static_cast<size_t>(t)*mesh.nodesPerElem];
+    glm::dvec2 a = mesh.pos[e[1]] - mesh.pos[e[0]];
+    glm::dvec2 b = mesh.pos[e[2]] - mesh.pos[e[0]];
+    return a.x*b.y - a.y*b.x;
+}
+
+
+ReducedModel::ReducedModel() {
+    m_numThreads = 0;
+    Clear();
+}
+
+ReducedModel::~ReducedModel() {
+}
+
+// ********************************** public methods *****************************
+
+void ReducedModel::Setup( const FEMesh &mesh, const DofMap &dofs, const FEOptions &opts ) {
+    Clear();
+    m_mesh = mesh;
+    m_dofs = dofs;
+    m_opts = opts;
+}
+
+
+void ReducedModel::Clear() {
+    m_mesh = FEMesh();
+    m_dofs = DofMap();
+    m_motion.clear();
+    m_lo.clear();
+    m_hi.clear();
+    m_samples = 0;
+    m_numGrid = 0;
+    m_numModes = 0;
+    m_basisSize = 0;
+    m_basis.clear();
+    m_Kr.clear();
+    m_Mr.clear();
+}
+
+
+int ReducedModel::AddParameter( const std::vector<glm::dvec2> &motion, double lo, double hi ) {
+    m_motion.push_back(motion);
+    m_motion.back().resize(m_mesh.NumNodes(),glm::dvec2(0.0));
+    m_lo.push_back(std::min(lo,hi));
+    m_hi.push_back(std::max(lo,hi));
+    m_basisSize = 0;
+    return NumParameters()-1;
+}
+
+
+void ReducedModel::SetNumThreads( int num ) {
+    m_numThreads = std::max(0,num);
+}
+
+
+bool ReducedModel::Build( int samples, int numModes ) {
+    m_basisSize = 0;
+    int n = m_dofs.NumDofs();
+    int p = NumParameters();
+    m_samples  = std::max(2,samples);
+    m_numModes = std::min(numModes,n);
+    m_numGrid  = 1;
+    if (p>maxParameters) {
+        fprintf(stderr,"Reduced model: more than %d parameters.\n",maxParameters);
+        return false;
+    }
+    for(int k=0; k<p; k++) {
+        m_numGrid *= m_samples;
+        if (m_numGrid>maxGridPoints) {
+            fprintf(stderr,"Reduced model: more than %d grid points.\n",maxGridPoints);
+            return false;
+        }
+    }
+    if (m_numModes<=0) {
+        return false;
+    }
+
+    std::vector<double> ref(m_mesh.NumElems());
+    for(int t=0; t<m_mesh.NumElems(); t++) {
+        ref[t] = signedArea(m_mesh,t);
+    }
+
+    // snapshots; all grid points share the pattern, hence the ordering
+    SparseMatrix K, M;
+    std::vector<int> perm;
+    std::vector<double> mu, S(static_cast<size_t>(m_numGrid)*m_numModes*n);
+    FEMesh moved;
+    for(int g=0; g<m_numGrid; g++) {
+        gridPoint(g,mu);
+        MovedMesh(&mu[0],moved);
+        for(int t=0; t<moved.NumElems(); t++) {
+            if (signedArea(moved,t)*ref[t]<=0.0) {
+                fprintf(stderr,"Reduced model: element %d inverted at grid point %d.\n",t,g);
+                return false;
+            }
+        }
+        FEAssembler::Assemble(moved,m_dofs,m_opts,K,M);
+        if (perm.empty()) {
+            ReverseCuthillMcKee(K,perm);
+        }
+
+        LOBPCGSolver solver(K,M);
+        solver.SetNumThreads(m_numThreads);
+        solver.SetOrdering(perm);
+        if (g>0) {
+            solver.SetInitialVectors(&S[static_cast<size_t>(g-1)*m_numModes*n],m_numModes);
+        }
+        if (!solver.Solve(m_numModes) && solver.NumFound()<m_numModes) {
+            fprintf(stderr,"Reduced model: solve at grid point %d failed.\n",g);
+            return false;
+        }
+        const std::vector<double> &X = solver.Eigenvectors();
+        std::copy(X.begin(),X.begin()+static_cast<size_t>(m_numModes)*n,S.begin()+static_cast<size_t>(g)*m_numModes*n);
+        fprintf(stderr,"Reduced model: snapshot %d/%d, lambda_0 = %g\n",g+1,m_numGrid,solver.Eigenvalues()[0]);
+    }
+
+    buildBasis(S,m_numGrid*m_numModes);
+    S.clear();
+    int r = m_basisSize;
+
+    // reduced operators and their scaled mixed derivatives per grid point
+    int numTerms = (1<<p);
+    m_Kr.resize(static_cast<size_t>(m_numGrid)*numTerms*r*r);
+    m_Mr.resize(static_cast<size_t>(m_numGrid)*numTerms*r*r);
+    SparseMatrix dK, dM;
+    std::vector<double> nu(mu.size());
+    for(int g=0; g<m_numGrid; g++) {
+        gridPoint(g,mu);
+        for(int set=0; set<numTerms; set++) {
+            // central differences over the parameters in set, steps relative to the grid spacing
+            int order = 0;
+            for(int k=0; k<p; k++) {
+                order += (set>>k) & 1;
+            }
+            for(int sigma=0; sigma<(1<<order); sigma++) {
+                double w = 1.0/std::pow(2.0*diffStep,order);
+                for(int k=0, j=0; k<p; k++) {
+                    nu[k] = mu[k];
+                    if ((set>>k) & 1) {
+                        double sign = (((sigma>>j) & 1) ? -1.0 : 1.0);
+                        nu[k] += sign*diffStep*(m_hi[k]-m_lo[k])/(m_samples-1);
+                        w *= sign;
+                        j++;
+                    }
+                }
+                MovedMesh(&nu[0],moved);
+                FEAssembler::Assemble(moved,m_dofs,m_opts,K,M);
+                if (sigma==0) {
+                    dK = K;
+                    dM = M;
+                    vecScale(static_cast<int>(dK.m_values.size()),w,&dK.m_values[0]);
+                    vecScale(static_cast<int>(dM.m_values.size()),w,&dM.m_values[0]);
+                } else {
+                    vecAxpy(static_cast<int>(dK.m_values.size()),w,&K.m_values[0],&dK.m_values[0]);
+                    vecAxpy(static_cast<int>(dM.m_values.size()),w,&M.m_values[0],&dM.m_values[0]);
+                }
+            }
+            size_t offset = (static_cast<size_t>(g)*numTerms + set)*r*r;
+            project(dK,&m_Kr[offset]);
+            project(dM,&m_Mr[offset]);
+        }
+    }
+    fprintf(stderr,"Reduced model: %d parameters, %d grid points, basis of %d vectors.\n",p,m_numGrid,r);
+    return true;
+}
+
+
+bool ReducedModel::Evaluate( const double* mu, std::vector<double> &lambda, std::vector<double>* X ) {
+    if (!IsBuilt()) {
+        return false;
+    }
+    int p = NumParameters();
+    int r = m_basisSize;
+
+    // cell of the grid and local coordinates
+    std::vector<int> cell(p);
+    std::vector<double> f(p);
+    for(int k=0; k<p; k++) {
+        double len = m_hi[k] - m_lo[k];
+        double t = (len>0.0 ? (mu[k]-m_lo[k])/len*(m_samples-1) : 0.0);
+        t = std::max(0.0,std::min(t,static_cast<double>(m_samples-1)));
+        cell[k] = std::min(static_cast<int>(t),m_samples-2);
+        f[k] = t - cell[k];
+    }
+
+    std::vector<double> Kr, Mr;
+    interpolate(cell,f,true,Kr,Mr);
+    std::vector<double> d(r), z(static_cast<size_t>(r)*r);
+    if (!GeneralizedSymmetricEigen(r,&Kr[0],&Mr[0],&d[0],&z[0])) {
+        // the multilinear interpolant of the mass matrices is positive definite
+        interpolate(cell,f,false,Kr,Mr);
+        if (!GeneralizedSymmetricEigen(r,&Kr[0],&Mr[0],&d[0],&z[0])) {
+            return false;
+        }
+    }
+    lambda.assign(d.begin(),d.begin()+m_numModes);
+
+    if (X!=NULL) {
+        int n = m_dofs.NumDofs();
+        X->assign(static_cast<size_t>(m_numModes)*n,0.0);
+        for(int k=0; k<m_numModes; k++) {
+            double* x = &(*X)[static_cast<size_t>(k)*n];
+            for(int j=0; j<r; j++) {
+                vecAxpy(n,z[static_cast<size_t>(k)*r+j],&m_basis[static_cast<size_t>(j)*n],x);
+            }
+        }
+    }
+    return true;
+}
+
+
+void ReducedModel::MovedMesh( const double* mu, FEMesh &mesh ) const {
+    mesh = m_mesh;
+    for(int k=0; k<NumParameters(); k++) {
+        const std::vector<glm::dvec2> &U = m_motion[k];
+        for(int i=0; i<mesh.NumNodes(); i++) {
+            mesh.pos[i] += mu[k]*U[i];
+        }
+    }
+}
+
+
+// ********************************* protected methods *****************************
+
+void ReducedModel::gridPoint( int g, std::vector<double> &mu ) const {
+    int p = NumParameters();
+    mu.resize(std::max(p,1),0.0);
+    for(int k=0; k<p; k++) {
+        int i = g % m_samples;
+        g /= m_samples;
+        mu[k] = m_lo[k] + (m_hi[k]-m_lo[k])*i/static_cast<double>(m_samples-1);
+    }
+}
+
+
+void ReducedModel::project( const SparseMatrix &A, double* Ar ) {
+    int n = m_dofs.NumDofs();
+    int r = m_basisSize;
+    std::vector<double> Av(n);
+    for(int j=0; j<r; j++) {
+        A.Multiply(&m_basis[static_cast<size_t>(j)*n],&Av[0]);
+        for(int i=0; i<=j; i++) {
+            Ar[j*r+i] = Ar[i*r+j] = vecDot(n,&m_basis[static_cast<size_t>(i)*n],&Av[0]);
+        }
+    }
+}
+
+
+void ReducedModel::interpolate( const std::vector<int> &cell, const std::vector<double> &f, bool cubic,
+                                std::vector<double> &Kr, std::vector<double> &Mr ) const {
+    int p = NumParameters();
+    int r = m_basisSize;
+    int numTerms = (1<<p);
+    Kr.assign(static_cast<size_t>(r)*r,0.0);
+    Mr.assign(static_cast<size_t>(r)*r,0.0);
+
+    // cubic Hermite basis per parameter: value and derivative weights at both ends
+    std::vector<double> hv(2*p), hd(2*p);
+    for(int k=0; k<p; k++) {
+        double t = f[k], t2 = t*t, t3 = t2*t;
+        if (cubic) {
+            hv[2*k+0] = 2.0*t3 - 3.0*t2 + 1.0;
+            hv[2*k+1] = -2.0*t3 + 3.0*t2;
+            hd[2*k+0] = t3 - 2.0*t2 + t;
+            hd[2*k+1] = t3 - t2;
+        } else {
+            hv[2*k+0] = 1.0 - t;
+            hv[2*k+1] = t;
+            hd[2*k+0] = hd[2*k+1] = 0.0;
+        }
+    }
+
+    for(int c=0; c<(1<<p); c++) {
+        int g = 0, stride = 1;
+        for(int k=0; k<p; k++) {
+            g += (cell[k] + ((c>>k) & 1))*stride;
+            stride *= m_samples;
+        }
+        for(int set=0; set<(cubic ? numTerms : 1); set++) {
+            double w = 1.0;
+            for(int k=0; k<p; k++) {
+                int bit = (c>>k) & 1;
+                w *= (((set>>k) & 1) ? hd[2*k+bit] : hv[2*k+bit]);
+            }
+            if (w==0.0) {
+                continue;
+            }
+            size_t offset = (static_cast<size_t>(g)*numTerms + set)*r*r;
+            vecAxpy(r*r,w,&m_Kr[offset],&Kr[0]);
+            vecAxpy(r*r,w,&m_Mr[offset],&Mr[0]);
+        }
+    }
+}
+
+
+void ReducedModel::buildBasis( const std::vector<double> &S, int numSnaps ) {
+    int n = m_dofs.NumDofs();
+    SparseMatrix K, M;
+    FEAssembler::Assemble(m_mesh,m_dofs,m_opts,K,M);
+
+    // method of snapshots: eigenvectors of the correlation matrix S^T M S
+    std::vector<double> MS(S.size()), C(static_cast<size_t>(numSnaps)*numSnaps);
+    for(int j=0; j<numSnaps; j++) {
+        M.Multiply(&S[static_cast<size_t>(j)*n],&MS[static_cast<size_t>(j)*n]);
+    }
+    for(int j=0; j<numSnaps; j++) {
+        for(int i=0; i<=j; i++) {
+            double c = vecDot(n,&S[static_cast<size_t>(i)*n],&MS[static_cast<size_t>(j)*n]);
+            C[static_cast<size_t>(j)*numSnaps+i] = C[static_cast<size_t>(i)*numSnaps+j] = c;
+        }
+    }
+    MS.clear();
+    std::vector<double> d(numSnaps), z(static_cast<size_t>(numSnaps)*numSnaps);
+    SymmetricEigen(numSnaps,&C[0],&d[0],&z[0]);
+
+    // largest eigenvalues last; keep all but the tail of relative energy podTolerance
+    double total = 0.0;
+    for(int k=0; k<numSnaps; k++) {
+        total += std::max(d[k],0.0);
+    }
+    int first = 0;
+    double tail = 0.0;
+    while (first<numSnaps-1 && tail+std::max(d[first],0.0)<=podTolerance*total) {
+        tail += std::max(d[first],0.0);
+        first++;
+    }
+
+    m_basisSize = numSnaps-first;
+    m_basis.assign(static_cast<size_t>(m_basisSize)*n,0.0);
+    for(int b=0; b<m_basisSize; b++) {
+        int k = numSnaps-1-b;
+        double* v = &m_basis[static_cast<size_t>(b)*n];
+        for(int j=0; j<numSnaps; j++) {
+            vecAxpy(n,z[static_cast<size_t>(k)*numSnaps+j],&S[static_cast<size_t>(j)*n],v);
+        }
+        vecScale(n,1.0/std::sqrt(d[k]),v);
+    }
+}
@@ -0,0 +1,146 @@
+/**
+    @file   ReducedModel.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_REDUCED_MODEL_H
+#define NUMCHLADNI_REDUCED_MODEL_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "FEAssembler.h"
+#include "SparseMatrix.h"
+
+/**
+ * @brief Parametric reduced-order model of the lowest eigenpairs.
+ *
+ *   The geometry family is the reference mesh with its nodes moved by
+ *   sum_k mu_k U_k, where U_k is the node motion per unit value of
+ *   parameter k. All members of the family hence share the nodes and
+ *   dofs of the reference mesh, and their eigenvectors can be compared
+ *   directly.
+ *
+ *   Offline, the eigenpairs are solved by LOBPCG on a tensor grid of
+ *   'samples' values per parameter. The snapshots are compressed by POD
+ *   into a basis V, orthonormal in the mass matrix of the reference mesh,
+ *   and the reduced operators V^T K V and V^T M V are stored per grid
+ *   point together with their mixed parameter derivatives, taken by
+ *   central differences of the assembly. Online, these are interpolated
+ *   by tensor-product cubic Hermite polynomials, and the small generalized
+ *   eigenproblem is solved densely. The interpolation error decreases
+ *   with the fourth power of the grid spacing. Should the interpolated
+ *   mass matrix not be positive definite, the operators are interpolated
+ *   multilinearly instead.
+ */
+class ReducedModel
+{
+public:
+    ReducedModel();
+    ~ReducedModel();
+
+    // --------- public methods -----------
+public:
+    /** Take over the reference mesh; removes all parameters.
+     * \param mesh  reference mesh
+     * \param dofs  dof map of the eigenvectors
+     * \param opts  assembly options
+     */
+    void  Setup( const FEMesh &mesh, const DofMap &dofs, const FEOptions &opts );
+
+    void  Clear();
+
+    /** Add a parameter.
+     * \param motion  node motion per unit parameter value
+     * \param lo      lower bound of the parameter
+     * \param hi      upper bound of the parameter
+     * \return  index of the parameter
+     */
+    int   AddParameter( const std::vector<glm::dvec2> &motion, double lo, double hi );
+
+    int   NumParameters() const  { return static_cast<int>(m_motion.size()); }
+
+    /** Number of worker threads of LOBPCG; 0 uses the number of cores.
+     */
+    void  SetNumThreads( int num );
+
+    /** Offline stage: solve the snapshots and build the reduced operators.
+     * \param samples   grid values per parameter (at least 2)
+     * \param numModes  number of eigenpairs per snapshot and online
+     * \return  false if an element is inverted or a solve failed
+     */
+    bool  Build( int samples, int numModes );
+
+    bool  IsBuilt() const  { return (m_basisSize>0); }
+    int   BasisSize() const  { return m_basisSize; }
+    int   NumModes() const  { return m_numModes; }
+
+    const FEMesh&  Mesh() const  { return m_mesh; }
+    const DofMap&  Dofs() const  { return m_dofs; }
+
+    /** Online stage: eigenpairs at the parameter values mu, clamped to their ranges.
+     * \param mu      NumParameters() values
+     * \param lambda  NumModes() eigenvalues in ascending order
+     * \param X       approximate eigenvectors over the dofs (may be NULL)
+     */
+    bool  Evaluate( const double* mu, std::vector<double> &lambda, std::vector<double>* X );
+
+    /** Reference mesh moved to the parameter values mu.
+     */
+    void  MovedMesh( const double* mu, FEMesh &mesh ) const;
+
+protected:
+    /** Parameter values of grid point g.
+     */
+    void  gridPoint( int g, std::vector<double> &mu ) const;
+
+    /** Ar = V^T A V for the current basis.
+     */
+    void  project( const SparseMatrix &A, double* Ar );
+
+    /** Reduced operators in the grid cell at local coordinates f.
+     * \param cubic  cubic Hermite, else multilinear interpolation
+     */
+    void  interpolate( const std::vector<int> &cell, const std::vector<double> &f, bool cubic,
+                       std::vector<double> &Kr, std::vector<double> &Mr ) const;
+
+    /** Build the POD basis of the snapshots S (numSnaps columns).
+     */
+    void  buildBasis( const std::vector<double> &S, int numSnaps );
+
+    // -------- private attributes --------
+private:
+    FEMesh               m_mesh;
+    DofMap               m_dofs;
+    FEOptions            m_opts;
+    std::vector< std::vector<glm::dvec2> >  m_motion;
+    std::vector<double>  m_lo;
+    std::vector<double>  m_hi;
+    int                  m_numThreads;
+
+    int                  m_samples;
+    int                  m_numGrid;      //!< samples^NumParameters()
+    int                  m_numModes;
+    int                  m_basisSize;
+    std::vector<double>  m_basis;        //!< M-orthonormal basis, m_basisSize columns
+    std::vector<double>  m_Kr;           //!< reduced stiffness matrices, 2^p derivatives per grid point
+    std::vector<double>  m_Mr;           //!< reduced mass matrices, 2^p derivatives per grid point
+};
+
+#endif // NUMCHLADNI_REDUCED_MODEL_H
@@ -0,0 +1,141 @@
+/**
+    @file   ShapePerturbation.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <algorithm>
+
+#include "ShapePerturbation.h"
+
+static const double diffStep    = 1e-3;   // step of the central differences in s
+static const double degenerate  = 1e-6;   // relative gap below which two eigenvalues are equal
+
+ShapePerturbation::ShapePerturbation() {
+}
+
+ShapePerturbation::~ShapePerturbation() {
+}
+
+// ********************************** public methods *****************************
+
+void ShapePerturbation::Setup( const FEMesh &mesh, const DofMap &dofs, const FEOptions &opts,
+                               int num, const double* lambda, const double* X ) {
+    m_mesh = mesh;
+    m_dofs = dofs;
+    m_opts = opts;
+    FEAssembler::Assemble(m_mesh,m_dofs,m_opts,m_K,m_M);
+
+    int n = m_dofs.NumDofs();
+    m_lambda.assign(lambda,lambda+num);
+    m_X.assign(X,X+static_cast<size_t>(num)*n);
+    std::vector<double> Mx(n);
+    for(int k=0; k<num; k++) {
+        double* x = &m_X[static_cast<size_t>(k)*n];
+        m_M.Multiply(x,&Mx[0]);
+        double xMx = vecDot(n,x,&Mx[0]);
+        if (xMx>0.0) {
+            vecScale(n,1.0/std::sqrt(xMx),x);
+        }
+    }
+}
+
+
+void ShapePerturbation::Clear() {
+    m_mesh = FEMesh();
+    m_dofs = DofMap();
+    m_K = SparseMatrix();
+    m_M = SparseMatrix();
+    m_lambda.clear();
+    m_X.clear();
+}
+
+
+void ShapePerturbation::Predict( const std::vector<glm::dvec2> &V, bool secondOrder,
+                                 std::vector<double> &lambda, std::vector<double> &X ) {
+    int num = static_cast<int>(m_lambda.size());
+    int n = m_dofs.NumDofs();
+    lambda = m_lambda;
+    X = m_X;
+    if (num==0 || n==0) {
+        return;
+    }
+
+    // first and second derivatives of K and M by central differences
+    SparseMatrix Kp, Mp, Km, Mm;
+    assembleMoved(V, diffStep,Kp,Mp);
+    assembleMoved(V,-diffStep,Km,Mm);
+    SparseMatrix dK = Kp, dM = Mp, ddK = Kp, ddM = Mp;
+    double h2 = diffStep*diffStep;
+    for(size_t k=0; k<dK.m_values.size(); k++) {
+        dK.m_values[k]  = (Kp.m_values[k] - Km.m_values[k])/(2.0*diffStep);
+        dM.m_values[k]  = (Mp.m_values[k] - Mm.m_values[k])/(2.0*diffStep);
+        ddK.m_values[k] = (Kp.m_values[k] - 2.0*m_K.m_values[k] + Km.m_values[k])/h2;
+        ddM.m_values[k] = (Mp.m_values[k] - 2.0*m_M.m_values[k] + Mm.m_values[k])/h2;
+    }
+
+    // dKX = K' X, dMX = M' X
+    std::vector<double> dKX(X.size()), dMX(X.size());
+    for(int j=0; j<num; j++) {
+        dK.Multiply(&m_X[static_cast<size_t>(j)*n],&dKX[static_cast<size_t>(j)*n]);
+        dM.Multiply(&m_X[static_cast<size_t>(j)*n],&dMX[static_cast<size_t>(j)*n]);
+    }
+
+    std::vector<double> tmp(n);
+    for(int j=0; j<num; j++) {
+        const double* xj = &m_X[static_cast<size_t>(j)*n];
+        double lj = m_lambda[j];
+        double xMx = vecDot(n,xj,&dMX[static_cast<size_t>(j)*n]);
+        double dl  = vecDot(n,xj,&dKX[static_cast<size_t>(j)*n]) - lj*xMx;
+
+        // x_j' from the other known modes
+        double* yj = &X[static_cast<size_t>(j)*n];
+        vecAxpy(n,-0.5*xMx,xj,yj);
+        double sum = 0.0;
+        for(int m=0; m<num; m++) {
+            double gap = lj - m_lambda[m];
+            if (m==j || std::fabs(gap)<=degenerate*std::max(std::fabs(lj),1.0)) {
+                continue;
+            }
+            const double* xm = &m_X[static_cast<size_t>(m)*n];
+            double b = vecDot(n,xm,&dKX[static_cast<size_t>(j)*n]) - lj*vecDot(n,xm,&dMX[static_cast<size_t>(j)*n]);
+            vecAxpy(n,b/gap,xm,yj);
+            sum += b*b/gap;
+        }
+
+        lambda[j] = lj + dl;
+        if (secondOrder) {
+            ddK.Multiply(xj,&tmp[0]);
+            double ddl = vecDot(n,xj,&tmp[0]);
+            ddM.Multiply(xj,&tmp[0]);
+            ddl += -lj*vecDot(n,xj,&tmp[0]) - 2.0*dl*xMx + 2.0*sum;
+            lambda[j] += 0.5*ddl;
+        }
+    }
+}
+
+// ********************************* protected methods *****************************
+
+void ShapePerturbation::assembleMoved( const std::vector<glm::dvec2> &V, double s, SparseMatrix &K, SparseMatrix &M ) {
+    FEMesh moved = m_mesh;
+    for(int i=0; i<moved.NumNodes() && i<static_cast<int>(V.size()); i++) {
+        moved.pos[i] += s*V[i];
+    }
+    FEAssembler::Assemble(moved,m_dofs,m_opts,K,M);
+}
@@ -0,0 +1,103 @@
+/**
+    @file   ShapePerturbation.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_SHAPE_PERTURBATION_H
+#define NUMCHLADNI_SHAPE_PERTURBATION_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "FEAssembler.h"
+#include "SparseMatrix.h"
+
+/**
+ * @brief Eigenpairs of a slightly deformed mesh by perturbation theory.
+ *
+ *   The nodes move by s*V, and K(s), M(s) are the operators of the moved
+ *   mesh with the same dofs. Their derivatives with respect to s are
+ *   taken by central differences of the assembly. With M-normalized x,
+ *
+ *     lambda'  = x^T (K' - lambda M') x,
+ *     x_n'     = sum_{m!=n} x_m^T (K' - lambda_n M') x_n / (lambda_n - lambda_m) x_m
+ *                - 1/2 (x_n^T M' x_n) x_n,
+ *     lambda'' = x^T (K'' - lambda M'') x - 2 lambda' x^T M' x
+ *                + 2 sum_{m!=n} (x_m^T (K' - lambda_n M') x_n)^2 / (lambda_n - lambda_m),
+ *
+ *   where the sums run over the known modes only. Pairs of (nearly)
+ *   equal eigenvalues are left out of the sums. The prediction for s = 1
+ *   is returned.
+ */
+class ShapePerturbation
+{
+public:
+    ShapePerturbation();
+    ~ShapePerturbation();
+
+    // --------- public methods -----------
+public:
+    /** Take over the mesh and eigenpairs to be perturbed.
+     * \param mesh    mesh of the eigenpairs
+     * \param dofs    dof map of the eigenvectors
+     * \param opts    assembly options
+     * \param num     number of eigenpairs
+     * \param lambda  eigenvalues
+     * \param X       eigenvectors, num columns of length dofs.NumDofs(), any scaling
+     */
+    void  Setup( const FEMesh &mesh, const DofMap &dofs, const FEOptions &opts,
+                 int num, const double* lambda, const double* X );
+
+    void  Clear();
+
+    bool  IsEmpty() const  { return m_lambda.empty(); }
+
+    const FEMesh&  Mesh() const  { return m_mesh; }
+    const DofMap&  Dofs() const  { return m_dofs; }
+
+    /** Eigenvalues of the undeformed mesh.
+     */
+    const std::vector<double>&  Eigenvalues() const  { return m_lambda; }
+
+    /** Predict the eigenpairs after moving the nodes by V.
+     * \param V            displacement per node
+     * \param secondOrder  add the second-order term to the eigenvalues
+     * \param lambda       predicted eigenvalues, in the order of Setup
+     * \param X            predicted eigenvectors (first order), M-normalized for the undeformed mesh
+     */
+    void  Predict( const std::vector<glm::dvec2> &V, bool secondOrder,
+                   std::vector<double> &lambda, std::vector<double> &X );
+
+protected:
+    /** Assemble K and M of the mesh moved by s*V.
+     */
+    void  assembleMoved( const std::vector<glm::dvec2> &V, double s, SparseMatrix &K, SparseMatrix &M );
+
+    // -------- private attributes --------
+private:
+    FEMesh               m_mesh;
+    DofMap               m_dofs;
+    FEOptions            m_opts;
+    SparseMatrix         m_K;        //!< operators of the undeformed mesh
+    SparseMatrix         m_M;
+    std::vector<double>  m_lambda;
+    std::vector<double>  m_X;        //!< M-normalized eigenvectors
+};
+
+#endif // NUMCHLADNI_SHAPE_PERTURBATION_H
@@ -0,0 +1,237 @@
+/**
+    @file   ShiftInvertLanczos.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+#include "ShiftInvertLanczos.h"
+#include "EigenUtils.h"
+
+ShiftInvertLanczos::ShiftInvertLanczos( const SparseMatrix &K, const SparseMatrix &M )
+    : m_K(K), m_M(M) {
+    m_seed = 4711;
+    m_tol  = 1e-10;
+}
+
+ShiftInvertLanczos::~ShiftInvertLanczos() {
+}
+
+// ********************************** public methods *****************************
+
+void ShiftInvertLanczos::SetOrdering( const std::vector<int> &perm ) {
+    m_perm = perm;
+}
+
+void ShiftInvertLanczos::SetSeed( unsigned int seed ) {
+    m_seed = seed;
+}
+
+
+bool ShiftInvertLanczos::SolveInterval( double lo, double hi, int expected ) {
+    int n = m_K.Size();
+    m_lambda.clear();
+    m_X.clear();
+    m_MX.clear();
+    if (expected<=0 || n==0) {
+        return (expected<=0);
+    }
+
+    double sigma = 0.5*(lo + hi);
+    if (m_perm.empty()) {
+        m_ldlt.Analyze(m_K);
+    } else {
+        m_ldlt.SetOrdering(m_K,m_perm);
+    }
+    m_ldlt.Factorize(m_K,m_M,1.0,-sigma);
+
+    std::vector<double> r(n), Mr(n), w(n), Mw(n);
+    std::vector<double> Q, MQ, alpha, beta, d, e, z;
+
+    const int maxRuns = 10;
+    for(int run=0; run<maxRuns && NumFound()<expected; run++) {
+        int remaining = expected - NumFound();
+        int kmax = std::min(n - NumFound(), 2*remaining + 40);
+        if (kmax<=0) {
+            break;
+        }
+        Q.assign(static_cast<size_t>(n)*kmax,0.0);
+        MQ.assign(static_cast<size_t>(n)*kmax,0.0);
+        alpha.assign(kmax,0.0);
+        beta.assign(kmax,0.0);
+
+        // random start vector, M-orthogonal to the locked eigenvectors
+        for(int i=0; i<n; i++) {
+            r[i] = random();
+        }
+        orthogonalize(r,m_X,m_MX,NumFound());
+        m_M.Multiply(&r[0],&Mr[0]);
+        double b = std::sqrt(std::max(vecDot(n,&r[0],&Mr[0]),0.0));
+        if (b==0.0) {
+            break;
+        }
+
+        int m = 0;
+        int numConv = 0;
+        d.clear();
+        for(int j=0; j<kmax; j++) {
+            double* qj  = &Q[static_cast<size_t>(j)*n];
+            double* Mqj = &MQ[static_cast<size_t>(j)*n];
+            for(int i=0; i<n; i++) {
+                qj[i]  = r[i]/b;
+                Mqj[i] = Mr[i]/b;
+            }
+            m = j+1;
+
+            // w = (K - sigma*M)^{-1} M q_j
+            m_ldlt.Solve(Mqj,&w[0]);
+            alpha[j] = vecDot(n,Mqj,&w[0]);
+            vecAxpy(n,-alpha[j],qj,&w[0]);
+            if (j>0) {
+                vecAxpy(n,-beta[j-1],&Q[static_cast<size_t>(j-1)*n],&w[0]);
+            }
+
+            // full reorthogonalization against Lanczos and locked vectors
+            orthogonalize(w,Q,MQ,m);
+            orthogonalize(w,m_X,m_MX,NumFound());
+
+            m_M.Multiply(&w[0],&Mw[0]);
+            b = std::sqrt(std::max(vecDot(n,&w[0],&Mw[0]),0.0));
+            beta[j] = b;
+
+            bool invariant = (b <= 1e-14*std::fabs(alpha[j]));
+            if (invariant || j==kmax-1 || (m>=remaining && (m%5)==0)) {
+                d.assign(alpha.begin(),alpha.begin()+m);
+                e.assign(beta.begin(),beta.begin()+m);
+                z.resize(static_cast<size_t>(m)*m);
+                if (!TridiagonalEigen(m,&d[0],&e[0],&z[0])) {
+                    d.clear();
+                    break;
+                }
+                numConv = 0;
+                for(int k=0; k<m; k++) {
+                    double theta = d[k];
+                    if (theta==0.0) {
+                        continue;
+                    }
+                    double lambda = sigma + 1.0/theta;
+                    double res = std::fabs(b*z[static_cast<size_t>(k)*m + m-1]);
+                    if (lambda>=lo && lambda<hi && (invariant || res<=m_tol*std::fabs(theta))) {
+                        numConv++;
+                    }
+                }
+                if (invariant || numConv>=remaining) {
+                    break;
+                }
+            }
+
+            r.swap(w);
+            Mr.swap(Mw);
+        }
+
+        // lock converged Ritz pairs within the interval
+        int numNew = 0;
+        bool invariant = (b <= 1e-14*std::fabs(alpha[m-1]));
+        for(int k=0; k<m && static_cast<int>(d.size())==m; k++) {
+            double theta = d[k];
+            if (theta==0.0) {
+                continue;
+            }
+            double lambda = sigma + 1.0/theta;
+            double res = std::fabs(b*z[static_cast<size_t>(k)*m + m-1]);
+            if (lambda<lo || lambda>=hi || !(invariant || res<=m_tol*std::fabs(theta))) {
+                continue;
+            }
+
+            size_t off = m_X.size();
+            m_X.resize(off+n,0.0);
+            m_MX.resize(off+n,0.0);
+            double* x  = &m_X[off];
+            double* Mx = &m_MX[off];
+            for(int j=0; j<m; j++) {
+                double s = z[static_cast<size_t>(k)*m + j];
+                vecAxpy(n,s,&Q[static_cast<size_t>(j)*n],x);
+                vecAxpy(n,s,&MQ[static_cast<size_t>(j)*n],Mx);
+            }
+            double nrm = std::sqrt(std::max(vecDot(n,x,Mx),0.0));
+            if (nrm>0.0) {
+                vecScale(n,1.0/nrm,x);
+                vecScale(n,1.0/nrm,Mx);
+            }
+            m_lambda.push_back(lambda);
+            numNew++;
+        }
+        if (numNew==0) {
+            break;
+        }
+    }
+
+    // sort eigenpairs
+    int num = NumFound();
+    std::vector<int> order(num);
+    for(int k=0; k<num; k++) {
+        order[k] = k;
+    }
+    for(int a=1; a<num; a++) {
+        int k = order[a];
+        int c = a;
+        while (c>0 && m_lambda[order[c-1]]>m_lambda[k]) {
+            order[c] = order[c-1];
+            c--;
+        }
+        order[c] = k;
+    }
+    std::vector<double> lambda(num), X(m_X.size());
+    for(int k=0; k<num; k++) {
+        lambda[k] = m_lambda[order[k]];
+        std::copy(m_X.begin() + static_cast<size_t>(order[k])*n,
+                  m_X.begin() + static_cast<size_t>(order[k]+1)*n,
+                  X.begin() + static_cast<size_t>(k)*n);
+    }
+    m_lambda.swap(lambda);
+    m_X.swap(X);
+    m_MX.clear();
+
+    if (num!=expected) {
+        fprintf(stderr,"Lanczos: found %d of %d eigenvalues in [%g,%g).\n",num,expected,lo,hi);
+    }
+    return (num==expected);
+}
+
+// ********************************* protected methods *****************************
+
+double ShiftInvertLanczos::random() {
+    // linear congruential generator, private per solver for thread safety
+    m_seed = m_seed*1664525u + 1013904223u;
+    return static_cast<double>(m_seed)/4294967296.0 - 0.5;
+}
+
+void ShiftInvertLanczos::orthogonalize( std::vector<double> &w, const std::vector<double> &V,
+                                        const std::vector<double> &MV, int num ) {
+    int n = static_cast<int>(w.size());
+    for(int pass=0; pass<2; pass++) {
+        for(int k=0; k<num; k++) {
+            double c = vecDot(n,&MV[static_cast<size_t>(k)*n],&w[0]);
+            vecAxpy(n,-c,&V[static_cast<size_t>(k)*n],&w[0]);
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/**
+    @file   ShiftInvertLanczos.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef NUMCHLADNI_SHIFT_INVERT_LANCZOS_H
+#define NUMCHLADNI_SHIFT_INVERT_LANCZOS_H
+
+#include <vector>
+
+#include "SparseMatrix.h"
+#include "SkylineLDLT.h"
+
+/**
+ * @brief Shift-invert Lanczos for all eigenpairs of  K x = lambda M x  in an interval.
+ *
+ *   The operator (K - sigma*M)^{-1} M is applied with a skyline LDL^T
+ *   factorization, sigma being the midpoint of the interval. Lanczos
+ *   vectors are fully reorthogonalized in the M inner product. Since a
+ *   single Lanczos run finds only one copy of a multiple eigenvalue, the
+ *   run is restarted with converged vectors locked until the expected
+ *   number of eigenvalues (from Sylvester inertia) has been found.
+ *
+ *   Eigenvectors are M-normalized, like the ones returned by dsygv.
+ */
+class ShiftInvertLanczos
+{
+public:
+    ShiftInvertLanczos( const SparseMatrix &K, const SparseMatrix &M );
+    ~ShiftInvertLanczos();
+
+    // --------- public methods -----------
+public:
+    /** Use a precomputed fill-reducing ordering for the factorization.
+     * \param perm  new -> old index, see ReverseCuthillMcKee
+     */
+    void  SetOrdering( const std::vector<int> &perm );
+
+    /** Seed of the random start vectors.
+     */
+    void  SetSeed( unsigned int seed );
+
+    /** Compute all eigenpairs with  lo <= lambda < hi.
+     * \param lo
+     * \param hi
+     * \param expected  number of eigenvalues in [lo,hi) from inertia counts
+     * \return true if the expected number of eigenpairs was found
+     */
+    bool  SolveInterval( double lo, double hi, int expected );
+
+    int   NumFound() const  { return static_cast<int>(m_lambda.size()); }
+
+    /** Eigenvalues in ascending order.
+     */
+    const std::vector<double>&  Eigenvalues() const  { return m_lambda; }
+
+    /** Eigenvectors, NumFound() columns of length K.Size().
+     */
+    const std::vector<double>&  Eigenvectors() const  { return m_X; }
+
+protected:
+    double  random();
+    void    orthogonalize( std::vector<double> &w, const std::vector<double> &V,
+                           const std::vector<double> &MV, int num );
+
+    // -------- private attributes --------
+private:
+    const SparseMatrix&  m_K;
+    const SparseMatrix&  m_M;
+    std::vector<int>     m_perm;
+    unsigned int         m_seed;
+    double               m_tol;
+
+    SkylineLDLT<double>  m_ldlt;
+    std::vector<double>  m_lambda;
+    std::vector<double>  m_X;
+    std::vector<double>  m_MX;
+};
+
+#endif // NUMCHLADNI_SHIFT_INVERT_LANCZOS_H
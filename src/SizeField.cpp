@@ -0,0 +1,107 @@
+/**
+    @file   SizeField.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+
+#include "SizeField.h"
+
+// one active field per thread, as for the globals of triangle.c
+#if defined _MSC_VER
+static __declspec(thread) const SizeField* activeSizeField = NULL;
+#else
+static __thread const SizeField* activeSizeField = NULL;
+#endif
+
+/**
+ *  Triangle's user test (switch 'u', compiled with EXTERNAL_TEST): a
+ *  triangle is refined if its area exceeds the active size field at its
+ *  centroid. triangle.c is compiled with SINGLE (float vertices) and
+ *  declares the test without prototype, so the area arrives promoted
+ *  to double.
+ */
+extern "C" int triunsuitable( float* triorg, float* tridest, float* triapex, double area ) {
+    const SizeField* field = SizeField::Active();
+    if (field==NULL) {
+        return 0;
+    }
+    glm::dvec2 c((triorg[0] + tridest[0] + triapex[0])/3.0,
+                 (triorg[1] + tridest[1] + triapex[1])/3.0);
+    return (area > field->MaxArea(c) ? 1 : 0);
+}
+
+// ********************************** SizeField *****************************
+
+SizeField::SizeField() {
+    Clear();
+}
+
+// ********************************** public methods *****************************
+
+void SizeField::Clear() {
+    m_lo = m_hi = glm::dvec2(0.0);
+    m_nx = m_ny = 0;
+    m_values.clear();
+}
+
+
+void SizeField::SetGrid( const glm::dvec2 &lo, const glm::dvec2 &hi, int nx, int ny,
+                         const std::vector<double> &values ) {
+    if (nx<1 || ny<1 || static_cast<int>(values.size())!=(nx+1)*(ny+1)) {
+        Clear();
+        return;
+    }
+    m_lo = lo;
+    m_hi = hi;
+    m_nx = nx;
+    m_ny = ny;
+    m_values = values;
+}
+
+
+double SizeField::MaxArea( const glm::dvec2 &p ) const {
+    if (m_values.empty()) {
+        return 0.0;
+    }
+    double fx = (m_hi.x>m_lo.x ? (p.x - m_lo.x)/(m_hi.x - m_lo.x)*m_nx : 0.0);
+    double fy = (m_hi.y>m_lo.y ? (p.y - m_lo.y)/(m_hi.y - m_lo.y)*m_ny : 0.0);
+    fx = std::max(0.0,std::min(fx,static_cast<double>(m_nx)));
+    fy = std::max(0.0,std::min(fy,static_cast<double>(m_ny)));
+    int ix = std::min(static_cast<int>(fx),m_nx-1);
+    int iy = std::min(static_cast<int>(fy),m_ny-1);
+    double tx = fx - ix;
+    double ty = fy - iy;
+
+    const double* v = &m_values[iy*(m_nx+1) + ix];
+    double v0 = (1.0-tx)*v[0] + tx*v[1];
+    double v1 = (1.0-tx)*v[m_nx+1] + tx*v[m_nx+2];
+    return (1.0-ty)*v0 + ty*v1;
+}
+
+
+void SizeField::SetActive( const SizeField* field ) {
+    activeSizeField = field;
+}
+
+
+const SizeField* SizeField::Active() {
+    return activeSizeField;
+}
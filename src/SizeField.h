@@ -0,0 +1,81 @@
+/**
+    @file   SizeField.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef NUMCHLADNI_SIZE_FIELD_H
+#define NUMCHLADNI_SIZE_FIELD_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * @brief Maximum triangle area as a function of position.
+ *
+ *   The field is sampled on a regular grid and interpolated bilinearly;
+ *   outside the grid the nearest boundary value is used. Triangle
+ *   consults the active field through triunsuitable (switch 'u'), so a
+ *   mesh can be graded instead of refined uniformly.
+ */
+class SizeField
+{
+public:
+    SizeField();
+
+    // --------- public methods -----------
+public:
+    void  Clear();
+    bool  IsEmpty() const  { return m_values.empty(); }
+
+    /** Set grid samples.
+     * \param lo      lower left corner
+     * \param hi      upper right corner
+     * \param nx      number of cells in x
+     * \param ny      number of cells in y
+     * \param values  (nx+1)*(ny+1) maximum areas, row by row
+     */
+    void  SetGrid( const glm::dvec2 &lo, const glm::dvec2 &hi, int nx, int ny,
+                   const std::vector<double> &values );
+
+    /** Maximum triangle area at p.
+     */
+    double  MaxArea( const glm::dvec2 &p ) const;
+
+    const glm::dvec2&  Lo() const  { return m_lo; }
+    const glm::dvec2&  Hi() const  { return m_hi; }
+    int   NumCellsX() const  { return m_nx; }
+    int   NumCellsY() const  { return m_ny; }
+    const std::vector<double>&  Values() const  { return m_values; }
+
+    /** Field used by triunsuitable in the calling thread; NULL accepts every triangle.
+     */
+    static void  SetActive( const SizeField* field );
+    static const SizeField*  Active();
+
+    // -------- private attributes --------
+private:
+    glm::dvec2  m_lo;
+    glm::dvec2  m_hi;
+    int         m_nx;
+    int         m_ny;
+    std::vector<double>  m_values;
+};
+
+#endif // NUMCHLADNI_SIZE_FIELD_H
@@ -0,0 +1,374 @@
+/**
+    @file   SkylineLDLT.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_SKYLINE_LDLT_H
+#define NUMCHLADNI_SKYLINE_LDLT_H
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cassert>
+
+#include "SparseMatrix.h"
+
+/**
+ * @brief Reverse Cuthill-McKee ordering of a symmetric sparsity pattern.
+ * \param A     matrix with symmetric pattern
+ * \param perm  new -> old index
+ */
+inline void ReverseCuthillMcKee( const SparseMatrix &A, std::vector<int> &perm ) {
+    int n = A.Size();
+    std::vector<int> degree(n);
+    for(int i=0; i<n; i++) {
+        degree[i] = A.m_rowPtr[i+1] - A.m_rowPtr[i];
+    }
+
+    perm.clear();
+    perm.reserve(n);
+    std::vector<char> visited(n,0);
+    std::vector<int>  level(n,-1);
+    std::vector<int>  nbs;
+
+    for(int seed=0; seed<n; seed++) {
+        if (visited[seed]) {
+            continue;
+        }
+
+        // find pseudo-peripheral start node of this component:
+        // repeat BFS from the node of minimum degree in the last level
+        int start = seed;
+        int lastDepth = -1;
+        for(int iter=0; iter<5; iter++) {
+            std::vector<int> comp;
+            std::deque<int> queue;
+            queue.push_back(start);
+            level[start] = 0;
+            int depth = 0;
+            while (!queue.empty()) {
+                int v = queue.front();
+                queue.pop_front();
+                comp.push_back(v);
+                depth = std::max(depth,level[v]);
+                for(int k=A.m_rowPtr[v]; k<A.m_rowPtr[v+1]; k++) {
+                    int w = A.m_colIdx[k];
+                    if (level[w]<0 && !visited[w]) {
+                        level[w] = level[v]+1;
+                        queue.push_back(w);
+                    }
+                }
+            }
+            int next = start;
+            for(size_t c=0; c<comp.size(); c++) {
+                int v = comp[c];
+                if (level[v]==depth && (next==start || degree[v]<degree[next])) {
+                    next = v;
+                }
+            }
+            for(size_t c=0; c<comp.size(); c++) {
+                level[comp[c]] = -1;
+            }
+            if (depth<=lastDepth) {
+                break;
+            }
+            lastDepth = depth;
+            start = next;
+        }
+
+        // Cuthill-McKee numbering, neighbours by increasing degree
+        size_t first = perm.size();
+        perm.push_back(start);
+        visited[start] = 1;
+        for(size_t head=first; head<perm.size(); head++) {
+            int v = perm[head];
+            nbs.clear();
+            for(int k=A.m_rowPtr[v]; k<A.m_rowPtr[v+1]; k++) {
+                int w = A.m_colIdx[k];
+                if (!visited[w]) {
+                    visited[w] = 1;
+                    nbs.push_back(w);
+                }
+            }
+            for(size_t a=1; a<nbs.size(); a++) {
+                int w = nbs[a];
+                size_t b = a;
+                while (b>0 && degree[nbs[b-1]]>degree[w]) {
+                    nbs[b] = nbs[b-1];
+                    b--;
+                }
+                nbs[b] = w;
+            }
+            perm.insert(perm.end(),nbs.begin(),nbs.end());
+        }
+    }
+    std::reverse(perm.begin(),perm.end());
+}
+
+
+/**
+ * @brief Envelope of the pattern of A for a given ordering, without factorizing.
+ * \param A         matrix with symmetric pattern
+ * \param perm      new -> old index
+ * \param envelope  number of off-diagonal entries within the envelope
+ * \return  approximate number of flops of one LDL^T factorization
+ */
+inline double SkylineEnvelope( const SparseMatrix &A, const std::vector<int> &perm, size_t &envelope ) {
+    int n = A.Size();
+    std::vector<int> iperm(n);
+    for(int i=0; i<n; i++) {
+        iperm[perm[i]] = i;
+    }
+    envelope = 0;
+    double flops = 0.0;
+    for(int i=0; i<n; i++) {
+        int old = perm[i];
+        int f = i;
+        for(int k=A.m_rowPtr[old]; k<A.m_rowPtr[old+1]; k++) {
+            f = std::min(f,iperm[A.m_colIdx[k]]);
+        }
+        double width = static_cast<double>(i - f);
+        envelope += static_cast<size_t>(i - f);
+        flops += width*width;
+    }
+    return flops;
+}
+
+
+inline bool skylineIsNegative( double d ) {
+    return d<0.0;
+}
+
+inline double skylineAbs( double d ) {
+    return std::fabs(d);
+}
+
+// complex symmetric matrices (no inertia): the sign only picks the perturbation
+inline bool skylineIsNegative( const std::complex<double> &d ) {
+    return d.real()<0.0;
+}
+
+inline double skylineAbs( const std::complex<double> &d ) {
+    return std::abs(d);
+}
+
+
+/**
+ * @brief Sparse LDL^T factorization in skyline (envelope) storage.
+ *
+ *   Factorizes  A = kFac*K + mFac*M  for two matrices with identical
+ *   sparsity pattern, e.g. the shifted operator K - sigma*M. The rows
+ *   are reordered by reverse Cuthill-McKee to keep the envelope small.
+ *   By Sylvester's law of inertia, the number of negative pivots of
+ *   K - sigma*M equals the number of eigenvalues below sigma.
+ *
+ *   The ordering only depends on the pattern and can be shared between
+ *   factorizations with different shifts (SetOrdering).
+ *
+ *   With T = std::complex<double>, complex symmetric matrices like
+ *   K + i*omega*C - omega^2*M are factorized without pivoting; the
+ *   number of negative pivots is meaningless then.
+ */
+template <typename T>
+class SkylineLDLT
+{
+public:
+    SkylineLDLT() : m_size(0), m_numNegative(0), m_numPerturbed(0) {}
+
+    /** Compute reverse Cuthill-McKee ordering and envelope for the pattern of A.
+     */
+    void Analyze( const SparseMatrix &A ) {
+        std::vector<int> perm;
+        ReverseCuthillMcKee(A,perm);
+        SetOrdering(A,perm);
+    }
+
+    /** Use a given ordering (new -> old) for the pattern of A.
+     */
+    void SetOrdering( const SparseMatrix &A, const std::vector<int> &perm ) {
+        m_size = A.Size();
+        m_perm = perm;
+        m_iperm.resize(m_size);
+        for(int i=0; i<m_size; i++) {
+            m_iperm[m_perm[i]] = i;
+        }
+
+        m_first.resize(m_size);
+        for(int i=0; i<m_size; i++) {
+            int old = m_perm[i];
+            int f = i;
+            for(int k=A.m_rowPtr[old]; k<A.m_rowPtr[old+1]; k++) {
+                f = std::min(f,m_iperm[A.m_colIdx[k]]);
+            }
+            m_first[i] = f;
+        }
+
+        m_rowStart.resize(m_size+1);
+        m_rowStart[0] = 0;
+        for(int i=0; i<m_size; i++) {
+            m_rowStart[i+1] = m_rowStart[i] + static_cast<size_t>(i - m_first[i]);
+        }
+        m_L.assign(m_rowStart[m_size],T(0));
+        m_D.assign(m_size,T(0));
+    }
+
+    const std::vector<int>& Ordering() const  { return m_perm; }
+
+    /** Number of off-diagonal entries within the envelope.
+     */
+    size_t EnvelopeSize() const  { return m_L.size(); }
+
+    /** Factorize  kFac*K + mFac*M.  Pass mFac=0 to factorize K alone.
+     *   Analyze or SetOrdering must have been called for the pattern.
+     * \return false if a zero pivot had to be perturbed
+     */
+    bool Factorize( const SparseMatrix &K, const SparseMatrix &M, T kFac, T mFac ) {
+        assert(K.Size()==m_size);
+        assert(M.NumNonZeros()==0 || M.NumNonZeros()==K.NumNonZeros());
+        bool useM = (M.NumNonZeros()>0 && mFac!=T(0));
+
+        std::fill(m_L.begin(),m_L.end(),T(0));
+        std::fill(m_D.begin(),m_D.end(),T(0));
+
+        double scale = 0.0;
+        for(int i=0; i<m_size; i++) {
+            int old = m_perm[i];
+            for(int k=K.m_rowPtr[old]; k<K.m_rowPtr[old+1]; k++) {
+                int j = m_iperm[K.m_colIdx[k]];
+                if (j>i) {
+                    continue;
+                }
+                T val = kFac*K.m_values[k];
+                if (useM) {
+                    val += mFac*M.m_values[k];
+                }
+                if (j==i) {
+                    m_D[i] = val;
+                    scale = std::max(scale,skylineAbs(val));
+                } else {
+                    m_L[m_rowStart[i] + static_cast<size_t>(j - m_first[i])] = val;
+                }
+            }
+        }
+
+        double tiny = 1e-13*(scale>0.0 ? scale : 1.0);
+        m_numNegative  = 0;
+        m_numPerturbed = 0;
+
+        for(int i=0; i<m_size; i++) {
+            int fi = m_first[i];
+            T* Li = row(i);
+
+            // Li[j-fi] holds g_ij = L_ij*D_j while the row is processed
+            for(int j=fi; j<i; j++) {
+                int fj = m_first[j];
+                const T* Lj = row(j);
+                T sum = T(0);
+                for(int k=std::max(fi,fj); k<j; k++) {
+                    sum += Li[k-fi]*Lj[k-fj];
+                }
+                Li[j-fi] -= sum;
+            }
+
+            T d = m_D[i];
+            for(int j=fi; j<i; j++) {
+                T g = Li[j-fi];
+                Li[j-fi] = g/m_D[j];
+                d -= g*Li[j-fi];
+            }
+
+            if (skylineAbs(d)<tiny) {
+                d = (skylineIsNegative(d) ? T(-tiny) : T(tiny));
+                m_numPerturbed++;
+            }
+            if (skylineIsNegative(d)) {
+                m_numNegative++;
+            }
+            m_D[i] = d;
+        }
+        return (m_numPerturbed==0);
+    }
+
+    /** Solve  A*x = b  with the current factorization; x and b may coincide.
+     */
+    void Solve( const T* b, T* x ) const {
+        std::vector<T> z(m_size);
+        for(int i=0; i<m_size; i++) {
+            z[i] = b[m_perm[i]];
+        }
+
+        for(int i=0; i<m_size; i++) {
+            int fi = m_first[i];
+            const T* Li = row(i);
+            T sum = z[i];
+            for(int j=fi; j<i; j++) {
+                sum -= Li[j-fi]*z[j];
+            }
+            z[i] = sum;
+        }
+
+        for(int i=0; i<m_size; i++) {
+            z[i] /= m_D[i];
+        }
+
+        for(int i=m_size-1; i>=0; i--) {
+            int fi = m_first[i];
+            const T* Li = row(i);
+            T zi = z[i];
+            for(int j=fi; j<i; j++) {
+                z[j] -= Li[j-fi]*zi;
+            }
+        }
+
+        for(int i=0; i<m_size; i++) {
+            x[m_perm[i]] = z[i];
+        }
+    }
+
+    /** Number of negative pivots of the last factorization (Sylvester inertia).
+     */
+    int NumNegativePivots() const  { return m_numNegative; }
+
+    /** Number of pivots which had to be perturbed in the last factorization.
+     */
+    int NumPerturbedPivots() const  { return m_numPerturbed; }
+
+    int Size() const  { return m_size; }
+
+private:
+    /** Row i of the strict lower envelope, columns m_first[i]...i-1;
+     *   NULL for an empty row, so that an empty envelope is never indexed.
+     */
+    T* row( int i )  { return (m_first[i]<i ? &m_L[m_rowStart[i]] : NULL); }
+    const T* row( int i ) const  { return (m_first[i]<i ? &m_L[m_rowStart[i]] : NULL); }
+
+    int                  m_size;
+    std::vector<int>     m_perm;      //!< new -> old
+    std::vector<int>     m_iperm;     //!< old -> new
+    std::vector<int>     m_first;     //!< first column of envelope per row
+    std::vector<size_t>  m_rowStart;  //!< start of row within m_L; the envelope may exceed 2^31 entries
+    std::vector<T>       m_L;         //!< strict lower envelope of L, row-wise
+    std::vector<T>       m_D;         //!< diagonal
+    int                  m_numNegative;
+    int                  m_numPerturbed;
+};
+
+#endif // NUMCHLADNI_SKYLINE_LDLT_H
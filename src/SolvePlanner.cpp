@@ -0,0 +1,234 @@
+/**
+    @file   SolvePlanner.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined __APPLE__
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "SolvePlanner.h"
+
+static QString megaBytes( double bytes ) {
+    return QString("%1 MB").arg(bytes/1048576.0,0,'f',0);
+}
+
+static QString estimateText( const QString &name, const SolveEstimate &est ) {
+    return QString("%1: %2 modes, ~%3, ~%4 s").arg(name).arg(est.numModes)
+            .arg(megaBytes(est.memory)).arg(est.seconds,0,'g',2);
+}
+
+// ********************************** public methods *****************************
+
+SolveEstimate SolvePlanner::EstimateDense( const SolvePlanInput &in ) {
+    SolveEstimate est;
+#if defined HAVE_GSL || defined HAVE_LAPACK || defined HAVE_MAGMA
+    est.available = true;
+#endif
+    double n = static_cast<double>(in.numNodes);
+    double f = static_cast<double>(in.numDofs);
+    est.numModes = in.numDofs;
+
+    // assembly: Stot and Mtot of full size, plus one temporary copy
+    // while deleting the rows and columns of the fixed vertices
+    double build = (in.massCached ? 2.0 : 3.0)*n*n + (in.massCached ? f*f : 0.0);
+
+    // solve: Stot and the mass factor, eigenvectors in a separate matrix
+    // (GSL) or a workspace of the same size (MAGMA)
+    double solve = 2.0*f*f;
+#if defined HAVE_GSL || defined HAVE_MAGMA
+    if (!in.evOnly) {
+        solve += f*f;
+    }
+#endif
+    est.memory = 8.0*std::max(build,solve);
+    if (!in.evOnly) {
+        est.memory += 4.0*f*n;   // evals for the viewer
+    }
+
+    // Cholesky, reduction, tridiagonalization; eigenvectors roughly
+    // quadruple the work. Each deleted row/column copies both matrices.
+    double flops = (in.evOnly ? 3.0 : 12.0)*f*f*f;
+    flops += 2.0*(n-f)*n*n;
+    est.seconds = flops/PLAN_FLOP_RATE;
+    return est;
+}
+
+
+SolveEstimate SolvePlanner::EstimateSlicing( const SolvePlanInput &in ) {
+    SolveEstimate est;
+    est.available = true;
+    double n = static_cast<double>(in.numNodes);
+    double f = static_cast<double>(in.numDofs);
+    int    t = std::max(1,in.numThreads);
+    int    m = ExpectedModes(in.area,in.evMin,in.evMax,in.numDofs);
+    est.numModes = m;
+
+    // windows: two per thread, bisected down to maxModesPerWindow
+    int perWindow = std::max(1,std::min(in.maxModesPerWindow,(m + 2*t - 1)/(2*t)));
+    int numWindows = std::max(2*t,(m + perWindow - 1)/perWindow);
+    int numActive  = std::min(t,numWindows);
+    double k = std::min(f,2.0*perWindow + 40.0);   // Lanczos basis, see ShiftInvertLanczos
+
+    // K and M, skyline factor, Lanczos and locked vectors with their M products
+    double ops    = 2.0*in.nnz*12.0 + 8.0*f;
+    double window = 8.0*in.envelope + 20.0*f + 16.0*k*f + 16.0*perWindow*f + 8.0*k*k;
+    double result = 16.0*m*f;
+    if (!in.evOnly) {
+        result += 4.0*m*n;
+    }
+    est.memory = ops + numActive*window + result;
+
+    // inertia counts at all window bounds, one factorization per window
+    // plus k Lanczos steps with full reorthogonalization
+    double lanczos = k*(4.0*in.envelope + 4.0*in.nnz + 4.0*f*(0.5*k + perWindow));
+    double flops = (2*t + 1 + numWindows)*in.factorFlops + numWindows*(in.factorFlops + lanczos);
+    est.seconds = flops/(PLAN_FLOP_RATE*numActive);
+    return est;
+}
+
+
+SolveEstimate SolvePlanner::EstimateLobpcg( const SolvePlanInput &in ) {
+    SolveEstimate est;
+    est.available = true;
+    double n  = static_cast<double>(in.numNodes);
+    double f  = static_cast<double>(in.numDofs);
+    int    t  = std::max(1,in.numThreads);
+    int    m  = std::min(in.numModes,in.numDofs);
+    double bs = std::min(f,m + std::max(4.0,m/4.0));   // see LOBPCGSolver::Solve
+    est.numModes = m;
+
+    // K and M, skyline factor of the preconditioner; X, W, P with their
+    // K and M products, residuals and temporaries
+    double ops    = 2.0*in.nnz*12.0 + 8.0*f;
+    double blocks = 8.0*12.0*bs*f + 8.0*2.0*9.0*bs*bs;
+    double result = 16.0*m*f;
+    if (!in.evOnly) {
+        result += 4.0*m*n;
+    }
+    est.memory = ops + 8.0*in.envelope + blocks + result;
+
+    // per iteration: K and M times W, preconditioner, Gram matrices and
+    // block updates of size f x 3bs x bs, dense Rayleigh-Ritz of size 3bs
+    const double iterations = 20.0;
+    double iter = 4.0*in.nnz*bs + 4.0*in.envelope*bs + 2.0*f*bs*bs*24.0 + 30.0*27.0*bs*bs*bs;
+    est.seconds = (in.factorFlops + iterations*iter)/(PLAN_FLOP_RATE*t);
+    return est;
+}
+
+
+int SolvePlanner::ExpectedModes( double area, double lo, double hi, int numDofs ) {
+    lo = std::max(lo,0.0);
+    if (hi<=lo) {
+        return 0;
+    }
+    double num = std::ceil(area*(hi-lo)/(4.0*M_PI));
+    return static_cast<int>(std::min(num,static_cast<double>(numDofs)));
+}
+
+
+void SolvePlanner::Plan( const SolvePlanInput &in, e_solverType requested, double memLimit, SolvePlan &plan ) {
+    plan.dense    = EstimateDense(in);
+    plan.slicing  = EstimateSlicing(in);
+    plan.lobpcg   = EstimateLobpcg(in);
+    plan.memLimit = memLimit;
+
+    bool denseFits   = plan.dense.available && plan.dense.memory<=memLimit;
+    bool slicingFits = plan.slicing.memory<=memLimit;
+
+    plan.feasible = false;
+    switch (requested) {
+        case e_solver_dense: {
+            plan.solver   = e_solver_dense;
+            plan.feasible = denseFits;
+            break;
+        }
+        case e_solver_slicing: {
+            plan.solver   = e_solver_slicing;
+            plan.feasible = slicingFits;
+            break;
+        }
+        case e_solver_lobpcg: {
+            plan.solver   = e_solver_lobpcg;
+            plan.feasible = plan.lobpcg.memory<=memLimit;
+            break;
+        }
+        case e_solver_auto: {
+            plan.feasible = (denseFits || slicingFits);
+            if (denseFits && slicingFits) {
+                plan.solver = (plan.dense.seconds<=plan.slicing.seconds ? e_solver_dense : e_solver_slicing);
+            } else {
+                plan.solver = (denseFits ? e_solver_dense : e_solver_slicing);
+            }
+            break;
+        }
+    }
+
+    const SolveEstimate &est = (plan.solver==e_solver_dense ? plan.dense :
+                                (plan.solver==e_solver_lobpcg ? plan.lobpcg : plan.slicing));
+    if (plan.feasible) {
+        plan.message = estimateText(stl_solverType[plan.solver],est);
+    } else if (requested==e_solver_auto) {
+        plan.message = QString("Refused: dense needs ~%1, slicing ~%2, limit is %3")
+                .arg(megaBytes(plan.dense.memory)).arg(megaBytes(plan.slicing.memory)).arg(megaBytes(memLimit));
+    } else {
+        plan.message = QString("Refused: %1 solver needs ~%2, limit is %3")
+                .arg(stl_solverType[plan.solver]).arg(megaBytes(est.memory)).arg(megaBytes(memLimit));
+    }
+}
+
+
+double SolvePlanner::PhysicalMemory() {
+#ifdef _WIN32
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status)) {
+        return static_cast<double>(status.ullTotalPhys);
+    }
+    return 0.0;
+#elif defined __APPLE__
+    int64_t mem = 0;
+    size_t len = sizeof(mem);
+    if (sysctlbyname("hw.memsize",&mem,&len,NULL,0)==0) {
+        return static_cast<double>(mem);
+    }
+    return 0.0;
+#else
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long size  = sysconf(_SC_PAGE_SIZE);
+    if (pages>0 && size>0) {
+        return static_cast<double>(pages)*size;
+    }
+    return 0.0;
+#endif
+}
+
+
+double SolvePlanner::DefaultMemoryLimit() {
+    double mem = PhysicalMemory();
+    return (mem>0.0 ? 0.5*mem : 2.0*1073741824.0);
+}
@@ -0,0 +1,129 @@
+/**
+    @file   SolvePlanner.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_SOLVE_PLANNER_H
+#define NUMCHLADNI_SOLVE_PLANNER_H
+
+#include <QString>
+
+#include "qtdefs.h"
+
+/**
+ * @brief Estimated cost of one solver path.
+ */
+struct SolveEstimate
+{
+    bool    available;   //!< solver is compiled in
+    double  memory;      //!< peak memory in bytes
+    double  seconds;     //!< rough runtime
+    int     numModes;    //!< number of eigenpairs to be computed
+
+    SolveEstimate() : available(false), memory(0.0), seconds(0.0), numModes(0) {}
+};
+
+
+/**
+ * @brief Problem size as seen by the planner.
+ */
+struct SolvePlanInput
+{
+    int     numNodes;           //!< mesh vertices, size of the dense matrices during assembly
+    int     numDofs;            //!< free mesh vertices
+    int     nnz;                //!< nonzeros of the sparse stiffness matrix
+    double  envelope;           //!< skyline envelope after reverse Cuthill-McKee
+    double  factorFlops;        //!< flops of one sparse LDL^T factorization
+    double  area;               //!< area of the plate
+    bool    evOnly;             //!< eigenvalues only
+    bool    massCached;         //!< dense mass factor is cached
+    double  evMin;              //!< eigenvalue interval of the slicing solver
+    double  evMax;
+    int     numModes;           //!< lowest eigenpairs of the LOBPCG solver
+    int     numThreads;         //!< threads of the sparse solvers
+    int     maxModesPerWindow;  //!< see SpectrumSlicer
+
+    SolvePlanInput() : numNodes(0), numDofs(0), nnz(0), envelope(0.0), factorFlops(0.0),
+        area(0.0), evOnly(false), massCached(false), evMin(0.0), evMax(0.0),
+        numModes(0), numThreads(1), maxModesPerWindow(200) {}
+};
+
+
+/**
+ * @brief Solver chosen by the planner.
+ */
+struct SolvePlan
+{
+    e_solverType   solver;     //!< e_solver_dense, e_solver_slicing, or e_solver_lobpcg
+    bool           feasible;   //!< false if every requested path exceeds the memory limit
+    SolveEstimate  dense;
+    SolveEstimate  slicing;
+    SolveEstimate  lobpcg;
+    double         memLimit;   //!< memory limit in bytes
+    QString        message;    //!< summary for the status line
+
+    SolvePlan() : solver(e_solver_dense), feasible(false), memLimit(0.0) {}
+};
+
+
+/**
+ * @brief Pre-solve estimate of peak memory and runtime.
+ *
+ *   The estimates follow the allocations of SystemData::SolveSystem
+ *   and SpectrumSlicer. Runtimes assume PLAN_FLOP_RATE flops per second
+ *   and thread and are meant as orders of magnitude only.
+ */
+class SolvePlanner
+{
+public:
+    /** Dense solver (GSL, LAPACK, or MAGMA): all eigenpairs.
+     */
+    static SolveEstimate EstimateDense( const SolvePlanInput &in );
+
+    /** Spectrum slicing: eigenpairs within [evMin,evMax).
+     */
+    static SolveEstimate EstimateSlicing( const SolvePlanInput &in );
+
+    /** LOBPCG: the numModes lowest eigenpairs, cold start.
+     */
+    static SolveEstimate EstimateLobpcg( const SolvePlanInput &in );
+
+    /** Expected number of eigenvalues within [lo,hi) from Weyl's law,
+     *   N(lambda) ~ area*lambda/(4 pi), limited to numDofs.
+     */
+    static int    ExpectedModes( double area, double lo, double hi, int numDofs );
+
+    /** Choose solver path.
+     * \param in         problem size
+     * \param requested  e_solver_auto picks the faster of dense and slicing within the limit
+     * \param memLimit   memory limit in bytes
+     * \param plan       chosen path and estimates
+     */
+    static void   Plan( const SolvePlanInput &in, e_solverType requested, double memLimit, SolvePlan &plan );
+
+    /** Physical memory in bytes, 0 if unknown.
+     */
+    static double PhysicalMemory();
+
+    /** Half of the physical memory, 2 GB if unknown.
+     */
+    static double DefaultMemoryLimit();
+};
+
+#endif // NUMCHLADNI_SOLVE_PLANNER_H
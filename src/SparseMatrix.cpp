@@ -0,0 +1,141 @@
+/**
+    @file   SparseMatrix.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cassert>
+
+#include "SparseMatrix.h"
+
+SparseMatrix::SparseMatrix() {
+    m_size = 0;
+}
+
+SparseMatrix::~SparseMatrix() {
+}
+
+// ********************************** public methods *****************************
+
+void SparseMatrix::SetPattern( int n, const std::vector< std::vector<int> > &pattern ) {
+    assert(static_cast<int>(pattern.size())==n);
+    m_size = n;
+    m_rowPtr.resize(n+1);
+    m_colIdx.clear();
+
+    std::vector<int> row;
+    m_rowPtr[0] = 0;
+    for(int r=0; r<n; r++) {
+        row = pattern[r];
+        std::sort(row.begin(),row.end());
+        row.erase(std::unique(row.begin(),row.end()),row.end());
+        m_colIdx.insert(m_colIdx.end(),row.begin(),row.end());
+        m_rowPtr[r+1] = static_cast<int>(m_colIdx.size());
+    }
+    m_values.assign(m_colIdx.size(),0.0);
+}
+
+void SparseMatrix::SetPatternFrom( const SparseMatrix &other ) {
+    m_size   = other.m_size;
+    m_rowPtr = other.m_rowPtr;
+    m_colIdx = other.m_colIdx;
+    m_values.assign(m_colIdx.size(),0.0);
+}
+
+void SparseMatrix::SetZero() {
+    std::fill(m_values.begin(),m_values.end(),0.0);
+}
+
+int SparseMatrix::Find( int row, int col ) const {
+    const int* first = &m_colIdx[0] + m_rowPtr[row];
+    const int* last  = &m_colIdx[0] + m_rowPtr[row+1];
+    const int* pos = std::lower_bound(first,last,col);
+    if (pos==last || *pos!=col) {
+        return -1;
+    }
+    return static_cast<int>(pos - &m_colIdx[0]);
+}
+
+void SparseMatrix::AddValue( int row, int col, double val ) {
+    int pos = Find(row,col);
+    assert(pos>=0);
+    m_values[pos] += val;
+}
+
+double SparseMatrix::GetValue( int row, int col ) const {
+    int pos = Find(row,col);
+    if (pos<0) {
+        return 0.0;
+    }
+    return m_values[pos];
+}
+
+void SparseMatrix::Multiply( const double* x, double* y ) const {
+    for(int r=0; r<m_size; r++) {
+        double sum = 0.0;
+        for(int k=m_rowPtr[r]; k<m_rowPtr[r+1]; k++) {
+            sum += m_values[k]*x[m_colIdx[k]];
+        }
+        y[r] = sum;
+    }
+}
+
+void SparseMatrix::MultiplyBlock( const double* X, double* Y, int numCols, int rowBegin, int rowEnd ) const {
+    for(int r=rowBegin; r<rowEnd; r++) {
+        double* y = Y + static_cast<size_t>(r)*numCols;
+        for(int c=0; c<numCols; c++) {
+            y[c] = 0.0;
+        }
+        for(int k=m_rowPtr[r]; k<m_rowPtr[r+1]; k++) {
+            double a = m_values[k];
+            const double* x = X + static_cast<size_t>(m_colIdx[k])*numCols;
+            for(int c=0; c<numCols; c++) {
+                y[c] += a*x[c];
+            }
+        }
+    }
+}
+
+size_t SparseMatrix::MemorySize() const {
+    return m_rowPtr.size()*sizeof(int) + m_colIdx.size()*sizeof(int) + m_values.size()*sizeof(double);
+}
+
+
+// ----------------------------------------
+//  dense vector helpers
+// ----------------------------------------
+double vecDot( int n, const double* x, const double* y ) {
+    double sum = 0.0;
+    for(int i=0; i<n; i++) {
+        sum += x[i]*y[i];
+    }
+    return sum;
+}
+
+void vecAxpy( int n, double a, const double* x, double* y ) {
+    for(int i=0; i<n; i++) {
+        y[i] += a*x[i];
+    }
+}
+
+void vecScale( int n, double a, double* x ) {
+    for(int i=0; i<n; i++) {
+        x[i] *= a;
+    }
+}
@@ -0,0 +1,100 @@
+/**
+    @file   SparseMatrix.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_SPARSE_MATRIX_H
+#define NUMCHLADNI_SPARSE_MATRIX_H
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * @brief Symmetric sparse matrix in compressed row storage (CRS).
+ *
+ *   Both triangles are stored, hence each row holds its complete
+ *   sparsity pattern. Column indices within a row are sorted.
+ */
+class SparseMatrix
+{
+public:
+    SparseMatrix();
+    ~SparseMatrix();
+
+    // --------- public methods -----------
+public:
+    /** Initialize sparsity pattern; all values are set to zero.
+     * \param n        number of rows/columns
+     * \param pattern  column indices for every row (need not be sorted or unique)
+     */
+    void   SetPattern( int n, const std::vector< std::vector<int> > &pattern );
+
+    /** Copy sparsity pattern of another matrix; all values are set to zero.
+     * \param other
+     */
+    void   SetPatternFrom( const SparseMatrix &other );
+
+    void   SetZero();
+
+    /** Add value to entry (row,col). The entry must be part of the pattern.
+     */
+    void   AddValue( int row, int col, double val );
+
+    /** Get value of entry (row,col); zero if not part of the pattern.
+     */
+    double GetValue( int row, int col ) const;
+
+    /** Matrix-vector product  y = A*x
+     */
+    void   Multiply( const double* x, double* y ) const;
+
+    /** Matrix-block product  Y = A*X  for the rows [rowBegin,rowEnd).
+     *   X and Y are stored row-major (numCols entries per row), such that
+     *   each matrix entry is applied to numCols contiguous values.
+     */
+    void   MultiplyBlock( const double* X, double* Y, int numCols, int rowBegin, int rowEnd ) const;
+
+    /** Position of entry (row,col) within the value array, -1 if not part of the pattern.
+     */
+    int    Find( int row, int col ) const;
+
+    int    Size() const  { return m_size; }
+    int    NumNonZeros() const  { return static_cast<int>(m_colIdx.size()); }
+
+    /** Memory used by the matrix in bytes.
+     */
+    size_t MemorySize() const;
+
+    // -------- public attributes --------
+public:
+    int                  m_size;
+    std::vector<int>     m_rowPtr;
+    std::vector<int>     m_colIdx;
+    std::vector<double>  m_values;
+};
+
+
+// ----------------------------------------
+//  dense vector helpers
+// ----------------------------------------
+double vecDot  ( int n, const double* x, const double* y );
+void   vecAxpy ( int n, double a, const double* x, double* y );
+void   vecScale( int n, double a, double* x );
+
+#endif // NUMCHLADNI_SPARSE_MATRIX_H
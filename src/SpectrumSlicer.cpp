@@ -0,0 +1,253 @@
+/**
+    @file   ShiftInvertLanczos.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cstdio>
+#include <algorithm>
+
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include "SpectrumSlicer.h"
+#include "SkylineLDLT.h"
+#include "ShiftInvertLanczos.h"
+
+/**
+ *  Inertia count of K - sigma*M.
+ */
+class InertiaJob : public QRunnable
+{
+public:
+    InertiaJob( const SparseMatrix &K, const SparseMatrix &M, const std::vector<int> &perm, double sigma )
+        : m_K(K), m_M(M), m_perm(perm), m_sigma(sigma), m_count(0) {
+        setAutoDelete(false);
+    }
+
+    virtual void run() {
+        SkylineLDLT<double> ldlt;
+        ldlt.SetOrdering(m_K,m_perm);
+        ldlt.Factorize(m_K,m_M,1.0,-m_sigma);
+        m_count = ldlt.NumNegativePivots();
+    }
+
+    int  Count() const  { return m_count; }
+
+private:
+    const SparseMatrix&       m_K;
+    const SparseMatrix&       m_M;
+    const std::vector<int>&   m_perm;
+    double  m_sigma;
+    int     m_count;
+};
+
+
+/**
+ *  Eigenpairs within one window [lo,hi).
+ */
+class WindowJob : public QRunnable
+{
+public:
+    WindowJob( const SparseMatrix &K, const SparseMatrix &M, const std::vector<int> &perm,
+               double lo, double hi, int expected, unsigned int seed )
+        : m_lo(lo), m_hi(hi), m_expected(expected), m_ok(false), m_solver(K,M) {
+        m_solver.SetOrdering(perm);
+        m_solver.SetSeed(seed);
+        setAutoDelete(false);
+    }
+
+    virtual void run() {
+        m_ok = m_solver.SolveInterval(m_lo,m_hi,m_expected);
+    }
+
+    int  Expected() const  { return m_expected; }
+    bool IsOk() const  { return m_ok; }
+    const ShiftInvertLanczos&  Solver() const  { return m_solver; }
+
+private:
+    double  m_lo;
+    double  m_hi;
+    int     m_expected;
+    bool    m_ok;
+    ShiftInvertLanczos  m_solver;
+};
+
+
+SpectrumSlicer::SpectrumSlicer( const SparseMatrix &K, const SparseMatrix &M )
+    : m_K(K), m_M(M) {
+    m_numThreads   = 0;
+    m_maxPerWindow = 200;
+    m_numWindows   = 0;
+    ReverseCuthillMcKee(m_K,m_perm);
+}
+
+SpectrumSlicer::~SpectrumSlicer() {
+}
+
+// ********************************** public methods *****************************
+
+void SpectrumSlicer::SetNumThreads( int num ) {
+    m_numThreads = num;
+}
+
+void SpectrumSlicer::SetMaxModesPerWindow( int num ) {
+    m_maxPerWindow = std::max(1,num);
+}
+
+int SpectrumSlicer::CountBelow( double sigma ) {
+    InertiaJob job(m_K,m_M,m_perm,sigma);
+    job.run();
+    return job.Count();
+}
+
+
+bool SpectrumSlicer::Solve( double lo, double hi ) {
+    m_lambda.clear();
+    m_X.clear();
+    m_numWindows = 0;
+    if (hi<=lo || m_K.Size()==0) {
+        return false;
+    }
+
+    int numThreads = (m_numThreads>0 ? m_numThreads : QThread::idealThreadCount());
+    numThreads = std::max(1,numThreads);
+
+    // initial uniform windows, two per thread
+    int numInit = 2*numThreads;
+    std::vector<double> bounds(numInit+1);
+    for(int w=0; w<=numInit; w++) {
+        bounds[w] = lo + (hi-lo)*w/static_cast<double>(numInit);
+    }
+    bounds[numInit] = hi;
+    std::vector<int> counts;
+    countBelow(bounds,counts);
+
+    // bisect windows with too many eigenvalues
+    for(int pass=0; pass<20; pass++) {
+        std::vector<double> mids;
+        for(size_t w=0; w+1<bounds.size(); w++) {
+            if (counts[w+1]-counts[w] > m_maxPerWindow && bounds[w+1]-bounds[w] > 1e-10*(hi-lo)) {
+                mids.push_back(0.5*(bounds[w]+bounds[w+1]));
+            }
+        }
+        if (mids.empty()) {
+            break;
+        }
+        std::vector<int> midCounts;
+        countBelow(mids,midCounts);
+
+        std::vector<double> nb;
+        std::vector<int> nc;
+        size_t m = 0;
+        for(size_t w=0; w<bounds.size(); w++) {
+            nb.push_back(bounds[w]);
+            nc.push_back(counts[w]);
+            if (m<mids.size() && w+1<bounds.size() && mids[m]>bounds[w] && mids[m]<bounds[w+1]) {
+                nb.push_back(mids[m]);
+                nc.push_back(midCounts[m]);
+                m++;
+            }
+        }
+        bounds.swap(nb);
+        counts.swap(nc);
+    }
+
+    int total = counts.back() - counts.front();
+    fprintf(stderr,"Spectrum slicing: %d eigenvalues in [%g,%g), %d windows, %d threads\n",
+            total,lo,hi,static_cast<int>(bounds.size())-1,numThreads);
+
+    // solve windows
+    std::vector<WindowJob*> jobs;
+    for(size_t w=0; w+1<bounds.size(); w++) {
+        int expected = counts[w+1] - counts[w];
+        if (expected>0) {
+            jobs.push_back(new WindowJob(m_K,m_M,m_perm,bounds[w],bounds[w+1],expected,
+                                         4711u + 97u*static_cast<unsigned int>(w)));
+        }
+    }
+    m_numWindows = static_cast<int>(jobs.size());
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+    // start the largest windows first for better load balance
+    std::vector<WindowJob*> order(jobs);
+    for(size_t a=1; a<order.size(); a++) {
+        WindowJob* job = order[a];
+        size_t c = a;
+        while (c>0 && order[c-1]->Expected() < job->Expected()) {
+            order[c] = order[c-1];
+            c--;
+        }
+        order[c] = job;
+    }
+    for(size_t j=0; j<order.size(); j++) {
+        pool.start(order[j]);
+    }
+    pool.waitForDone();
+
+    // merge in window order
+    int n = m_K.Size();
+    bool complete = true;
+    m_lambda.reserve(total);
+    m_X.reserve(static_cast<size_t>(total)*n);
+    for(size_t j=0; j<jobs.size(); j++) {
+        const ShiftInvertLanczos &solver = jobs[j]->Solver();
+        m_lambda.insert(m_lambda.end(),solver.Eigenvalues().begin(),solver.Eigenvalues().end());
+        m_X.insert(m_X.end(),solver.Eigenvectors().begin(),solver.Eigenvectors().end());
+        complete = complete && jobs[j]->IsOk();
+        delete jobs[j];
+    }
+
+    if (!complete) {
+        fprintf(stderr,"Spectrum slicing: found %d of %d eigenvalues.\n",NumModes(),total);
+    }
+    return complete;
+}
+
+
+const double* SpectrumSlicer::Eigenvector( int k ) const {
+    if (k<0 || k>=NumModes()) {
+        return NULL;
+    }
+    return &m_X[static_cast<size_t>(k)*m_K.Size()];
+}
+
+// ********************************* protected methods *****************************
+
+void SpectrumSlicer::countBelow( const std::vector<double> &sigmas, std::vector<int> &counts ) {
+    std::vector<InertiaJob*> jobs;
+    for(size_t s=0; s<sigmas.size(); s++) {
+        jobs.push_back(new InertiaJob(m_K,m_M,m_perm,sigmas[s]));
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(std::max(1,(m_numThreads>0 ? m_numThreads : QThread::idealThreadCount())));
+    for(size_t s=0; s<jobs.size(); s++) {
+        pool.start(jobs[s]);
+    }
+    pool.waitForDone();
+
+    counts.resize(sigmas.size());
+    for(size_t s=0; s<jobs.size(); s++) {
+        counts[s] = jobs[s]->Count();
+        delete jobs[s];
+    }
+}
@@ -0,0 +1,94 @@
+/**
+    @file   ShiftInvertLanczos.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef NUMCHLADNI_SPECTRUM_SLICER_H
+#define NUMCHLADNI_SPECTRUM_SLICER_H
+
+#include <vector>
+
+#include "SparseMatrix.h"
+
+/**
+ * @brief Spectrum slicing for  K x = lambda M x.
+ *
+ *   The eigenvalue interval [lo,hi) is split into windows. The number
+ *   of eigenvalues within each window follows from the Sylvester inertia
+ *   of K - sigma*M at the window boundaries; windows holding too many
+ *   eigenvalues are bisected. Every window is then solved independently
+ *   by shift-invert Lanczos on a thread pool, and the results are merged
+ *   in ascending order.
+ */
+class SpectrumSlicer
+{
+public:
+    SpectrumSlicer( const SparseMatrix &K, const SparseMatrix &M );
+    ~SpectrumSlicer();
+
+    // --------- public methods -----------
+public:
+    /** Number of worker threads; 0 uses the number of cores.
+     */
+    void  SetNumThreads( int num );
+
+    /** Upper bound for the number of eigenvalues per window.
+     */
+    void  SetMaxModesPerWindow( int num );
+
+    /** Number of eigenvalues below sigma (Sylvester inertia of K - sigma*M).
+     */
+    int   CountBelow( double sigma );
+
+    /** Compute all eigenpairs with  lo <= lambda < hi.
+     * \return true if every window found the number of eigenpairs given by inertia
+     */
+    bool  Solve( double lo, double hi );
+
+    int   NumModes() const  { return static_cast<int>(m_lambda.size()); }
+    int   NumWindows() const  { return m_numWindows; }
+
+    /** Eigenvalues in ascending order.
+     */
+    const std::vector<double>&  Eigenvalues() const  { return m_lambda; }
+
+    /** M-normalized eigenvector k (K.Size() entries).
+     */
+    const double*  Eigenvector( int k ) const;
+
+protected:
+    /** Inertia counts at several shifts, computed in parallel.
+     */
+    void  countBelow( const std::vector<double> &sigmas, std::vector<int> &counts );
+
+    // -------- private attributes --------
+private:
+    const SparseMatrix&  m_K;
+    const SparseMatrix&  m_M;
+    std::vector<int>     m_perm;
+    int                  m_numThreads;
+    int                  m_maxPerWindow;
+    int                  m_numWindows;
+
+    std::vector<double>  m_lambda;
+    std::vector<double>  m_X;
+};
+
+#endif // NUMCHLADNI_SPECTRUM_SLICER_H
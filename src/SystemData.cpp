@@ -20,15 +20,65 @@
 */
 
 #include <locale>
+#include <cmath>
 #include <limits>
+#include <cstring>
 
 #include <QTextStream>
 #include <QMessageBox>
+#include <QThread>
+#include <QDataStream>
+
+#ifdef HAVE_AUDIO
+#include <QAudioOutput>
+#include <QAudioDeviceInfo>
+#endif
 
 #include "SystemData.h"
+#include "SpectrumSlicer.h"
+#include "EigenContinuation.h"
+#include "EigenUtils.h"
+#include "KrylovSweep.h"
+#include "LOBPCGSolver.h"
+#include "SkylineLDLT.h"
+#include "Mesher.h"
+
+// FNV-1a hash for the cache keys of the pipeline stages
+static const quint64 fnvOffset = Q_UINT64_C(14695981039346656037);
+
+static quint64 fnv1a( quint64 h, const void* data, size_t len ) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for(size_t i=0; i<len; i++) {
+        h ^= p[i];
+        h *= Q_UINT64_C(1099511628211);
+    }
+    return h;
+}
 
-extern "C" {
-#include "triangle.h"
+// relative shifts tried when K - sigma*M is numerically singular at sigma
+static const double inertiaShifts[] = { 0.0, -1e-8, 1e-8, -1e-6, 1e-6 };
+
+/**
+ *  Number of eigenvalues below sigma from the inertia of K - sigma*M.
+ *  Perturbed pivots make the inertia unreliable; sigma is then moved
+ *  slightly off the nearby eigenvalue.
+ *  \return  false if every shift needed perturbed pivots
+ */
+static bool inertiaCount( SkylineLDLT<double> &ldlt, const SparseMatrix &K, const SparseMatrix &M,
+                          double sigma, int &count ) {
+    int numShifts = static_cast<int>(sizeof(inertiaShifts)/sizeof(inertiaShifts[0]));
+    for(int s=0; s<numShifts; s++) {
+        double shift = inertiaShifts[s]*std::max(fabs(sigma),1.0);
+        ldlt.Factorize(K,M,1.0,-(sigma+shift));
+        if (ldlt.NumPerturbedPivots()==0) {
+            if (shift!=0.0) {
+                fprintf(stderr,"Mode count: K - sigma*M is singular at %g, counted at %g.\n",sigma,sigma+shift);
+            }
+            count = ldlt.NumNegativePivots();
+            return true;
+        }
+    }
+    return false;
 }
 
 SystemData::SystemData() {    
@@ -103,8 +153,51 @@ SystemData::SystemData() {
     m_useDelaunay    = false;
     m_useConvexHull  = false;
     m_elastSupported = false;
+    m_elastStiffness = init_elast_stiffness;
+    m_evOnly   = false;
+    m_headless = false;
+    m_printEV  = true;
     m_eigenvalues = NULL;
 
+    m_solverType = e_solver_dense;
+    m_sliceEvMin = init_slice_ev_min;
+    m_sliceEvMax = init_slice_ev_max;
+    m_numThreads = init_num_threads;
+    m_numModes   = init_num_modes;
+    m_useMultigrid = false;
+    m_meshParts  = init_mesh_parts;
+    m_livePreview = false;
+    m_progressive = false;
+    m_perturbOrder = 0;
+    m_perturbPoint = -1;
+    m_damping    = init_damping;
+    m_rayleighMass  = 0.0;
+    m_rayleighStiff = 0.0;
+    m_respPressure = 0.0;
+    m_forcedKey  = 0;
+    m_transientScheme = static_cast<int>(TransientSolver::e_scheme_newmark);
+    m_transientStep   = 0.0;
+    m_transientRate   = init_transient_rate;
+    m_transientSignal = TransientSolver::e_signal_hammer;
+    m_transientParam[0] = 1.0;
+    m_transientParam[1] = 100.0;
+    m_transient       = NULL;
+    m_transientKey    = 0;
+    m_transientFrame  = NULL;
+    m_transientTarget = 0.0;
+    m_soundRate  = init_sound_rate;
+    m_soundFreq  = init_sound_freq;
+    m_soundPickupSet = false;
+#ifdef HAVE_AUDIO
+    m_audio       = NULL;
+    m_audioDevice = NULL;
+#endif
+    m_warmKey    = 0;
+    m_multigrid  = NULL;
+    m_multigridKey = 0;
+    m_massType   = e_mass_consistent;
+    m_memLimit   = init_mem_limit;
+
     N = 0;
     mMeshVerts   = NULL;
     mMeshIndices = NULL;
@@ -115,6 +208,14 @@ SystemData::SystemData() {
 #endif
     s1 = NULL;
     Stot = Mtot = NULL;
+    m_massFactor = NULL;
+    m_massKey = 0;
+
+    m_meshGeneration = 0;
+    m_meshBaseKey = 0;
+    for(int s=0; s<e_stage_count; s++) {
+        m_stageKey[s] = 0;
+    }
 }
 
 
@@ -125,6 +226,29 @@ SystemData::~SystemData() {
 }
 
 void SystemData::ClearAll() {
+    releaseMassCache();
+    InvalidateStage(e_stage_mesh);
+    m_triMesh = TriMesh();
+    m_meshBaseKey = 0;
+    m_sizeField.Clear();
+    m_dofs = DofMap();
+    m_sparseK = SparseMatrix();
+    m_sparseM = SparseMatrix();
+    m_warmStart.clear();
+    m_warmKey = 0;
+    m_warmMesh = FEMesh();
+    ClearReducedModel();
+    ClearShapeTargets();
+    ClearResponse();
+    StopTransient();
+    ClearSuperModes();
+    StopSound();
+    m_warmDofs = DofMap();
+    if (m_multigrid!=NULL) {
+        delete m_multigrid;
+        m_multigrid = NULL;
+    }
+    m_multigridKey = 0;
     if (!m_vertices.empty()) {
         m_vertices.clear();
     }
@@ -157,99 +281,89 @@ void SystemData::ClearAll() {
 
 // ********************************** public methods *****************************
 
-void freeSpace( void* data ) {
-    if (data!=NULL) {
-        //std::cerr << data << std::endl;
-        trifree(data);
-        data = NULL;
-    } else {
-        //fprintf(stderr,"is null\n");
-    }
-}
-
-
 bool SystemData::DoTriangulation(const char *triswitches) {
     if (m_vertices.size()<3) {
         return false;
     }
+
+    quint64 key = meshKey(triswitches);
+    if (IsMeshValid(triswitches)) {
+        fprintf(stderr,"Mesh is up to date.\n");
+        UpdateBoundaryMarkers();
+        return true;
+    }
+    InvalidateStage(e_stage_mesh);
     fprintf(stderr,"Triangulate...\n");
 
-    //const char *triswitches = "zYYpa0.1";
-    const unsigned int length = 256;
-    char refparams[length];
-#if defined _WIN32 && !defined __MINGW32__
-    sprintf_s(refparams, length, "%s", triswitches);
-#else
-    sprintf(refparams,"%s",triswitches);
-#endif
+    MeshGeometry geom;
+    GetMeshGeometry(geom);
+    TriMesh mesh;
+    bool meshed = false;
+    if (m_meshParts>1 && m_maxArea>0.0) {
+        QString quality = QString();
+        if (m_minAngle>0.0) {
+            quality += QString("q%1").arg(m_minAngle);
+        }
+        if (m_useDelaunay) {
+            quality += QString("D");
+        }
+        meshed = Mesher::TriangulateParts(geom,quality.toStdString().c_str(),m_maxArea,m_useConvexHull,
+                                          m_useQuad,&m_sizeField,m_meshParts,mesh);
+        if (!meshed) {
+            fprintf(stderr,"Domain too small for %d parts, triangulate at once.\n",m_meshParts);
+        }
+    }
+    if (!meshed && !Mesher::Triangulate(triswitches,geom,&m_sizeField,mesh)) {
+        fprintf(stderr,"Triangulation failed.\n");
+        return false;
+    }
+    storeTriangulation(mesh);
 
-    struct triangulateio in, out;
-
-    in.numberofpoints   = m_vertices.size();
-    in.numberofsegments = m_segments.size();
-    in.numberofholes    = m_holes.size();
-    in.numberofpointattributes = 0;
-
-    in.pointlist          = (REAL*)malloc(in.numberofpoints*2*sizeof(REAL));
-    in.pointattributelist = (REAL*)NULL;
-    in.pointmarkerlist    = (int*)malloc(in.numberofpoints*sizeof(int));
-    in.trianglearealist   = (REAL*)NULL;
-
-    in.segmentlist        = (int*)malloc(in.numberofsegments*2*sizeof(int));
-    in.segmentmarkerlist  = (int*)malloc(in.numberofsegments*sizeof(int));
-    in.numberoftriangles  = 0;
-    in.numberofcorners    = 3;
-    in.numberoftriangleattributes = 0;
-    in.trianglelist        = (int*)NULL;
-    in.triangleattributelist = (REAL*)NULL;
-    in.neighborlist        = (int*)NULL;
-    in.holelist            = (REAL*)malloc(in.numberofholes*2*sizeof(REAL));
-    in.numberofregions     = 0;
-    in.regionlist          = (REAL*)NULL;
-
-    out.pointlist = (REAL*)NULL;
-    out.pointattributelist = (REAL*)NULL;
-    out.pointmarkerlist = (int*)NULL;
-
-    out.trianglelist = (int*)NULL;
-    out.triangleattributelist = (REAL*)NULL;
-    out.neighborlist = (int*)NULL;
-    out.segmentlist = (int*)NULL;
-    out.segmentmarkerlist = (int*)NULL;
-    out.edgelist = (int*)NULL;
-    out.edgemarkerlist = (int*)NULL;
+    m_stageKey[e_stage_mesh] = key;
+    m_meshBaseKey = key;
+    UpdateBoundaryMarkers();
+
+    fprintf(stderr,"finished\n");
+    return true;
+}
 
 
+void SystemData::GetMeshGeometry( MeshGeometry &geom ) {
+    // Instead of the boundary markers, triangle gets tags which tell
+    // where the marker of an output vertex stems from: input point i
+    // is tagged i+2, segment i is tagged -(i+2). Input points with
+    // marker zero are left to triangle. The actual markers are set by
+    // UpdateBoundaryMarkers, which is also used when only the fixed
+    // points changed.
+    geom.points.resize(m_vertices.size());
+    geom.pointTags.resize(m_vertices.size());
     for(int i=0; i<m_vertices.size(); i++) {
-        in.pointlist[2*i+0] = m_vertices[i].pos.x;
-        in.pointlist[2*i+1] = m_vertices[i].pos.y;
-        in.pointmarkerlist[i] = m_vertices[i].bmarker;
+        geom.points[i]    = m_vertices[i].pos;
+        geom.pointTags[i] = (m_vertices[i].bmarker!=0 ? i+2 : 0);
     }
 
+    geom.segments.resize(2*m_segments.size());
+    geom.segmentTags.resize(m_segments.size());
     for(int i=0; i<m_segments.size(); i++) {
-        in.segmentlist[2*i+0] = m_segments[i].p1-1;
-        in.segmentlist[2*i+1] = m_segments[i].p2-1;
-        //in.segmentmarkerlist[i] = m_segments[i].bmarker;
-        if (m_vertices[m_segments[i].p1-1].isFixed && m_vertices[m_segments[i].p2-1].isFixed) {
-            in.segmentmarkerlist[i] = BOUNDARY_FIXED_MARKER;
-        } else {
-            in.segmentmarkerlist[i] = 1;
-        }
+        geom.segments[2*i+0] = m_segments[i].p1-1;
+        geom.segments[2*i+1] = m_segments[i].p2-1;
+        geom.segmentTags[i]  = -(i+2);
     }
 
+    geom.holes.resize(m_holes.size());
     for(int i=0; i<m_holes.size(); i++) {
-        in.holelist[2*i+0] = m_holes[i].pos.x;
-        in.holelist[2*i+1] = m_holes[i].pos.y;
+        geom.holes[i] = m_holes[i].pos;
     }
+}
 
-    triangulate(refparams,&in,&out,(struct triangulateio*)NULL);
 
-    numMeshVertices = out.numberofpoints;
-    numMeshAttribs  = out.numberofpointattributes;
+void SystemData::storeTriangulation( const TriMesh &mesh ) {
+    numMeshVertices = mesh.NumNodes();
+    numMeshAttribs  = 0;
     numMeshBMarkers = 1;
 
-    numTriangles = out.numberoftriangles;
-    numNodesPerTriangle = out.numberofcorners;
+    numTriangles = mesh.NumElems();
+    numNodesPerTriangle = mesh.nodesPerElem;
     numTriAttribs = 0;
 
     if (!mesh_vertices.empty()) {
@@ -259,22 +373,23 @@ bool SystemData::DoTriangulation(const char *triswitches) {
         mesh_triIndices.clear();
     }
 
-    for(int i=0; i<out.numberofpoints; i++) {
-        node_t node = {i,glm::dvec2(out.pointlist[2*i+0],out.pointlist[2*i+1]),out.pointmarkerlist[i],false};
+    m_triMesh = mesh;
+    for(int i=0; i<mesh.NumNodes(); i++) {
+        node_t node = {i,mesh.pos[i],0,false};
         mesh_vertices.push_back(node);
     }
-    assert(out.numberofpoints == mesh_vertices.size());
 
     // TAKE CARE OF THE ORDER OF THE TRIANGLE VERTICES a !!!
-    for(int i=0; i<out.numberoftriangles; i++) {
+    const int* tri = (mesh.elems.empty() ? NULL : &mesh.elems[0]);
+    for(int i=0; i<numTriangles; i++) {
         triIdx_t triIndex;
-        triIndex.v = glm::ivec3( out.trianglelist[numNodesPerTriangle*i+0], out.trianglelist[numNodesPerTriangle*i+1], out.trianglelist[numNodesPerTriangle*i+2] );
+        triIndex.v = glm::ivec3( tri[numNodesPerTriangle*i+0], tri[numNodesPerTriangle*i+1], tri[numNodesPerTriangle*i+2] );
         if (numNodesPerTriangle>3) {
-            triIndex.a = glm::ivec3( out.trianglelist[numNodesPerTriangle*i+5], out.trianglelist[numNodesPerTriangle*i+3], out.trianglelist[numNodesPerTriangle*i+4] );
+            triIndex.a = glm::ivec3( tri[numNodesPerTriangle*i+5], tri[numNodesPerTriangle*i+3], tri[numNodesPerTriangle*i+4] );
         }
         mesh_triIndices.push_back(triIndex);
     }
-    assert(out.numberoftriangles == mesh_triIndices.size());
+    assert(numTriangles == mesh_triIndices.size());
 
     if (mMeshVerts!=NULL) {
         delete [] mMeshVerts;
@@ -302,30 +417,562 @@ bool SystemData::DoTriangulation(const char *triswitches) {
         }
     }
     //std::cerr << "hier: " << mesh_vertices.size() << " " << mesh_triIndices.size() << std::endl;
+}
 
-    freeSpace(in.pointlist);
-    freeSpace(in.segmentlist);
-    freeSpace(in.pointattributelist);
-    freeSpace(in.pointmarkerlist);
-    freeSpace(in.regionlist);
-    freeSpace(in.segmentmarkerlist);
-    freeSpace(in.holelist);
-    freeSpace(in.neighborlist);
-    freeSpace(in.trianglelist);
-    freeSpace(in.triangleattributelist);
-
-    freeSpace(out.pointlist);
-    freeSpace(out.pointattributelist);
-    freeSpace(out.pointmarkerlist);
-    freeSpace(out.trianglelist);
-    freeSpace(out.triangleattributelist);
-    freeSpace(out.neighborlist);
-    freeSpace(out.segmentlist);
-    freeSpace(out.segmentmarkerlist);
-    freeSpace(out.edgelist);
-    freeSpace(out.edgemarkerlist);
 
-    fprintf(stderr,"finished\n");
+bool SystemData::AdaptMesh( double tol, int maxSteps ) {
+    if (mesh_vertices.empty() || m_triMesh.tags.empty()) {
+        fprintf(stderr,"Adaptive refinement needs a mesh generated by triangle.\n");
+        return false;
+    }
+
+    FEOptions opts;
+    getFEOptions(opts);
+
+    double maxErr = 0.0;
+    for(int step=0; ; step++) {
+        UpdateBoundaryMarkers();
+        solveLobpcg();
+        int n = m_dofs.NumDofs();
+        if (N==0 || n==0 || m_warmStart.empty()) {
+            InvalidateStage(e_stage_spectrum);
+            return false;
+        }
+
+        // combined indicator of all modes, divided by their eigenvalues
+        FEMesh mesh;
+        GetFEMesh(mesh);
+        int numElems = mesh.NumElems();
+        int num = std::min(N,static_cast<int>(m_warmStart.size()/n));
+        std::vector<double> indicator(numElems,0.0), eta2;
+        maxErr = 0.0;
+        for(int k=0; k<num; k++) {
+            double lambda = m_eigenvalues[k];
+            // rigid body modes of a free plate have no relative indicator
+            if (lambda<=1e-8*fabs(m_eigenvalues[num-1])) {
+                continue;
+            }
+            FEAssembler::EstimateError(mesh,m_dofs,opts,&m_warmStart[static_cast<size_t>(k)*n],lambda,eta2);
+            double sum = 0.0;
+            for(int t=0; t<numElems; t++) {
+                sum += eta2[t];
+                indicator[t] += eta2[t]/lambda;
+            }
+            maxErr = std::max(maxErr,sum/lambda);
+        }
+        fprintf(stderr,"Adapt step %d: %d dofs, %d triangles, error indicator %g\n",
+                step,n,numElems,maxErr);
+        if (maxErr<=tol || step>=maxSteps) {
+            break;
+        }
+
+        // bulk marking: the triangles with the largest indicators which
+        // together hold half of the total get a quarter of their area
+        std::vector< std::pair<double,int> > order(numElems);
+        double total = 0.0;
+        for(int t=0; t<numElems; t++) {
+            order[t] = std::make_pair(-indicator[t],t);
+            total += indicator[t];
+        }
+        std::sort(order.begin(),order.end());
+
+        std::vector<double> maxAreas(numElems,-1.0);
+        double marked = 0.0;
+        int numMarked = 0;
+        for(; numMarked<numElems && marked<0.5*total; numMarked++) {
+            int t = order[numMarked].second;
+            const int* idx = &mesh.elems[t*mesh.nodesPerElem];
+            glm::dvec2 e1 = mesh.pos[idx[1]] - mesh.pos[idx[0]];
+            glm::dvec2 e2 = mesh.pos[idx[2]] - mesh.pos[idx[0]];
+            maxAreas[t] = 0.125*fabs(e1.x*e2.y - e1.y*e2.x);
+            marked += indicator[t];
+        }
+        if (numMarked==0 || !refineMesh(maxAreas)) {
+            break;
+        }
+    }
+
+    // the solution belongs to the LOBPCG solver, not necessarily to m_solverType
+    InvalidateStage(e_stage_spectrum);
+    return (maxErr<=tol);
+}
+
+
+void SystemData::AddShapeTarget( int mode, double lambda ) {
+    if (mode>=0 && lambda>0.0) {
+        m_shapeTargets.push_back(std::make_pair(mode,lambda));
+    }
+}
+
+
+void SystemData::FixShapePoint( int point ) {
+    if (point>=0 && point<m_vertices.size() && !m_shapeFixed.contains(point)) {
+        m_shapeFixed.append(point);
+    }
+}
+
+
+void SystemData::ClearShapeTargets() {
+    m_shapeTargets.clear();
+    m_shapeFixed.clear();
+}
+
+
+bool SystemData::OptimizeShape( const char* triswitches, double tol, int maxSteps ) {
+    int numPoints = m_vertices.size();
+    int m = static_cast<int>(m_shapeTargets.size());
+    if (m==0 || numPoints<3) {
+        return false;
+    }
+    int maxMode = 0;
+    for(int k=0; k<m; k++) {
+        maxMode = std::max(maxMode,m_shapeTargets[k].first);
+    }
+    int numModes = m_numModes;
+    m_numModes = std::max(m_numModes,maxMode+2);
+
+    glm::dvec2 lo = m_vertices[0].pos, hi = lo;
+    for(int p=1; p<numPoints; p++) {
+        lo = glm::min(lo,m_vertices[p].pos);
+        hi = glm::max(hi,m_vertices[p].pos);
+    }
+    double size = glm::length(hi-lo);
+    double radius = OPT_TRUST_RADIUS*size;
+    double damping = 0.0;
+
+    // accepted design: points, residuals, and Jacobian (m x 2*numPoints)
+    std::vector<glm::dvec2> points(numPoints);
+    std::vector<double> r(m), Jac(static_cast<size_t>(m)*2*numPoints);
+    double bestF = std::numeric_limits<double>::max();
+    FEOptions opts;
+    bool reached = false;
+
+    for(int step=0; ; step++) {
+        bool solved = DoTriangulation(triswitches);
+        if (solved) {
+            UpdateBoundaryMarkers();
+            solveLobpcg();
+            solved = (N>maxMode && !m_warmStart.empty());
+        }
+        double F = std::numeric_limits<double>::max(), maxDev = F;
+        if (solved) {
+            F = maxDev = 0.0;
+            for(int k=0; k<m; k++) {
+                double dev = m_eigenvalues[m_shapeTargets[k].first]/m_shapeTargets[k].second - 1.0;
+                F += dev*dev;
+                maxDev = std::max(maxDev,fabs(dev));
+            }
+            fprintf(stderr,"Optimize step %d: largest relative eigenvalue deviation %g\n",step,maxDev);
+        }
+
+        if (solved && F<bestF) {
+            bestF = F;
+            for(int p=0; p<numPoints; p++) {
+                points[p] = m_vertices[p].pos;
+            }
+            if (maxDev<=tol) {
+                reached = true;
+                break;
+            }
+
+            // shape gradients of the target eigenvalues, pulled back to the input points
+            FEMesh mesh;
+            GetFEMesh(mesh);
+            getFEOptions(opts);
+            int n = m_dofs.NumDofs();
+            int numNodes = mesh.NumNodes();
+            std::vector<glm::dvec2> G(static_cast<size_t>(m)*numNodes), g;
+            for(int k=0; k<m; k++) {
+                int mode = m_shapeTargets[k].first;
+                FEAssembler::ShapeGradient(mesh,m_dofs,opts,&m_warmStart[static_cast<size_t>(mode)*n],m_eigenvalues[mode],g);
+                std::copy(g.begin(),g.end(),G.begin()+static_cast<size_t>(k)*numNodes);
+            }
+            std::vector<int> a, b;
+            std::vector<double> t;
+            nodeAttachment(mesh,a,b,t);
+            std::vector<bool> given(numNodes);
+            for(int i=0; i<numNodes; i++) {
+                given[i] = (a[i]>=0);
+            }
+            FEAssembler::HarmonicExtensionAdjoint(mesh,given,G,m);
+
+            std::fill(Jac.begin(),Jac.end(),0.0);
+            for(int k=0; k<m; k++) {
+                double target = m_shapeTargets[k].second;
+                r[k] = m_eigenvalues[m_shapeTargets[k].first]/target - 1.0;
+                double* row = &Jac[static_cast<size_t>(k)*2*numPoints];
+                const glm::dvec2* gk = &G[static_cast<size_t>(k)*numNodes];
+                for(int i=0; i<numNodes; i++) {
+                    if (given[i]) {
+                        row[2*a[i]+0] += (1.0-t[i])*gk[i].x/target;
+                        row[2*a[i]+1] += (1.0-t[i])*gk[i].y/target;
+                        row[2*b[i]+0] += t[i]*gk[i].x/target;
+                        row[2*b[i]+1] += t[i]*gk[i].y/target;
+                    }
+                }
+                for(int j=0; j<m_shapeFixed.size(); j++) {
+                    row[2*m_shapeFixed[j]+0] = row[2*m_shapeFixed[j]+1] = 0.0;
+                }
+            }
+            damping *= 0.3;
+        } else {
+            // back to the accepted design with a shorter, more damped step
+            for(int p=0; p<numPoints; p++) {
+                m_vertices[p].pos = points[p];
+            }
+            radius *= 0.5;
+            damping = std::max(10.0*damping,1e-6);
+            if (bestF==std::numeric_limits<double>::max() || radius<1e-6*size) {
+                break;
+            }
+        }
+        if (step>=maxSteps) {
+            break;
+        }
+
+        // Levenberg-Marquardt step  d = -J^T (J J^T + damping*I)^{-1} r
+        std::vector<double> A(static_cast<size_t>(m)*m), y(r);
+        double trace = 0.0;
+        for(int k=0; k<m; k++) {
+            for(int l=0; l<m; l++) {
+                A[l*m+k] = vecDot(2*numPoints,&Jac[static_cast<size_t>(k)*2*numPoints],&Jac[static_cast<size_t>(l)*2*numPoints]);
+            }
+            trace += A[k*m+k];
+        }
+        if (trace<=0.0) {
+            fprintf(stderr,"Optimize: the targets do not depend on the movable points.\n");
+            break;
+        }
+        for(int k=0; k<m; k++) {
+            A[k*m+k] += (damping + 1e-12)*trace/m;
+        }
+        if (!CholeskyDecomp(m,&A[0])) {
+            break;
+        }
+        for(int i=0; i<m; i++) {
+            for(int k=0; k<i; k++) {
+                y[i] -= A[k*m+i]*y[k];
+            }
+            y[i] /= A[i*m+i];
+        }
+        for(int i=m-1; i>=0; i--) {
+            for(int k=i+1; k<m; k++) {
+                y[i] -= A[i*m+k]*y[k];
+            }
+            y[i] /= A[i*m+i];
+        }
+
+        std::vector<glm::dvec2> d(numPoints,glm::dvec2(0.0));
+        double maxMove = 0.0;
+        for(int p=0; p<numPoints; p++) {
+            for(int k=0; k<m; k++) {
+                const double* row = &Jac[static_cast<size_t>(k)*2*numPoints];
+                d[p] -= y[k]*glm::dvec2(row[2*p+0],row[2*p+1]);
+            }
+            maxMove = std::max(maxMove,glm::length(d[p]));
+        }
+        double scale = (maxMove>radius ? radius/maxMove : 1.0);
+        for(int p=0; p<numPoints; p++) {
+            m_vertices[p].pos = points[p] + scale*d[p];
+        }
+        if (scale==1.0) {
+            radius = std::max(radius,2.0*maxMove);
+        } else {
+            radius *= 1.5;
+        }
+    }
+
+    m_numModes = numModes;
+    // the solution belongs to the LOBPCG solver, not necessarily to m_solverType
+    InvalidateStage(e_stage_spectrum);
+    return reached;
+}
+
+
+bool SystemData::IsMeshValid( const char* triswitches ) {
+    // an adapted mesh stems from the same inputs (see AdaptMesh)
+    return (meshKey(triswitches)==m_meshBaseKey && m_stageKey[e_stage_mesh]!=0 && !mesh_vertices.empty());
+}
+
+
+bool SystemData::GetPreviewInput( PreviewInput &input, double areaFactor ) {
+    if (m_vertices.size()<3) {
+        return false;
+    }
+    GetMeshGeometry(input.geom);
+    input.pointMarkers.resize(m_vertices.size());
+    for(int i=0; i<m_vertices.size(); i++) {
+        input.pointMarkers[i] = MarkerFromTag(i+2);
+    }
+    input.segmentMarkers.resize(m_segments.size());
+    for(int i=0; i<m_segments.size(); i++) {
+        input.segmentMarkers[i] = MarkerFromTag(-(i+2));
+    }
+
+    glm::dvec2 lo = m_vertices[0].pos, hi = m_vertices[0].pos;
+    for(int i=1; i<m_vertices.size(); i++) {
+        lo = glm::min(lo,m_vertices[i].pos);
+        hi = glm::max(hi,m_vertices[i].pos);
+    }
+    double area = std::max((hi.x-lo.x)*(hi.y-lo.y)/init_preview_triangles,m_maxArea);
+    if (areaFactor>0.0) {
+        area = m_maxArea*areaFactor;
+    }
+    if (area<=0.0) {
+        return false;
+    }
+
+    // no size field, and linear elements for a live preview, keep it cheap
+    QString sw = QString("zpQ");
+    if (m_useConvexHull) {
+        sw += QString("c");
+    }
+    sw += QString("a%1").arg(area,0,'f',12);
+    if (m_minAngle>0.0) {
+        sw += QString("q%1").arg(m_minAngle);
+    }
+    if (m_useDelaunay) {
+        sw += QString("D");
+    }
+    if (areaFactor>0.0 && m_useQuad) {
+        sw += QString("o2");
+    }
+    input.switches = sw.toStdString();
+
+    getFEOptions(input.opts);
+    input.numModes = (areaFactor>0.0 ? m_numModes : init_preview_modes);
+    return true;
+}
+
+
+void SystemData::ApplyPreview( const PreviewResult &res ) {
+    storeTriangulation(res.mesh);
+    for(int i=0; i<mesh_vertices.size(); i++) {
+        mesh_vertices[i].bmarker = res.feMesh.bmarker[i];
+    }
+    markFixedVertices();
+    InvalidateStage(e_stage_mesh);
+    m_meshBaseKey = 0;
+
+    m_dofs = res.dofs;
+    int num = static_cast<int>(res.lambda.size());
+    setSparseSolution(num,(num>0 ? &res.lambda[0] : NULL),(num>0 ? &res.X[0] : NULL));
+
+    // interpolated onto the final mesh, see solveLobpcg
+    m_warmStart = res.X;
+    m_warmKey   = 0;
+    m_warmMesh  = res.feMesh;
+    m_warmDofs  = res.dofs;
+}
+
+
+bool SystemData::GetCurrentMode( FEMesh &mesh, std::vector<double> &values ) {
+    if (evals==NULL || m_currEV<0 || m_currEV>=N || mesh_vertices.empty()) {
+        return false;
+    }
+    GetFEMesh(mesh);
+    const float* ev = evals + static_cast<size_t>(m_currEV)*numMeshVertices;
+    values.assign(ev,ev+numMeshVertices);
+    return true;
+}
+
+
+int SystemData::MatchMode( const FEMesh &mesh, const std::vector<double> &values ) {
+    if (evals==NULL || N==0 || mesh.NumElems()==0) {
+        return -1;
+    }
+
+    // interpolate at all nodes, fixed ones included
+    FEMesh curr;
+    GetFEMesh(curr);
+    DofMap oldNodes, newNodes;
+    oldNodes.nodeToDof.resize(mesh.NumNodes());
+    oldNodes.dofToNode.resize(mesh.NumNodes());
+    for(int i=0; i<mesh.NumNodes(); i++) {
+        oldNodes.nodeToDof[i] = oldNodes.dofToNode[i] = i;
+    }
+    newNodes.nodeToDof.resize(curr.NumNodes());
+    newNodes.dofToNode.resize(curr.NumNodes());
+    for(int i=0; i<curr.NumNodes(); i++) {
+        newNodes.nodeToDof[i] = newNodes.dofToNode[i] = i;
+    }
+    Interpolation P;
+    P.Build(mesh,oldNodes,curr,newNodes);
+    std::vector<double> x(curr.NumNodes());
+    P.Prolongate(&values[0],&x[0],curr.NumNodes());
+
+    double xx = 0.0;
+    for(int i=0; i<curr.NumNodes(); i++) {
+        xx += x[i]*x[i];
+    }
+    int best = -1;
+    double bestOverlap = 0.0;
+    for(int n=0; n<N; n++) {
+        const float* y = evals + static_cast<size_t>(n)*numMeshVertices;
+        double xy = 0.0, yy = 0.0;
+        for(int i=0; i<curr.NumNodes(); i++) {
+            xy += x[i]*y[i];
+            yy += static_cast<double>(y[i])*y[i];
+        }
+        double overlap = (xx>0.0 && yy>0.0 ? std::fabs(xy)/std::sqrt(xx*yy) : 0.0);
+        if (overlap>bestOverlap) {
+            bestOverlap = overlap;
+            best = n;
+        }
+    }
+    return best;
+}
+
+
+bool SystemData::BeginPerturbation( int point ) {
+    EndPerturbation();
+    if (point<0 || point>=m_vertices.size() || evals==NULL || N==0
+            || m_triMesh.NumNodes()!=mesh_vertices.size() || !updateSparseOperators()) {
+        return false;
+    }
+    int n = m_dofs.NumDofs();
+    int num = std::min(N,PERTURB_MAX_MODES);
+    std::vector<double> X(static_cast<size_t>(num)*n);
+    for(int k=0; k<num; k++) {
+        for(int j=0; j<n; j++) {
+            X[static_cast<size_t>(k)*n+j] = evals[static_cast<size_t>(k)*numMeshVertices+m_dofs.dofToNode[j]];
+        }
+    }
+
+    FEMesh mesh;
+    GetFEMesh(mesh);
+    FEOptions opts;
+    getFEOptions(opts);
+    m_perturbation.Setup(mesh,m_dofs,opts,num,m_eigenvalues,&X[0]);
+    m_perturbPoint  = point;
+    m_perturbOrigin = m_vertices[point].pos;
+    return true;
+}
+
+
+bool SystemData::PredictPerturbation() {
+    if (m_perturbPoint<0 || m_perturbPoint>=m_vertices.size() || m_perturbation.IsEmpty()) {
+        return false;
+    }
+    const FEMesh &mesh = m_perturbation.Mesh();
+    const DofMap &dofs = m_perturbation.Dofs();
+    glm::dvec2 delta = m_vertices[m_perturbPoint].pos - m_perturbOrigin;
+
+    // the node at the point; it is tagged unless its marker is zero (see GetMeshGeometry)
+    std::vector<glm::dvec2> V(mesh.NumNodes(),glm::dvec2(0.0));
+    int node = -1;
+    for(int i=0; i<mesh.NumNodes() && node<0; i++) {
+        if (m_triMesh.tags[i]==m_perturbPoint+2) {
+            node = i;
+        }
+    }
+    if (node<0) {
+        double dist = std::numeric_limits<double>::max();
+        for(int i=0; i<mesh.NumNodes(); i++) {
+            double d = glm::length(mesh.pos[i] - m_perturbOrigin);
+            if (d<dist) {
+                dist = d;
+                node = i;
+            }
+        }
+    }
+    if (node>=0) {
+        V[node] = delta;
+    }
+    for(int i=0; i<mesh.NumNodes(); i++) {
+        int tag = m_triMesh.tags[i];
+        if (tag>-2 || -tag-2>=m_segments.size()) {
+            continue;
+        }
+        const segment_t &seg = m_segments[-tag-2];
+        int other = (seg.p1-1==m_perturbPoint ? seg.p2-1 : (seg.p2-1==m_perturbPoint ? seg.p1-1 : -1));
+        if (other<0) {
+            continue;
+        }
+        glm::dvec2 e = m_perturbOrigin - m_vertices[other].pos;
+        double len2 = glm::dot(e,e);
+        if (len2>0.0) {
+            V[i] = glm::clamp(glm::dot(mesh.pos[i] - m_vertices[other].pos,e)/len2,0.0,1.0)*delta;
+        }
+    }
+
+    std::vector<double> lambda, X;
+    m_perturbation.Predict(V,m_perturbOrder>1,lambda,X);
+
+    for(int i=0; i<mesh_vertices.size(); i++) {
+        mesh_vertices[i].pos = mesh.pos[i] + V[i];
+        mMeshVerts[3*i+0] = static_cast<float>(mesh_vertices[i].pos.x);
+        mMeshVerts[3*i+1] = static_cast<float>(mesh_vertices[i].pos.y);
+    }
+    int n = dofs.NumDofs();
+    for(int k=0; k<static_cast<int>(lambda.size()); k++) {
+        m_eigenvalues[k] = lambda[k];
+        for(int j=0; j<n; j++) {
+            evals[static_cast<size_t>(k)*numMeshVertices+dofs.dofToNode[j]] = static_cast<float>(X[static_cast<size_t>(k)*n+j]);
+        }
+    }
+    InvalidateStage(e_stage_mesh);
+    m_meshBaseKey = 0;
+    return true;
+}
+
+
+void SystemData::EndPerturbation() {
+    m_perturbation.Clear();
+    m_perturbPoint = -1;
+}
+
+
+bool SystemData::SizeFieldGrid( int res, glm::dvec2 &lo, glm::dvec2 &hi, int &nx, int &ny ) {
+    if (m_vertices.size()<3 || res<1) {
+        return false;
+    }
+    lo = hi = m_vertices[0].pos;
+    for(int i=1; i<m_vertices.size(); i++) {
+        lo = glm::min(lo,m_vertices[i].pos);
+        hi = glm::max(hi,m_vertices[i].pos);
+    }
+    double len = std::max(hi.x-lo.x,hi.y-lo.y);
+    if (len<=0.0) {
+        return false;
+    }
+    nx = std::max(1,static_cast<int>(ceil(res*(hi.x-lo.x)/len)));
+    ny = std::max(1,static_cast<int>(ceil(res*(hi.y-lo.y)/len)));
+    return true;
+}
+
+
+bool SystemData::SetGradedSizeField( double minArea, double maxArea, double dist, int res ) {
+    glm::dvec2 lo, hi;
+    int nx, ny;
+    if (minArea<=0.0 || maxArea<minArea || dist<=0.0 || !SizeFieldGrid(res,lo,hi,nx,ny)) {
+        return false;
+    }
+
+    std::vector<double> values((nx+1)*(ny+1));
+    for(int iy=0; iy<=ny; iy++) {
+        for(int ix=0; ix<=nx; ix++) {
+            glm::dvec2 p(lo.x + (hi.x-lo.x)*ix/nx, lo.y + (hi.y-lo.y)*iy/ny);
+
+            // distance to the boundary segments and to the clamped points
+            double d = dist;
+            for(int i=0; i<m_segments.size(); i++) {
+                glm::dvec2 a = m_vertices[m_segments[i].p1-1].pos;
+                glm::dvec2 b = m_vertices[m_segments[i].p2-1].pos;
+                glm::dvec2 ab = b - a;
+                double l2 = glm::dot(ab,ab);
+                double s = (l2>0.0 ? glm::clamp(glm::dot(p-a,ab)/l2,0.0,1.0) : 0.0);
+                d = std::min(d,glm::length(p - (a + s*ab)));
+            }
+            for(int i=0; i<m_vertices.size(); i++) {
+                if (m_vertices[i].isFixed) {
+                    d = std::min(d,glm::length(p - m_vertices[i].pos));
+                }
+            }
+            values[iy*(nx+1) + ix] = minArea + (maxArea-minArea)*d/dist;
+        }
+    }
+    m_sizeField.SetGrid(lo,hi,nx,ny,values);
     return true;
 }
 
@@ -402,6 +1049,10 @@ bool SystemData::ReadNodeAndEleFile( QString nodeFileName, QString eleFileName)
 
     int numDim;  // must be 2
 
+    InvalidateStage(e_stage_mesh);
+    m_triMesh = TriMesh();
+    m_meshBaseKey = 0;
+
     if (!mesh_vertices.empty()) {
         mesh_vertices.clear();
     }
@@ -531,6 +1182,11 @@ bool SystemData::ReadNodeAndEleFile( QString nodeFileName, QString eleFileName)
           //  fprintf(stderr,"\n");
         }
     }
+
+    // markers are taken from the file as they are
+    m_meshGeneration++;
+    m_stageKey[e_stage_mesh] = fnv1a(fnvOffset,&m_meshGeneration,sizeof(quint64));
+    UpdateBoundaryMarkers();
     return true;
 }
 
@@ -574,7 +1230,7 @@ void SystemData::calc_params( const glm::dvec2 v1, const glm::dvec2 v2, const gl
 }
 
 
-void SystemData::initMatrices( int MSize ) {
+bool SystemData::initMatrices( int MSize, bool withMass ) {
     fprintf(stderr,"Initialize %d x %d matrices ... ",MSize,MSize);
 
 #ifdef HAVE_GSL
@@ -591,9 +1247,8 @@ void SystemData::initMatrices( int MSize ) {
         gsl_matrix_free(bS2);
         gsl_matrix_free(cS3);
         gsl_vector_free(s1);
-        gsl_matrix_free(Stot);
-        gsl_matrix_free(Mtot);
     }
+    freeMatrices();
 
     S1  = gsl_matrix_calloc(MSize,MSize);
     S2  = gsl_matrix_calloc(MSize,MSize);
@@ -642,8 +1297,11 @@ void SystemData::initMatrices( int MSize ) {
     gsl_vector_scale(s1,fac[4]);
 
     gsl_matrix_memcpy(Me,S4);
+
+    // a failed allocation shall not abort the program
+    gsl_set_error_handler_off();
     Stot = gsl_matrix_calloc(numMeshVertices,numMeshVertices);
-    Mtot = gsl_matrix_calloc(numMeshVertices,numMeshVertices);
+    Mtot = (withMass && Stot!=NULL ? gsl_matrix_calloc(numMeshVertices,numMeshVertices) : NULL);
 
     gsl_matrix_set(S5l,0,0,1.0/3.0); gsl_matrix_set(S5l,0,1,1.0/6.0);
     gsl_matrix_set(S5l,1,1,1.0/3.0); gsl_matrix_set(S5l,1,0,1.0/6.0);
@@ -663,9 +1321,8 @@ void SystemData::initMatrices( int MSize ) {
         free(S5l);
         free(S5q);
         free(s1);
-        free(Stot);
-        free(Mtot);
     }
+    freeMatrices();
 
     S1  = (double*)calloc(MSize*MSize,sizeof(double));
     S2  = (double*)calloc(MSize*MSize,sizeof(double));
@@ -674,8 +1331,8 @@ void SystemData::initMatrices( int MSize ) {
     S5l = (double*)calloc(2*2,sizeof(double));
     S5q = (double*)calloc(3*3,sizeof(double));
     s1  = (double*)calloc(MSize,sizeof(double));
-    Stot = (double*)calloc(numMeshVertices*numMeshVertices,sizeof(double));
-    Mtot = (double*)calloc(numMeshVertices*numMeshVertices,sizeof(double));
+    Stot = (double*)calloc(static_cast<size_t>(numMeshVertices)*numMeshVertices,sizeof(double));
+    Mtot = (withMass && Stot!=NULL ? (double*)calloc(static_cast<size_t>(numMeshVertices)*numMeshVertices,sizeof(double)) : NULL);
 
     const double *ms1, *ms2, *ms3, *ms4, *vs1, *fac;
     if (MSize==3) {
@@ -710,12 +1367,38 @@ void SystemData::initMatrices( int MSize ) {
     S5q[1] = S5q[3] = S5q[5] = S5q[7] = 1.0/15.0;
     S5q[0] = S5q[8] = 2.0/15.0; S5q[2] = S5q[6] = -1.0/30.0; S5q[4] = 8.0/15.0;
 #endif
+    if (Stot==NULL || (withMass && Mtot==NULL)) {
+        fprintf(stderr,"failed.\n");
+        freeMatrices();
+        return false;
+    }
     fprintf(stderr,"done.\n");
+    return true;
+}
+
+
+void SystemData::freeMatrices() {
+#ifdef HAVE_GSL
+    if (Stot!=NULL) {
+        gsl_matrix_free(Stot);
+    }
+    if (Mtot!=NULL) {
+        gsl_matrix_free(Mtot);
+    }
+#elif defined HAVE_LAPACK || defined HAVE_MAGMA
+    free(Stot);
+    free(Mtot);
+#endif
+    Stot = Mtot = NULL;
 }
 
 #ifdef HAVE_GSL
 gsl_matrix*  SystemData::deleteElement( gsl_matrix* src, int N, int row, int col ) {
     gsl_matrix* dst = gsl_matrix_alloc(N-1,N-1);
+    if (dst==NULL) {
+        gsl_matrix_free(src);
+        return NULL;
+    }
     double val;
     int ar,ac;
     for(int r=0; r<N-1; r++) {
@@ -732,7 +1415,11 @@ gsl_matrix*  SystemData::deleteElement( gsl_matrix* src, int N, int row, int col
 
 #elif defined HAVE_LAPACK || defined HAVE_MAGMA
 double* SystemData::deleteElement(double *src, int N, int row, int col ) {
-    double *dst = (double*)calloc((N-1)*(N-1),sizeof(double));
+    double *dst = (double*)calloc(static_cast<size_t>(N-1)*(N-1),sizeof(double));
+    if (dst==NULL) {
+        free(src);
+        return NULL;
+    }
     double val;
     int ar,ac;
     for(int r=0; r<N-1; r++) {
@@ -741,8 +1428,8 @@ double* SystemData::deleteElement(double *src, int N, int row, int col ) {
         for(int c=0; c<N-1; c++) {
             ac = c;
             if (ac>=col) ac = c+1;
-            val = src[ar*N+ac];    //gsl_matrix_get(src,ar,ac);
-            dst[r*(N-1)+c] = val;  //gsl_matrix_set(dst,r,c,val);
+            val = src[static_cast<size_t>(ar)*N+ac];    //gsl_matrix_get(src,ar,ac);
+            dst[static_cast<size_t>(r)*(N-1)+c] = val;  //gsl_matrix_set(dst,r,c,val);
         }
     }
     free(src);
@@ -789,6 +1476,20 @@ void SystemData::compileMatrices() {
 #ifdef HAVE_GSL
         gsl_matrix_memcpy(Me,S4);
         gsl_matrix_scale(Me,J);
+        if (Mtot!=NULL && m_massType!=e_mass_consistent) {
+            double Mel[36];
+            for(int j=0; j<numNodesPerTriangle; j++) {
+                for(int k=0; k<numNodesPerTriangle; k++) {
+                    Mel[j*numNodesPerTriangle+k] = gsl_matrix_get(Me,j,k);
+                }
+            }
+            FEAssembler::LumpElementMass(numNodesPerTriangle,m_massType,Mel);
+            for(int j=0; j<numNodesPerTriangle; j++) {
+                for(int k=0; k<numNodesPerTriangle; k++) {
+                    gsl_matrix_set(Me,j,k,Mel[j*numNodesPerTriangle+k]);
+                }
+            }
+        }
 
         gsl_matrix_memcpy(aS1,S1);
         gsl_matrix_scale(aS1,a);
@@ -806,17 +1507,27 @@ void SystemData::compileMatrices() {
         for(int j=0; j<numNodesPerTriangle; j++) {
             for(int k=0; k<numNodesPerTriangle; k++) {
                 gsl_matrix_set(Stot,idx[j],idx[k], gsl_matrix_get(Stot,idx[j],idx[k]) + gsl_matrix_get(Se,j,k));
-                gsl_matrix_set(Mtot,idx[j],idx[k], gsl_matrix_get(Mtot,idx[j],idx[k]) + gsl_matrix_get(Me,j,k));
+                if (Mtot!=NULL) {
+                    gsl_matrix_set(Mtot,idx[j],idx[k], gsl_matrix_get(Mtot,idx[j],idx[k]) + gsl_matrix_get(Me,j,k));
+                }
             }
         }
 #elif defined HAVE_LAPACK || defined HAVE_MAGMA
-        int pos;
+        size_t pos;
         int MSize = numNodesPerTriangle;
+        double Mel[36];
+        for(int j=0; j<MSize*MSize; j++) {
+            Mel[j] = J*S4[j];
+        }
+        FEAssembler::LumpElementMass(MSize,m_massType,Mel);
+
         for(int j=0; j<MSize; j++) {
             for(int k=0; k<MSize; k++) {
-                pos = idx[j]*numMeshVertices + idx[k];
+                pos = static_cast<size_t>(idx[j])*numMeshVertices + idx[k];
                 Stot[pos] += a*S1[j*MSize+k] + b*S2[j*MSize+k] + c*S3[j*MSize+k];
-                Mtot[pos] += J*S4[j*MSize+k];
+                if (Mtot!=NULL) {
+                    Mtot[pos] += Mel[j*MSize+k];
+                }
             }
         }
 
@@ -828,8 +1539,8 @@ void SystemData::compileMatrices() {
                     int mi[2] = {0,1};
                     for(int y=0; y<2; y++) {
                         for(int x=0; x<2; x++) {
-                            pos = idx[mi[y]]*numMeshVertices + idx[mi[x]];
-                            Stot[pos] += l12*S5l[y*2+x];
+                            pos = static_cast<size_t>(idx[mi[y]])*numMeshVertices + idx[mi[x]];
+                            Stot[pos] += m_elastStiffness*l12*S5l[y*2+x];
                         }
                     }
                     //pos = idx[0]*numMeshVertices + idx[0];  Stot[pos] += l12*S5l[0];
@@ -841,8 +1552,8 @@ void SystemData::compileMatrices() {
                     int mi[2] = {1,2};
                     for(int y=0; y<2; y++) {
                         for(int x=0; x<2; x++) {
-                            pos = idx[mi[y]]*numMeshVertices + idx[mi[x]];
-                            Stot[pos] += l23*S5l[y*2+x];
+                            pos = static_cast<size_t>(idx[mi[y]])*numMeshVertices + idx[mi[x]];
+                            Stot[pos] += m_elastStiffness*l23*S5l[y*2+x];
                         }
                     }
                 }
@@ -850,8 +1561,8 @@ void SystemData::compileMatrices() {
                     int mi[2] = {2,0};
                     for(int y=0; y<2; y++) {
                         for(int x=0; x<2; x++) {
-                            pos = idx[mi[y]]*numMeshVertices + idx[mi[x]];
-                            Stot[pos] += l31*S5l[y*2+x];
+                            pos = static_cast<size_t>(idx[mi[y]])*numMeshVertices + idx[mi[x]];
+                            Stot[pos] += m_elastStiffness*l31*S5l[y*2+x];
                         }
                     }
                 }
@@ -862,8 +1573,8 @@ void SystemData::compileMatrices() {
                     int mi[3] = {0,3,1};
                     for(int y=0; y<3; y++) {
                         for(int x=0; x<3; x++) {
-                            pos = idx[mi[y]]*numMeshVertices + idx[mi[x]];
-                            Stot[pos] += l12*S5q[y*3+x];
+                            pos = static_cast<size_t>(idx[mi[y]])*numMeshVertices + idx[mi[x]];
+                            Stot[pos] += m_elastStiffness*l12*S5q[y*3+x];
                         }
                     }
                 }
@@ -873,8 +1584,8 @@ void SystemData::compileMatrices() {
                     int mi[3] = {1,4,2};
                     for(int y=0; y<3; y++) {
                         for(int x=0; x<3; x++) {
-                            pos = idx[mi[y]]*numMeshVertices + idx[mi[x]];
-                            Stot[pos] += l23*S5q[y*3+x];
+                            pos = static_cast<size_t>(idx[mi[y]])*numMeshVertices + idx[mi[x]];
+                            Stot[pos] += m_elastStiffness*l23*S5q[y*3+x];
                         }
                     }
                 }
@@ -884,8 +1595,8 @@ void SystemData::compileMatrices() {
                     int mi[3] = {2,5,0};
                     for(int y=0; y<3; y++) {
                         for(int x=0; x<3; x++) {
-                            pos = idx[mi[y]]*numMeshVertices + idx[mi[x]];
-                            Stot[pos] += l31*S5q[y*3+x];
+                            pos = static_cast<size_t>(idx[mi[y]])*numMeshVertices + idx[mi[x]];
+                            Stot[pos] += m_elastStiffness*l31*S5q[y*3+x];
                         }
                     }
                 }
@@ -900,34 +1611,96 @@ void SystemData::compileMatrices() {
 // http://www.gnu.org/software/gsl/manual/html_node/Eigensystems.html
 //
 void SystemData::SolveSystem() {
-    initMatrices(numNodesPerTriangle);
-    compileMatrices();
+    InvalidateStage(e_stage_spectrum);
+    UpdateBoundaryMarkers();
 
-    N = mesh_vertices.size();
-    for(int i=mesh_vertices.size()-1; i>=0; i--) {
-        if (mesh_vertices[i].bmarker==BOUNDARY_FIXED_MARKER) {
-            //std::cerr << "del " << i << std::endl;
-            Stot = deleteElement(Stot,N,i,i);
-            Mtot = deleteElement(Mtot,N,i,i);
-            mMeshVerts[3*i+2] = -10.0f;  // fixed point
-            N -= 1;
-        }
+    // estimate memory before anything is allocated
+    if (!PlanSolve(m_plan)) {
+        failSolve(m_plan.message);
+        return;
     }
-    //exportSMmatrices(QString("sm_matrices.bin"));
-
-    fprintf(stderr,"Solve system...\n");
 
+    // release previous solution before the new matrices are allocated
+    StopTransient();
     if (m_eigenvalues!=NULL) {
         delete [] m_eigenvalues;
+        m_eigenvalues = NULL;
     }
     if (evals!=NULL) {
         delete [] evals;
+        evals = NULL;
     }
 
-    evals = new float[N*numMeshVertices];
-    for(int n=0; n<N; n++) {
-        for(int i=0; i<numMeshVertices; i++) {
-            evals[n*numMeshVertices+i] = 0.0f;
+    if (m_plan.solver==e_solver_slicing) {
+        solveSlicing();
+        SetStageValid(e_stage_spectrum);
+        return;
+    }
+    if (m_plan.solver==e_solver_lobpcg) {
+        solveLobpcg();
+        SetStageValid(e_stage_spectrum);
+        return;
+    }
+
+    // the mass matrix only depends on the mesh, the fixed points, and
+    // the mass type; stiffness-only changes reuse its factorization
+    quint64 massKey = massCacheKey();
+    bool massCached = (m_massKey!=0 && massKey==m_massKey);
+    if (!massCached) {
+        releaseMassCache();
+    }
+
+    if (!initMatrices(numNodesPerTriangle,!massCached)) {
+        failSolve(QString("Not enough memory for the dense matrices"));
+        return;
+    }
+    compileMatrices();
+
+    N = mesh_vertices.size();
+    for(int i=mesh_vertices.size()-1; i>=0; i--) {
+        if (mesh_vertices[i].bmarker==BOUNDARY_FIXED_MARKER) {
+            //std::cerr << "del " << i << std::endl;
+            Stot = deleteElement(Stot,N,i,i);
+            if (Mtot!=NULL && Stot!=NULL) {
+                Mtot = deleteElement(Mtot,N,i,i);
+            }
+            if (Stot==NULL || (!massCached && Mtot==NULL)) {
+                failSolve(QString("Not enough memory for the dense matrices"));
+                return;
+            }
+            N -= 1;
+        }
+    }
+    //exportSMmatrices(QString("sm_matrices.bin"));
+
+    if (massCached) {
+        fprintf(stderr,"Reuse mass matrix factorization.\n");
+    } else if (!prepareMass(massKey)) {
+        failSolve(QString("Mass matrix is not positive definite"));
+        return;
+    }
+
+    // transform to standard problem if the mass matrix is factorized
+    std::vector<double> scale;
+    bool standard = toStandard(scale);
+#if defined HAVE_GSL || defined HAVE_LAPACK
+    // only MAGMA has a generalized driver here
+    if (!standard) {
+        failSolve(QString("Transformation to a standard eigenproblem failed"));
+        return;
+    }
+#endif
+
+    fprintf(stderr,"Solve system...\n");
+
+    // in eigenvalue-only mode, neither the eigenvectors are computed
+    // nor the per-vertex data array for the viewer is allocated
+    if (!m_evOnly) {
+        evals = new float[static_cast<size_t>(N)*numMeshVertices];
+        for(int n=0; n<N; n++) {
+            for(int i=0; i<numMeshVertices; i++) {
+                evals[static_cast<size_t>(n)*numMeshVertices+i] = 0.0f;
+            }
         }
     }
     m_eigenvalues = new double[N];
@@ -940,14 +1713,39 @@ void SystemData::SolveSystem() {
 #ifdef HAVE_GSL
     gsl_set_error_handler_off();
 
-    gsl_eigen_gensymmv_workspace *w = gsl_eigen_gensymmv_alloc(N);
+    int status;
     gsl_vector*  eval = gsl_vector_alloc(N);
-    gsl_matrix*  evec = gsl_matrix_alloc(N,N);
-    int status = gsl_eigen_gensymmv(Stot,Mtot,eval,evec,w);
+    gsl_matrix*  evec = NULL;
+    if (m_evOnly) {
+        gsl_eigen_symm_workspace *w = gsl_eigen_symm_alloc(N);
+        status = gsl_eigen_symm(Stot,eval,w);
+        gsl_eigen_symm_free(w);
+    } else {
+        gsl_eigen_symmv_workspace *w = gsl_eigen_symmv_alloc(N);
+        evec = gsl_matrix_alloc(N,N);
+        status = gsl_eigen_symmv(Stot,eval,evec,w);
+        gsl_eigen_symmv_free(w);
+        if (status==0) {
+            fromStandard(evec);
+        }
+    }
 
     if (status>0) {
-        //fprintf(stderr,"Error: %d\n\t\%s\n",status,gsl_strerror(status));
-        QMessageBox::critical(NULL,tr("GSL error"),QString("Error code: ")+QString(gsl_strerror(status))+QString("\n\nPerhapse you should use convex hull or segments connecting the points."));
+        gsl_vector_free(eval);
+        if (evec!=NULL) {
+            gsl_matrix_free(evec);
+        }
+        QString msg = QString("GSL error: ")+QString(gsl_strerror(status));
+        failSolve(msg);
+        if (!m_headless) {
+            QMessageBox::critical(NULL,tr("GSL error"),QString("Error code: ")+QString(gsl_strerror(status))+QString("\n\nPerhapse you should use convex hull or segments connecting the points."));
+        }
+        return;
+    } else if (m_evOnly) {
+        gsl_sort_vector(eval);
+        for(int n=0; n<N; n++) {
+            m_eigenvalues[n] = gsl_vector_get( eval, n );
+        }
     } else {
         gsl_eigen_symmv_sort( eval, evec, GSL_EIGEN_SORT_ABS_ASC );
         // step over all eigenvalues
@@ -955,39 +1753,47 @@ void SystemData::SolveSystem() {
             double           eval_n = gsl_vector_get( eval, n );
             gsl_vector_view  evec_n = gsl_matrix_column(evec, n );
             m_eigenvalues[n] = eval_n;
-            fprintf(stderr,"%4d -> %10.5f\n",n,eval_n);
             for(int i=0,j=0; i<numMeshVertices && j<N; i++) {
                 if (mesh_vertices[i].bmarker!=BOUNDARY_FIXED_MARKER) {
-                    double val = gsl_vector_get(&evec_n.vector,j);
+                    double val = gsl_vector_get(&evec_n.vector,j)*scale[j];
                     if (val>max) max = val;
                     if (val<min) min = val;
-                    evals[n*numMeshVertices+i] = static_cast<float>(val);
+                    evals[static_cast<size_t>(n)*numMeshVertices+i] = static_cast<float>(val);
                     j++;
                 }
             }
         }
     }
-    gsl_eigen_gensymmv_free(w);
     gsl_vector_free(eval);
-    gsl_matrix_free(evec);
+    if (evec!=NULL) {
+        gsl_matrix_free(evec);
+    }
 
 #elif defined HAVE_LAPACK
 
-    lapack_int info,n,lda,ldb;
+    lapack_int info,n,lda;
     n   = static_cast<lapack_int>(N);
     lda = static_cast<lapack_int>(N);
-    ldb = static_cast<lapack_int>(N);
-    info = LAPACKE_dsygv(LAPACK_COL_MAJOR,1,'V','U',n,Stot,lda,Mtot,ldb,m_eigenvalues);
+    info = LAPACKE_dsyev(LAPACK_COL_MAJOR,(m_evOnly ? 'N' : 'V'),'U',n,Stot,lda,m_eigenvalues);
     //std::cerr << "INFO: ---------------" << info << std::endl;
+    if (info!=0) {
+        failSolve(QString("LAPACK error: dsyev returned %1").arg(info));
+        return;
+    }
+    if (!m_evOnly) {
+        fromStandard(Stot);
+    }
 
     for(int n=0; n<N; n++) {
-        fprintf(stderr,"%4d -> %10.5f\n",n,m_eigenvalues[n]);
+        if (m_evOnly) {
+            continue;
+        }
         for(int i=0,j=0; i<numMeshVertices && j<N; i++) {
             if (mesh_vertices[i].bmarker!=BOUNDARY_FIXED_MARKER) {
-                double val = Stot[n*N+j]; //gsl_vector_get(&evec_n.vector,j);
+                double val = Stot[static_cast<size_t>(n)*N+j]*scale[j]; //gsl_vector_get(&evec_n.vector,j);
                 if (val>max) max = val;
                 if (val<min) min = val;
-                evals[n*numMeshVertices+i] = static_cast<float>(val);
+                evals[static_cast<size_t>(n)*numMeshVertices+i] = static_cast<float>(val);
                 j++;
             }
         }
@@ -1006,20 +1812,36 @@ void SystemData::SolveSystem() {
     magma_int_t nb = magma_get_dsytrd_nb(n);
     magma_int_t lwork  = 1 + 6*n*nb + 2* n*n;
     magma_int_t liwork = 3 + 5*n;
+    if (m_evOnly) {
+        lwork  = 2*n + n*nb;
+        liwork = 1;
+    }
     h_work = (double*)calloc(lwork,sizeof(double));
     iwork = (magma_int_t*)calloc(liwork,sizeof(magma_int_t));
 
     //info = LAPACKE_dsygv(LAPACK_COL_MAJOR,1,'V','U',n,Stot,lda,Mtot,ldb,W);
-    magma_dsygvd(1, 'V','U', n, Stot, lda, Mtot, ldb, m_eigenvalues, h_work, lwork, iwork,liwork, &info);
+    if (standard) {
+        magma_dsyevd((m_evOnly ? 'N' : 'V'),'U', n, Stot, lda, m_eigenvalues, h_work, lwork, iwork,liwork, &info);
+    } else {
+        magma_dsygvd(1, (m_evOnly ? 'N' : 'V'),'U', n, Stot, lda, Mtot, ldb, m_eigenvalues, h_work, lwork, iwork,liwork, &info);
+    }
+    if (info!=0) {
+        free(iwork);
+        free(h_work);
+        failSolve(QString("MAGMA error: eigensolver returned %1").arg(info));
+        return;
+    }
 
     for(int n=0; n<N; n++) {
-        fprintf(stderr,"%4d -> %10.5f\n",n,m_eigenvalues[n]);
+        if (m_evOnly) {
+            continue;
+        }
         for(int i=0,j=0; i<numMeshVertices && j<N; i++) {
             if (mesh_vertices[i].bmarker!=BOUNDARY_FIXED_MARKER) {
-                double val = Stot[n*N+j]; //gsl_vector_get(&evec_n.vector,j);
+                double val = Stot[static_cast<size_t>(n)*N+j]*scale[j]; //gsl_vector_get(&evec_n.vector,j);
                 if (val>max) max = val;
                 if (val<min) min = val;
-                evals[n*numMeshVertices+i] = static_cast<float>(val);
+                evals[static_cast<size_t>(n)*numMeshVertices+i] = static_cast<float>(val);
                 j++;
             }
         }
@@ -1028,6 +1850,1481 @@ void SystemData::SolveSystem() {
     free(h_work);
 #endif
 
+    printEigenvalues();
+    showSolveStatus(min,max);
+    SetStageValid(e_stage_spectrum);
+}
+
+
+void SystemData::GetFEMesh( FEMesh &mesh ) {
+    mesh.nodesPerElem = numNodesPerTriangle;
+    mesh.pos.resize(mesh_vertices.size());
+    mesh.bmarker.resize(mesh_vertices.size());
+    for(int i=0; i<mesh_vertices.size(); i++) {
+        mesh.pos[i]     = mesh_vertices[i].pos;
+        mesh.bmarker[i] = mesh_vertices[i].bmarker;
+    }
+
+    mesh.elems.resize(mesh_triIndices.size()*numNodesPerTriangle);
+    for(int t=0; t<mesh_triIndices.size(); t++) {
+        int* idx = &mesh.elems[t*numNodesPerTriangle];
+        idx[0] = mesh_triIndices[t].v.x - m_idxOffset;
+        idx[1] = mesh_triIndices[t].v.y - m_idxOffset;
+        idx[2] = mesh_triIndices[t].v.z - m_idxOffset;
+        if (numNodesPerTriangle==6) {
+            idx[3] = mesh_triIndices[t].a.x - m_idxOffset;
+            idx[4] = mesh_triIndices[t].a.y - m_idxOffset;
+            idx[5] = mesh_triIndices[t].a.z - m_idxOffset;
+        }
+    }
+}
+
+
+void SystemData::ResetSolution() {
+    StopTransient();
+    if (m_eigenvalues!=NULL) {
+        delete [] m_eigenvalues;
+        m_eigenvalues = NULL;
+    }
+    if (evals!=NULL) {
+        delete [] evals;
+        evals = NULL;
+    }
+    N = 0;
+    m_currEV = 0;
+    markFixedVertices();
+    InvalidateStage(e_stage_spectrum);
+}
+
+
+quint64 SystemData::StageKey( e_stage stage ) {
+    if (stage==e_stage_mesh) {
+        return m_stageKey[e_stage_mesh];
+    }
+    quint64 h = StageKey(static_cast<e_stage>(stage-1));
+    if (h==0) {
+        return 0;
+    }
+    h = fnv1a(h,&stage,sizeof(e_stage));
+
+    switch (stage) {
+        case e_stage_dofs: {
+            for(int i=0; i<m_vertices.size(); i++) {
+                h = fnv1a(h,&m_vertices[i].bmarker,sizeof(int));
+                h = fnv1a(h,&m_vertices[i].isFixed,sizeof(bool));
+            }
+            break;
+        }
+        case e_stage_operators: {
+            h = fnv1a(h,&m_elastSupported,sizeof(bool));
+            h = fnv1a(h,&m_elastStiffness,sizeof(double));
+            h = fnv1a(h,&m_massType,sizeof(e_massType));
+            break;
+        }
+        case e_stage_spectrum: {
+            h = fnv1a(h,&m_solverType,sizeof(e_solverType));
+            h = fnv1a(h,&m_evOnly,sizeof(bool));
+            if (m_solverType==e_solver_auto) {
+                h = fnv1a(h,&m_memLimit,sizeof(int));
+            }
+            if (m_solverType==e_solver_slicing || m_solverType==e_solver_auto) {
+                h = fnv1a(h,&m_sliceEvMin,sizeof(double));
+                h = fnv1a(h,&m_sliceEvMax,sizeof(double));
+            }
+            if (m_solverType==e_solver_lobpcg) {
+                h = fnv1a(h,&m_numModes,sizeof(int));
+                h = fnv1a(h,&m_useMultigrid,sizeof(bool));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return (h!=0 ? h : 1);
+}
+
+
+bool SystemData::IsStageValid( e_stage stage ) {
+    return (m_stageKey[stage]!=0 && m_stageKey[stage]==StageKey(stage));
+}
+
+
+void SystemData::SetStageValid( e_stage stage ) {
+    m_stageKey[stage] = StageKey(stage);
+}
+
+
+void SystemData::InvalidateStage( e_stage stage ) {
+    for(int s=stage; s<e_stage_count; s++) {
+        m_stageKey[s] = 0;
+    }
+}
+
+
+void SystemData::UpdateBoundaryMarkers() {
+    if (IsStageValid(e_stage_dofs)) {
+        return;
+    }
+    InvalidateStage(e_stage_dofs);
+
+    // see DoTriangulation for the tags; empty if the mesh was read from file
+    for(int i=0; i<mesh_vertices.size() && i<m_triMesh.NumNodes(); i++) {
+        mesh_vertices[i].bmarker = MarkerFromTag(m_triMesh.tags[i]);
+    }
+    markFixedVertices();
+    SetStageValid(e_stage_dofs);
+}
+
+
+int SystemData::MarkerFromTag( int tag ) {
+    if (tag>=2 && tag-2<m_vertices.size()) {
+        return m_vertices[tag-2].bmarker;
+    } else if (tag<=-2 && -tag-2<m_segments.size()) {
+        const segment_t &seg = m_segments[-tag-2];
+        if (m_vertices[seg.p1-1].isFixed && m_vertices[seg.p2-1].isFixed) {
+            return BOUNDARY_FIXED_MARKER;
+        }
+        return 1;
+    }
+    return tag;
+}
+
+
+bool SystemData::PlanSolve( SolvePlan &plan ) {
+    if (mesh_vertices.empty() || mesh_triIndices.empty()) {
+        plan = SolvePlan();
+        plan.message = QString("No mesh available");
+        return false;
+    }
+
+    FEMesh mesh;
+    GetFEMesh(mesh);
+    SolvePlanInput in;
+    in.numNodes = mesh.NumNodes();
+
+    // sparsity pattern and envelope only, no values are assembled
+    DofMap dofs;
+    SparseMatrix pattern;
+    FEAssembler::BuildDofMap(mesh,dofs);
+    FEAssembler::BuildPattern(mesh,dofs,pattern);
+    std::vector<int> perm;
+    ReverseCuthillMcKee(pattern,perm);
+    size_t envelope = 0;
+    in.factorFlops = SkylineEnvelope(pattern,perm,envelope);
+    in.envelope = static_cast<double>(envelope);
+    in.numDofs  = dofs.NumDofs();
+    in.nnz      = pattern.NumNonZeros();
+
+    for(int t=0; t<mesh.NumElems(); t++) {
+        const int* idx = &mesh.elems[t*mesh.nodesPerElem];
+        glm::dvec2 e1 = mesh.pos[idx[1]] - mesh.pos[idx[0]];
+        glm::dvec2 e2 = mesh.pos[idx[2]] - mesh.pos[idx[0]];
+        in.area += 0.5*std::fabs(e1.x*e2.y - e1.y*e2.x);
+    }
+
+    in.evOnly     = m_evOnly;
+    in.massCached = (m_massKey!=0 && massCacheKey()==m_massKey);
+    in.evMin      = m_sliceEvMin;
+    in.evMax      = m_sliceEvMax;
+    in.numModes   = m_numModes;
+    in.numThreads = (m_numThreads>0 ? m_numThreads : QThread::idealThreadCount());
+
+    double limit = (m_memLimit>0 ? m_memLimit*1048576.0 : SolvePlanner::DefaultMemoryLimit());
+    SolvePlanner::Plan(in,m_solverType,limit,plan);
+    fprintf(stderr,"Plan: %d nodes, %d dofs, limit %.0f MB\n",in.numNodes,in.numDofs,limit/1048576.0);
+    fprintf(stderr,"  dense:   %.1f MB, %.2g s\n",plan.dense.memory/1048576.0,plan.dense.seconds);
+    fprintf(stderr,"  slicing: %.1f MB, %.2g s, ~%d modes\n",plan.slicing.memory/1048576.0,plan.slicing.seconds,plan.slicing.numModes);
+    fprintf(stderr,"  lobpcg:  %.1f MB, %.2g s, %d modes\n",plan.lobpcg.memory/1048576.0,plan.lobpcg.seconds,plan.lobpcg.numModes);
+    fprintf(stderr,"%s\n",plan.message.toStdString().c_str());
+    return plan.feasible;
+}
+
+
+int SystemData::CountModesBelow( double sigma ) {
+    return CountModesInBand(-std::numeric_limits<double>::max(),sigma);
+}
+
+
+int SystemData::CountModesInBand( double sigmaMin, double sigmaMax ) {
+    if (!updateSparseOperators()) {
+        fprintf(stderr,"Mode count: no mesh available.\n");
+        return -1;
+    }
+    const SparseMatrix &K = m_sparseK;
+    const SparseMatrix &M = m_sparseM;
+    if (sigmaMax<=sigmaMin) {
+        return 0;
+    }
+
+    // K is positive semidefinite, hence there are no eigenvalues below zero;
+    // the rigid modes of a free plate at zero are counted in [0,sigmaMax)
+    SkylineLDLT<double> ldlt;
+    ldlt.Analyze(K);
+    int numMin = 0;
+    int numMax = 0;
+    if ((sigmaMin>0.0 && !inertiaCount(ldlt,K,M,sigmaMin,numMin)) || !inertiaCount(ldlt,K,M,sigmaMax,numMax)) {
+        fprintf(stderr,"Mode count: K - sigma*M is singular near the bounds, the count is unreliable.\n");
+        return -1;
+    }
+
+    fprintf(stderr,"Mode count: %d eigenvalues in [%g,%g)\n",numMax-numMin,sigmaMin,sigmaMax);
+    return numMax - numMin;
+}
+
+
+bool SystemData::SaveEigenvalues( QString filename ) {
+    if (m_eigenvalues==NULL || N<=0) {
+        return false;
+    }
+    setlocale(LC_NUMERIC, "C");
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+       fprintf(stderr,"Cannot open file %s for output.\n",filename.toStdString().c_str());
+       return false;
+    }
+
+    QTextStream out(&file);
+    out << "# " << N << " eigenvalues, " << numMeshVertices << " mesh vertices\n";
+    for(int n=0; n<N; n++) {
+        out << QString("%1 %2\n").arg(n,6).arg(m_eigenvalues[n],0,'g',15);
+    }
+    file.close();
+    return true;
+}
+
+
+bool SystemData::TraceElasticSupport( double kappaMax, int numSteps, QString filename ) {
+    if (kappaMax<=0.0 || numSteps<1 || !updateSparseOperators()) {
+        return false;
+    }
+
+    // K(kappa) = K0 + kappa*B, on the dofs of the current operators
+    FEMesh mesh;
+    GetFEMesh(mesh);
+    FEOptions opts;
+    getFEOptions(opts);
+    SparseMatrix K0, B, M;
+    opts.elastSupported = false;
+    FEAssembler::Assemble(mesh,m_dofs,opts,K0,M);
+    opts.elastSupported = true;
+    opts.elastStiffness = 1.0;
+    FEAssembler::Assemble(mesh,m_dofs,opts,B,M);
+    for(size_t k=0; k<B.m_values.size(); k++) {
+        B.m_values[k] -= K0.m_values[k];
+    }
+
+    std::vector<double> kappa(1,0.0);
+    for(int i=0; i<numSteps; i++) {
+        double t = (numSteps>1 ? i/static_cast<double>(numSteps-1) : 1.0);
+        kappa.push_back(kappaMax*std::pow(10.0,-4.0*(1.0-t)));
+    }
+
+    fprintf(stderr,"Trace %d eigenvalues over the elastic support stiffness...\n",m_numModes);
+    EigenContinuation cont(K0,B,M);
+    cont.SetNumThreads(m_numThreads);
+    bool ok = cont.Trace(kappa,m_numModes);
+
+    setlocale(LC_NUMERIC, "C");
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+       fprintf(stderr,"Cannot open file %s for output.\n",filename.toStdString().c_str());
+       return false;
+    }
+    QTextStream out(&file);
+    int num = cont.NumModes();
+    out << "# kappa and " << num << " eigenvalue curves, " << cont.NumAmbiguous() << " ambiguous steps\n";
+    for(size_t s=0; s<cont.Parameters().size(); s++) {
+        out << QString("%1").arg(cont.Parameters()[s],0,'g',10);
+        for(int k=0; k<num; k++) {
+            out << QString(" %1").arg(cont.Eigenvalues()[s*num+k],0,'g',12);
+        }
+        out << "\n";
+    }
+    file.close();
+    return ok;
+}
+
+
+bool SystemData::prepareResponse() {
+    // ShowResponse replaces the solution, hence the key of its inputs decides
+    quint64 key = StageKey(e_stage_spectrum);
+    if (key==0) {
+        return false;
+    }
+    if (m_forced.IsEmpty() || key!=m_forcedKey) {
+        if (!IsStageValid(e_stage_spectrum) || evals==NULL || N<=0) {
+            fprintf(stderr,"The forced response needs a solution with eigenvectors.\n");
+            return false;
+        }
+        if (!updateSparseOperators()) {
+            return false;
+        }
+        FEMesh mesh;
+        GetFEMesh(mesh);
+        int n = m_dofs.NumDofs();
+        std::vector<double> X(static_cast<size_t>(N)*n);
+        for(int k=0; k<N; k++) {
+            for(int j=0; j<n; j++) {
+                X[static_cast<size_t>(k)*n+j] = evals[static_cast<size_t>(k)*numMeshVertices+m_dofs.dofToNode[j]];
+            }
+        }
+        m_forced.Setup(mesh,m_dofs,m_sparseM,N,m_eigenvalues,&X[0]);
+        m_forcedKey = key;
+    }
+
+    m_forced.SetDamping(m_damping);
+    m_forced.ClearDrive();
+    for(int i=0; i<m_respDrives.size(); i++) {
+        m_forced.AddPointDrive(m_respDrives[i].pos,m_respDrives[i].amplitude);
+    }
+    if (m_respPressure!=0.0) {
+        m_forced.AddPressureDrive(m_respPressure);
+    }
+    for(int i=0; i<m_respProbes.size(); i++) {
+        m_forced.AddProbe(m_respProbes[i]);
+    }
+    return true;
+}
+
+
+bool SystemData::strikeSynth( ModalSynth &synth, glm::dvec2 p, double amplitude ) {
+    if (!prepareResponse()) {
+        return false;
+    }
+    const std::vector<double> &lambda = m_forced.Eigenvalues();
+    synth.SetSampleRate(m_soundRate);
+    synth.SetBaseFrequency(m_soundFreq);
+    synth.SetDamping(m_damping);
+    synth.SetModes(static_cast<int>(lambda.size()),lambda.empty() ? NULL : &lambda[0]);
+
+    std::vector<double> a, r;
+    m_forced.ModeValues(p,a);
+    m_forced.ModeValues(m_soundPickupSet ? m_soundPickup : p,r);
+    for(size_t n=0; n<a.size(); n++) {
+        a[n] *= amplitude*r[n];
+    }
+    synth.Strike(a);
+    return true;
+}
+
+
+void SystemData::responseVectors( const FEMesh &mesh, const DofMap &dofs, const SparseMatrix &M,
+                                  std::vector<double> &f, std::vector<double> &L ) {
+    int n = dofs.NumDofs();
+    std::vector<int> idx;
+    std::vector<double> w;
+    f.assign(n,0.0);
+    for(int i=0; i<m_respDrives.size(); i++) {
+        ForcedResponse::PointWeights(mesh,dofs,m_respDrives[i].pos,idx,w);
+        for(size_t j=0; j<idx.size(); j++) {
+            f[idx[j]] += m_respDrives[i].amplitude*w[j];
+        }
+    }
+    if (m_respPressure!=0.0) {
+        std::vector<double> one(n,1.0), M1(n);
+        M.Multiply(&one[0],&M1[0]);
+        vecAxpy(n,m_respPressure,&M1[0],&f[0]);
+    }
+
+    L.assign(static_cast<size_t>(m_respProbes.size())*n,0.0);
+    for(int p=0; p<m_respProbes.size(); p++) {
+        ForcedResponse::PointWeights(mesh,dofs,m_respProbes[p],idx,w);
+        for(size_t j=0; j<idx.size(); j++) {
+            L[static_cast<size_t>(p)*n+idx[j]] = w[j];
+        }
+    }
+}
+
+
+void SystemData::showTransientFrame() {
+    const std::vector<double> &u = m_transient->Displacement();
+    for(int j=0; j<m_dofs.NumDofs(); j++) {
+        evals[m_dofs.dofToNode[j]] = static_cast<float>(u[j]);
+    }
+}
+
+
+void SystemData::nodeAttachment( const FEMesh &mesh, std::vector<int> &a, std::vector<int> &b, std::vector<double> &t ) {
+    // see GetMeshGeometry for the tags
+    int numNodes = mesh.NumNodes();
+    a.assign(numNodes,-1);
+    b.assign(numNodes,-1);
+    t.assign(numNodes,0.0);
+    for(int i=0; i<numNodes && i<m_triMesh.NumNodes(); i++) {
+        int tag = m_triMesh.tags[i];
+        if (tag>=2 && tag-2<m_vertices.size()) {
+            a[i] = b[i] = tag-2;
+        } else if (tag<=-2 && -tag-2<m_segments.size()) {
+            const segment_t &seg = m_segments[-tag-2];
+            a[i] = seg.p1-1;
+            b[i] = seg.p2-1;
+            glm::dvec2 e = m_vertices[b[i]].pos - m_vertices[a[i]].pos;
+            double len2 = glm::dot(e,e);
+            t[i] = (len2>0.0 ? glm::clamp(glm::dot(mesh.pos[i] - m_vertices[a[i]].pos,e)/len2,0.0,1.0) : 0.0);
+        }
+    }
+}
+
+
+int SystemData::AddReducedParameter( double lo, double hi ) {
+    reducedParam_t par;
+    par.lo = lo;
+    par.hi = hi;
+    m_reducedParams.append(par);
+    m_reduced.Clear();
+    return m_reducedParams.size()-1;
+}
+
+
+bool SystemData::AddReducedMotion( int param, int point, glm::dvec2 dir ) {
+    if (param<0 || param>=m_reducedParams.size() || point<0 || point>=m_vertices.size()) {
+        return false;
+    }
+    m_reducedParams[param].points.append(point);
+    m_reducedParams[param].motion.append(dir);
+    m_reduced.Clear();
+    return true;
+}
+
+
+void SystemData::ClearReducedModel() {
+    m_reducedParams.clear();
+    m_reduced.Clear();
+}
+
+
+bool SystemData::BuildReducedModel( int samples ) {
+    m_reduced.Clear();
+    if (m_reducedParams.isEmpty() || !updateSparseOperators() || m_triMesh.NumNodes()!=mesh_vertices.size()) {
+        return false;
+    }
+    FEMesh mesh;
+    GetFEMesh(mesh);
+    FEOptions opts;
+    getFEOptions(opts);
+    m_reduced.Setup(mesh,m_dofs,opts);
+    m_reduced.SetNumThreads(m_numThreads);
+
+    int numNodes = mesh.NumNodes();
+    std::vector<int> a, b;
+    std::vector<double> t;
+    nodeAttachment(mesh,a,b,t);
+    std::vector<bool> given(numNodes);
+    for(int i=0; i<numNodes; i++) {
+        given[i] = (a[i]>=0);
+    }
+    for(int k=0; k<m_reducedParams.size(); k++) {
+        const reducedParam_t &par = m_reducedParams[k];
+        std::vector<glm::dvec2> motion(m_vertices.size(),glm::dvec2(0.0));
+        for(int j=0; j<par.points.size(); j++) {
+            motion[par.points[j]] += par.motion[j];
+        }
+
+        std::vector<glm::dvec2> U(numNodes,glm::dvec2(0.0));
+        for(int i=0; i<numNodes; i++) {
+            if (given[i]) {
+                U[i] = (1.0-t[i])*motion[a[i]] + t[i]*motion[b[i]];
+            }
+        }
+        FEAssembler::HarmonicExtension(mesh,given,U);
+        m_reduced.AddParameter(U,par.lo,par.hi);
+    }
+
+    if (!m_reduced.Build(samples,m_numModes)) {
+        m_reduced.Clear();
+        return false;
+    }
+    return true;
+}
+
+
+bool SystemData::EvaluateReducedModel( const std::vector<double> &mu, std::vector<double> &lambda ) {
+    if (!m_reduced.IsBuilt() || static_cast<int>(mu.size())!=m_reduced.NumParameters()) {
+        return false;
+    }
+    return m_reduced.Evaluate((mu.empty() ? NULL : &mu[0]),lambda,NULL);
+}
+
+
+bool SystemData::ShowReducedModel( const std::vector<double> &mu ) {
+    if (!m_reduced.IsBuilt() || static_cast<int>(mu.size())!=m_reduced.NumParameters()
+            || m_reduced.Mesh().NumNodes()!=mesh_vertices.size()) {
+        return false;
+    }
+    const double* p = (mu.empty() ? NULL : &mu[0]);
+    std::vector<double> lambda, X;
+    if (!m_reduced.Evaluate(p,lambda,&X)) {
+        return false;
+    }
+    FEMesh moved;
+    m_reduced.MovedMesh(p,moved);
+    for(int i=0; i<mesh_vertices.size(); i++) {
+        mesh_vertices[i].pos = moved.pos[i];
+        mMeshVerts[3*i+0] = static_cast<float>(moved.pos[i].x);
+        mMeshVerts[3*i+1] = static_cast<float>(moved.pos[i].y);
+    }
+    InvalidateStage(e_stage_mesh);
+    m_meshBaseKey = 0;
+
+    m_dofs = m_reduced.Dofs();
+    int num = static_cast<int>(lambda.size());
+    setSparseSolution(num,&lambda[0],&X[0]);
+    return true;
+}
+
+
+void SystemData::AddResponseDrive( glm::dvec2 p, double a ) {
+    respDrive_t drive;
+    drive.pos = p;
+    drive.amplitude = a;
+    m_respDrives.append(drive);
+}
+
+
+void SystemData::SetResponsePressure( double a ) {
+    m_respPressure = a;
+}
+
+
+int SystemData::AddResponseProbe( glm::dvec2 p ) {
+    m_respProbes.append(p);
+    return m_respProbes.size()-1;
+}
+
+
+void SystemData::ClearResponse() {
+    m_respDrives.clear();
+    m_respProbes.clear();
+    m_respPressure = 0.0;
+    m_forced.Clear();
+    m_forcedKey = 0;
+}
+
+
+bool SystemData::SaveTransferFunctions( double omegaMin, double omegaMax, int num, QString filename ) {
+    if (num<1 || omegaMax<omegaMin || !prepareResponse()) {
+        return false;
+    }
+    std::vector<double> omega(num);
+    for(int f=0; f<num; f++) {
+        omega[f] = (num>1 ? omegaMin + (omegaMax-omegaMin)*f/(num-1) : omegaMin);
+    }
+    std::vector< std::complex<double> > H;
+    m_forced.Sweep(omega,H);
+
+    setlocale(LC_NUMERIC, "C");
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+       fprintf(stderr,"Cannot open file %s for output.\n",filename.toStdString().c_str());
+       return false;
+    }
+    QTextStream out(&file);
+    int numProbes = m_forced.NumProbes();
+    out << "# omega and " << numProbes << " transfer functions (Re Im), "
+        << m_forced.NumModes() << " modes, damping ratio " << m_damping << "\n";
+    for(int f=0; f<num; f++) {
+        out << QString("%1").arg(omega[f],0,'g',10);
+        for(int p=0; p<numProbes; p++) {
+            const std::complex<double> &h = H[static_cast<size_t>(f)*numProbes+p];
+            out << QString(" %1 %2").arg(h.real(),0,'g',12).arg(h.imag(),0,'g',12);
+        }
+        out << "\n";
+    }
+    file.close();
+    return true;
+}
+
+
+bool SystemData::ShowResponse( double omega ) {
+    if (!prepareResponse() || m_forced.Mesh().NumNodes()!=numMeshVertices) {
+        return false;
+    }
+    std::vector< std::complex<double> > U;
+    m_forced.Field(omega,U);
+
+    // phase of the largest real part: maximize |Re(e^{-i phi} U)|^2
+    double rr = 0.0, ii = 0.0, ri = 0.0;
+    for(size_t j=0; j<U.size(); j++) {
+        rr += U[j].real()*U[j].real();
+        ii += U[j].imag()*U[j].imag();
+        ri += U[j].real()*U[j].imag();
+    }
+    double phi = 0.5*atan2(2.0*ri,rr-ii);
+    std::complex<double> rot = std::polar(1.0,-phi);
+    std::vector<double> field(std::max(U.size(),static_cast<size_t>(1)),0.0);
+    for(size_t j=0; j<U.size(); j++) {
+        field[j] = (rot*U[j]).real();
+    }
+
+    m_dofs = m_forced.Dofs();
+    double w2 = omega*omega;
+    setSparseSolution(1,&w2,&field[0]);
+    InvalidateStage(e_stage_spectrum);
+    return true;
+}
+
+
+bool SystemData::SaveResponseField( double omega, QString filename ) {
+    if (!prepareResponse()) {
+        return false;
+    }
+    std::vector< std::complex<double> > U;
+    m_forced.Field(omega,U);
+
+    setlocale(LC_NUMERIC, "C");
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+       fprintf(stderr,"Cannot open file %s for output.\n",filename.toStdString().c_str());
+       return false;
+    }
+    QTextStream out(&file);
+    const FEMesh &mesh = m_forced.Mesh();
+    const DofMap &dofs = m_forced.Dofs();
+    out << "# x y Re Im of the response at omega " << omega << ", " << mesh.NumNodes() << " mesh vertices\n";
+    for(int i=0; i<mesh.NumNodes(); i++) {
+        int dof = dofs.nodeToDof[i];
+        std::complex<double> u = (dof>=0 ? U[dof] : std::complex<double>(0.0,0.0));
+        out << QString("%1 %2 %3 %4\n").arg(mesh.pos[i].x,0,'g',10).arg(mesh.pos[i].y,0,'g',10)
+               .arg(u.real(),0,'g',12).arg(u.imag(),0,'g',12);
+    }
+    file.close();
+    return true;
+}
+
+
+bool SystemData::SaveDirectSweep( double omegaMin, double omegaMax, int num, double tol, QString filename ) {
+    if (num<1 || omegaMax<omegaMin || !updateSparseOperators()) {
+        return false;
+    }
+    FEMesh mesh;
+    GetFEMesh(mesh);
+    std::vector<double> f, L;
+    responseVectors(mesh,m_dofs,m_sparseM,f,L);
+    int numProbes = m_respProbes.size();
+
+    std::vector<double> omega(num);
+    for(int w=0; w<num; w++) {
+        omega[w] = (num>1 ? omegaMin + (omegaMax-omegaMin)*w/(num-1) : omegaMin);
+    }
+    std::vector< std::complex<double> > H;
+    KrylovSweep sweep(m_sparseK,m_sparseM);
+    sweep.SetDamping(m_rayleighMass,m_rayleighStiff);
+    bool ok = sweep.Sweep(omega,f,L,numProbes,tol,H);
+    fprintf(stderr,"Direct sweep: %d expansion points, basis %d, estimated error %g\n",
+            static_cast<int>(sweep.ExpansionPoints().size()),sweep.BasisSize(),sweep.ErrorEstimate());
+
+    setlocale(LC_NUMERIC, "C");
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+       fprintf(stderr,"Cannot open file %s for output.\n",filename.toStdString().c_str());
+       return false;
+    }
+    QTextStream out(&file);
+    out << "# omega and " << numProbes << " transfer functions (Re Im), direct sweep with "
+        << sweep.ExpansionPoints().size() << " expansion points, estimated error " << sweep.ErrorEstimate() << "\n";
+    for(int w=0; w<num; w++) {
+        out << QString("%1").arg(omega[w],0,'g',10);
+        for(int p=0; p<numProbes; p++) {
+            const std::complex<double> &h = H[static_cast<size_t>(w)*numProbes+p];
+            out << QString(" %1 %2").arg(h.real(),0,'g',12).arg(h.imag(),0,'g',12);
+        }
+        out << "\n";
+    }
+    file.close();
+    return ok;
+}
+
+
+void SystemData::SetTransientSignal( TransientSolver::e_signal type, double p0, double p1 ) {
+    m_transientSignal = type;
+    m_transientParam[0] = p0;
+    m_transientParam[1] = p1;
+}
+
+
+bool SystemData::StartTransient() {
+    StopTransient();
+    if (!updateSparseOperators() || m_dofs.NumDofs()==0) {
+        return false;
+    }
+    FEMesh mesh;
+    GetFEMesh(mesh);
+    if (mesh.NumNodes()!=numMeshVertices) {
+        return false;
+    }
+    std::vector<double> f, L, diag;
+    responseVectors(mesh,m_dofs,m_sparseM,f,L);
+    FEAssembler::LumpedMass(mesh,m_dofs,diag);
+
+    TransientSolver* transient = new TransientSolver(m_sparseK,m_sparseM);
+    transient->SetDamping(m_rayleighMass,m_rayleighStiff);
+    transient->SetLumpedMass(diag);
+    transient->SetNumThreads(m_numThreads);
+    transient->SetLoad(f);
+    transient->SetSignal(m_transientSignal,m_transientParam[0],m_transientParam[1]);
+
+    TransientSolver::e_scheme scheme = (m_transientScheme==static_cast<int>(TransientSolver::e_scheme_central)
+                                        ? TransientSolver::e_scheme_central : TransientSolver::e_scheme_newmark);
+    double dt = m_transientStep;
+    if (dt<=0.0) {
+        // 20 steps per pulse or period of the drive
+        if (m_transientSignal==TransientSolver::e_signal_hammer && m_transientParam[0]>0.0) {
+            dt = m_transientParam[0]/20.0;
+        } else if (m_transientSignal==TransientSolver::e_signal_sine && m_transientParam[0]>0.0) {
+            dt = 2.0*M_PI/m_transientParam[0]/20.0;
+        }
+        // the friction of the bow is stiff, it needs the steps of the central differences
+        double dtStable = 0.9*transient->StableTimeStep();
+        if (dt<=0.0 || scheme==TransientSolver::e_scheme_central || m_transientSignal==TransientSolver::e_signal_bow) {
+            dt = (dt>0.0 ? std::min(dt,dtStable) : dtStable);
+        }
+    }
+    if (!transient->Start(scheme,dt)) {
+        delete transient;
+        return false;
+    }
+    fprintf(stderr,"Transient: %s, time step %g\n",
+            (scheme==TransientSolver::e_scheme_newmark ? "Newmark" : "central differences"),dt);
+
+    std::vector<double> u(m_dofs.NumDofs(),0.0);
+    double lambda = 0.0;
+    setSparseSolution(1,&lambda,&u[0]);
+    if (evals==NULL) {
+        evals = new float[numMeshVertices];
+        std::fill(evals,evals+numMeshVertices,0.0f);
+    }
+    m_currEV = 0;
+    InvalidateStage(e_stage_spectrum);
+
+    m_transient = transient;
+    m_transientKey = StageKey(e_stage_operators);
+    m_transientFrame = evals;
+    m_transientTarget = 0.0;
+    return true;
+}
+
+
+bool SystemData::AdvanceTransient( double duration, int maxMsec ) {
+    if (!IsTransientShown()) {
+        return false;
+    }
+    // m_transient refers to m_sparseK and m_sparseM
+    if (!IsStageValid(e_stage_operators) || StageKey(e_stage_operators)!=m_transientKey
+            || m_dofs.NumDofs()!=static_cast<int>(m_transient->Displacement().size())) {
+        StopTransient();
+        return false;
+    }
+
+    QTime time;
+    time.start();
+    double dt = m_transient->TimeStep();
+    m_transientTarget += std::max(0.0,duration);
+    while (m_transient->Time() + 0.5*dt < m_transientTarget) {
+        m_transient->Step();
+        if (maxMsec>0 && time.elapsed()>maxMsec) {
+            m_transientTarget = m_transient->Time();
+            break;
+        }
+    }
+    showTransientFrame();
+    return true;
+}
+
+
+void SystemData::StopTransient() {
+    if (m_transient!=NULL) {
+        delete m_transient;
+        m_transient = NULL;
+    }
+    m_transientKey = 0;
+    m_transientFrame = NULL;
+}
+
+
+bool SystemData::IsTransientShown() const {
+    return (m_transient!=NULL && evals!=NULL && evals==m_transientFrame && N==1);
+}
+
+
+double SystemData::TransientTime() const {
+    return (m_transient!=NULL ? m_transient->Time() : 0.0);
+}
+
+
+bool SystemData::SaveTransient( double duration, QString filename ) {
+    if (!StartTransient()) {
+        return false;
+    }
+    FEMesh mesh;
+    GetFEMesh(mesh);
+    int numProbes = m_respProbes.size();
+    std::vector< std::vector<int> > idx(numProbes);
+    std::vector< std::vector<double> > w(numProbes);
+    for(int p=0; p<numProbes; p++) {
+        ForcedResponse::PointWeights(mesh,m_dofs,m_respProbes[p],idx[p],w[p]);
+    }
+
+    setlocale(LC_NUMERIC, "C");
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+       fprintf(stderr,"Cannot open file %s for output.\n",filename.toStdString().c_str());
+       return false;
+    }
+    QTextStream out(&file);
+    out << "# t g and the displacement at " << numProbes << " probes, time step " << m_transient->TimeStep() << "\n";
+
+    double dt = m_transient->TimeStep();
+    while (m_transient->Time() + 0.5*dt < duration) {
+        m_transient->Step();
+        const std::vector<double> &u = m_transient->Displacement();
+        out << QString("%1 %2").arg(m_transient->Time(),0,'g',10).arg(m_transient->Signal(),0,'g',10);
+        for(int p=0; p<numProbes; p++) {
+            double val = 0.0;
+            for(size_t j=0; j<idx[p].size(); j++) {
+                val += w[p][j]*u[idx[p][j]];
+            }
+            out << QString(" %1").arg(val,0,'g',12);
+        }
+        out << "\n";
+    }
+    file.close();
+    m_transientTarget = m_transient->Time();
+    showTransientFrame();
+    return true;
+}
+
+
+bool SystemData::AddSuperMode( int mode, double amplitude, double phase ) {
+    if (mode<0 || m_superModes.size()>=MAX_SUPER_MODES) {
+        return false;
+    }
+    superMode_t sm;
+    sm.mode = mode;
+    sm.amplitude = amplitude;
+    sm.phase = phase;
+    m_superModes.append(sm);
+    return true;
+}
+
+
+void SystemData::ClearSuperModes() {
+    m_superModes.clear();
+}
+
+
+void SystemData::SetSoundPickup( glm::dvec2 p ) {
+    m_soundPickup = p;
+    m_soundPickupSet = true;
+}
+
+
+void SystemData::ClearSoundPickup() {
+    m_soundPickupSet = false;
+}
+
+
+bool SystemData::StrikeSound( glm::dvec2 p, double amplitude ) {
+#ifdef HAVE_AUDIO
+    if (m_audio==NULL || m_audio->format().sampleRate()!=m_soundRate) {
+        StopSound();
+        QAudioFormat format;
+        format.setSampleRate(m_soundRate);
+        format.setChannelCount(1);
+        format.setSampleSize(16);
+        format.setCodec("audio/pcm");
+        format.setByteOrder(QAudioFormat::LittleEndian);
+        format.setSampleType(QAudioFormat::SignedInt);
+        if (!QAudioDeviceInfo::defaultOutputDevice().isFormatSupported(format)) {
+            fprintf(stderr,"The audio output does not support 16 bit mono at %d Hz.\n",m_soundRate);
+            return false;
+        }
+        m_audio = new QAudioOutput(format,this);
+        m_audio->setBufferSize(2*m_soundRate*SOUND_BUFFER_MSEC/1000);
+        m_audioDevice = new ModalSynthDevice(&m_synth,this);
+        m_audioDevice->open(QIODevice::ReadOnly);
+    }
+
+    if (m_audio->state()!=QAudio::ActiveState) {
+        m_synth.Reset();
+    }
+    if (!strikeSynth(m_synth,p,amplitude)) {
+        return false;
+    }
+    if (m_synth.NumAudible()==0) {
+        fprintf(stderr,"No mode of the solution is audible.\n");
+        return false;
+    }
+    // the sum of the modal amplitudes bounds the output
+    m_audioDevice->SetGain(0.9/m_synth.Bound());
+    if (m_audio->state()!=QAudio::ActiveState) {
+        m_audio->start(m_audioDevice);
+    }
+    return (m_audio->error()==QAudio::NoError);
+#else
+    Q_UNUSED(p);
+    Q_UNUSED(amplitude);
+    fprintf(stderr,"NumChladni was built without audio output (USE_AUDIO), use SaveSound instead.\n");
+    return false;
+#endif
+}
+
+
+void SystemData::StopSound() {
+#ifdef HAVE_AUDIO
+    if (m_audio!=NULL) {
+        m_audio->stop();
+        delete m_audio;
+        m_audio = NULL;
+    }
+    if (m_audioDevice!=NULL) {
+        delete m_audioDevice;
+        m_audioDevice = NULL;
+    }
+#endif
+    m_synth.Reset();
+}
+
+
+bool SystemData::SaveSound( glm::dvec2 p, double duration, QString filename ) {
+    ModalSynth synth;
+    if (!strikeSynth(synth,p,1.0)) {
+        return false;
+    }
+    int numSamples = static_cast<int>(std::max(0.0,duration)*m_soundRate);
+    std::vector<float> samples(numSamples,0.0f);
+    if (numSamples>0) {
+        synth.Render(&samples[0],numSamples);
+    }
+    float peak = 0.0f;
+    for(int s=0; s<numSamples; s++) {
+        peak = std::max(peak,std::fabs(samples[s]));
+    }
+    double gain = (peak>0.0f ? 0.9*32767.0/peak : 0.0);
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+       fprintf(stderr,"Cannot open file %s for output.\n",filename.toStdString().c_str());
+       return false;
+    }
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    quint32 dataBytes = static_cast<quint32>(numSamples)*2;
+    out.writeRawData("RIFF",4);
+    out << static_cast<quint32>(36+dataBytes);
+    out.writeRawData("WAVEfmt ",8);
+    out << static_cast<quint32>(16) << static_cast<quint16>(1) << static_cast<quint16>(1);
+    out << static_cast<quint32>(m_soundRate) << static_cast<quint32>(2*m_soundRate);
+    out << static_cast<quint16>(2) << static_cast<quint16>(16);
+    out.writeRawData("data",4);
+    out << dataBytes;
+    for(int s=0; s<numSamples; s++) {
+        out << static_cast<qint16>(floor(gain*samples[s]+0.5));
+    }
+    file.close();
+    fprintf(stderr,"%d of %d modes audible.\n",synth.NumAudible(),m_forced.NumModes());
+    return true;
+}
+
+
+quint64 SystemData::massCacheKey() {
+    // the mass matrix does not depend on the elastic support,
+    // hence the dofs key is used instead of the operators key
+    quint64 h = StageKey(e_stage_dofs);
+    if (h==0) {
+        // e.g. a preview or predicted mesh, which has no key of its own
+        return 0;
+    }
+    int type = static_cast<int>(m_massType);
+    h = fnv1a(h,&type,sizeof(int));
+    return (h!=0 ? h : 1);
+}
+
+
+bool SystemData::prepareMass( quint64 key ) {
+    if (m_massType!=e_mass_consistent) {
+        m_massScale.resize(N);
+        for(int i=0; i<N; i++) {
+#ifdef HAVE_GSL
+            double d = gsl_matrix_get(Mtot,i,i);
+#elif defined HAVE_LAPACK || defined HAVE_MAGMA
+            double d = Mtot[static_cast<size_t>(i)*N+i];
+#endif
+            if (d<=0.0) {
+                m_massScale.clear();
+                return false;
+            }
+            m_massScale[i] = 1.0/sqrt(d);
+        }
+        m_massKey = key;
+        return true;
+    }
+
+#ifdef HAVE_GSL
+    gsl_set_error_handler_off();
+    if (gsl_linalg_cholesky_decomp(Mtot)!=0) {
+        return false;
+    }
+    m_massFactor = Mtot;
+    Mtot = NULL;
+    m_massKey = key;
+#elif defined HAVE_LAPACK
+    lapack_int n = static_cast<lapack_int>(N);
+    if (LAPACKE_dpotrf(LAPACK_COL_MAJOR,'U',n,Mtot,n)!=0) {
+        return false;
+    }
+    m_massFactor = Mtot;
+    Mtot = NULL;
+    m_massKey = key;
+#endif
+    // with MAGMA, the generalized driver factorizes Mtot itself
+    return true;
+}
+
+
+bool SystemData::toStandard( std::vector<double> &scale ) {
+    scale.assign(N,1.0);
+    if (m_massType!=e_mass_consistent) {
+        // lumped mass: D^{-1/2} K D^{-1/2}
+        scale = m_massScale;
+        for(int r=0; r<N; r++) {
+            for(int c=0; c<N; c++) {
+#ifdef HAVE_GSL
+                gsl_matrix_set(Stot,r,c,gsl_matrix_get(Stot,r,c)*scale[r]*scale[c]);
+#elif defined HAVE_LAPACK || defined HAVE_MAGMA
+                Stot[static_cast<size_t>(r)*N+c] *= scale[r]*scale[c];
+#endif
+            }
+        }
+        return true;
+    }
+
+    // consistent mass:  L^{-1} K L^{-T}  with  M = L L^T
+#ifdef HAVE_GSL
+    return (gsl_eigen_gensymm_standardize(Stot,m_massFactor)==0);
+#elif defined HAVE_LAPACK
+    lapack_int n = static_cast<lapack_int>(N);
+    return (LAPACKE_dsygst(LAPACK_COL_MAJOR,1,'U',n,Stot,n,m_massFactor,n)==0);
+#else
+    return false;
+#endif
+}
+
+
+#ifdef HAVE_GSL
+void SystemData::fromStandard( gsl_matrix* evec ) {
+    if (m_massType!=e_mass_consistent || m_massFactor==NULL) {
+        return;
+    }
+    gsl_blas_dtrsm(CblasLeft,CblasLower,CblasTrans,CblasNonUnit,1.0,m_massFactor,evec);
+
+    // unit length, as returned by gsl_eigen_gensymmv
+    for(int n=0; n<N; n++) {
+        gsl_vector_view evec_n = gsl_matrix_column(evec,n);
+        double nrm = gsl_blas_dnrm2(&evec_n.vector);
+        if (nrm>0.0) {
+            gsl_vector_scale(&evec_n.vector,1.0/nrm);
+        }
+    }
+}
+#elif defined HAVE_LAPACK || defined HAVE_MAGMA
+void SystemData::fromStandard( double* evec ) {
+    if (m_massType!=e_mass_consistent || m_massFactor==NULL) {
+        return;
+    }
+#ifdef HAVE_LAPACK
+    lapack_int n = static_cast<lapack_int>(N);
+    LAPACKE_dtrtrs(LAPACK_COL_MAJOR,'U','N','N',n,n,m_massFactor,n,evec,n);
+#endif
+}
+#endif
+
+
+void SystemData::releaseMassCache() {
+    if (m_massFactor!=NULL) {
+#ifdef HAVE_GSL
+        gsl_matrix_free(m_massFactor);
+#elif defined HAVE_LAPACK || defined HAVE_MAGMA
+        free(m_massFactor);
+#endif
+        m_massFactor = NULL;
+    }
+    m_massScale.clear();
+    m_massKey = 0;
+}
+
+
+void SystemData::markFixedVertices() {
+    if (mMeshVerts==NULL) {
+        return;
+    }
+    for(int i=0; i<mesh_vertices.size(); i++) {
+        if (mesh_vertices[i].bmarker==BOUNDARY_FIXED_MARKER) {
+            mMeshVerts[3*i+2] = -10.0f;  // fixed point
+        } else {
+            mMeshVerts[3*i+2] = static_cast<float>(i);
+        }
+    }
+}
+
+
+quint64 SystemData::meshKey( const char* triswitches ) {
+    quint64 h = fnv1a(fnvOffset,triswitches,strlen(triswitches));
+    for(int i=0; i<m_vertices.size(); i++) {
+        // input points with marker zero are tagged differently
+        int hasMarker = (m_vertices[i].bmarker!=0 ? 1 : 0);
+        h = fnv1a(h,&m_vertices[i].pos,sizeof(glm::dvec2));
+        h = fnv1a(h,&hasMarker,sizeof(int));
+    }
+    int parts = (m_meshParts>1 ? m_meshParts : 0);
+    h = fnv1a(h,&parts,sizeof(int));
+    int numSegs = m_segments.size();
+    h = fnv1a(h,&numSegs,sizeof(int));
+    for(int i=0; i<m_segments.size(); i++) {
+        h = fnv1a(h,&m_segments[i].p1,sizeof(int));
+        h = fnv1a(h,&m_segments[i].p2,sizeof(int));
+    }
+    for(int i=0; i<m_holes.size(); i++) {
+        h = fnv1a(h,&m_holes[i].pos,sizeof(glm::dvec2));
+    }
+    if (!m_sizeField.IsEmpty()) {
+        const std::vector<double> &values = m_sizeField.Values();
+        h = fnv1a(h,&m_sizeField.Lo(),sizeof(glm::dvec2));
+        h = fnv1a(h,&m_sizeField.Hi(),sizeof(glm::dvec2));
+        int n[2] = { m_sizeField.NumCellsX(), m_sizeField.NumCellsY() };
+        h = fnv1a(h,n,sizeof(n));
+        h = fnv1a(h,&values[0],values.size()*sizeof(double));
+    }
+    return (h!=0 ? h : 1);
+}
+
+
+void SystemData::getFEOptions( FEOptions &opts ) {
+    opts.elastSupported = m_elastSupported;
+    opts.elastStiffness = m_elastStiffness;
+    opts.massType = m_massType;
+}
+
+
+bool SystemData::updateSparseOperators() {
+    if (mesh_vertices.empty() || mesh_triIndices.empty()) {
+        return false;
+    }
+    if (IsStageValid(e_stage_operators)) {
+        return true;
+    }
+    FEMesh mesh;
+    GetFEMesh(mesh);
+    FEAssembler::BuildDofMap(mesh,m_dofs);
+
+    FEOptions opts;
+    getFEOptions(opts);
+    FEAssembler::Assemble(mesh,m_dofs,opts,m_sparseK,m_sparseM);
+    fprintf(stderr,"Sparse matrices: %d dofs, %d nonzeros\n",m_sparseK.Size(),m_sparseK.NumNonZeros());
+    SetStageValid(e_stage_operators);
+    return true;
+}
+
+
+bool SystemData::refineMesh( const std::vector<double> &maxAreas ) {
+    if (m_triMesh.tags.empty() || static_cast<int>(maxAreas.size())!=m_triMesh.NumElems()) {
+        return false;
+    }
+
+    // triangle refines the linear mesh; midside nodes are generated again
+    TriMesh linear, mesh;
+    Mesher::Corners(m_triMesh,linear);
+
+    QString sw = QString("zrpQa");
+    if (m_minAngle>0.0) {
+        sw += QString("q%1").arg(m_minAngle);
+    }
+    if (m_useDelaunay) {
+        sw += QString("D");
+    }
+    if (numNodesPerTriangle==6) {
+        sw += QString("o2");
+    }
+    if (!Mesher::Refine(sw.toStdString().c_str(),linear,maxAreas,&m_sizeField,mesh)) {
+        return false;
+    }
+
+    InvalidateStage(e_stage_mesh);
+    storeTriangulation(mesh);
+
+    // DoTriangulation keeps the adapted mesh while m_meshBaseKey is unchanged
+    m_meshGeneration++;
+    m_stageKey[e_stage_mesh] = fnv1a(m_meshBaseKey,&m_meshGeneration,sizeof(quint64));
+    UpdateBoundaryMarkers();
+    return true;
+}
+
+
+bool SystemData::buildMeshHierarchy( std::vector<FEMesh> &coarse ) {
+    coarse.clear();
+    // the tags are needed for the boundary markers of the coarse meshes
+    if (m_triMesh.tags.empty() || m_maxArea<=0.0 || m_vertices.size()<3) {
+        return false;
+    }
+
+    FEMesh fine;
+    GetFEMesh(fine);
+    double area = 0.0;
+    for(int t=0; t<fine.NumElems(); t++) {
+        const int* idx = &fine.elems[t*fine.nodesPerElem];
+        glm::dvec2 e1 = fine.pos[idx[1]] - fine.pos[idx[0]];
+        glm::dvec2 e2 = fine.pos[idx[2]] - fine.pos[idx[0]];
+        area += 0.5*std::fabs(e1.x*e2.y - e1.y*e2.x);
+    }
+
+    // a triangulation with maximum area a has roughly area/a vertices
+    int numRefine = 0;
+    while (numRefine<MG_MAX_LEVELS && area/(m_maxArea*std::pow(4.0,numRefine+1))>=MG_MIN_COARSE_NODES) {
+        numRefine++;
+    }
+    bool quadratic = (fine.nodesPerElem==6);
+    if (numRefine==0 && !quadratic) {
+        return false;
+    }
+
+    MeshGeometry geom;
+    if (numRefine>0) {
+        GetMeshGeometry(geom);
+    }
+
+    TriMesh prev, mesh;
+    for(int k=numRefine; k>=1; k--) {
+        double maxArea = m_maxArea*std::pow(4.0,k);
+        QString sw = (k==numRefine ? QString("zpQ") : QString("zrpQ"));
+        if (k==numRefine && m_useConvexHull) {
+            sw += QString("c");
+        }
+        // triangle does not parse exponents
+        sw += QString("a%1").arg(maxArea,0,'f',12);
+        if (m_minAngle>0.0) {
+            sw += QString("q%1").arg(m_minAngle);
+        }
+        if (m_useDelaunay) {
+            sw += QString("D");
+        }
+        // the previous mesh is refined; triangle keeps holes carved out
+        bool ok = (k==numRefine ? Mesher::Triangulate(sw.toStdString().c_str(),geom,NULL,mesh)
+                                : Mesher::Refine(sw.toStdString().c_str(),prev,std::vector<double>(),NULL,mesh));
+        if (!ok) {
+            coarse.clear();
+            return false;
+        }
+
+        FEMesh level;
+        level.nodesPerElem = 3;
+        level.pos = mesh.pos;
+        level.bmarker.resize(mesh.NumNodes());
+        for(int i=0; i<mesh.NumNodes(); i++) {
+            level.bmarker[i] = MarkerFromTag(mesh.tags[i]);
+        }
+        level.elems = mesh.elems;
+        coarse.push_back(level);
+        prev = mesh;
+    }
+
+    // the corners of a quadratic mesh form a nested linear mesh
+    if (quadratic) {
+        std::vector<int> newIdx(fine.NumNodes(),-1);
+        FEMesh mesh;
+        mesh.nodesPerElem = 3;
+        for(int t=0; t<fine.NumElems(); t++) {
+            for(int j=0; j<3; j++) {
+                int v = fine.elems[t*6+j];
+                if (newIdx[v]<0) {
+                    newIdx[v] = mesh.NumNodes();
+                    mesh.pos.push_back(fine.pos[v]);
+                    mesh.bmarker.push_back(fine.bmarker[v]);
+                }
+                mesh.elems.push_back(newIdx[v]);
+            }
+        }
+        coarse.push_back(mesh);
+    }
+    return true;
+}
+
+
+bool SystemData::updateMultigrid() {
+    quint64 key = StageKey(e_stage_operators);
+    if (m_multigrid!=NULL && key!=0 && key==m_multigridKey) {
+        return true;
+    }
+    if (m_multigrid!=NULL) {
+        delete m_multigrid;
+        m_multigrid = NULL;
+    }
+    m_multigridKey = 0;
+
+    std::vector<FEMesh> coarse;
+    if (!buildMeshHierarchy(coarse)) {
+        return false;
+    }
+    FEMesh fine;
+    GetFEMesh(fine);
+    FEOptions opts;
+    getFEOptions(opts);
+
+    m_multigrid = new MultigridPreconditioner();
+    double sigma = LOBPCGSolver::DefaultShift(m_sparseK,m_sparseM);
+    if (!m_multigrid->Setup(coarse,fine,m_dofs,m_sparseK,m_sparseM,opts,sigma)) {
+        delete m_multigrid;
+        m_multigrid = NULL;
+        return false;
+    }
+    m_multigridKey = key;
+    return true;
+}
+
+
+void SystemData::solveSlicing() {
+    updateSparseOperators();
+
+    fprintf(stderr,"Solve system by spectrum slicing...\n");
+    SpectrumSlicer slicer(m_sparseK,m_sparseM);
+    slicer.SetNumThreads(m_numThreads);
+    if (!slicer.Solve(m_sliceEvMin,m_sliceEvMax)) {
+        fprintf(stderr,"Warning: not all eigenpairs within [%g,%g) were found.\n",m_sliceEvMin,m_sliceEvMax);
+    }
+    setSparseSolution(slicer.NumModes(),(slicer.NumModes()>0 ? &slicer.Eigenvalues()[0] : NULL),slicer.Eigenvector(0));
+}
+
+
+int SystemData::interpolateWarmStart( std::vector<double> &X ) {
+    int numOld = m_warmDofs.NumDofs();
+    int numNew = m_dofs.NumDofs();
+    if (numOld==0 || numNew==0 || m_warmMesh.NumElems()==0) {
+        return 0;
+    }
+    int num = static_cast<int>(m_warmStart.size()/numOld);
+
+    FEMesh mesh;
+    GetFEMesh(mesh);
+    Interpolation P;
+    P.Build(m_warmMesh,m_warmDofs,mesh,m_dofs);
+
+    X.resize(static_cast<size_t>(numNew)*num);
+    for(int k=0; k<num; k++) {
+        P.Prolongate(&m_warmStart[static_cast<size_t>(k)*numOld],&X[static_cast<size_t>(k)*numNew],numNew);
+    }
+    return num;
+}
+
+
+void SystemData::solveLobpcg() {
+    updateSparseOperators();
+    quint64 dofsKey = StageKey(e_stage_dofs);
+
+    fprintf(stderr,"Solve system by LOBPCG...\n");
+    LOBPCGSolver solver(m_sparseK,m_sparseM);
+    solver.SetNumThreads(m_numThreads);
+    std::vector<double> X0;
+    if (m_warmKey==dofsKey && !m_warmStart.empty()) {
+        int num = static_cast<int>(m_warmStart.size()/std::max(m_dofs.NumDofs(),1));
+        fprintf(stderr,"Warm start from %d eigenvectors.\n",num);
+        solver.SetInitialVectors(&m_warmStart[0],num);
+    } else if (!m_warmStart.empty()) {
+        int num = interpolateWarmStart(X0);
+        if (num>0) {
+            fprintf(stderr,"Warm start from %d eigenvectors of the previous mesh.\n",num);
+            solver.SetInitialVectors(&X0[0],num);
+        }
+    }
+    if (m_useMultigrid) {
+        if (updateMultigrid()) {
+            solver.SetPreconditioner(m_multigrid);
+        } else {
+            fprintf(stderr,"Multigrid not applicable, using sparse factorization.\n");
+        }
+    }
+    if (!solver.Solve(m_numModes)) {
+        fprintf(stderr,"Warning: only %d of %d eigenpairs converged.\n",solver.NumConverged(),m_numModes);
+    }
+
+    m_warmStart = solver.Eigenvectors();
+    m_warmKey = dofsKey;
+    GetFEMesh(m_warmMesh);
+    m_warmDofs = m_dofs;
+
+    int num = solver.NumFound();
+    setSparseSolution(num,(num>0 ? &solver.Eigenvalues()[0] : NULL),(num>0 ? &solver.Eigenvectors()[0] : NULL));
+}
+
+
+void SystemData::setSparseSolution( int num, const double* lambda, const double* X ) {
+    const DofMap &dofs = m_dofs;
+    StopTransient();
+    if (m_eigenvalues!=NULL) {
+        delete [] m_eigenvalues;
+    }
+    if (evals!=NULL) {
+        delete [] evals;
+        evals = NULL;
+    }
+
+    N = num;
+    m_eigenvalues = new double[std::max(N,1)];
+    m_eigenvalues[0] = 0.0;
+
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::min();
+
+    if (!m_evOnly && N>0) {
+        evals = new float[static_cast<size_t>(N)*numMeshVertices];
+        for(size_t i=0; i<static_cast<size_t>(N)*numMeshVertices; i++) {
+            evals[i] = 0.0f;
+        }
+    }
+    for(int n=0; n<N; n++) {
+        m_eigenvalues[n] = lambda[n];
+        if (evals==NULL) {
+            continue;
+        }
+        const double* x = X + static_cast<size_t>(n)*dofs.NumDofs();
+        for(int j=0; j<dofs.NumDofs(); j++) {
+            double val = x[j];
+            if (val>max) max = val;
+            if (val<min) min = val;
+            evals[static_cast<size_t>(n)*numMeshVertices+dofs.dofToNode[j]] = static_cast<float>(val);
+        }
+    }
+    printEigenvalues();
+    showSolveStatus(min,max);
+}
+
+
+void SystemData::failSolve( QString msg ) {
+    fprintf(stderr,"%s\n",msg.toStdString().c_str());
+    freeMatrices();
+    ResetSolution();
+    led_status->setText(msg);
+}
+
+
+void SystemData::printEigenvalues() {
+    if (!m_printEV || m_eigenvalues==NULL) {
+        return;
+    }
+    for(int n=0; n<N; n++) {
+        fprintf(stderr,"%4d -> %10.5f\n",n,m_eigenvalues[n]);
+    }
+}
+
+
+void SystemData::showSolveStatus( double min, double max ) {
+    if (m_evOnly) {
+        if (N>0) {
+            min = m_eigenvalues[0];
+            max = m_eigenvalues[N-1];
+        }
+        fprintf(stderr,"Eigenvalues only:  Min: %10.4f  Max: %10.4f\n",min,max);
+        led_status->setText(QString("EV min: %1   max: %2").arg(min,8,'f',4).arg(max,8,'f',4));
+        return;
+    }
     fprintf(stderr,"Min: %8.4f  Max: %8.4f\n",min,max);
     led_status->setText(QString("Min: %1   Max: %2").arg(min,8,'f',4).arg(max,8,'f',4));
 }
@@ -1053,7 +3350,7 @@ bool SystemData::exportSMmatrices( QString filename ) {
 #ifdef HAVE_GSL
             double val = gsl_matrix_get(Stot,row,col);
 #elif defined HAVE_LAPACK || defined HAVE_MAGMA
-            double val = Stot[row*N+col];
+            double val = Stot[static_cast<size_t>(row)*N+col];
 #endif
             fwrite(&val,sizeof(double),1,fptr);
         }
@@ -1063,7 +3360,7 @@ bool SystemData::exportSMmatrices( QString filename ) {
 #ifdef HAVE_GSL
             double val = gsl_matrix_get(Mtot,row,col);
 #elif defined HAVE_LAPACK || defined HAVE_MAGMA
-            double val = Mtot[row*N+col];
+            double val = Mtot[static_cast<size_t>(row)*N+col];
 #endif
             fwrite(&val,sizeof(double),1,fptr);
         }
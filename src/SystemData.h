@@ -44,6 +44,21 @@
 
 #include "qtdefs.h"
 #include "Camera.h"
+#include "FEAssembler.h"
+#include "SolvePlanner.h"
+#include "Multigrid.h"
+#include "SizeField.h"
+#include "Mesher.h"
+#include "LivePreview.h"
+#include "ShapePerturbation.h"
+#include "ReducedModel.h"
+#include "ForcedResponse.h"
+#include "TransientSolver.h"
+#include "ModalSynth.h"
+
+#ifdef HAVE_AUDIO
+class QAudioOutput;
+#endif
 
 #ifdef HAVE_GSL                  // HAVE_GSL
 #include <gsl/gsl_math.h>
@@ -52,6 +67,7 @@
 #include <gsl/gsl_matrix.h>
 #include <gsl/gsl_vector.h>
 #include <gsl/gsl_blas.h>
+#include <gsl/gsl_sort_vector.h>
 
 #elif defined HAVE_LAPACK        // HAVE_LAPACK
 #include <lapacke.h>
@@ -86,14 +102,369 @@ public:
     void AdjustBorder(glm::dvec2 mmX, glm::dvec2 mmY, glm::dvec2 center );
 
     /** Call triangle library to calculate triangular mesh
+     *   The mesh is kept if neither the input geometry nor the switches
+     *   changed since the last call. If m_sizeField is set, triangle
+     *   also refines every triangle larger than the field (switch 'u').
+     *   With m_meshParts>1 and a maximum area, the parts of a domain
+     *   decomposition are meshed concurrently (Mesher::TriangulateParts).
+     *   Boundary markers are updated in any case (see UpdateBoundaryMarkers).
      * \param triswitches  switch parameters for triangle library
      */
     bool DoTriangulation( const char *triswitches );
 
+    /** Copy of the input geometry for the Mesher, tagged as described in DoTriangulation.
+     *   Meshes of the copy can be generated in other threads.
+     */
+    void GetMeshGeometry( MeshGeometry &geom );
+
+    /** Mesh is up to date for the switches (see DoTriangulation).
+     */
+    bool IsMeshValid( const char* triswitches );
+
+    /** Input of a live preview: the current geometry, meshed much coarser
+     *   than m_maxArea, and the boundary markers the tags map to (see MarkerFromTag).
+     * \param input
+     * \param areaFactor  zero: about init_preview_triangles linear triangles and
+     *                    init_preview_modes modes; otherwise a stage of a progressive
+     *                    solve with m_maxArea*areaFactor, the configured elements,
+     *                    and m_numModes modes
+     * \return  false if there is no geometry
+     */
+    bool GetPreviewInput( PreviewInput &input, double areaFactor = 0.0 );
+
+    /** Show a live preview as current mesh and solution
+     *   The mesh stage is invalidated, so the next DoTriangulation meshes
+     *   the geometry again. The preview modes are kept as start vectors
+     *   of the next LOBPCG solve.
+     * \param res
+     */
+    void ApplyPreview( const PreviewResult &res );
+
+    /** Mesh and nodal values of the current mode m_currEV
+     * \return  false if there is no mode
+     */
+    bool GetCurrentMode( FEMesh &mesh, std::vector<double> &values );
+
+    /** Find a mode of another mesh among the current solution
+     *   The mode is interpolated onto the current mesh; the mode with the
+     *   largest normalized overlap is taken.
+     * \param mesh    mesh of the mode, see GetCurrentMode
+     * \param values  nodal values of the mode
+     * \return  index of the matching mode, -1 if there is none
+     */
+    int  MatchMode( const FEMesh &mesh, const std::vector<double> &values );
+
+    /** Prepare eigenvalue predictions for moving an input point (see ShapePerturbation)
+     *   The current mesh and the lowest PERTURB_MAX_MODES modes are taken
+     *   as unperturbed state.
+     * \param point  index of the input point
+     * \return  false if there is no solution with eigenvectors or no mesh of triangle
+     */
+    bool BeginPerturbation( int point );
+
+    /** Predict mesh and modes for the current position of the point
+     *   The mesh nodes at the point move with it, the nodes on its
+     *   segments proportionally to their distance from the other end.
+     *   The prediction replaces mesh and solution; the mesh stage is
+     *   invalidated.
+     * \return  false if BeginPerturbation was not successful
+     */
+    bool PredictPerturbation();
+
+    void EndPerturbation();
+
+    /** Regular grid over the bounding box of the input points for m_sizeField
+     * \param res  number of cells along the longer side
+     * \param lo   lower left corner
+     * \param hi   upper right corner
+     * \param nx   number of cells in x
+     * \param ny   number of cells in y
+     * \return  false if there is no geometry
+     */
+    bool SizeFieldGrid( int res, glm::dvec2 &lo, glm::dvec2 &hi, int &nx, int &ny );
+
+    /** Size field graded toward the boundary segments and the fixed points
+     *   The maximum area grows linearly from minArea at the boundary to
+     *   maxArea at distance dist and beyond.
+     * \param res  number of grid cells along the longer side
+     * \return  false if the parameters or the geometry are invalid
+     */
+    bool SetGradedSizeField( double minArea, double maxArea, double dist, int res );
+
+    /** Adaptive refinement for the m_numModes lowest modes
+     *   Repeat: solve by LOBPCG, estimate the error of every mode by
+     *   residual-based indicators (FEAssembler::EstimateError), and let
+     *   triangle refine the triangles with large indicators by per-triangle
+     *   area constraints, until the error indicator of all modes is below
+     *   tol. The indicator of a mode is the sum of its element indicators
+     *   divided by its eigenvalue; it follows the relative eigenvalue error
+     *   only up to an unknown constant, so tol has no absolute meaning.
+     *   The spectrum has to be solved afterwards.
+     * \param tol       tolerance of the error indicator
+     * \param maxSteps  maximum number of refinement steps
+     * \return  true if the tolerance was reached
+     */
+    bool AdaptMesh( double tol, int maxSteps );
+
+    /** Add a target of the shape optimization.
+     * \param mode    index of the eigenvalue in ascending order
+     * \param lambda  target eigenvalue
+     */
+    void AddShapeTarget( int mode, double lambda );
+
+    /** Keep input point 'point' in place during the shape optimization.
+     */
+    void FixShapePoint( int point );
+
+    /** Remove all targets and fixed points.
+     */
+    void ClearShapeTargets();
+
+    /** Move the input points until the eigenvalues hit their targets.
+     *   Repeat: triangulate, solve by LOBPCG, and take a Levenberg-Marquardt
+     *   step for the relative deviations  lambda_k/target_k - 1  within a
+     *   trust radius. The shape gradients of the eigenvalues are computed
+     *   from the eigenpairs (FEAssembler::ShapeGradient) and pulled back to
+     *   the input points by one adjoint solve of the harmonic mesh motion.
+     *   Degenerate eigenvalues have no gradient and should not be targets.
+     *   The spectrum has to be solved afterwards.
+     * \param triswitches  switches of triangle for the meshes
+     * \param tol          tolerance of the largest relative deviation
+     * \param maxSteps     maximum number of steps
+     * \return  true if the tolerance was reached
+     */
+    bool OptimizeShape( const char* triswitches, double tol, int maxSteps );
+
     /** Call either GSL, Lapack, or Magma routine to solve eigenvalue problem
+     *   If m_evOnly is set, only the eigenvalues are computed and no
+     *   eigenvectors are stored (evals stays NULL).
+     *   With the slicing solver, only the eigenvalues within
+     *   [m_sliceEvMin,m_sliceEvMax) are computed, with the LOBPCG
+     *   solver only the m_numModes lowest ones. The solver path is
+     *   planned first (PlanSolve); if it does not fit into m_memLimit,
+     *   nothing is solved and N is zero.
      */
     void SolveSystem();
 
+    /** Estimate memory and runtime of the solver paths for the current
+     *   mesh and choose one (see SolvePlanner). Nothing large is allocated.
+     * \param plan
+     * \return  false if the solve has to be refused
+     */
+    bool PlanSolve( SolvePlan &plan );
+
+    /** Number of eigenvalues below sigma for the current mesh
+     *   Uses the Sylvester inertia of K - sigma*M from a sparse LDL^T
+     *   factorization; no eigenvalue problem is solved.
+     *   The plate has no material parameters, hence bounds are eigenvalues,
+     *   not frequencies; mode n resonates at the angular frequency sqrt(lambda_n).
+     *   If K - sigma*M is numerically singular, the inertia is taken at a
+     *   slightly shifted sigma.
+     * \param sigma  in units of the eigenvalues
+     * \return  number of eigenvalues, -1 if there is no mesh or no shift gave a reliable count
+     */
+    int  CountModesBelow( double sigma );
+
+    /** Number of eigenvalues within [sigmaMin,sigmaMax) for the current mesh
+     * \return  number of eigenvalues, -1 if there is no mesh or the count is unreliable
+     */
+    int  CountModesInBand( double sigmaMin, double sigmaMax );
+
+    /** Copy current triangulation into a self-contained mesh
+     * \param mesh
+     */
+    void GetFEMesh( FEMesh &mesh );
+
+    /** Release eigenvalues and eigenmodes of a previous solve
+     *   Used when the mesh was regenerated without solving.
+     */
+    void ResetSolution();
+
+    /** Key of all inputs a stage of the "Calc mesh" pipeline depends on,
+     *   chained over the previous stages.
+     * \param stage
+     * \return  key, zero if there is no mesh
+     */
+    quint64 StageKey( e_stage stage );
+
+    /** A stage is valid if its output was produced with the current inputs.
+     */
+    bool IsStageValid( e_stage stage );
+
+    /** Mark output of stage as produced with the current inputs.
+     */
+    void SetStageValid( e_stage stage );
+
+    /** Invalidate stage and all stages depending on it.
+     */
+    void InvalidateStage( e_stage stage );
+
+    /** Set boundary markers of the mesh vertices from the fixed input
+     *   points without triangulating again. Nothing is done if the dofs
+     *   stage is valid.
+     */
+    void UpdateBoundaryMarkers();
+
+    /** Boundary marker of a mesh vertex with the given tag (see DoTriangulation).
+     */
+    int  MarkerFromTag( int tag );
+
+    /** Save eigenvalues to text file (one 'index eigenvalue' pair per line)
+     * \param filename
+     */
+    bool SaveEigenvalues( QString filename );
+
+    /** Trace the m_numModes lowest eigenvalues over the elastic support stiffness
+     *   From free edges (stiffness zero) over numSteps logarithmically spaced
+     *   values between kappaMax*1e-4 and kappaMax toward clamped edges, by
+     *   EigenContinuation on the current mesh. Only edges with marker 1 are
+     *   supported, as with m_elastSupported. The curves are saved to a text
+     *   file, one 'kappa lambda_0 lambda_1 ...' line per step.
+     * \return  false if there is no mesh or the continuation failed
+     */
+    bool TraceElasticSupport( double kappaMax, int numSteps, QString filename );
+
+    /** Add a geometry parameter of the reduced model.
+     * \param lo  lower bound of the parameter
+     * \param hi  upper bound of the parameter
+     * \return  index of the parameter
+     */
+    int  AddReducedParameter( double lo, double hi );
+
+    /** Let input point 'point' move by mu*dir with parameter value mu.
+     */
+    bool AddReducedMotion( int param, int point, glm::dvec2 dir );
+
+    /** Remove the parameters and the reduced model.
+     */
+    void ClearReducedModel();
+
+    /** Build the reduced model of the m_numModes lowest eigenpairs on the current mesh.
+     *   Mesh nodes on segments follow the motion of their end points, the
+     *   interior nodes are moved by harmonic extension. The eigenpairs are
+     *   solved for 'samples' values per parameter, see ReducedModel.
+     */
+    bool BuildReducedModel( int samples );
+
+    /** Eigenvalues of the reduced model at the parameter values mu.
+     */
+    bool EvaluateReducedModel( const std::vector<double> &mu, std::vector<double> &lambda );
+
+    /** Show the reduced eigenpairs at the parameter values mu on the moved mesh.
+     *   Like a perturbation prediction, the control points are not moved,
+     *   and the next calculation triangulates them again.
+     */
+    bool ShowReducedModel( const std::vector<double> &mu );
+
+    /** Add a point force of amplitude a at p to the harmonic drive.
+     */
+    void AddResponseDrive( glm::dvec2 p, double a );
+
+    /** Uniform pressure of amplitude a over the plate, in addition to the point forces.
+     */
+    void SetResponsePressure( double a );
+
+    /** Add a probe of the transfer functions at p.
+     * \return  index of the probe
+     */
+    int  AddResponseProbe( glm::dvec2 p );
+
+    /** Remove drive and probes.
+     */
+    void ClearResponse();
+
+    /** Save the transfer functions from the drive to the probes (see ForcedResponse)
+     *   for num angular frequencies between omegaMin and omegaMax, one
+     *   'omega Re_0 Im_0 Re_1 Im_1 ...' line per frequency. The modes of
+     *   the current solution with damping ratio m_damping are superposed.
+     * \return  false if there is no solution with eigenvectors
+     */
+    bool SaveTransferFunctions( double omegaMin, double omegaMax, int num, QString filename );
+
+    /** Show the response field at omega instead of the modes.
+     *   The operating deflection shape, the real part of the field at the
+     *   phase of its largest amplitude, is shown as the only mode with
+     *   eigenvalue omega^2. The next calculation solves again.
+     */
+    bool ShowResponse( double omega );
+
+    /** Save the response field at omega, one 'x y Re Im' line per mesh vertex.
+     */
+    bool SaveResponseField( double omega, QString filename );
+
+    /** Save the transfer functions like SaveTransferFunctions, but from
+     *   direct solves of  (K + i omega C - omega^2 M) u = f  with Rayleigh
+     *   damping C = m_rayleighMass*M + m_rayleighStiff*K. The solves are
+     *   replaced by a reduced model of a few expansion points (see KrylovSweep).
+     * \param tol  tolerance of the estimated relative error
+     * \return  false if there is no mesh or the estimate stayed above tol
+     */
+    bool SaveDirectSweep( double omegaMin, double omegaMax, int num, double tol, QString filename );
+
+    /** Signal of the transient drive, see TransientSolver.
+     */
+    void SetTransientSignal( TransientSolver::e_signal type, double p0, double p1 );
+
+    /** Start the transient from rest and show its displacement as the
+     *   only mode. The drive of the forced response is loaded with the
+     *   signal, and the damping is m_rayleighMass*M + m_rayleighStiff*K.
+     *   The time step m_transientStep, if 0, resolves the signal and
+     *   keeps the central differences stable.
+     * \return  false if there is no mesh or the step is unstable
+     */
+    bool StartTransient();
+
+    /** Advance the shown transient by 'duration' simulated time.
+     *   After maxMsec milliseconds the remaining steps are dropped,
+     *   the simulation then runs slower than requested.
+     * \return  false if no transient is shown or the operators changed
+     */
+    bool AdvanceTransient( double duration, int maxMsec = 0 );
+
+    void StopTransient();
+
+    /** The displacement of a running transient is shown. */
+    bool IsTransientShown() const;
+
+    /** Simulated time of the running transient. */
+    double TransientTime() const;
+
+    /** Run the transient from rest for 'duration' and save the signal and
+     *   the displacement at the probes, one 't g u_0 u_1 ...' line per step.
+     *   The last state is shown and can be continued by AdvanceTransient.
+     */
+    bool SaveTransient( double duration, QString filename );
+
+    /** Add mode 'mode' with amplitude and phase to the animated superposition.
+     *   Each mode oscillates with its own frequency: the lowest one with
+     *   m_freq, the others faster by sqrt(ev/ev_lowest). The view shaders
+     *   sum the modes, so a frame costs the same for any mesh size.
+     * \return  false if the superposition is full
+     */
+    bool AddSuperMode( int mode, double amplitude, double phase );
+
+    /** Animate the single mode m_currEV again. */
+    void ClearSuperModes();
+
+    /** Listen to the plate at p, by default at the strike point.
+     */
+    void SetSoundPickup( glm::dvec2 p );
+    void ClearSoundPickup();
+
+    /** Strike the plate at p and play the modes of the solution (see
+     *   ModalSynth) with damping ratio m_damping. The lowest mode sounds
+     *   at m_soundFreq Hz. Strikes while the plate still sounds add up.
+     * \return  false if there is no solution or no audio output
+     */
+    bool StrikeSound( glm::dvec2 p, double amplitude );
+
+    void StopSound();
+
+    /** Strike the plate at p and save 'duration' seconds of its sound
+     *   as a 16 bit mono WAV file with a peak at 90% of full scale.
+     */
+    bool SaveSound( glm::dvec2 p, double duration, QString filename );
+
 #ifdef HAVE_GSL
     gsl_matrix*  deleteElement( gsl_matrix* src, int N, int row, int col );
 #elif defined HAVE_LAPACK || defined HAVE_MAGMA
@@ -109,9 +480,15 @@ public:
 
 protected:
     /** Initialize basis matrices for linear or quadratic ansatz
-     * \param MSize  matrix size
+     * \param MSize     matrix size
+     * \param withMass  allocate mass matrix (not needed if its factor is cached)
+     * \return  false if Stot or Mtot could not be allocated
+     */
+    bool initMatrices( int MSize, bool withMass );
+
+    /** Free Stot and Mtot.
      */
-    void initMatrices( int MSize );
+    void freeMatrices();
 
     /** Compile stiffness and mass matrices
      */
@@ -129,6 +506,161 @@ protected:
     void calc_params( const glm::dvec2 v1, const glm::dvec2 v2, const glm::dvec2 v3,
                       double &a, double &b, double &c, double &J );
 
+    /** Key of everything the reduced mass matrix depends on: mesh,
+     *   fixed vertices, and mass type.
+     * \return  0 if the dofs stage is invalid; the factor is then not cached
+     */
+    quint64 massCacheKey();
+
+    /** Factorize the reduced mass matrix Mtot and keep the factor.
+     *   Consistent mass: Cholesky factor M = U^T U (Mtot is taken over).
+     *   Lumped mass: D^{-1/2} of the diagonal.
+     * \param key  cache key of the mass matrix
+     * \return  false if the mass matrix is not positive definite
+     */
+    bool prepareMass( quint64 key );
+
+    /** Transform K x = lambda M x into a standard problem with the
+     *   cached mass factor: U^{-T} K U^{-1} or D^{-1/2} K D^{-1/2}.
+     * \param scale  D^{-1/2}; eigenvectors of the standard problem have
+     *               to be multiplied by it (one for consistent mass)
+     * \return  false if the generalized problem has to be solved (MAGMA)
+     *          or the transformation failed (GSL, LAPACK)
+     */
+    bool toStandard( std::vector<double> &scale );
+
+    /** Back-transform eigenvectors of the standard problem, x = U^{-1} y.
+     *   Nothing is done for lumped mass (see toStandard).
+     * \param evec  eigenvectors (columns)
+     */
+#ifdef HAVE_GSL
+    void fromStandard( gsl_matrix* evec );
+#elif defined HAVE_LAPACK || defined HAVE_MAGMA
+    void fromStandard( double* evec );
+#endif
+
+    /** Free cached mass factor.
+     */
+    void releaseMassCache();
+
+    /** Mark fixed mesh vertices for the shaders
+     */
+    void markFixedVertices();
+
+    /** Take over a triangulation as current mesh.
+     * \param mesh
+     */
+    void storeTriangulation( const TriMesh &mesh );
+
+    /** Refine the current mesh with triangle (switch 'r').
+     * \param maxAreas  maximum area per triangle, negative: no constraint
+     * \return  false if the mesh was not generated by triangle
+     */
+    bool refineMesh( const std::vector<double> &maxAreas );
+
+    /** Key of the triangulation inputs: geometry and switches.
+     * \param triswitches
+     */
+    quint64 meshKey( const char* triswitches );
+
+    /** Assemble sparse stiffness and mass matrices of the current mesh
+     *   into m_dofs, m_sparseK, and m_sparseM unless the operators stage
+     *   is valid.
+     * \return  false if there is no mesh
+     */
+    bool updateSparseOperators();
+
+    /** Assembly options from the current parameters.
+     */
+    void getFEOptions( FEOptions &opts );
+
+    /** How the mesh nodes follow the input points: node i moves by
+     *   (1-t[i]) u[a[i]] + t[i] u[b[i]], where u is the motion of the
+     *   input points. Nodes off points and segments get a[i] = -1.
+     */
+    void nodeAttachment( const FEMesh &mesh, std::vector<int> &a, std::vector<int> &b, std::vector<double> &t );
+
+    /** Set up m_forced with the modes of the current solution unless it
+     *   is up to date, and load drive, probes, and damping.
+     * \return  false if there is no solution with eigenvectors
+     */
+    bool prepareResponse();
+
+    /** Load vector of the drive and output vectors of the probes over the dofs.
+     * \param L  one column per probe
+     */
+    void responseVectors( const FEMesh &mesh, const DofMap &dofs, const SparseMatrix &M,
+                          std::vector<double> &f, std::vector<double> &L );
+
+    /** Copy the displacement of the transient into the shown mode.
+     */
+    void showTransientFrame();
+
+    /** Load the modes of the solution into synth and excite them by a
+     *   strike at p, see ModalSynth::Strike.
+     * \return  false if there is no solution with eigenvectors
+     */
+    bool strikeSynth( ModalSynth &synth, glm::dvec2 p, double amplitude );
+
+    /** Coarser meshes of the current geometry for multigrid, coarsest first
+     *   The coarsest mesh is triangulated from the input geometry with a
+     *   maximum area of m_maxArea*4^k, every finer one is refined from its
+     *   predecessor with a quarter of the area (switch 'r'). All of them
+     *   are linear; a quadratic mesh gets its own corner mesh as finest
+     *   coarse level.
+     * \param coarse
+     * \return  false if the mesh is too small or was read from file
+     */
+    bool buildMeshHierarchy( std::vector<FEMesh> &coarse );
+
+    /** Set up m_multigrid for the current sparse operators unless it is
+     *   up to date.
+     * \return  false if multigrid is not applicable
+     */
+    bool updateMultigrid();
+
+    /** Solve eigenvalue problem by spectrum slicing
+     */
+    void solveSlicing();
+
+    /** Interpolate the eigenvectors of the last LOBPCG solve from the
+     *   mesh they were computed on onto the current dofs (see Interpolation).
+     * \param X  interpolated eigenvectors, columns of length m_dofs.NumDofs()
+     * \return  number of columns
+     */
+    int  interpolateWarmStart( std::vector<double> &X );
+
+    /** Solve for the lowest m_numModes eigenpairs by LOBPCG
+     *   The eigenvectors of the previous LOBPCG solve are used as start
+     *   vectors, interpolated onto the current mesh if the mesh or the
+     *   fixed points changed in between. If m_useMultigrid is
+     *   set, the multigrid V-cycle preconditions the iteration instead of
+     *   a sparse factorization.
+     */
+    void solveLobpcg();
+
+    /** Store eigenpairs of a sparse solver as solution
+     * \param num     number of eigenpairs
+     * \param lambda  eigenvalues
+     * \param X       eigenvectors over the dofs of m_dofs, num columns
+     */
+    void setSparseSolution( int num, const double* lambda, const double* X );
+
+    /** Give up solving: release matrices and solution, report in status line
+     * \param msg
+     */
+    void failSolve( QString msg );
+
+    /** Print the eigenvalues of the solution to stderr if m_printEV is set.
+     */
+    void printEigenvalues();
+
+    /** Report eigenvector range or eigenvalue range in status line
+     * \param min
+     * \param max
+     */
+    void showSolveStatus( double min, double max );
+
     /** Save stiffness and mass matric to file
      * \param filename
      */
@@ -217,6 +749,33 @@ public:
     bool     m_useDelaunay;
     bool     m_useConvexHull;
     bool     m_elastSupported;
+    double   m_elastStiffness;   //!< Spring stiffness of elastically supported edges
+    bool     m_evOnly;           //!< Compute eigenvalues only, skip eigenvectors
+    bool     m_headless;         //!< No OpenGL context available (batch mode)
+    bool     m_printEV;          //!< Print every eigenvalue of a solve to stderr
+
+    e_solverType  m_solverType;
+    double   m_sliceEvMin;       //!< Lower bound of eigenvalue interval for slicing
+    double   m_sliceEvMax;       //!< Upper bound of eigenvalue interval for slicing
+    int      m_numThreads;       //!< Number of worker threads, 0: number of cores
+    int      m_numModes;         //!< Number of lowest eigenpairs for LOBPCG
+    bool     m_useMultigrid;     //!< Precondition LOBPCG by multigrid
+    int      m_meshParts;        //!< Number of concurrently meshed parts, 0 or 1: none
+    bool     m_livePreview;      //!< Preview the lowest modes while control points are dragged
+    bool     m_progressive;      //!< Solve on coarser meshes first (see SystemView::CalcMesh)
+    int      m_perturbOrder;     //!< Predict eigenvalues while dragging: 0 off, 1 or 2 order
+    double   m_damping;          //!< Modal damping ratio of the forced response and the sound
+    double   m_rayleighMass;     //!< Mass-proportional damping of the direct sweep and the transient
+    double   m_rayleighStiff;    //!< Stiffness-proportional damping of the direct sweep and the transient
+    int      m_transientScheme;  //!< Time integration: 0 Newmark, 1 central differences
+    double   m_transientStep;    //!< Time step of the transient, 0: automatic
+    double   m_transientRate;    //!< Simulated time per second of the animation
+    QList<superMode_t>  m_superModes;  //!< Animated superposition of modes, empty: m_currEV only
+    int      m_soundRate;        //!< Samples per second of the sound
+    double   m_soundFreq;        //!< Frequency in Hz of the lowest mode in the sound
+    e_massType  m_massType;      //!< Consistent or lumped mass matrix
+    int      m_memLimit;         //!< Memory limit in MB, 0: half of the physical memory
+    SolvePlan   m_plan;          //!< Solver plan of the last SolveSystem
 
     int N;
     float *evals;
@@ -227,12 +786,56 @@ public:
     gsl_vector *s1;
     gsl_matrix *Stot;
     gsl_matrix *Mtot;
+    gsl_matrix *m_massFactor;    //!< Cholesky factor of reduced mass matrix
 #elif defined HAVE_LAPACK || defined HAVE_MAGMA
     double *S1,*S2,*S3,*S4,*S5l,*S5q;
     double *s1;
     double *Stot;
     double *Mtot;
+    double *m_massFactor;        //!< Cholesky factor of reduced mass matrix
+#endif
+    std::vector<double> m_massScale;   //!< D^{-1/2} of lumped mass matrix
+    quint64  m_massKey;          //!< Key of cached mass factor, 0: none
+
+    quint64  m_stageKey[e_stage_count];  //!< Input keys of valid stages, 0: invalid
+    quint64  m_meshGeneration;   //!< Counts meshes read from file
+    TriMesh  m_triMesh;          //!< Last output of triangle; its tags tell the origin of the boundary markers
+    quint64  m_meshBaseKey;      //!< Key of the triangulation inputs of the mesh, see meshKey
+    SizeField  m_sizeField;      //!< Local maximum triangle area, empty: none
+    DofMap       m_dofs;         //!< Dof map of the sparse operators
+    SparseMatrix m_sparseK;      //!< Sparse stiffness matrix
+    SparseMatrix m_sparseM;      //!< Sparse mass matrix
+    std::vector<double> m_warmStart;   //!< Eigenvectors of the last LOBPCG solve
+    quint64  m_warmKey;          //!< Dofs key of m_warmStart, 0: none
+    FEMesh   m_warmMesh;         //!< Mesh of m_warmStart
+    DofMap   m_warmDofs;         //!< Dof map of m_warmStart
+    MultigridPreconditioner* m_multigrid;  //!< Multigrid of the sparse operators
+    ShapePerturbation  m_perturbation;     //!< Unperturbed state of BeginPerturbation
+    int         m_perturbPoint;  //!< Input point of the perturbation, -1: none
+    glm::dvec2  m_perturbOrigin; //!< Its position in the unperturbed state
+    QList<reducedParam_t>  m_reducedParams;  //!< Geometry parameters of m_reduced
+    ReducedModel  m_reduced;     //!< Reduced model over m_reducedParams
+    std::vector< std::pair<int,double> >  m_shapeTargets;  //!< Mode index and target eigenvalue
+    QList<int>  m_shapeFixed;    //!< Input points kept in place by OptimizeShape
+    QList<respDrive_t>  m_respDrives;  //!< Point forces of the harmonic drive
+    double      m_respPressure;  //!< Uniform pressure of the harmonic drive
+    QList<glm::dvec2>  m_respProbes;   //!< Probes of the transfer functions
+    ForcedResponse  m_forced;    //!< Modes of the solution for the forced response
+    quint64     m_forcedKey;     //!< Spectrum key of m_forced, 0: none
+    TransientSolver::e_signal  m_transientSignal;  //!< Signal of the transient drive
+    double      m_transientParam[2];   //!< Its parameters
+    TransientSolver*  m_transient;     //!< Running transient, NULL: none
+    quint64     m_transientKey;  //!< Operators key of m_transient
+    float*      m_transientFrame;      //!< evals showing m_transient
+    double      m_transientTarget;     //!< Simulated time requested by AdvanceTransient
+    glm::dvec2  m_soundPickup;   //!< Pickup of the sound
+    bool        m_soundPickupSet;      //!< false: the pickup is at the strike point
+    ModalSynth  m_synth;         //!< Sound played by StrikeSound
+#ifdef HAVE_AUDIO
+    QAudioOutput*      m_audio;        //!< Audio output pulling from m_audioDevice, NULL: none
+    ModalSynthDevice*  m_audioDevice;  //!< Renders m_synth
 #endif
+    quint64  m_multigridKey;     //!< Operators key of m_multigrid, 0: none
 };
 
 #endif // NUMCHLADNI_SYSTEM_DATA_H
@@ -25,6 +25,7 @@
 #include <QFileSystemModel>
 #include <QGridLayout>
 #include <QGroupBox>
+#include <QMessageBox>
 
 SystemView :: SystemView( SystemData* sd, OpenGL* ogl, QWidget *parent )
     : QDockWidget(parent)
@@ -54,117 +55,200 @@ void SystemView::ResetParams() {
     chb_useDelaunay->setChecked(false);
     chb_useQuad->setChecked(true);
     chb_elastSupported->setChecked(false);
+    chb_evOnly->setChecked(false);
+    chb_livePreview->setChecked(false);
+    chb_progressive->setChecked(false);
+    chb_perturb->setChecked(false);
+    cob_solver->setCurrentIndex((int)e_solver_dense);
+    cob_massType->setCurrentIndex((int)e_mass_consistent);
+    led_evMin->setValue(init_slice_ev_min);
+    led_evMax->setValue(init_slice_ev_max);
+    spb_numThreads->setValue(init_num_threads);
+    spb_numModes->setValue(init_num_modes);
+    chb_multigrid->setChecked(false);
+    spb_memLimit->setValue(init_mem_limit);
 
     mData->m_maxArea  = init_max_area;
     mData->m_minAngle = init_min_angle;
     mData->m_useConvexHull = false;
     mData->m_useDelaunay   = false;
     mData->m_useQuad       = true;
+    mData->m_elastStiffness = init_elast_stiffness;
+    mData->m_evOnly        = false;
+    mData->m_livePreview   = false;
+    mData->m_progressive   = false;
+    mData->m_perturbOrder  = 0;
+    mData->m_damping       = init_damping;
+    mData->m_rayleighMass  = 0.0;
+    mData->m_rayleighStiff = 0.0;
+    mData->m_transientScheme = static_cast<int>(TransientSolver::e_scheme_newmark);
+    mData->m_transientStep = 0.0;
+    mData->m_transientRate = init_transient_rate;
+    mData->SetTransientSignal(TransientSolver::e_signal_hammer,1.0,100.0);
+    mData->m_soundRate     = init_sound_rate;
+    mData->m_soundFreq     = init_sound_freq;
+    mData->ClearSoundPickup();
+    mData->m_solverType    = e_solver_dense;
+    mData->m_massType      = e_mass_consistent;
+    mData->m_sliceEvMin    = init_slice_ev_min;
+    mData->m_sliceEvMax    = init_slice_ev_max;
+    mData->m_numThreads    = init_num_threads;
+    mData->m_numModes      = init_num_modes;
+    mData->m_useMultigrid  = false;
+    mData->m_meshParts     = init_mesh_parts;
+    mData->m_memLimit      = init_mem_limit;
 }
 
 // ************************************* public slots ***********************************
 
 void SystemView::CalcMesh() {
-
-#ifndef USE_EXTERN_TRI
-    QString cmdSwitches = QString();
-    cmdSwitches += QString("zp");
-    if (mData->m_useConvexHull) {
-        cmdSwitches += QString("c");
-    }
-    if (mData->m_maxArea>0.0) {
-        cmdSwitches += QString("a%1").arg(mData->m_maxArea);
-    }
-    if (mData->m_minAngle>0.0) {
-        cmdSwitches += QString("q%1").arg(mData->m_minAngle);
-    }
-    if (mData->m_useDelaunay) {
-        cmdSwitches += QString("D");
+    mProgress->Cancel();
+    mProgressStage = -1;
+    if (!triangulate()) {
+        return;
     }
-    if (mData->m_useQuad) {
-        cmdSwitches += QString("o2");
+
+    // TODO: wenn der zu lange dauert, dann abbrechen !!!
+
+    // only stages whose inputs changed since the last run are redone
+    if (mData->IsStageValid(e_stage_spectrum)) {
+        fprintf(stderr,"Spectrum is up to date.\n");
+    } else {
+        QTime time;
+        time.start();
+        mData->SolveSystem();
+        int dt = time.elapsed();
+        fprintf(stderr,"Elapsed time for solving system: %d msec\n",dt);
+        if (!mData->m_plan.feasible && !mData->m_headless) {
+            QMessageBox::warning(this,"Calc mesh",mData->m_plan.message
+                                 + QString("\n\nUse a coarser mesh, the slicing solver with a smaller EV range, or raise the memory limit."));
+        }
     }
-#ifdef BE_VERBOSE
-    std::cerr << cmdSwitches.toStdString() << std::endl;
-#endif // BE_VERBOSE
-    if (!mData->DoTriangulation(cmdSwitches.toStdString().c_str())) {
+
+    updateCurrEV();
+
+    if (mData->m_headless) {
         return;
     }
 
-#else
-    QString cmdSwitches = QString("-p");
-    if (mData->m_useConvexHull) {
-        cmdSwitches += QString("c");
+    // In eigenvalue-only mode there is no eigenvector data to upload;
+    // GenDataTexture then only releases a previous texture.
+    if (!mData->IsStageValid(e_stage_buffers)) {
+        mOpenGL->GenMeshBuffers();
+        mOpenGL->GenDataTexture();
+        mData->SetStageValid(e_stage_buffers);
     }
-    if (mData->m_maxArea>0.0) {
-        cmdSwitches += QString("a%1").arg(mData->m_maxArea);
+    //    cob_viewModus->setCurrentIndex((int)e_view2D);
+
+    mOpenGL->UpdateShaders();
+    mOpenGL->updateGL();
+}
+
+bool SystemView::GenMesh() {
+    if (!triangulate()) {
+        return false;
     }
-    if (mData->m_minAngle>0.0) {
-        cmdSwitches += QString("q%1").arg(mData->m_minAngle);
+    mData->ResetSolution();
+
+    spb_currEV->setRange(0,0);
+    led_currEV->clear();
+
+    if (!mData->m_headless) {
+        mOpenGL->GenMeshBuffers();
+        mOpenGL->GenDataTexture();
+        mOpenGL->UpdateShaders();
+        mOpenGL->updateGL();
     }
-    if (mData->m_useDelaunay) {
-        cmdSwitches += QString(" -D");
+    return true;
+}
+
+bool SystemView::AdaptMesh(double tol, int maxSteps) {
+    if (!triangulate()) {
+        return false;
     }
-    if (mData->m_useQuad) {
-        cmdSwitches += QString(" -o2");
+    bool ok = mData->AdaptMesh(tol,maxSteps);
+    if (!ok) {
+        fprintf(stderr,"Adaptive refinement stopped with the error indicator above %g.\n",tol);
     }
-    std::cerr << cmdSwitches.toStdString() << std::endl;
-
-    // ---------------------------
-    //  save to temporary file
-    // ---------------------------
-    QString tmpFileName = QString("models/tmp.poly");
-    mData->SavePoly(tmpFileName);
-    QProcess genMeshOutside;
+    CalcMesh();
+    return ok;
+}
 
-    // ---------------------------
-    //  solve by external program
-    // ---------------------------
-    QString cmd = QString("../src/Triangle %1 %2").arg(cmdSwitches).arg("models/tmp.poly");
-    genMeshOutside.start(cmd);
-    QByteArray output = genMeshOutside.readAllStandardError();
-    if (!output.isEmpty()) {
-        std::cerr << "error: " << output.data() << std::endl;
+bool SystemView::SetSizeField(QScriptValue func, int res) {
+    glm::dvec2 lo, hi;
+    int nx, ny;
+    if (!func.isFunction() || !mData->SizeFieldGrid(res,lo,hi,nx,ny)) {
+        return false;
     }
-    output = genMeshOutside.readAllStandardOutput();
-    if (!output.isEmpty()) {
-        std::cerr << "output: " << output.data() << std::endl;
-    }
-    genMeshOutside.waitForFinished();
-    fprintf(stderr,"finished\n");
 
-    // ---------------------------
-    // read back generated mesh
-    // ---------------------------
-    if (!mData->ReadNodeAndEleFile(QString("models/tmp.1.node"),QString("models/tmp.1.ele"))) {
-        return;
+    // the script function is sampled once; triangle only sees the grid
+    std::vector<double> values((nx+1)*(ny+1));
+    for(int iy=0; iy<=ny; iy++) {
+        for(int ix=0; ix<=nx; ix++) {
+            QScriptValueList args;
+            args << lo.x + (hi.x-lo.x)*ix/nx << lo.y + (hi.y-lo.y)*iy/ny;
+            double area = func.call(QScriptValue(),args).toNumber();
+            if (!(area>0.0)) {
+                fprintf(stderr,"Size field: invalid area %g at (%d,%d).\n",area,ix,iy);
+                return false;
+            }
+            values[iy*(nx+1) + ix] = area;
+        }
     }
-#endif // USE_EXTERN_TRI
+    mData->m_sizeField.SetGrid(lo,hi,nx,ny,values);
+    return true;
+}
 
-    mData->lcd_numMeshVertices->display(mData->mesh_vertices.size());
-    mData->lcd_numTriangles->display(mData->numTriangles);
+bool SystemView::SetSizeFieldGraded(double minArea, double maxArea, double dist, int res) {
+    return mData->SetGradedSizeField(minArea,maxArea,dist,res);
+}
 
-    // TODO: wenn der zu lange dauert, dann abbrechen !!!
+void SystemView::ClearSizeField() {
+    mData->m_sizeField.Clear();
+}
 
-    QTime time;
-    time.start();
-    mData->SolveSystem();
-    int dt = time.elapsed();
-    fprintf(stderr,"Elapsed time for solving system: %d msec\n",dt);
+QString SystemView::PlanSolve() {
+    if (!triangulate()) {
+        return QString();
+    }
+    SolvePlan plan;
+    mData->PlanSolve(plan);
+    return plan.message;
+}
 
-    mOpenGL->GenMeshBuffers();
-    mOpenGL->GenDataTexture();
-    //    cob_viewModus->setCurrentIndex((int)e_view2D);
+void SystemView::GrabPreview() {
+    // a live preview remeshes anyway
+    mPerturbing = false;
+    if (mData->m_perturbOrder>0 && !mData->m_livePreview && !mData->m_headless) {
+        mPerturbing = mData->BeginPerturbation(mData->m_trackPoint);
+    }
+}
 
-    spb_currEV->setRange(0,mData->N);
-    if (mData->m_currEV>mData->N) {
-        mData->m_currEV = mData->N;
+void SystemView::PreviewMesh() {
+    if (mPerturbing) {
+        showPerturbation();
+        return;
     }
-    int ev = mData->m_currEV;
-    led_currEV->setText(QString("%1").arg(mData->m_eigenvalues[ev],8,'f',4));
+    if (!mData->m_livePreview || mData->m_headless) {
+        return;
+    }
+    // at most one preview request per timer interval; LivePreview drops outdated ones
+    if (!mPreviewTimer->isActive()) {
+        mPreviewTimer->start();
+    }
+}
 
-    mOpenGL->UpdateShaders();
-    mOpenGL->updateGL();
+void SystemView::FinishPreview() {
+    if (mPerturbing) {
+        mData->EndPerturbation();
+        mPerturbing = false;
+    }
+    if (!mData->m_livePreview) {
+        return;
+    }
+    mPreviewTimer->stop();
+    mPreview->Cancel();
+    startCalcMesh();
 }
 
 void SystemView::UpdateView() {
@@ -198,14 +282,18 @@ void SystemView::SetTimer( bool status ) {
 void SystemView::SingleTimeStep() {
     mData->m_timer->setSingleShot(true);
     mData->m_currTime += 10e-3;
-    mOpenGL->updateGL();
+    if (!mData->m_headless) {
+        mOpenGL->updateGL();
+    }
 }
 
 void SystemView::Reset() {
     mData->m_timer->setSingleShot(false);
     mData->m_time.restart();
     mData->m_currTime = 0.0;
-    mOpenGL->updateGL();
+    if (!mData->m_headless) {
+        mOpenGL->updateGL();
+    }
 }
 
 void SystemView::Play() {
@@ -295,6 +383,463 @@ void SystemView::SetElast(bool e) {
     chb_elastSupported->blockSignals(false);
 }
 
+double SystemView::GetElastStiffness() {
+    return mData->m_elastStiffness;
+}
+
+void SystemView::SetElastStiffness(double k) {
+    mData->m_elastStiffness = std::max(0.0,k);
+}
+
+bool SystemView::GetEVOnly() {
+    return mData->m_evOnly;
+}
+
+void SystemView::SetEVOnly(bool e) {
+    mData->m_evOnly = e;
+    chb_evOnly->blockSignals(true);
+    chb_evOnly->setChecked(e);
+    chb_evOnly->blockSignals(false);
+}
+
+bool SystemView::GetPrintEV() {
+    return mData->m_printEV;
+}
+
+void SystemView::SetPrintEV(bool p) {
+    mData->m_printEV = p;
+}
+
+bool SystemView::SaveEigenvalues(QString filename) {
+    return mData->SaveEigenvalues(filename);
+}
+
+bool SystemView::TraceElast(double kappaMax, int numSteps, QString filename) {
+    return mData->TraceElasticSupport(kappaMax,numSteps,filename);
+}
+
+int SystemView::RomParameter(double min, double max) {
+    return mData->AddReducedParameter(min,max);
+}
+
+bool SystemView::RomMotion(int param, int point, double dx, double dy) {
+    // points are counted from 1, as in CM.checkPoint
+    return mData->AddReducedMotion(param,point-1,glm::dvec2(dx,dy));
+}
+
+void SystemView::RomClear() {
+    mData->ClearReducedModel();
+}
+
+bool SystemView::RomBuild(int samples) {
+    if (!triangulate()) {
+        return false;
+    }
+    QTime time;
+    time.start();
+    bool ok = mData->BuildReducedModel(samples);
+    fprintf(stderr,"Elapsed time for building reduced model: %d msec\n",time.elapsed());
+    return ok;
+}
+
+QVariantList SystemView::RomEigenvalues(QVariantList mu) {
+    std::vector<double> values(mu.size()), lambda;
+    for(int k=0; k<mu.size(); k++) {
+        values[k] = mu[k].toDouble();
+    }
+    QVariantList list;
+    if (mData->EvaluateReducedModel(values,lambda)) {
+        for(size_t k=0; k<lambda.size(); k++) {
+            list << lambda[k];
+        }
+    }
+    return list;
+}
+
+bool SystemView::RomShow(QVariantList mu) {
+    std::vector<double> values(mu.size());
+    for(int k=0; k<mu.size(); k++) {
+        values[k] = mu[k].toDouble();
+    }
+    if (!mData->ShowReducedModel(values)) {
+        return false;
+    }
+    updateCurrEV();
+    if (!mData->m_headless) {
+        mOpenGL->GenMeshBuffers();
+        mOpenGL->GenDataTexture();
+        mOpenGL->UpdateShaders();
+        mOpenGL->updateGL();
+    }
+    return true;
+}
+
+void SystemView::OptTarget(int mode, double ev) {
+    mData->AddShapeTarget(mode,ev);
+}
+
+void SystemView::OptFix(int point) {
+    // points are counted from 1, as in CM.checkPoint
+    mData->FixShapePoint(point-1);
+}
+
+void SystemView::OptClear() {
+    mData->ClearShapeTargets();
+}
+
+bool SystemView::Optimize(double tol, int maxSteps) {
+    if (!triangulate()) {
+        return false;
+    }
+    QTime time;
+    time.start();
+    bool ok = mData->OptimizeShape(triSwitches().toStdString().c_str(),tol,maxSteps);
+    fprintf(stderr,"Elapsed time for shape optimization: %d msec\n",time.elapsed());
+    if (!ok) {
+        fprintf(stderr,"Shape optimization stopped above tolerance %g.\n",tol);
+    }
+    if (!mData->m_headless) {
+        mOpenGL->setCtrlPoints();
+    }
+    CalcMesh();
+    return ok;
+}
+
+double SystemView::GetDamping() {
+    return mData->m_damping;
+}
+
+void SystemView::SetDamping(double zeta) {
+    mData->m_damping = std::max(0.0,zeta);
+}
+
+void SystemView::RespDrive(double x, double y, double a) {
+    mData->AddResponseDrive(glm::dvec2(x,y),a);
+}
+
+void SystemView::RespPressure(double a) {
+    mData->SetResponsePressure(a);
+}
+
+int SystemView::RespProbe(double x, double y) {
+    return mData->AddResponseProbe(glm::dvec2(x,y));
+}
+
+void SystemView::RespClear() {
+    mData->ClearResponse();
+}
+
+bool SystemView::RespSweep(double omegaMin, double omegaMax, int num, QString filename) {
+    QTime time;
+    time.start();
+    bool ok = mData->SaveTransferFunctions(omegaMin,omegaMax,num,filename);
+    fprintf(stderr,"Elapsed time for %d frequencies: %d msec\n",num,time.elapsed());
+    return ok;
+}
+
+bool SystemView::RespShow(double omega) {
+    if (!mData->ShowResponse(omega)) {
+        return false;
+    }
+    updateCurrEV();
+    if (!mData->m_headless) {
+        mOpenGL->GenDataTexture();
+        mOpenGL->UpdateShaders();
+        mOpenGL->updateGL();
+    }
+    return true;
+}
+
+bool SystemView::RespSave(double omega, QString filename) {
+    return mData->SaveResponseField(omega,filename);
+}
+
+bool SystemView::RespDirect(double omegaMin, double omegaMax, int num, double tol, QString filename) {
+    if (!triangulate()) {
+        return false;
+    }
+    QTime time;
+    time.start();
+    bool ok = mData->SaveDirectSweep(omegaMin,omegaMax,num,tol,filename);
+    fprintf(stderr,"Elapsed time for %d frequencies: %d msec\n",num,time.elapsed());
+    return ok;
+}
+
+double SystemView::GetRayleighMass() {
+    return mData->m_rayleighMass;
+}
+
+void SystemView::SetRayleighMass(double a) {
+    mData->m_rayleighMass = std::max(0.0,a);
+}
+
+double SystemView::GetRayleighStiff() {
+    return mData->m_rayleighStiff;
+}
+
+void SystemView::SetRayleighStiff(double b) {
+    mData->m_rayleighStiff = std::max(0.0,b);
+}
+
+QString SystemView::GetTransScheme() {
+    return stl_transientScheme[mData->m_transientScheme];
+}
+
+void SystemView::SetTransScheme(QString scheme) {
+    for(int i=0; i<stl_transientScheme.size(); i++) {
+        if (scheme.compare(stl_transientScheme[i],Qt::CaseInsensitive)==0) {
+            mData->m_transientScheme = i;
+            break;
+        }
+    }
+}
+
+double SystemView::GetTransStep() {
+    return mData->m_transientStep;
+}
+
+void SystemView::SetTransStep(double dt) {
+    mData->m_transientStep = std::max(0.0,dt);
+}
+
+double SystemView::GetTransRate() {
+    return mData->m_transientRate;
+}
+
+void SystemView::SetTransRate(double rate) {
+    mData->m_transientRate = std::max(0.0,rate);
+}
+
+void SystemView::TransHammer(double duration) {
+    mData->SetTransientSignal(TransientSolver::e_signal_hammer,duration,0.0);
+}
+
+void SystemView::TransSine(double omega) {
+    mData->SetTransientSignal(TransientSolver::e_signal_sine,omega,0.0);
+}
+
+void SystemView::TransBow(double velocity, double sharpness) {
+    mData->SetTransientSignal(TransientSolver::e_signal_bow,velocity,sharpness);
+}
+
+bool SystemView::TransStart() {
+    if (!triangulate() || !mData->StartTransient()) {
+        return false;
+    }
+    updateCurrEV();
+    if (!mData->m_headless) {
+        mOpenGL->GenMeshBuffers();
+        mOpenGL->GenDataTexture();
+        mOpenGL->UpdateShaders();
+        mOpenGL->updateGL();
+        SetTimer(true);
+    }
+    return true;
+}
+
+void SystemView::TransStop() {
+    mData->StopTransient();
+}
+
+bool SystemView::SuperAdd(int ev, double amplitude, double phase) {
+    bool ok = mData->AddSuperMode(ev,amplitude,phase);
+    if (!mData->m_headless) {
+        mOpenGL->updateGL();
+    }
+    return ok;
+}
+
+void SystemView::SuperClear() {
+    mData->ClearSuperModes();
+    if (!mData->m_headless) {
+        mOpenGL->updateGL();
+    }
+}
+
+int SystemView::GetSoundRate() {
+    return mData->m_soundRate;
+}
+
+void SystemView::SetSoundRate(int rate) {
+    mData->m_soundRate = std::max(1000,rate);
+}
+
+double SystemView::GetSoundFreq() {
+    return mData->m_soundFreq;
+}
+
+void SystemView::SetSoundFreq(double hz) {
+    mData->m_soundFreq = std::max(0.0,hz);
+}
+
+void SystemView::SoundPickup(double x, double y) {
+    mData->SetSoundPickup(glm::dvec2(x,y));
+}
+
+void SystemView::SoundPickupClear() {
+    mData->ClearSoundPickup();
+}
+
+bool SystemView::SoundStrike(double x, double y, double a) {
+    return mData->StrikeSound(glm::dvec2(x,y),a);
+}
+
+void SystemView::SoundStop() {
+    mData->StopSound();
+}
+
+bool SystemView::SoundSave(double x, double y, double duration, QString filename) {
+    QTime time;
+    time.start();
+    bool ok = mData->SaveSound(glm::dvec2(x,y),duration,filename);
+    fprintf(stderr,"Elapsed time for the sound: %d msec\n",time.elapsed());
+    return ok;
+}
+
+bool SystemView::TransRun(double duration, QString filename) {
+    if (!triangulate()) {
+        return false;
+    }
+    QTime time;
+    time.start();
+    bool ok = mData->SaveTransient(duration,filename);
+    fprintf(stderr,"Elapsed time for the transient: %d msec\n",time.elapsed());
+    if (!ok) {
+        return false;
+    }
+    updateCurrEV();
+    if (!mData->m_headless) {
+        mOpenGL->GenMeshBuffers();
+        mOpenGL->GenDataTexture();
+        mOpenGL->UpdateShaders();
+        mOpenGL->updateGL();
+    }
+    return true;
+}
+
+int SystemView::CountModesBelow(double lambda) {
+    return mData->CountModesBelow(lambda);
+}
+
+int SystemView::CountModesInBand(double lambdaMin, double lambdaMax) {
+    return mData->CountModesInBand(lambdaMin,lambdaMax);
+}
+
+QString SystemView::GetSolver() {
+    return stl_solverType[cob_solver->currentIndex()];
+}
+
+void SystemView::SetSolver(QString solver) {
+    for(int i=0; i<stl_solverType.size(); i++) {
+        if (solver.compare(stl_solverType[i],Qt::CaseInsensitive)==0) {
+            cob_solver->setCurrentIndex(i);
+            break;
+        }
+    }
+}
+
+QString SystemView::GetMassType() {
+    return stl_massType[cob_massType->currentIndex()];
+}
+
+void SystemView::SetMassType(QString mass) {
+    for(int i=0; i<stl_massType.size(); i++) {
+        if (mass.compare(stl_massType[i],Qt::CaseInsensitive)==0) {
+            cob_massType->setCurrentIndex(i);
+            break;
+        }
+    }
+}
+
+double SystemView::GetEVMin() {
+    return mData->m_sliceEvMin;
+}
+
+void SystemView::SetEVMin(double ev) {
+    mData->m_sliceEvMin = ev;
+    led_evMin->blockSignals(true);
+    led_evMin->setValue(ev);
+    led_evMin->blockSignals(false);
+}
+
+double SystemView::GetEVMax() {
+    return mData->m_sliceEvMax;
+}
+
+void SystemView::SetEVMax(double ev) {
+    mData->m_sliceEvMax = ev;
+    led_evMax->blockSignals(true);
+    led_evMax->setValue(ev);
+    led_evMax->blockSignals(false);
+}
+
+int SystemView::GetNumThreads() {
+    return mData->m_numThreads;
+}
+
+void SystemView::SetNumThreads(int num) {
+    spb_numThreads->setValue(num);
+}
+
+int SystemView::GetNumModes() {
+    return mData->m_numModes;
+}
+
+void SystemView::SetNumModes(int num) {
+    spb_numModes->setValue(num);
+}
+
+bool SystemView::GetMultigrid() {
+    return mData->m_useMultigrid;
+}
+
+void SystemView::SetMultigrid(bool mg) {
+    chb_multigrid->setChecked(mg);
+}
+
+int SystemView::GetMeshParts() {
+    return mData->m_meshParts;
+}
+
+void SystemView::SetMeshParts(int num) {
+    mData->m_meshParts = std::max(0,num);
+}
+
+bool SystemView::GetLivePreview() {
+    return mData->m_livePreview;
+}
+
+void SystemView::SetLivePreview(bool p) {
+    chb_livePreview->setChecked(p);
+}
+
+bool SystemView::GetProgressive() {
+    return mData->m_progressive;
+}
+
+void SystemView::SetProgressive(bool p) {
+    chb_progressive->setChecked(p);
+}
+
+int SystemView::GetPerturbOrder() {
+    return mData->m_perturbOrder;
+}
+
+void SystemView::SetPerturbOrder(int order) {
+    mData->m_perturbOrder = std::max(0,std::min(order,2));
+    chb_perturb->blockSignals(true);
+    chb_perturb->setChecked(mData->m_perturbOrder>0);
+    chb_perturb->blockSignals(false);
+}
+
+int SystemView::GetMemLimit() {
+    return mData->m_memLimit;
+}
+
+void SystemView::SetMemLimit(int mb) {
+    spb_memLimit->setValue(mb);
+}
+
 double SystemView::GetFreq() {
     return mData->m_freq;
 }
@@ -304,7 +849,9 @@ void SystemView::SetFreq(double freq) {
     led_freq->blockSignals(true);
     led_freq->setValue(freq);
     led_freq->blockSignals(false);
-    mOpenGL->updateGL();
+    if (!mData->m_headless) {
+        mOpenGL->updateGL();
+    }
 }
 
 double SystemView::GetScaleFactor() {
@@ -316,7 +863,9 @@ void SystemView::SetScaleFactor(double s) {
     led_scaleFactor->blockSignals(true);
     led_scaleFactor->setValue(s);
     led_scaleFactor->blockSignals(false);
-    mOpenGL->updateGL();
+    if (!mData->m_headless) {
+        mOpenGL->updateGL();
+    }
 }
 
 int SystemView::GetEV() {
@@ -343,14 +892,21 @@ void SystemView::selectViewModus(int idx) {
         mData->m_timer->stop();
     }
     UpdateView();
-    mOpenGL->updateGL();
+    if (!mData->m_headless) {
+        mOpenGL->updateGL();
+    }
     emit emitViewModusChanged();
 }
 
 void SystemView::setCurrEV(int ev) {
     mData->m_currEV = ev;
+    if (mData->m_eigenvalues==NULL || ev>=mData->N) {
+        return;
+    }
     led_currEV->setText(QString("%1").arg(mData->m_eigenvalues[ev],8,'f',4));
-    mOpenGL->updateGL();
+    if (!mData->m_headless) {
+        mOpenGL->updateGL();
+    }
 }
 
 void SystemView::setFreq() {
@@ -367,6 +923,41 @@ void SystemView::setSwitchParams() {
     mData->m_useConvexHull = chb_useConvexHull->isChecked();
     mData->m_useDelaunay = chb_useDelaunay->isChecked();
     mData->m_elastSupported = chb_elastSupported->isChecked();
+    mData->m_evOnly = chb_evOnly->isChecked();
+    mData->m_livePreview = chb_livePreview->isChecked();
+    mData->m_progressive = chb_progressive->isChecked();
+    if (!chb_perturb->isChecked()) {
+        mData->m_perturbOrder = 0;
+    } else if (mData->m_perturbOrder==0) {
+        mData->m_perturbOrder = 1;
+    }
+    if (!mData->m_livePreview) {
+        mPreviewTimer->stop();
+        mPreview->Cancel();
+    }
+}
+
+void SystemView::setSolverParams() {
+    mData->m_solverType = static_cast<e_solverType>(cob_solver->currentIndex());
+    mData->m_massType   = static_cast<e_massType>(cob_massType->currentIndex());
+    mData->m_sliceEvMin = led_evMin->getValue();
+    mData->m_sliceEvMax = led_evMax->getValue();
+    mData->m_numThreads = spb_numThreads->value();
+    mData->m_numModes   = spb_numModes->value();
+    mData->m_useMultigrid = chb_multigrid->isChecked();
+    mData->m_memLimit   = spb_memLimit->value();
+
+    bool slicing = (mData->m_solverType==e_solver_slicing || mData->m_solverType==e_solver_auto);
+    bool lobpcg  = (mData->m_solverType==e_solver_lobpcg);
+    led_evMin->setEnabled(slicing);
+    led_evMax->setEnabled(slicing);
+    spb_numThreads->setEnabled(slicing || lobpcg);
+    spb_numModes->setEnabled(lobpcg);
+    chb_multigrid->setEnabled(lobpcg);
+}
+
+void SystemView::adaptMesh() {
+    AdaptMesh(init_adapt_tol,init_adapt_steps);
 }
 
 void SystemView::setScaleFactor() {
@@ -374,9 +965,103 @@ void SystemView::setScaleFactor() {
     mOpenGL->updateGL();
 }
 
+void SystemView::startPreview() {
+    PreviewInput input;
+    if (mData->GetPreviewInput(input)) {
+        mPreview->Request(input);
+    }
+}
+
+void SystemView::showPreview() {
+    // the drag may have ended meanwhile
+    if (!mData->m_livePreview || mData->m_trackPoint<0) {
+        return;
+    }
+    mData->ApplyPreview(mPreview->Result());
+    mData->lcd_numMeshVertices->display(mData->mesh_vertices.size());
+    mData->lcd_numTriangles->display(mData->numTriangles);
+    updateCurrEV();
+
+    mOpenGL->GenMeshBuffers();
+    mOpenGL->GenDataTexture();
+    mOpenGL->UpdateShaders();
+    mOpenGL->updateGL();
+}
+
+void SystemView::showPerturbation() {
+    if (!mData->PredictPerturbation()) {
+        return;
+    }
+    updateCurrEV();
+    int ev = mData->m_currEV;
+    const std::vector<double> &lambda = mData->m_perturbation.Eigenvalues();
+    if (ev<static_cast<int>(lambda.size())) {
+        mData->led_status->setText(QString("Predicted EV %1: %2 -> %3").arg(ev)
+                                   .arg(lambda[ev],8,'f',4).arg(mData->m_eigenvalues[ev],8,'f',4));
+    }
+    mOpenGL->GenMeshBuffers();
+    mOpenGL->GenDataTexture();
+    mOpenGL->UpdateShaders();
+    mOpenGL->updateGL();
+}
+
+void SystemView::startCalcMesh() {
+    // nothing to show early if the mesh is up to date
+    if (!mData->m_progressive || mData->m_headless || mData->m_maxArea<=0.0
+            || mData->IsMeshValid(triSwitches().toStdString().c_str())) {
+        CalcMesh();
+        return;
+    }
+    mProgress->Cancel();
+    mProgressStage = 0;
+    startProgressStage();
+}
+
+void SystemView::showProgress() {
+    if (mProgressStage<0) {
+        return;
+    }
+    FEMesh mesh;
+    std::vector<double> values;
+    bool haveMode = mData->GetCurrentMode(mesh,values);
+
+    mData->ApplyPreview(mProgress->Result());
+    mData->lcd_numMeshVertices->display(mData->mesh_vertices.size());
+    mData->lcd_numTriangles->display(mData->numTriangles);
+    updateCurrEV();
+    mOpenGL->GenMeshBuffers();
+    mOpenGL->GenDataTexture();
+    mOpenGL->UpdateShaders();
+    if (haveMode) {
+        selectMatchingMode(mesh,values);
+    }
+    mOpenGL->updateGL();
+
+    mProgressStage++;
+    if (mProgressStage<PROGRESSIVE_STAGES) {
+        startProgressStage();
+        return;
+    }
+
+    // the final mesh is solved as usual; LOBPCG starts from the modes of the last stage
+    haveMode = mData->GetCurrentMode(mesh,values);
+    CalcMesh();
+    if (haveMode) {
+        selectMatchingMode(mesh,values);
+    }
+}
+
 // *********************************** protected methods *********************************
 
 void SystemView::init() {
+    mProgress = new LivePreview(this);
+    mProgressStage = -1;
+    mPerturbing = false;
+    mPreview = new LivePreview(this);
+    mPreviewTimer = new QTimer(this);
+    mPreviewTimer->setSingleShot(true);
+    mPreviewTimer->setInterval(init_preview_delay);
+
     initElements();
     initGUI();
     initActions();
@@ -402,8 +1087,62 @@ void SystemView::initElements() {
     chb_useDelaunay = new QCheckBox("Del'ay");
     chb_useDelaunay->setChecked(false);
     pub_calcMesh = new QPushButton("Calc mesh");
+    pub_adaptMesh = new QPushButton("Adapt");
+    pub_adaptMesh->setToolTip("Refine the mesh where the error of the lowest \"Modes\" eigenpairs is large,\nuntil their error indicator is below 1e-3; then solve");
     chb_elastSupported = new QCheckBox("Elast.");
     chb_elastSupported->setChecked(false);
+    chb_evOnly = new QCheckBox("EV only");
+    chb_evOnly->setChecked(false);
+    chb_evOnly->setToolTip("Compute eigenvalues only, without eigenmodes");
+    chb_livePreview = new QCheckBox("Live");
+    chb_livePreview->setChecked(false);
+    chb_progressive = new QCheckBox("Progr.");
+    chb_progressive->setChecked(false);
+    chb_progressive->setToolTip("Calc mesh: show the modes of coarser meshes (16x and 4x MaxArea) first,\nsolved in the background, before the final mesh is solved");
+    chb_perturb = new QCheckBox("Predict");
+    chb_perturb->setChecked(false);
+    chb_perturb->setToolTip("Predict eigenvalues and modes by perturbation theory while a control point\nis dragged, without solving (Ctrl.perturbOrder = 2 for second order)");
+    chb_livePreview->setToolTip("Preview the lowest modes on a coarse mesh while a control point is dragged;\nthe mesh is calculated when the point is released");
+
+    lab_solver = new QLabel("Solver");
+    cob_solver = new QComboBox();
+    cob_solver->addItems(stl_solverType);
+    cob_solver->setToolTip("Dense: all eigenpairs\nSlicing: eigenpairs within EV range, parallel windows\nLOBPCG: lowest eigenpairs, block iteration with warm start\nAuto: faster of Dense and Slicing within the memory limit");
+    lab_massType = new QLabel("Mass");
+    cob_massType = new QComboBox();
+    cob_massType->addItems(stl_massType);
+    cob_massType->setToolTip("Consistent or lumped (diagonal) mass matrix\nLumped mass yields a cheaper standard eigenproblem");
+    lab_evRange = new QLabel("EV range");
+    led_evMin = new DoubleEdit(3,init_slice_ev_min,1.0);
+    led_evMin->setRange(-1e10,1e10);
+    led_evMin->setEnabled(false);
+    led_evMax = new DoubleEdit(3,init_slice_ev_max,1.0);
+    led_evMax->setRange(-1e10,1e10);
+    led_evMax->setEnabled(false);
+    lab_numThreads = new QLabel("Threads");
+    spb_numThreads = new QSpinBox();
+    spb_numThreads->setRange(0,256);
+    spb_numThreads->setSpecialValueText("auto");
+    spb_numThreads->setValue(init_num_threads);
+    spb_numThreads->setEnabled(false);
+    lab_numModes = new QLabel("Modes");
+    spb_numModes = new QSpinBox();
+    spb_numModes->setRange(1,10000);
+    spb_numModes->setValue(init_num_modes);
+    spb_numModes->setEnabled(false);
+    spb_numModes->setToolTip("Number of lowest eigenpairs for LOBPCG");
+    chb_multigrid = new QCheckBox("MG");
+    chb_multigrid->setChecked(false);
+    chb_multigrid->setEnabled(false);
+    chb_multigrid->setToolTip("Precondition LOBPCG by multigrid over coarser meshes\ninstead of a sparse factorization (large meshes)");
+    lab_memLimit = new QLabel("Mem limit");
+    spb_memLimit = new QSpinBox();
+    spb_memLimit->setRange(0,1048576);
+    spb_memLimit->setSingleStep(256);
+    spb_memLimit->setSuffix(" MB");
+    spb_memLimit->setSpecialValueText("auto");
+    spb_memLimit->setValue(init_mem_limit);
+    spb_memLimit->setToolTip("Solving is refused if the estimated peak memory exceeds this limit\nauto: half of the physical memory");
 
     pub_reset = new QPushButton(QIcon(":/back.png"),"");
     pub_reset->setMaximumWidth(30);
@@ -445,9 +1184,33 @@ void SystemView::initGUI() {
     layout_gmesh->addWidget( chb_useQuad,  2, 0 );
     layout_gmesh->addWidget( pub_calcMesh, 2, 1 );
     layout_gmesh->addWidget( chb_elastSupported, 2, 2 );
+    layout_gmesh->addWidget( chb_livePreview, 3, 0 );
+    layout_gmesh->addWidget( chb_progressive, 4, 0 );
+    layout_gmesh->addWidget( chb_perturb, 4, 2 );
+    layout_gmesh->addWidget( pub_adaptMesh, 3, 1 );
+    layout_gmesh->addWidget( chb_evOnly, 3, 2 );
     grb_gmesh->setLayout(layout_gmesh);
 
 
+    QGroupBox* grb_solver = new QGroupBox("Solver");
+    QGridLayout* layout_solver = new QGridLayout();
+    layout_solver->addWidget( lab_solver,  0, 0 );
+    layout_solver->addWidget( cob_solver,  0, 1, 1, 2 );
+    layout_solver->addWidget( lab_massType, 1, 0 );
+    layout_solver->addWidget( cob_massType, 1, 1, 1, 2 );
+    layout_solver->addWidget( lab_evRange, 2, 0 );
+    layout_solver->addWidget( led_evMin,   2, 1 );
+    layout_solver->addWidget( led_evMax,   2, 2 );
+    layout_solver->addWidget( lab_numThreads, 3, 0 );
+    layout_solver->addWidget( spb_numThreads, 3, 1 );
+    layout_solver->addWidget( lab_numModes, 4, 0 );
+    layout_solver->addWidget( spb_numModes, 4, 1 );
+    layout_solver->addWidget( chb_multigrid, 4, 2 );
+    layout_solver->addWidget( lab_memLimit, 5, 0 );
+    layout_solver->addWidget( spb_memLimit, 5, 1 );
+    grb_solver->setLayout(layout_solver);
+
+
     QGroupBox* grb_anim = new QGroupBox("Animate");
     QGridLayout* layout_anim = new QGridLayout();
     layout_anim->addWidget( lab_currEV, 0, 0 );
@@ -463,8 +1226,9 @@ void SystemView::initGUI() {
     grb_anim->setLayout(layout_anim);
 
     layout_complete->addWidget( grb_gmesh, 1, 0, 1, 2 );
-    layout_complete->addWidget( grb_anim, 2, 0, 1, 2);
-    layout_complete->setRowStretch(3,2);
+    layout_complete->addWidget( grb_solver, 2, 0, 1, 2 );
+    layout_complete->addWidget( grb_anim, 3, 0, 1, 2);
+    layout_complete->setRowStretch(4,2);
     layout_complete->setColumnStretch(1,1);
 
     QWidget* centralWidget = new QWidget();
@@ -504,7 +1268,23 @@ void SystemView::initConnect() {
     connect( chb_useConvexHull, SIGNAL(stateChanged(int)), this, SLOT(setSwitchParams()) );
     connect( chb_useDelaunay,   SIGNAL(stateChanged(int)), this, SLOT(setSwitchParams()) );
     connect( chb_elastSupported, SIGNAL(stateChanged(int)), this, SLOT(setSwitchParams()) );
-    connect( pub_calcMesh, SIGNAL(pressed()), this,      SLOT(CalcMesh()) );
+    connect( chb_evOnly, SIGNAL(stateChanged(int)), this, SLOT(setSwitchParams()) );
+    connect( chb_livePreview, SIGNAL(stateChanged(int)), this, SLOT(setSwitchParams()) );
+    connect( chb_progressive, SIGNAL(stateChanged(int)), this, SLOT(setSwitchParams()) );
+    connect( chb_perturb, SIGNAL(stateChanged(int)), this, SLOT(setSwitchParams()) );
+    connect( mPreviewTimer, SIGNAL(timeout()), this, SLOT(startPreview()) );
+    connect( mPreview, SIGNAL(ready()), this, SLOT(showPreview()) );
+    connect( mProgress, SIGNAL(ready()), this, SLOT(showProgress()) );
+    connect( pub_calcMesh, SIGNAL(pressed()), this,      SLOT(startCalcMesh()) );
+    connect( pub_adaptMesh, SIGNAL(pressed()), this,     SLOT(adaptMesh()) );
+    connect( cob_solver, SIGNAL(currentIndexChanged(int)), this, SLOT(setSolverParams()) );
+    connect( cob_massType, SIGNAL(currentIndexChanged(int)), this, SLOT(setSolverParams()) );
+    connect( led_evMin,  SIGNAL(editingFinished()), this, SLOT(setSolverParams()) );
+    connect( led_evMax,  SIGNAL(editingFinished()), this, SLOT(setSolverParams()) );
+    connect( spb_numThreads, SIGNAL(valueChanged(int)), this, SLOT(setSolverParams()) );
+    connect( spb_numModes, SIGNAL(valueChanged(int)), this, SLOT(setSolverParams()) );
+    connect( chb_multigrid, SIGNAL(stateChanged(int)), this, SLOT(setSolverParams()) );
+    connect( spb_memLimit, SIGNAL(valueChanged(int)), this, SLOT(setSolverParams()) );
 
     connect( spb_currEV, SIGNAL(valueChanged(int)), this, SLOT(setCurrEV(int)) );
     connect( led_freq, SIGNAL(editingFinished()), this, SLOT(setFreq()) );
@@ -514,6 +1294,124 @@ void SystemView::initConnect() {
     connect( led_scaleFactor, SIGNAL(editingFinished()), this, SLOT(setScaleFactor()) );
 }
 
+bool SystemView::triangulate() {
+
+#ifndef USE_EXTERN_TRI
+    QString cmdSwitches = triSwitches();
+#ifdef BE_VERBOSE
+    std::cerr << cmdSwitches.toStdString() << std::endl;
+#endif // BE_VERBOSE
+    if (!mData->DoTriangulation(cmdSwitches.toStdString().c_str())) {
+        return false;
+    }
+
+#else
+    QString cmdSwitches = QString("-p");
+    if (mData->m_useConvexHull) {
+        cmdSwitches += QString("c");
+    }
+    if (mData->m_maxArea>0.0) {
+        cmdSwitches += QString("a%1").arg(mData->m_maxArea);
+    }
+    if (mData->m_minAngle>0.0) {
+        cmdSwitches += QString("q%1").arg(mData->m_minAngle);
+    }
+    if (mData->m_useDelaunay) {
+        cmdSwitches += QString(" -D");
+    }
+    if (mData->m_useQuad) {
+        cmdSwitches += QString(" -o2");
+    }
+    std::cerr << cmdSwitches.toStdString() << std::endl;
+
+    // ---------------------------
+    //  save to temporary file
+    // ---------------------------
+    QString tmpFileName = QString("models/tmp.poly");
+    mData->SavePoly(tmpFileName);
+    QProcess genMeshOutside;
+
+    // ---------------------------
+    //  solve by external program
+    // ---------------------------
+    QString cmd = QString("../src/Triangle %1 %2").arg(cmdSwitches).arg("models/tmp.poly");
+    genMeshOutside.start(cmd);
+    QByteArray output = genMeshOutside.readAllStandardError();
+    if (!output.isEmpty()) {
+        std::cerr << "error: " << output.data() << std::endl;
+    }
+    output = genMeshOutside.readAllStandardOutput();
+    if (!output.isEmpty()) {
+        std::cerr << "output: " << output.data() << std::endl;
+    }
+    genMeshOutside.waitForFinished();
+    fprintf(stderr,"finished\n");
+
+    // ---------------------------
+    // read back generated mesh
+    // ---------------------------
+    if (!mData->ReadNodeAndEleFile(QString("models/tmp.1.node"),QString("models/tmp.1.ele"))) {
+        return false;
+    }
+#endif // USE_EXTERN_TRI
+
+    mData->lcd_numMeshVertices->display(mData->mesh_vertices.size());
+    mData->lcd_numTriangles->display(mData->numTriangles);
+    return true;
+}
+
+QString SystemView::triSwitches() {
+    QString cmdSwitches = QString();
+    cmdSwitches += QString("zp");
+    if (mData->m_useConvexHull) {
+        cmdSwitches += QString("c");
+    }
+    if (mData->m_maxArea>0.0) {
+        cmdSwitches += QString("a%1").arg(mData->m_maxArea);
+    }
+    if (mData->m_minAngle>0.0) {
+        cmdSwitches += QString("q%1").arg(mData->m_minAngle);
+    }
+    if (mData->m_useDelaunay) {
+        cmdSwitches += QString("D");
+    }
+    if (mData->m_useQuad) {
+        cmdSwitches += QString("o2");
+    }
+    return cmdSwitches;
+}
+
+void SystemView::startProgressStage() {
+    PreviewInput input;
+    double factor = std::pow(PROGRESSIVE_AREA_FACTOR,PROGRESSIVE_STAGES-mProgressStage);
+    if (!mData->GetPreviewInput(input,factor)) {
+        CalcMesh();
+        return;
+    }
+    mData->led_status->setText(QString("Progressive solve: stage %1 of %2").arg(mProgressStage+1).arg(PROGRESSIVE_STAGES+1));
+    mProgress->Request(input);
+}
+
+void SystemView::selectMatchingMode( const FEMesh &mesh, const std::vector<double> &values ) {
+    int ev = mData->MatchMode(mesh,values);
+    if (ev>=0 && ev<mData->N) {
+        spb_currEV->setValue(ev);
+    }
+}
+
+void SystemView::updateCurrEV() {
+    spb_currEV->setRange(0,std::max(mData->N-1,0));
+    if (mData->m_currEV>=mData->N) {
+        mData->m_currEV = std::max(mData->N-1,0);
+    }
+    int ev = mData->m_currEV;
+    if (mData->N>0 && mData->m_eigenvalues!=NULL) {
+        led_currEV->setText(QString("%1").arg(mData->m_eigenvalues[ev],8,'f',4));
+    } else {
+        led_currEV->clear();
+    }
+}
+
 QSize SystemView::sizeHint() const {
     return QSize(100,50);
 }
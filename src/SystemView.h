@@ -23,6 +23,7 @@
 #define NUMCHLADNI_SYSTEM_VIEW_H
 
 #include "DoubleEdit.h"
+#include "LivePreview.h"
 #include "OpenGL.h"
 #include "SystemData.h"
 
@@ -31,8 +32,10 @@
 #include <QDockWidget>
 #include <QLabel>
 #include <QPushButton>
+#include <QScriptValue>
 #include <QSpinBox>
 #include <QSortFilterProxyModel>
+#include <QVariantList>
 
 /**
  * @brief The SystemView class
@@ -47,6 +50,29 @@ class SystemView : public QDockWidget
     Q_PROPERTY( bool     chull     READ GetCHull        WRITE  SetCHull )
     Q_PROPERTY( bool     delay     READ GetDelaunay     WRITE  SetDelaunay )
     Q_PROPERTY( bool     elast     READ GetElast        WRITE  SetElast )
+    Q_PROPERTY( double   elastStiffness  READ GetElastStiffness  WRITE  SetElastStiffness )
+    Q_PROPERTY( bool     evOnly    READ GetEVOnly       WRITE  SetEVOnly )
+    Q_PROPERTY( bool     printEV   READ GetPrintEV      WRITE  SetPrintEV )
+    Q_PROPERTY( QString  solver    READ GetSolver       WRITE  SetSolver )
+    Q_PROPERTY( QString  mass      READ GetMassType     WRITE  SetMassType )
+    Q_PROPERTY( double   evMin     READ GetEVMin        WRITE  SetEVMin )
+    Q_PROPERTY( double   evMax     READ GetEVMax        WRITE  SetEVMax )
+    Q_PROPERTY( int      numThreads  READ GetNumThreads  WRITE  SetNumThreads )
+    Q_PROPERTY( int      numModes  READ GetNumModes     WRITE  SetNumModes )
+    Q_PROPERTY( bool     multigrid READ GetMultigrid    WRITE  SetMultigrid )
+    Q_PROPERTY( int      meshParts READ GetMeshParts    WRITE  SetMeshParts )
+    Q_PROPERTY( bool     livePreview  READ GetLivePreview  WRITE  SetLivePreview )
+    Q_PROPERTY( bool     progressive  READ GetProgressive  WRITE  SetProgressive )
+    Q_PROPERTY( int      perturbOrder READ GetPerturbOrder WRITE  SetPerturbOrder )
+    Q_PROPERTY( int      memLimit  READ GetMemLimit     WRITE  SetMemLimit )
+    Q_PROPERTY( double   damping   READ GetDamping      WRITE  SetDamping )
+    Q_PROPERTY( double   rayleighMass   READ GetRayleighMass   WRITE  SetRayleighMass )
+    Q_PROPERTY( double   rayleighStiff  READ GetRayleighStiff  WRITE  SetRayleighStiff )
+    Q_PROPERTY( QString  transScheme  READ GetTransScheme  WRITE  SetTransScheme )
+    Q_PROPERTY( double   transStep    READ GetTransStep    WRITE  SetTransStep )
+    Q_PROPERTY( double   transRate    READ GetTransRate    WRITE  SetTransRate )
+    Q_PROPERTY( int      soundRate    READ GetSoundRate    WRITE  SetSoundRate )
+    Q_PROPERTY( double   soundFreq    READ GetSoundFreq    WRITE  SetSoundFreq )
     Q_PROPERTY( double   freq      READ GetFreq         WRITE  SetFreq )
     Q_PROPERTY( double   scale     READ GetScaleFactor  WRITE  SetScaleFactor)
     Q_PROPERTY( QString  modus     READ GetViewModus    WRITE  SetViewModus)
@@ -74,6 +100,15 @@ public:
 // ------------ public slots -------------
 public slots:
     void  CalcMesh();
+    bool  GenMesh();
+    bool  AdaptMesh(double tol, int maxSteps);
+    bool  SetSizeField(QScriptValue func, int res);
+    bool  SetSizeFieldGraded(double minArea, double maxArea, double dist, int res);
+    void  ClearSizeField();
+    QString PlanSolve();
+    void  GrabPreview();
+    void  PreviewMesh();
+    void  FinishPreview();
     void  UpdateView();
     void  SetTimer(bool);
     void  SingleTimeStep();
@@ -94,6 +129,87 @@ public slots:
     void   SetDelaunay(bool d);
     bool   GetElast();
     void   SetElast(bool e);
+    double GetElastStiffness();
+    void   SetElastStiffness(double k);
+    bool   GetEVOnly();
+    void   SetEVOnly(bool e);
+    bool   GetPrintEV();
+    void   SetPrintEV(bool p);
+    bool   SaveEigenvalues(QString filename);
+    bool   TraceElast(double kappaMax, int numSteps, QString filename);
+    int    RomParameter(double min, double max);
+    bool   RomMotion(int param, int point, double dx, double dy);
+    void   RomClear();
+    bool   RomBuild(int samples);
+    QVariantList RomEigenvalues(QVariantList mu);
+    bool   RomShow(QVariantList mu);
+    void   OptTarget(int mode, double ev);
+    void   OptFix(int point);
+    void   OptClear();
+    bool   Optimize(double tol, int maxSteps);
+    double GetDamping();
+    void   SetDamping(double zeta);
+    void   RespDrive(double x, double y, double a);
+    void   RespPressure(double a);
+    int    RespProbe(double x, double y);
+    void   RespClear();
+    bool   RespSweep(double omegaMin, double omegaMax, int num, QString filename);
+    bool   RespShow(double omega);
+    bool   RespSave(double omega, QString filename);
+    bool   RespDirect(double omegaMin, double omegaMax, int num, double tol, QString filename);
+    double GetRayleighMass();
+    void   SetRayleighMass(double a);
+    double GetRayleighStiff();
+    void   SetRayleighStiff(double b);
+    QString GetTransScheme();
+    void    SetTransScheme(QString scheme);
+    double GetTransStep();
+    void   SetTransStep(double dt);
+    double GetTransRate();
+    void   SetTransRate(double rate);
+    void   TransHammer(double duration);
+    void   TransSine(double omega);
+    void   TransBow(double velocity, double sharpness);
+    bool   TransStart();
+    void   TransStop();
+    bool   TransRun(double duration, QString filename);
+    bool   SuperAdd(int ev, double amplitude, double phase);
+    void   SuperClear();
+    int    GetSoundRate();
+    void   SetSoundRate(int rate);
+    double GetSoundFreq();
+    void   SetSoundFreq(double hz);
+    void   SoundPickup(double x, double y);
+    void   SoundPickupClear();
+    bool   SoundStrike(double x, double y, double a);
+    void   SoundStop();
+    bool   SoundSave(double x, double y, double duration, QString filename);
+    int    CountModesBelow(double lambda);
+    int    CountModesInBand(double lambdaMin, double lambdaMax);
+    QString GetSolver();
+    void    SetSolver(QString solver);
+    QString GetMassType();
+    void    SetMassType(QString mass);
+    double GetEVMin();
+    void   SetEVMin(double ev);
+    double GetEVMax();
+    void   SetEVMax(double ev);
+    int    GetNumThreads();
+    void   SetNumThreads(int num);
+    int    GetNumModes();
+    void   SetNumModes(int num);
+    bool   GetMultigrid();
+    void   SetMultigrid(bool mg);
+    int    GetMeshParts();
+    void   SetMeshParts(int num);
+    bool   GetLivePreview();
+    void   SetLivePreview(bool p);
+    bool   GetProgressive();
+    void   SetProgressive(bool p);
+    int    GetPerturbOrder();
+    void   SetPerturbOrder(int order);
+    int    GetMemLimit();
+    void   SetMemLimit(int mb);
     double GetFreq();
     void   SetFreq(double freq);
     double GetScaleFactor();
@@ -107,7 +223,14 @@ protected slots:
     void  setCurrEV(int);
     void  setFreq();
     void  setSwitchParams();
+    void  setSolverParams();
+    void  adaptMesh();
     void  setScaleFactor();
+    void  startPreview();
+    void  showPreview();
+    void  showPerturbation();
+    void  startCalcMesh();
+    void  showProgress();
 
 // ------------ signals -------------
 signals:
@@ -135,12 +258,37 @@ protected:
      */
     void initConnect();
 
+    /** Triangulate current geometry with the actual switch parameters.
+     */
+    bool triangulate();
+
+    /** Range of the current eigenvalue after a new solution.
+     */
+    void updateCurrEV();
+
+    /** Solve the next stage of a progressive "Calc mesh" in the background.
+     */
+    void startProgressStage();
+
+    /** Select the mode of the new solution that matches a mode of the previous one.
+     */
+    void selectMatchingMode( const FEMesh &mesh, const std::vector<double> &values );
+
+    /** Switches for the triangle library from the actual parameters.
+     */
+    QString triSwitches();
+
     virtual QSize  sizeHint () const;
  
 // ----------- private attributes ----------
 private:
     SystemData*   mData;
     OpenGL*       mOpenGL;
+    LivePreview*  mPreview;
+    QTimer*       mPreviewTimer;
+    LivePreview*  mProgress;
+    int           mProgressStage;   //!< Stage of a progressive "Calc mesh", -1: none
+    bool          mPerturbing;      //!< Eigenvalues are predicted for the dragged point
 
     QLabel*       lab_viewModus;
     QComboBox*    cob_viewModus;
@@ -152,7 +300,27 @@ private:
     QCheckBox*    chb_useConvexHull;
     QCheckBox*    chb_useDelaunay;
     QCheckBox*    chb_elastSupported;
+    QCheckBox*    chb_evOnly;
+    QCheckBox*    chb_livePreview;
+    QCheckBox*    chb_progressive;
+    QCheckBox*    chb_perturb;
     QPushButton*  pub_calcMesh;
+    QPushButton*  pub_adaptMesh;
+
+    QLabel*       lab_solver;
+    QComboBox*    cob_solver;
+    QLabel*       lab_massType;
+    QComboBox*    cob_massType;
+    QLabel*       lab_evRange;
+    DoubleEdit*   led_evMin;
+    DoubleEdit*   led_evMax;
+    QLabel*       lab_numThreads;
+    QSpinBox*     spb_numThreads;
+    QLabel*       lab_numModes;
+    QSpinBox*     spb_numModes;
+    QCheckBox*    chb_multigrid;
+    QLabel*       lab_memLimit;
+    QSpinBox*     spb_memLimit;
 
     QLabel*       lab_freq;
     DoubleEdit*   led_freq;
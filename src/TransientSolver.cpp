@@ -0,0 +1,372 @@
+/**
+    @file   TransientSolver.cpp
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include "TransientSolver.h"
+
+// below this number of rows, a step of the central differences runs in the calling thread
+static const int minRowsPerThread = 4096;
+
+// power iterations for the largest eigenvalue of the lumped operator
+static const int    stableIterations = 100;
+static const double stableSafety     = 1.1;
+
+/**
+ *  Step of the central differences on the rows [rowBegin,rowEnd):
+ *    a = (g f - K w - alpha D v)/D,  v += dt a,  u += dt v,  w' = u + beta v
+ *  with w = u + beta v of the previous step.
+ */
+class CentralJob : public QRunnable
+{
+public:
+    CentralJob( const SparseMatrix &K, int rowBegin, int rowEnd )
+        : m_K(K), m_rowBegin(rowBegin), m_rowEnd(rowEnd) {
+        setAutoDelete(false);
+        u = v = Kw = wNext = NULL;
+        w = diag = f = NULL;
+        g = dt = alpha = beta = 0.0;
+    }
+
+    virtual void run() {
+        m_K.MultiplyBlock(w,Kw,1,m_rowBegin,m_rowEnd);
+        for(int i=m_rowBegin; i<m_rowEnd; i++) {
+            double vi = v[i] + dt*((g*f[i] - Kw[i])/diag[i] - alpha*v[i]);
+            double ui = u[i] + dt*vi;
+            v[i] = vi;
+            u[i] = ui;
+            wNext[i] = ui + beta*vi;
+        }
+    }
+
+    double*        u;
+    double*        v;
+    double*        Kw;
+    const double*  w;
+    double*        wNext;
+    const double*  diag;
+    const double*  f;
+    double         g;
+    double         dt;
+    double         alpha;
+    double         beta;
+
+private:
+    const SparseMatrix&  m_K;
+    int      m_rowBegin;
+    int      m_rowEnd;
+};
+
+
+TransientSolver::TransientSolver( const SparseMatrix &K, const SparseMatrix &M )
+    : m_K(K), m_M(M) {
+    m_alpha = 0.0;
+    m_beta  = 0.0;
+    m_numThreads = 0;
+    m_fsum = 0.0;
+    m_signal = e_signal_hammer;
+    m_p0 = 1.0;
+    m_p1 = 100.0;
+    m_scheme = e_scheme_newmark;
+    m_dt = 0.0;
+    m_numSteps = 0;
+    m_g = 0.0;
+    m_pool = NULL;
+}
+
+TransientSolver::~TransientSolver() {
+    for(size_t j=0; j<m_jobs.size(); j++) {
+        delete m_jobs[j];
+    }
+    if (m_pool!=NULL) {
+        delete m_pool;
+    }
+}
+
+// ********************************** public methods *****************************
+
+void TransientSolver::SetDamping( double alpha, double beta ) {
+    m_alpha = std::max(0.0,alpha);
+    m_beta  = std::max(0.0,beta);
+}
+
+
+void TransientSolver::SetLumpedMass( const std::vector<double> &diag ) {
+    m_diag = diag;
+}
+
+
+void TransientSolver::SetNumThreads( int num ) {
+    m_numThreads = num;
+}
+
+
+void TransientSolver::SetLoad( const std::vector<double> &f ) {
+    m_f = f;
+    m_f.resize(m_K.Size(),0.0);
+    m_fsum = 0.0;
+    for(size_t i=0; i<m_f.size(); i++) {
+        m_fsum += m_f[i];
+    }
+}
+
+
+void TransientSolver::SetSignal( e_signal type, double p0, double p1 ) {
+    m_signal = type;
+    m_p0 = p0;
+    m_p1 = p1;
+}
+
+
+double TransientSolver::StableTimeStep() {
+    int n = m_K.Size();
+    if (n==0) {
+        return 0.0;
+    }
+    lumpedMass();
+
+    // Gershgorin bound and power iteration for the largest eigenvalue of D^{-1} K
+    double bound = 0.0;
+    for(int r=0; r<n; r++) {
+        double sum = 0.0;
+        for(int k=m_K.m_rowPtr[r]; k<m_K.m_rowPtr[r+1]; k++) {
+            sum += std::fabs(m_K.m_values[k]);
+        }
+        bound = std::max(bound,sum/m_diag[r]);
+    }
+
+    std::vector<double> x(n), Kx(n);
+    for(int i=0; i<n; i++) {
+        x[i] = ((i%2)==0 ? 1.0 : -1.0) + 0.1*std::sin(static_cast<double>(i));
+    }
+    double lambda = 0.0;
+    for(int iter=0; iter<stableIterations; iter++) {
+        m_K.Multiply(&x[0],&Kx[0]);
+        double xKx = vecDot(n,&x[0],&Kx[0]);
+        double xDx = 0.0;
+        for(int i=0; i<n; i++) {
+            xDx += x[i]*m_diag[i]*x[i];
+        }
+        lambda = (xDx>0.0 ? xKx/xDx : 0.0);
+        double nrm = 0.0;
+        for(int i=0; i<n; i++) {
+            x[i] = Kx[i]/m_diag[i];
+            nrm = std::max(nrm,std::fabs(x[i]));
+        }
+        if (nrm==0.0) {
+            break;
+        }
+        vecScale(n,1.0/nrm,&x[0]);
+    }
+    // the Rayleigh quotient approaches the largest eigenvalue from below
+    lambda = std::min(bound,stableSafety*lambda);
+    if (lambda<=0.0) {
+        return 0.0;
+    }
+
+    // 2/omega (sqrt(1+xi^2) - xi) for the damping ratio xi of the highest mode
+    double omega = std::sqrt(lambda);
+    double xi = 0.5*(m_alpha/omega + m_beta*omega);
+    return 2.0/omega*(std::sqrt(1.0+xi*xi) - xi);
+}
+
+
+bool TransientSolver::Start( e_scheme scheme, double dt ) {
+    int n = m_K.Size();
+    m_scheme = scheme;
+    m_dt = dt;
+    m_numSteps = 0;
+    m_g = 0.0;
+    m_u.assign(n,0.0);
+    m_v.assign(n,0.0);
+    m_a.assign(n,0.0);
+    m_tmp.assign(n,0.0);
+    m_f.resize(n,0.0);
+    if (dt<=0.0 || n==0) {
+        return false;
+    }
+
+    if (m_scheme==e_scheme_newmark) {
+        // M a = g(0) f at rest
+        m_g = signal(0.0,&m_v[0]);
+        if (m_g!=0.0) {
+            SkylineLDLT<double> mass;
+            mass.Analyze(m_K);
+            mass.Factorize(m_K,m_M,0.0,1.0);
+            for(int i=0; i<n; i++) {
+                m_tmp[i] = m_g*m_f[i];
+            }
+            mass.Solve(&m_tmp[0],&m_a[0]);
+        }
+
+        // K_eff = K + 2/dt C + 4/dt^2 M
+        double a0 = 4.0/(dt*dt);
+        double a1 = 2.0/dt;
+        m_ldlt.Analyze(m_K);
+        if (!m_ldlt.Factorize(m_K,m_M,1.0 + a1*m_beta,a0 + a1*m_alpha)) {
+            fprintf(stderr,"Transient: singular effective operator.\n");
+            return false;
+        }
+        return true;
+    }
+
+    double dtStable = StableTimeStep();
+    if (dt>dtStable) {
+        fprintf(stderr,"Transient: time step %g beyond the stability limit %g of the central differences.\n",dt,dtStable);
+        return false;
+    }
+    m_w[0].assign(n,0.0);
+    m_w[1].assign(n,0.0);
+
+    for(size_t j=0; j<m_jobs.size(); j++) {
+        delete m_jobs[j];
+    }
+    m_jobs.clear();
+    int numThreads = (m_numThreads>0 ? m_numThreads : QThread::idealThreadCount());
+    int numJobs = std::max(1,std::min(numThreads,n/minRowsPerThread));
+    if (numJobs>1 && m_pool==NULL) {
+        m_pool = new QThreadPool();
+    }
+    if (m_pool!=NULL) {
+        m_pool->setMaxThreadCount(numJobs);
+    }
+    for(int j=0; j<numJobs; j++) {
+        int r0 = static_cast<int>(static_cast<long long>(n)*j/numJobs);
+        int r1 = static_cast<int>(static_cast<long long>(n)*(j+1)/numJobs);
+        CentralJob* job = new CentralJob(m_K,r0,r1);
+        job->u     = &m_u[0];
+        job->v     = &m_v[0];
+        job->Kw    = &m_tmp[0];
+        job->diag  = &m_diag[0];
+        job->f     = &m_f[0];
+        job->dt    = m_dt;
+        job->alpha = m_alpha;
+        job->beta  = m_beta;
+        m_jobs.push_back(job);
+    }
+    return true;
+}
+
+
+void TransientSolver::Step() {
+    if (m_dt<=0.0 || m_u.empty()) {
+        return;
+    }
+    if (m_scheme==e_scheme_newmark) {
+        stepNewmark();
+    } else {
+        stepCentral();
+    }
+    m_numSteps++;
+}
+
+// ********************************* protected methods *****************************
+
+double TransientSolver::signal( double t, const double* v ) const {
+    switch (m_signal) {
+        case e_signal_hammer: {
+            return (t<m_p0 ? std::sin(M_PI*t/m_p0) : 0.0);
+        }
+        case e_signal_sine: {
+            return std::sin(m_p0*t);
+        }
+        case e_signal_bow: {
+            double vm = (m_fsum!=0.0 ? vecDot(m_K.Size(),&m_f[0],v)/m_fsum : 0.0);
+            double x = m_p0 - vm;
+            double a = std::max(m_p1,1e-12);
+            return std::sqrt(2.0*a)*x*std::exp(-a*x*x + 0.5);
+        }
+    }
+    return 0.0;
+}
+
+
+void TransientSolver::lumpedMass() {
+    int n = m_K.Size();
+    if (static_cast<int>(m_diag.size())==n) {
+        return;
+    }
+    m_diag.assign(n,0.0);
+    for(int r=0; r<n; r++) {
+        for(int k=m_M.m_rowPtr[r]; k<m_M.m_rowPtr[r+1]; k++) {
+            m_diag[r] += m_M.m_values[k];
+        }
+    }
+}
+
+
+void TransientSolver::stepNewmark() {
+    // average acceleration: beta = 1/4, gamma = 1/2
+    int n = m_K.Size();
+    double dt = m_dt;
+    double a0 = 4.0/(dt*dt);
+    double a2 = 4.0/dt;
+    double a1 = 2.0/dt;
+
+    m_g = signal((m_numSteps+1)*dt,&m_v[0]);
+
+    // rhs = g f + M (p + alpha q) + beta K q  with  p = a0 u + a2 v + a,  q = a1 u + v
+    std::vector<double> p(n), q(n), rhs(n);
+    for(int i=0; i<n; i++) {
+        q[i] = a1*m_u[i] + m_v[i];
+        p[i] = a0*m_u[i] + a2*m_v[i] + m_a[i] + m_alpha*q[i];
+    }
+    m_M.Multiply(&p[0],&rhs[0]);
+    if (m_beta!=0.0) {
+        m_K.Multiply(&q[0],&m_tmp[0]);
+        vecAxpy(n,m_beta,&m_tmp[0],&rhs[0]);
+    }
+    vecAxpy(n,m_g,&m_f[0],&rhs[0]);
+
+    m_ldlt.Solve(&rhs[0],&m_tmp[0]);
+    for(int i=0; i<n; i++) {
+        double ai = a0*(m_tmp[i] - m_u[i]) - a2*m_v[i] - m_a[i];
+        m_v[i] += 0.5*dt*(m_a[i] + ai);
+        m_a[i] = ai;
+        m_u[i] = m_tmp[i];
+    }
+}
+
+
+void TransientSolver::stepCentral() {
+    m_g = signal(m_numSteps*m_dt,&m_v[0]);
+    std::vector<double> &w = m_w[m_numSteps%2];
+    std::vector<double> &wNext = m_w[(m_numSteps+1)%2];
+    for(size_t j=0; j<m_jobs.size(); j++) {
+        m_jobs[j]->w = &w[0];
+        m_jobs[j]->wNext = &wNext[0];
+        m_jobs[j]->g = m_g;
+    }
+    if (m_jobs.size()==1) {
+        m_jobs[0]->run();
+    } else {
+        for(size_t j=0; j<m_jobs.size(); j++) {
+            m_pool->start(m_jobs[j]);
+        }
+        m_pool->waitForDone();
+    }
+}
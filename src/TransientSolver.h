@@ -0,0 +1,163 @@
+/**
+    @file   TransientSolver.h
+
+    Copyright (c) 2013, Universitaet Stuttgart, VISUS, Thomas Mueller
+
+    This file is part of NumChladni.
+
+    NumChladni is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    NumChladni is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with NumChladni.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMCHLADNI_TRANSIENT_SOLVER_H
+#define NUMCHLADNI_TRANSIENT_SOLVER_H
+
+#include <vector>
+
+#include "SparseMatrix.h"
+#include "SkylineLDLT.h"
+
+class QThreadPool;
+class CentralJob;
+
+/**
+ * @brief Time integration of  M u'' + C u' + K u = g(t) f  from rest.
+ *
+ *   C = alpha M + beta K is Rayleigh damping and f a fixed load vector
+ *   whose amplitude g(t) follows a signal:
+ *     hammer:  g = sin(pi t/T) for t < T, a half-sine pulse of duration T,
+ *     sine:    g = sin(omega t), a loudspeaker drive,
+ *     bow:     g = phi(vb - v), the friction of a bow with velocity vb,
+ *              where v is the load-weighted mean velocity under the bow and
+ *              phi(x) = sqrt(2a) x exp(-a x^2 + 1/2) with a maximum of 1
+ *              at x = 1/sqrt(2a).
+ *   The friction of the bow uses the velocity of the previous step.
+ *
+ *   The implicit Newmark scheme (average acceleration) is unconditionally
+ *   stable; its effective operator is factorized once (SkylineLDLT) and
+ *   a step costs one solve. Explicit central differences with a lumped
+ *   (diagonal) mass need no factorization, but the step must stay below
+ *   the stability limit (StableTimeStep). Their step is a single pass
+ *   over the rows, split among threads, with contiguous loops that the
+ *   compiler vectorizes.
+ */
+class TransientSolver
+{
+public:
+    enum e_scheme {
+        e_scheme_newmark = 0,
+        e_scheme_central
+    };
+
+    enum e_signal {
+        e_signal_hammer = 0,
+        e_signal_sine,
+        e_signal_bow
+    };
+
+    TransientSolver( const SparseMatrix &K, const SparseMatrix &M );
+    ~TransientSolver();
+
+    // --------- public methods -----------
+public:
+    /** Rayleigh damping  C = alpha M + beta K.
+     */
+    void  SetDamping( double alpha, double beta );
+
+    /** Diagonal mass of the central differences, by default the row sums of M.
+     */
+    void  SetLumpedMass( const std::vector<double> &diag );
+
+    /** Number of threads of the central differences, 0: number of cores.
+     */
+    void  SetNumThreads( int num );
+
+    /** Load vector f over the dofs.
+     */
+    void  SetLoad( const std::vector<double> &f );
+
+    /** Signal of the load amplitude.
+     * \param type
+     * \param p0    duration (hammer), angular frequency (sine), or bow velocity (bow)
+     * \param p1    sharpness a of the friction curve (bow)
+     */
+    void  SetSignal( e_signal type, double p0, double p1 = 100.0 );
+
+    /** Largest stable step of the central differences with the lumped mass.
+     */
+    double  StableTimeStep();
+
+    /** Reset to rest at t=0 and prepare the scheme.
+     * \param scheme
+     * \param dt      time step
+     * \return  false if the step is not positive or beyond the stability limit of the central differences
+     */
+    bool  Start( e_scheme scheme, double dt );
+
+    /** Advance by one time step.
+     */
+    void  Step();
+
+    double  Time() const  { return m_numSteps*m_dt; }
+    double  TimeStep() const  { return m_dt; }
+    int     NumSteps() const  { return m_numSteps; }
+
+    /** Load amplitude g of the last step.
+     */
+    double  Signal() const  { return m_g; }
+
+    const std::vector<double>&  Displacement() const  { return m_u; }
+
+    // --------- protected methods -----------
+protected:
+    /** Load amplitude at t for the velocity v.
+     */
+    double  signal( double t, const double* v ) const;
+
+    void  lumpedMass();
+    void  stepNewmark();
+    void  stepCentral();
+
+    // -------- private attributes --------
+private:
+    const SparseMatrix&  m_K;
+    const SparseMatrix&  m_M;
+    double               m_alpha;
+    double               m_beta;
+    int                  m_numThreads;
+
+    std::vector<double>  m_f;
+    double               m_fsum;       //!< sum of the load, weights the mean velocity of the bow
+    e_signal             m_signal;
+    double               m_p0;
+    double               m_p1;
+
+    e_scheme             m_scheme;
+    double               m_dt;
+    int                  m_numSteps;
+    double               m_g;
+
+    std::vector<double>  m_u;
+    std::vector<double>  m_v;          //!< velocity, at half steps for the central differences
+    std::vector<double>  m_a;
+    std::vector<double>  m_tmp;
+
+    SkylineLDLT<double>  m_ldlt;       //!< effective operator of the Newmark scheme
+
+    std::vector<double>  m_diag;       //!< lumped mass
+    std::vector<double>  m_w[2];       //!< u + beta v of the central differences, double buffered
+    QThreadPool*         m_pool;
+    std::vector<CentralJob*>  m_jobs;
+};
+
+#endif // NUMCHLADNI_TRANSIENT_SOLVER_H
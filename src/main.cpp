@@ -31,6 +31,8 @@
 #include <QTextStream>
 
 bool ignoreTessShaderAvail = false;
+bool batchMode = false;
+QString startScript = QString();
 
 bool testParam( int argc, char* argv[], int n, const char* name, const int numParams ) {
     if (strcmp(argv[n],name)==0 && (n+numParams<argc)) {
@@ -47,13 +49,23 @@ bool readCmdLineParams( int argc, char* argv[] ) {
             fprintf(stderr,"NumChladni Help\n-------------\n");
             fprintf(stderr," -h / -help : show this help\n");
             fprintf(stderr," -i         : ignore tess shader availability\n");
+            fprintf(stderr," -s <file>  : execute script file after startup\n");
+            fprintf(stderr," -b         : batch mode, run script given by -s without\n");
+            fprintf(stderr,"              opening the main window and quit afterwards\n");
             fprintf(stderr,"\n");
             return false;
         } else if (testParam(argc,argv,nArg,"-i",0)) {
             ignoreTessShaderAvail = true;
-            break;
+        } else if (testParam(argc,argv,nArg,"-s",1)) {
+            startScript = QString(argv[++nArg]);
+        } else if (testParam(argc,argv,nArg,"-b",0)) {
+            batchMode = true;
         }
     }
+    if (batchMode && startScript==QString()) {
+        fprintf(stderr,"Batch mode needs a script file (-s <file>).\n");
+        return false;
+    }
     return true;
 }
 
@@ -88,6 +100,10 @@ int main( int argc, char *argv[] )
     QLocale::setDefault(QLocale(QLocale::English, QLocale::UnitedStates));
 
     MainWindow w;
+    if (batchMode) {
+        w.SetHeadless();
+        return (w.ExecScriptFile(startScript) ? 0 : 1);
+    }
     w.show();
 
     w.move(350,150);
@@ -96,6 +112,10 @@ int main( int argc, char *argv[] )
     if (ignoreTessShaderAvail) {
         w.IgnoreTessShaderAvailability();
     }
+    if (startScript!=QString()) {
+        app.processEvents();
+        w.ExecScriptFile(startScript);
+    }
     return app.exec();
 }
 
@@ -117,6 +117,39 @@ const double init_min_angle    =  0.0;
 
 const double init_freq  = 1.0;
 
+const double init_slice_ev_min = -1.0e-3;
+const double init_slice_ev_max = 500.0;
+const int    init_num_threads  = 0;
+const int    init_mesh_parts   = 0;        // 0 or 1: triangulate the whole domain at once
+const int    init_num_modes    = 20;
+const int    init_mem_limit    = 0;        // MB, 0: half of the physical memory
+const double init_elast_stiffness = 1.0;   // spring stiffness of elastically supported edges
+const double init_adapt_tol    = 1.0e-3;   // error indicator, see SystemData::AdaptMesh
+const int    init_adapt_steps  = 10;
+const int    init_preview_delay     = 40;    // ms after the last move of a control point
+const int    init_preview_triangles = 400;   // about as many triangles in a live preview
+const int    init_preview_modes     = 6;
+const double init_damping  = 0.01;        // modal damping ratio of the forced response
+const double init_transient_rate = 1.0;     // simulated time per second of the animation
+const int    TRANSIENT_FRAME_MSEC = 30;    // time steps per animation frame at most take that long
+const int    init_sound_rate   = 44100;    // samples per second of the modal sound
+const double init_sound_freq   = 220.0;    // Hz of the lowest mode of the modal sound
+const int    SOUND_BUFFER_MSEC = 50;       // audio buffer, bounds the latency of a strike
+
+const double PLAN_FLOP_RATE    = 1.0e9;    // assumed flops per second and thread
+
+const int    PROGRESSIVE_STAGES      = 2;     // coarser meshes solved before the final one
+const double PROGRESSIVE_AREA_FACTOR = 4.0;   // ratio of maximum areas of successive stages
+
+const int PERTURB_MAX_MODES     = 40;       // modes predicted by perturbation theory
+
+const double OPT_TRUST_RADIUS   = 0.02;     // initial step of the shape optimizer, relative to the geometry size
+
+const int MAX_SUPER_MODES       = 16;       // animated superposition of modes, see superModes in the view shaders
+
+const int MG_MAX_LEVELS        = 8;        // coarser meshes for multigrid
+const int MG_MIN_COARSE_NODES  = 500;      // vertices of the coarsest multigrid mesh
+
 const int MAX_NUM_CTRL_POINTS  = 1000;
 
 enum  e_viewModus {
@@ -178,6 +211,24 @@ typedef struct triIdxT {
     glm::ivec3  a;
 } triIdx_t;
 
+typedef struct reducedParamT {
+    double lo;
+    double hi;
+    QList<int>         points;   // moved input points
+    QList<glm::dvec2>  motion;   // their motion per unit parameter value
+} reducedParam_t;
+
+typedef struct respDriveT {
+    glm::dvec2  pos;
+    double      amplitude;
+} respDrive_t;
+
+typedef struct superModeT {
+    int         mode;
+    double      amplitude;
+    double      phase;       // radians
+} superMode_t;
+
 const double fac_lin[] = {0.5,0.5,0.5,1.0/24.0,1.0/6.0};
 const double ms1_lin[] = {1,-1,0,-1,1,0,0,0,0};
 const double ms2_lin[] = {2,-1,-1,-1,0,1,-1,1,0};
@@ -227,4 +278,43 @@ const QStringList stl_shading = QStringList()
         << "Color/Sign"
         << "barycentric";
 
+enum e_solverType {
+    e_solver_dense = 0,
+    e_solver_slicing,
+    e_solver_lobpcg,
+    e_solver_auto
+};
+
+const QStringList stl_solverType = QStringList()
+        << "Dense"
+        << "Slicing"
+        << "LOBPCG"
+        << "Auto";
+
+enum e_massType {
+    e_mass_consistent = 0,
+    e_mass_rowsum,
+    e_mass_hrz
+};
+
+const QStringList stl_massType = QStringList()
+        << "Consistent"
+        << "Row sum"
+        << "HRZ";
+
+// time integration of the transient, see TransientSolver::e_scheme
+const QStringList stl_transientScheme = QStringList()
+        << "Newmark"
+        << "Central";
+
+// stages of the "Calc mesh" pipeline; each stage depends on the previous ones
+enum e_stage {
+    e_stage_mesh = 0,      //!< triangulation of the input geometry
+    e_stage_dofs,          //!< boundary markers and fixed mesh vertices
+    e_stage_operators,     //!< assembled stiffness and mass matrices
+    e_stage_spectrum,      //!< eigenvalues and eigenmodes
+    e_stage_buffers,       //!< OpenGL mesh buffers and data texture
+    e_stage_count
+};
+
 #endif // NUMCHLADNI_DEFS_H
@@ -644,18 +644,31 @@ struct memorypool {
 };
 
 
+/* NumChladni: the globals below are written by every call of triangulate(). */
+/*   They are kept per thread, so that meshes can be generated concurrently. */
+
+#ifndef TRI_THREADLOCAL
+#if defined(_MSC_VER)
+#define TRI_THREADLOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define TRI_THREADLOCAL __thread
+#else
+#define TRI_THREADLOCAL
+#endif
+#endif
+
 /* Global constants.                                                         */
 
-REAL splitter;       /* Used to split REAL factors for exact multiplication. */
-REAL epsilon;                             /* Floating-point machine epsilon. */
-REAL resulterrbound;
-REAL ccwerrboundA, ccwerrboundB, ccwerrboundC;
-REAL iccerrboundA, iccerrboundB, iccerrboundC;
-REAL o3derrboundA, o3derrboundB, o3derrboundC;
+TRI_THREADLOCAL REAL splitter;  /* Used to split REAL factors for exact multiplication. */
+TRI_THREADLOCAL REAL epsilon;                   /* Floating-point machine epsilon. */
+TRI_THREADLOCAL REAL resulterrbound;
+TRI_THREADLOCAL REAL ccwerrboundA, ccwerrboundB, ccwerrboundC;
+TRI_THREADLOCAL REAL iccerrboundA, iccerrboundB, iccerrboundC;
+TRI_THREADLOCAL REAL o3derrboundA, o3derrboundB, o3derrboundC;
 
 /* Random number seed is not constant, but I've made it global anyway.       */
 
-unsigned long randomseed;                     /* Current random number seed. */
+TRI_THREADLOCAL unsigned long randomseed;     /* Current random number seed. */
 
 
 /* Mesh data structure.  Triangle operates on only one mesh, but the mesh    */
@@ -3351,7 +3364,10 @@ struct behavior *b;
               k++;
             }
             workstring[k] = '\0';
-            setlocale(LC_NUMERIC, "C");
+            /* NumChladni: setlocale is not thread safe; call it only if needed. */
+            if (localeconv()->decimal_point[0] != '.') {
+              setlocale(LC_NUMERIC, "C");
+            }
             //fprintf(stderr,"%s %f\n",workstring,strtod("0,05", (char **) NULL));
             b->minangle = (REAL) strtod(workstring, (char **) NULL);
 	  } else {
@@ -7658,6 +7674,7 @@ struct otri *searchtri;
   VOID **sampleblock;
   char *firsttri;
   struct otri sampletri;
+  struct otri hulltri;                     /* NumChladni, see below. */
   vertex torg, tdest;
   unsigned long alignptr;
   REAL searchdist, dist;
@@ -7784,7 +7801,14 @@ struct otri *searchtri;
   if (ahead < 0.0) {
     /* Turn around so that `searchpoint' is to the left of the */
     /*   edge specified by `searchtri'.                        */
+    otricopy(*searchtri, hulltri);
     symself(*searchtri);
+    /* NumChladni: the sampled triangle may lie on the convex hull, with */
+    /*   `searchpoint' outside of it (e.g. hole points in concavities).  */
+    if (searchtri->tri == m->dummytri) {
+      otricopy(hulltri, *searchtri);
+      return OUTSIDE;
+    }
   } else if (ahead == 0.0) {
     /* Check if `searchpoint' is between `torg' and `tdest'. */
     if (((torg[0] < searchpoint[0]) == (searchpoint[0] < tdest[0])) &&